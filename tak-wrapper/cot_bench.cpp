@@ -0,0 +1,819 @@
+#include "cot_common.h"
+#include "cot_pipeline.h"
+#include "cot_text.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <new>
+
+// Every heap allocation in the process goes through these, so a benchmark
+// can report allocations per event. The benchmarks run on one thread.
+static uint64_t heap_allocations = 0;
+static uint64_t heap_bytes = 0;
+
+void* operator new(size_t size) {
+    heap_allocations++;
+    heap_bytes += size;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+// Out of line so GCC does not pair an inlined free() with operator new
+__attribute__((noinline)) static void heap_free(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept {
+    heap_free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    heap_free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    heap_free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    heap_free(p);
+}
+
+struct BenchOptions {
+    size_t events = 1000;        // Events per corpus
+    uint32_t seed = 42;
+    int repetitions = 5;
+    double min_time_ms = 100.0;  // Per repetition
+    std::string filter;          // Substring of the benchmark name
+    std::string json_file;
+    std::string compare_file;
+    std::string corpus_file;     // Extra "file" corpus, e.g. from cot_corpus
+    double threshold = 0.10;     // Slowdown reported as a regression
+    double max_allocs = -1.0;    // Allocations per event allowed; < 0 = no limit
+    bool list_only = false;
+};
+
+// Keeps results observable so the compiler cannot drop the work
+static volatile size_t bench_sink = 0;
+
+// Micro-benchmarks for the parse, framing and rendering paths.
+//
+// Corpora are generated from a fixed seed with fixed timestamps, so the
+// same options produce byte-identical input on every run and results can
+// be compared across commits. Each benchmark runs one untimed pass, one
+// pass with the allocation counter, then timed repetitions of enough passes
+// to fill min_time_ms; the median repetition is reported.
+class CoTBench {
+private:
+    struct Corpus {
+        std::string name;
+        std::vector<std::string> events;
+        std::string stream;      // All events back to back
+    };
+
+    struct Benchmark {
+        std::string name;
+        size_t events;           // Per pass
+        size_t bytes;            // Input (or output for generators) per pass
+        std::function<void()> pass;
+    };
+
+    struct Result {
+        std::string name;
+        size_t events;
+        double bytes_per_event;
+        double ns_per_event;     // Median repetition
+        double min_ns_per_event;
+        double max_ns_per_event;
+        double mb_per_s;
+        double allocs_per_event;
+        double alloc_bytes_per_event;
+    };
+
+    BenchOptions options;
+    std::vector<Corpus> corpora;
+    std::vector<Benchmark> benchmarks;
+    std::vector<Result> results;
+
+    // Shared state for the benchmark passes
+    CoTCommon::CoTParser parser;
+    CoTCommon::BatchArena arena;
+    std::vector<CoTCommon::CoTObject> objects;
+    std::vector<CoTCommon::CoTObject> sidc_objects;
+    std::vector<std::chrono::system_clock::time_point> timestamps;
+    std::vector<std::string> sidcs;
+    std::vector<std::string> remarks;        // Free text: plain, with XML specials, non-ASCII
+    std::vector<std::string> marked_remarks;
+    std::vector<std::string> unicode_remarks;
+    std::vector<std::string> coordinates;    // lat, lon, hae of each event as in <point>
+    std::vector<CoTCommon::CoTTape> detail_tapes;   // Typical corpus, parsed once
+
+    static std::string format_time(int64_t epoch_s) {
+        time_t tt = static_cast<time_t>(epoch_s);
+        struct tm tm_utc;
+        gmtime_r(&tt, &tm_utc);
+        char buf[32];
+        strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S.000Z", &tm_utc);
+        return buf;
+    }
+
+    void generate_corpora() {
+        static const char* const TYPES[] = {"a-f-G-U-C", "a-h-G-E-V-A", "a-n-A-C-F", "a-u-S", "a-f-G-E-V-C"};
+        static const char* const HOWS[] = {"m-g", "h-e", "m-g", "h-g-i-g-o"};
+        static const char* const TEAMS[] = {"Cyan", "Blue", "Red", "Green", "White"};
+        static const char* const NAMES[] = {"Alpha", "Bravo", "Charlie", "Delta", "Echo", "Foxtrot"};
+        const int64_t base_time = 1714564800;  // 2024-05-01T12:00:00Z
+
+        std::mt19937 gen(options.seed);
+        std::uniform_real_distribution<double> lat_dist(-60.0, 70.0);
+        std::uniform_real_distribution<double> lon_dist(-179.0, 179.0);
+        std::uniform_real_distribution<double> hae_dist(0.0, 3000.0);
+        std::uniform_real_distribution<double> speed_dist(0.0, 40.0);
+        std::uniform_int_distribution<int> pick(0, 1 << 20);
+
+        corpora = {{"small", {}, {}}, {"typical", {}, {}}, {"large", {}, {}}};
+        char num[160];
+        for (size_t i = 0; i < options.events; i++) {
+            int r = pick(gen);
+            double lat = lat_dist(gen);
+            double lon = lon_dist(gen);
+            double hae = hae_dist(gen);
+            std::string time = format_time(base_time + static_cast<int64_t>(i));
+            std::string stale = format_time(base_time + static_cast<int64_t>(i) + 120);
+            std::string type = TYPES[r % 5];
+            std::string how = HOWS[r % 4];
+            std::string team = TEAMS[r % 5];
+            std::string callsign = std::string(NAMES[r % 6]) + "-" + std::to_string(i);
+            snprintf(num, sizeof(num), "lat=\"%.7f\" lon=\"%.7f\" hae=\"%.1f\"", lat, lon, hae);
+            std::string point = std::string("<point ") + num + " ce=\"9999999\" le=\"9999999\"/>";
+
+            // Minimal position report
+            std::string small = "<event version=\"2.0\" uid=\"S-" + std::to_string(i) + "\" type=\"" + type +
+                                "\" how=\"" + how + "\" time=\"" + time + "\" start=\"" + time +
+                                "\" stale=\"" + stale + "\">" + point + "<detail><contact callsign=\"" +
+                                callsign + "\"/></detail></event>";
+
+            // ATAK-style PLI with the usual detail elements
+            snprintf(num, sizeof(num), "%08x-%04x-4%03x-a%03x-%012llx", r, static_cast<int>(i & 0xffff), r & 0xfff,
+                     static_cast<int>(i & 0xfff), static_cast<unsigned long long>(i) * 2654435761ULL);
+            std::string uid = num;
+            snprintf(num, sizeof(num), "<track course=\"%.8f\" speed=\"%.8f\"/>", (r % 36000) / 100.0,
+                     speed_dist(gen));
+            std::string track = num;
+            std::string detail =
+                "<contact endpoint=\"192.168.1." + std::to_string(i % 250) + ":4242:tcp\" callsign=\"" + callsign +
+                "\"/>\n    <uid Droid=\"" + callsign + "\"/>\n    <__group role=\"Team Member\" name=\"" + team +
+                "\"/>\n    <status battery=\"" + std::to_string(r % 100) + "\"/>\n    " + track +
+                "\n    <takv device=\"SAMSUNG SM-G781U\" platform=\"ATAK-CIV\" os=\"31\" version=\"4.8.1.5\"/>"
+                "\n    <precisionlocation altsrc=\"GPS\" geopointsrc=\"GPS\"/>";
+            std::string typical = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                                  "<event version=\"2.0\" uid=\"" + uid + "\" type=\"" + type +
+                                  "\" how=\"" + how + "\" time=\"" + time + "\" start=\"" + time +
+                                  "\" stale=\"" + stale + "\">\n  " + point + "\n  <detail>\n    " + detail +
+                                  "\n  </detail>\n</event>";
+
+            // Route with many waypoints and long remarks (drawings, mission
+            // packages)
+            std::string large = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                                "<event version=\"2.0\" uid=\"" + uid + "-route\" type=\"b-m-r\" how=\"h-e\" time=\"" +
+                                time + "\" start=\"" + time + "\" stale=\"" + stale + "\">\n  " + point +
+                                "\n  <detail>\n    " + detail;
+            for (int w = 0; w < 60; w++) {
+                snprintf(num, sizeof(num),
+                         "\n    <link uid=\"%s-wp%d\" callsign=\"CP%d\" type=\"b-m-p-w\" point=\"%.7f,%.7f,%.1f\" "
+                         "remarks=\"\" relation=\"c\"/>",
+                         uid.c_str(), w, w, lat + w * 0.001, lon + w * 0.0015, hae);
+                large += num;
+            }
+            large += "\n    <remarks>";
+            for (int k = 0; k < 12; k++) {
+                large += "Checkpoint " + std::to_string(k) + ": hold &amp; report &lt;status&gt; to " + callsign +
+                         " before proceeding along the route. ";
+            }
+            large += "</remarks>\n    <strokeColor value=\"-1\"/>\n    <strokeWeight value=\"3.0\"/>"
+                     "\n    <__routeinfo><__navcues/></__routeinfo>\n    <archive/>\n  </detail>\n</event>";
+
+            corpora[0].events.push_back(std::move(small));
+            corpora[1].events.push_back(std::move(typical));
+            corpora[2].events.push_back(std::move(large));
+
+            // Inputs for the rendering benchmarks
+            objects.emplace_back(type, how, lat, lon, hae, callsign, team);
+            snprintf(num, sizeof(num), "%.7f", lat);
+            coordinates.emplace_back(num);
+            snprintf(num, sizeof(num), "%.7f", lon);
+            coordinates.emplace_back(num);
+            snprintf(num, sizeof(num), "%.1f", hae);
+            coordinates.emplace_back(num);
+            timestamps.push_back(std::chrono::system_clock::time_point(
+                std::chrono::milliseconds((base_time + static_cast<int64_t>(i)) * 1000 + r % 1000)));
+        }
+        for (auto& corpus : corpora) {
+            for (const auto& event : corpus.events) {
+                corpus.stream += event;
+                corpus.stream += '\n';
+            }
+        }
+
+        using M = CoTCommon::MilStd2525;
+        static const M::Affiliation AFFILIATIONS[] = {M::Affiliation::FRIEND, M::Affiliation::HOSTILE,
+                                                      M::Affiliation::NEUTRAL, M::Affiliation::UNKNOWN};
+        static const M::BattleDimension DIMENSIONS[] = {M::BattleDimension::LAND_UNIT, M::BattleDimension::AIR,
+                                                        M::BattleDimension::SEA_SURFACE};
+        static const M::FunctionID FUNCTIONS[] = {M::FunctionID::INFANTRY, M::FunctionID::ARMOR,
+                                                  M::FunctionID::ARTILLERY, M::FunctionID::MEDICAL,
+                                                  M::FunctionID::RECONNAISSANCE};
+        static const M::Echelon ECHELONS[] = {M::Echelon::NONE, M::Echelon::SQUAD, M::Echelon::PLATOON,
+                                              M::Echelon::COMPANY};
+        for (size_t i = 0; i < options.events; i++) {
+            std::string sidc = M::generateSIDC(AFFILIATIONS[i % 4], DIMENSIONS[i % 3], M::Status::REALITY,
+                                               FUNCTIONS[i % 5], ECHELONS[i % 4]);
+            const auto& obj = objects[i];
+            sidc_objects.emplace_back(sidc, obj.get_latitude(), obj.get_longitude(), obj.get_hae(),
+                                      obj.get_callsign(), obj.get_team());
+            sidcs.push_back(std::move(sidc));
+        }
+
+        static const char* const WORDS[] = {"moving", "north", "along", "ridge", "at", "grid", "contact",
+                                            "lost", "vehicle", "observed", "request", "resupply"};
+        static const char* const MARKED[] = {"\"Bravo\"", "A&B", "<hold>", "don't", "->"};
+        static const char* const UNICODE[] = {"Привет", "северо-восток", "東京", "Ünterstützung", "ʻokina"};
+        for (size_t i = 0; i < options.events; i++) {
+            std::string plain, marked, unicode;
+            for (size_t w = 0; w < 12; w++) {
+                const char* word = WORDS[(i * 7 + w * 5) % 12];
+                plain.append(word).append(" ");
+                marked.append(w % 4 == 3 ? MARKED[(i + w) % 5] : word).append(" ");
+                unicode.append(w % 4 == 3 ? UNICODE[(i + w) % 5] : word).append(" ");
+            }
+            remarks.push_back(std::move(plain));
+            marked_remarks.push_back(std::move(marked));
+            unicode_remarks.push_back(std::move(unicode));
+        }
+    }
+
+    // First options.events events of a captured or generated stream, framed
+    // the way the listener reads them
+    bool load_corpus_file() {
+        std::ifstream file(options.corpus_file, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open corpus " << options.corpus_file << std::endl;
+            return false;
+        }
+        Corpus corpus{"file", {}, {}};
+        CoTCommon::CoTFramer framer(1024 * 1024);
+        std::vector<char> chunk(65536);
+        while (corpus.events.size() < options.events && file) {
+            file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            framer.append(chunk.data(), static_cast<size_t>(file.gcount()));
+            std::string_view event;
+            while (corpus.events.size() < options.events && framer.next(event)) {
+                corpus.events.emplace_back(event);
+                corpus.stream.append(event.data(), event.size()).append("\n");
+            }
+            framer.compact();
+        }
+        if (corpus.events.empty()) {
+            std::cerr << "No events in corpus " << options.corpus_file << std::endl;
+            return false;
+        }
+        corpora.push_back(std::move(corpus));
+        return true;
+    }
+
+    static size_t total_size(const std::vector<std::string>& items) {
+        size_t bytes = 0;
+        for (const auto& item : items) bytes += item.size();
+        return bytes;
+    }
+
+    void register_benchmarks() {
+        for (const auto& corpus : corpora) {
+            const Corpus* c = &corpus;
+            size_t bytes = total_size(corpus.events);
+
+            benchmarks.push_back({"parse/" + corpus.name, corpus.events.size(), bytes, [this, c] {
+                for (const auto& event : c->events) {
+                    try {
+                        auto msg = parser.parse(event);
+                        bench_sink = bench_sink + msg.uid.size();
+                    } catch (const std::invalid_argument&) {
+                        bench_sink = bench_sink + 1;  // Malformed events in a --corpus file
+                    }
+                }
+            }});
+
+            benchmarks.push_back({"parse_view/" + corpus.name, corpus.events.size(), bytes, [this, c] {
+                CoTCommon::CoTParser::CoTMessageView view;
+                arena.reset();
+                for (const auto& event : c->events) {
+                    if (parser.parse_view(event, view, arena)) {
+                        bench_sink = bench_sink + view.uid.size();
+                    }
+                }
+            }});
+
+            // Feed the stream in socket-sized reads, as the listener does
+            benchmarks.push_back({"frame/" + corpus.name, corpus.events.size(), corpus.stream.size(), [c] {
+                CoTCommon::CoTFramer framer(1024 * 1024);
+                const size_t chunk = 16384;
+                size_t count = 0;
+                for (size_t pos = 0; pos < c->stream.size(); pos += chunk) {
+                    framer.append(c->stream.data() + pos, std::min(chunk, c->stream.size() - pos));
+                    std::string_view event;
+                    while (framer.next(event)) count++;
+                    framer.compact();
+                }
+                bench_sink = bench_sink + count;
+            }});
+        }
+
+        size_t n = objects.size();
+        size_t xml_bytes = 0;
+        size_t sidc_xml_bytes = 0;
+        for (size_t i = 0; i < n; i++) {
+            xml_bytes += objects[i].to_xml().size();
+            sidc_xml_bytes += sidc_objects[i].to_xml().size();
+        }
+        benchmarks.push_back({"to_xml/type", n, xml_bytes, [this] {
+            for (const auto& obj : objects) bench_sink = bench_sink + obj.to_xml().size();
+        }});
+        benchmarks.push_back({"to_xml/sidc", n, sidc_xml_bytes, [this] {
+            for (const auto& obj : sidc_objects) bench_sink = bench_sink + obj.to_xml().size();
+        }});
+
+        benchmarks.push_back({"generate_uuid", n, n * 36, [this] {
+            for (auto& obj : objects) bench_sink = bench_sink + obj.generate_uuid().size();
+        }});
+        benchmarks.push_back({"format_timestamp", n, n * 24, [this] {
+            const auto& obj = objects[0];
+            for (const auto& tp : timestamps) bench_sink = bench_sink + obj.format_timestamp(tp).size();
+        }});
+
+        // Text kernels: escaping on output, UTF-8 validation on input
+        std::vector<std::pair<std::string, const std::vector<std::string>*>> texts = {
+            {"plain", &remarks}, {"marked", &marked_remarks}};
+        for (const auto& text : texts) {
+            const std::vector<std::string>* items = text.second;
+            benchmarks.push_back({"escape/" + text.first, n, total_size(*items), [items] {
+                std::string out;
+                for (const auto& item : *items) {
+                    out.clear();
+                    CoTCommon::append_xml_escaped(out, item);
+                    bench_sink = bench_sink + out.size();
+                }
+            }});
+        }
+        benchmarks.push_back({"utf8/typical", n, total_size(corpora[1].events), [this] {
+            for (const auto& event : corpora[1].events) bench_sink = bench_sink + CoTCommon::is_valid_utf8(event);
+        }});
+        benchmarks.push_back({"utf8/unicode", n, total_size(unicode_remarks), [this] {
+            for (const auto& text : unicode_remarks) bench_sink = bench_sink + CoTCommon::is_valid_utf8(text);
+        }});
+
+        // Detail codecs generated from the extension structs (cot_detail.h)
+        // against the same work written out by hand
+        auto write_generated = [](std::string& out, const CoTCommon::CoTObject& obj) {
+            CoTCommon::ContactDetail contact;
+            contact.callsign = obj.get_callsign();
+            contact.endpoint = "*:-1:stcp";
+            CoTCommon::write_detail(out, contact);
+            CoTCommon::write_detail(out, CoTCommon::GroupDetail{obj.get_team(), "Team Member"});
+            CoTCommon::write_detail(out, CoTCommon::TrackDetail{obj.get_latitude(), obj.get_longitude()});
+            CoTCommon::write_detail(out, CoTCommon::StatusDetail{});
+            CoTCommon::write_detail(out, CoTCommon::RemarksDetail{obj.get_how()});
+        };
+        auto write_handwritten = [](std::string& out, const CoTCommon::CoTObject& obj) {
+            out += "<contact callsign=\"";
+            CoTCommon::append_xml_escaped(out, obj.get_callsign());
+            out += "\" endpoint=\"*:-1:stcp\" phone=\"\"/><__group name=\"";
+            CoTCommon::append_xml_escaped(out, obj.get_team());
+            out += "\" role=\"Team Member\"/><track speed=\"";
+            CoTCommon::append_detail_number(out, obj.get_latitude(), 8);
+            out += "\" course=\"";
+            CoTCommon::append_detail_number(out, obj.get_longitude(), 8);
+            out += "\"/><status readiness=\"true\"/><remarks>";
+            CoTCommon::append_xml_escaped(out, obj.get_how());
+            out += "</remarks>";
+        };
+        std::string detail_xml;
+        for (const auto& obj : objects) write_generated(detail_xml, obj);
+        for (const auto& write : {std::make_pair("detail/write", +write_generated),
+                                  std::make_pair("detail/write_handwritten", +write_handwritten)}) {
+            auto pass = write.second;
+            benchmarks.push_back({write.first, n, detail_xml.size(), [this, pass] {
+                std::string out;
+                for (const auto& obj : objects) {
+                    out.clear();
+                    pass(out, obj);
+                    bench_sink = bench_sink + out.size();
+                }
+            }});
+        }
+
+        // Reads over tapes built once, so only the field decoding is timed.
+        // Both sides look the elements up the same way and decode the same
+        // attributes, entities included.
+        detail_tapes.resize(corpora[1].events.size());
+        for (size_t i = 0; i < detail_tapes.size(); i++) detail_tapes[i].build(corpora[1].events[i]);
+        benchmarks.push_back({"detail/read", n, total_size(corpora[1].events), [this] {
+            arena.reset();
+            using CoTCommon::CoTTape;
+            for (const auto& tape : detail_tapes) {
+                uint32_t detail = tape.child(0, "detail");
+                if (detail == CoTTape::NONE) continue;
+                CoTCommon::ContactDetail contact;
+                CoTCommon::GroupDetail group;
+                CoTCommon::TrackDetail track;
+                uint32_t element = tape.child(detail, "contact");
+                if (element != CoTTape::NONE) CoTCommon::read_detail(tape, element, contact, arena);
+                element = tape.child(detail, "__group");
+                if (element != CoTTape::NONE) CoTCommon::read_detail(tape, element, group, arena);
+                element = tape.child(detail, "track");
+                if (element != CoTTape::NONE) CoTCommon::read_detail(tape, element, track, arena);
+                bench_sink = bench_sink + contact.callsign.size() + contact.endpoint.size() + contact.phone.size() +
+                             group.name.size() + group.role.size() + static_cast<size_t>(track.speed + track.course);
+            }
+        }});
+        benchmarks.push_back({"detail/read_handwritten", n, total_size(corpora[1].events), [this] {
+            using CoTCommon::CoTTape;
+            arena.reset();
+            for (const auto& tape : detail_tapes) {
+                uint32_t detail = tape.child(0, "detail");
+                if (detail == CoTTape::NONE) continue;
+                std::string_view callsign, endpoint, phone, name, role;
+                double speed = 0.0, course = 0.0;
+                uint32_t element = tape.child(detail, "contact");
+                if (element != CoTTape::NONE) {
+                    CoTCommon::parse_detail_string(tape.attribute(element, "callsign"), callsign, arena);
+                    CoTCommon::parse_detail_string(tape.attribute(element, "endpoint"), endpoint, arena);
+                    CoTCommon::parse_detail_string(tape.attribute(element, "phone"), phone, arena);
+                }
+                element = tape.child(detail, "__group");
+                if (element != CoTTape::NONE) {
+                    CoTCommon::parse_detail_string(tape.attribute(element, "name"), name, arena);
+                    CoTCommon::parse_detail_string(tape.attribute(element, "role"), role, arena);
+                }
+                element = tape.child(detail, "track");
+                if (element != CoTTape::NONE) {
+                    CoTCommon::parse_detail_number(tape.attribute(element, "speed"), speed);
+                    CoTCommon::parse_detail_number(tape.attribute(element, "course"), course);
+                }
+                bench_sink = bench_sink + callsign.size() + endpoint.size() + phone.size() + name.size() + role.size() +
+                             static_cast<size_t>(speed + course);
+            }
+        }});
+
+        // <point> decoding: strtod on a NUL-terminated copy (the previous
+        // parser) against decode_point()
+        benchmarks.push_back({"coord/strtod", n, total_size(coordinates), [this] {
+            double sum = 0.0;
+            char buf[64];
+            for (const auto& text : coordinates) {
+                memcpy(buf, text.data(), text.size());
+                buf[text.size()] = '\0';
+                sum += std::strtod(buf, nullptr);
+            }
+            bench_sink = bench_sink + static_cast<size_t>(sum);
+        }});
+        benchmarks.push_back({"coord/decode", n, total_size(coordinates), [this] {
+            double latitude = 0.0, longitude = 0.0, hae = 0.0;
+            CoTCommon::CompactPosition position;
+            for (size_t i = 0; i + 2 < coordinates.size(); i += 3) {
+                CoTCommon::decode_point(coordinates[i], coordinates[i + 1], coordinates[i + 2], {}, {}, latitude,
+                                        longitude, hae, position);
+                bench_sink = bench_sink + static_cast<size_t>(position.lat);
+            }
+        }});
+
+        using M = CoTCommon::MilStd2525;
+        size_t sidc_bytes = total_size(sidcs);
+        benchmarks.push_back({"sidc/generate", n, sidc_bytes, [n] {
+            for (size_t i = 0; i < n; i++) {
+                std::string sidc = M::generateSIDC(i % 2 ? M::Affiliation::FRIEND : M::Affiliation::HOSTILE,
+                                                   M::BattleDimension::LAND_UNIT, M::Status::REALITY,
+                                                   M::FunctionID::INFANTRY, M::Echelon::PLATOON);
+                bench_sink = bench_sink + sidc.size();
+            }
+        }});
+        benchmarks.push_back({"sidc/to_cot_type", n, sidc_bytes, [this] {
+            for (const auto& sidc : sidcs) bench_sink = bench_sink + M::sidcToCoTType(sidc).size();
+        }});
+        benchmarks.push_back({"sidc/describe", n, sidc_bytes, [this] {
+            for (const auto& sidc : sidcs) bench_sink = bench_sink + M::describeSIDC(sidc).size();
+        }});
+        benchmarks.push_back({"sidc/validate", n, sidc_bytes, [this] {
+            for (const auto& sidc : sidcs) bench_sink = bench_sink + M::isValidSIDC(sidc);
+        }});
+
+#ifdef COT_ENABLE_TRACING
+        // Cost of one trace point, off and recording (bytes: one record)
+        benchmarks.push_back({"trace/disabled", n, n * 24, [n] {
+            for (size_t i = 0; i < n; i++) {
+                COT_TRACE_SCOPE("bench");
+                bench_sink = bench_sink + i;
+            }
+        }});
+        benchmarks.push_back({"trace/enabled", n, n * 24, [n] {
+            CoTCommon::Tracer::enable(4096);
+            for (size_t i = 0; i < n; i++) {
+                COT_TRACE_SCOPE("bench");
+                bench_sink = bench_sink + i;
+            }
+            CoTCommon::Tracer::disable();
+        }});
+#endif
+    }
+
+    Result run_benchmark(const Benchmark& bench) {
+        using Clock = std::chrono::steady_clock;
+        bench.pass();  // Warm caches, arenas and the interner
+
+        uint64_t allocations = heap_allocations;
+        uint64_t alloc_bytes = heap_bytes;
+        bench.pass();
+        allocations = heap_allocations - allocations;
+        alloc_bytes = heap_bytes - alloc_bytes;
+
+        // Calibrate passes per repetition against min_time_ms
+        size_t passes = 1;
+        for (;;) {
+            auto start = Clock::now();
+            for (size_t i = 0; i < passes; i++) bench.pass();
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            if (ms >= options.min_time_ms || passes >= (1u << 20)) break;
+            passes = ms <= 0.0 ? passes * 10
+                               : std::max(passes + 1, static_cast<size_t>(passes * options.min_time_ms / ms * 1.1));
+        }
+
+        std::vector<double> samples;
+        for (int rep = 0; rep < options.repetitions; rep++) {
+            auto start = Clock::now();
+            for (size_t i = 0; i < passes; i++) bench.pass();
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            samples.push_back(ns / static_cast<double>(passes * bench.events));
+        }
+        std::sort(samples.begin(), samples.end());
+
+        Result result;
+        result.name = bench.name;
+        result.events = bench.events;
+        result.bytes_per_event = static_cast<double>(bench.bytes) / bench.events;
+        result.ns_per_event = samples[samples.size() / 2];
+        result.min_ns_per_event = samples.front();
+        result.max_ns_per_event = samples.back();
+        result.mb_per_s = result.bytes_per_event / result.ns_per_event * 1000.0;
+        result.allocs_per_event = static_cast<double>(allocations) / bench.events;
+        result.alloc_bytes_per_event = static_cast<double>(alloc_bytes) / bench.events;
+        return result;
+    }
+
+    static void print_row(const Result& r) {
+        printf("%-22s %10.1f %10.1f %9.1f %9.2f %11.1f\n", r.name.c_str(), r.bytes_per_event, r.ns_per_event,
+               r.mb_per_s, r.allocs_per_event, (r.max_ns_per_event - r.min_ns_per_event) / r.ns_per_event * 100.0);
+        fflush(stdout);
+    }
+
+public:
+    explicit CoTBench(const BenchOptions& opts) : options(opts) {
+        options.events = std::max<size_t>(1, options.events);
+        options.repetitions = std::max(1, options.repetitions);
+    }
+
+    bool setup() {
+        generate_corpora();
+        if (!options.corpus_file.empty() && !load_corpus_file()) return false;
+        register_benchmarks();
+        return true;
+    }
+
+    void list() const {
+        for (const auto& bench : benchmarks) {
+            std::cout << bench.name << std::endl;
+        }
+    }
+
+    bool run() {
+        printf("%-22s %10s %10s %9s %9s %11s\n", "benchmark", "bytes/evt", "ns/event", "MB/s", "allocs",
+               "spread %");
+        for (const auto& bench : benchmarks) {
+            if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos) continue;
+            results.push_back(run_benchmark(bench));
+            print_row(results.back());
+        }
+        if (results.empty()) {
+            std::cerr << "No benchmark matches '" << options.filter << "'" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool write_json(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Cannot write " << path << std::endl;
+            return false;
+        }
+        // One benchmark per line, so baselines diff cleanly and --compare
+        // can read them back without a JSON library
+        char line[512];
+        out << "{\n  \"format\": \"cot_bench/1\",\n";
+        out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#ifdef __OPTIMIZE__
+        out << "  \"optimized\": true,\n";
+#else
+        out << "  \"optimized\": false,\n";
+#endif
+        out << "  \"seed\": " << options.seed << ",\n  \"events\": " << options.events << ",\n";
+        out << "  \"repetitions\": " << options.repetitions << ",\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            snprintf(line, sizeof(line),
+                     "    {\"name\": \"%s\", \"events\": %zu, \"bytes_per_event\": %.1f, \"ns_per_event\": %.2f, "
+                     "\"min_ns_per_event\": %.2f, \"max_ns_per_event\": %.2f, \"mb_per_s\": %.2f, "
+                     "\"allocs_per_event\": %.3f, \"alloc_bytes_per_event\": %.1f}%s\n",
+                     r.name.c_str(), r.events, r.bytes_per_event, r.ns_per_event, r.min_ns_per_event,
+                     r.max_ns_per_event, r.mb_per_s, r.allocs_per_event, r.alloc_bytes_per_event,
+                     i + 1 < results.size() ? "," : "");
+            out << line;
+        }
+        out << "  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+
+    // Benchmarks that allocate more than max_allocs per event
+    int over_allocation_limit() const {
+        int over = 0;
+        for (const auto& r : results) {
+            if (r.allocs_per_event > options.max_allocs) {
+                printf("%s: %.2f allocations per event, limit %.2f\n", r.name.c_str(), r.allocs_per_event,
+                       options.max_allocs);
+                over++;
+            }
+        }
+        return over;
+    }
+
+    // Compare against a file written by --json; returns the number of
+    // regressions (slower beyond the threshold, or more allocations)
+    int compare(const std::string& path) const {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Cannot read baseline " << path << std::endl;
+            return -1;
+        }
+        auto number_after = [](const std::string& line, const std::string& key, double& value) {
+            size_t pos = line.find("\"" + key + "\": ");
+            if (pos == std::string::npos) return false;
+            value = std::strtod(line.c_str() + pos + key.size() + 4, nullptr);
+            return true;
+        };
+
+        std::map<std::string, std::pair<double, double>> baseline;
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t pos = line.find("\"name\": \"");
+            if (pos == std::string::npos) continue;
+            pos += 9;
+            size_t end = line.find('"', pos);
+            double ns = 0.0;
+            double allocs = 0.0;
+            if (end == std::string::npos || !number_after(line, "ns_per_event", ns) ||
+                !number_after(line, "allocs_per_event", allocs)) {
+                continue;
+            }
+            baseline[line.substr(pos, end - pos)] = {ns, allocs};
+        }
+
+        int regressions = 0;
+        printf("\nAgainst %s (threshold %.0f%%):\n", path.c_str(), options.threshold * 100.0);
+        printf("%-22s %10s %10s %8s %17s\n", "benchmark", "base ns", "ns/event", "change", "allocs");
+        for (const auto& r : results) {
+            auto it = baseline.find(r.name);
+            if (it == baseline.end()) {
+                printf("%-22s %10s %10.1f %8s\n", r.name.c_str(), "-", r.ns_per_event, "new");
+                continue;
+            }
+            double base_ns = it->second.first;
+            double base_allocs = it->second.second;
+            double change = base_ns > 0.0 ? r.ns_per_event / base_ns - 1.0 : 0.0;
+            bool slower = change > options.threshold;
+            bool more_allocs = r.allocs_per_event > base_allocs + 0.005;
+            char allocs[32];
+            snprintf(allocs, sizeof(allocs), "%.2f -> %.2f", base_allocs, r.allocs_per_event);
+            printf("%-22s %10.1f %10.1f %+7.1f%% %17s%s\n", r.name.c_str(), base_ns, r.ns_per_event,
+                   change * 100.0, allocs,
+                   slower && more_allocs ? "  REGRESSION (time, allocs)"
+                   : slower              ? "  REGRESSION (time)"
+                   : more_allocs         ? "  REGRESSION (allocs)"
+                                         : "");
+            regressions += slower || more_allocs;
+        }
+        return regressions;
+    }
+};
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --filter <text>       Only run benchmarks whose name contains text\n";
+    std::cout << "  --events <n>          Events per corpus (default: 1000)\n";
+    std::cout << "  --seed <n>            Corpus generator seed (default: 42)\n";
+    std::cout << "  --corpus <file>       Also run the parse and frame benchmarks on the first\n";
+    std::cout << "                        --events events of file (e.g. from cot_corpus)\n";
+    std::cout << "  --repetitions <n>     Timed repetitions; the median is reported (default: 5)\n";
+    std::cout << "  --min-time <ms>       Minimum duration of one repetition (default: 100)\n";
+    std::cout << "  --json <file>         Write results as JSON\n";
+    std::cout << "  --compare <file>      Compare with a previous --json file; exit status 2 if\n";
+    std::cout << "                        any benchmark regressed\n";
+    std::cout << "  --threshold <pct>     Slowdown counted as a regression (default: 10)\n";
+    std::cout << "  --max-allocs <n>      Exit status 3 if a benchmark allocates more than n times\n";
+    std::cout << "                        per event (e.g. 0 for the allocation-free parse path)\n";
+    std::cout << "  --list                List benchmark names and exit\n";
+    std::cout << "  --help                Show this help message\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+
+    // Simple argument parsing
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (std::string(argv[i]) == "--events" && i + 1 < argc) {
+            options.events = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--seed" && i + 1 < argc) {
+            options.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (std::string(argv[i]) == "--corpus" && i + 1 < argc) {
+            options.corpus_file = argv[++i];
+        } else if (std::string(argv[i]) == "--repetitions" && i + 1 < argc) {
+            options.repetitions = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--min-time" && i + 1 < argc) {
+            options.min_time_ms = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--json" && i + 1 < argc) {
+            options.json_file = argv[++i];
+        } else if (std::string(argv[i]) == "--compare" && i + 1 < argc) {
+            options.compare_file = argv[++i];
+        } else if (std::string(argv[i]) == "--threshold" && i + 1 < argc) {
+            options.threshold = std::stod(argv[++i]) / 100.0;
+        } else if (std::string(argv[i]) == "--max-allocs" && i + 1 < argc) {
+            options.max_allocs = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--list") {
+            options.list_only = true;
+        } else if (std::string(argv[i]) == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    CoTBench bench(options);
+    if (!bench.setup()) {
+        return 1;
+    }
+    if (options.list_only) {
+        bench.list();
+        return 0;
+    }
+
+    std::cout << "CoT Micro-Benchmarks (C++)\n";
+    std::cout << "==========================\n";
+    std::cout << "Corpora: " << options.events << " events each (seed " << options.seed << "), "
+              << options.repetitions << " repetitions of >= " << options.min_time_ms << " ms\n";
+#ifndef __OPTIMIZE__
+    std::cout << "Warning: built without optimization; configure with -DCMAKE_BUILD_TYPE=Release\n";
+#endif
+    std::cout << std::endl;
+
+    if (!bench.run()) {
+        return 1;
+    }
+    if (!options.json_file.empty()) {
+        if (!bench.write_json(options.json_file)) {
+            return 1;
+        }
+        std::cout << "\nResults written to " << options.json_file << std::endl;
+    }
+    if (!options.compare_file.empty()) {
+        int regressions = bench.compare(options.compare_file);
+        if (regressions < 0) {
+            return 1;
+        }
+        if (regressions > 0) {
+            std::cout << regressions << " regression(s)" << std::endl;
+            return 2;
+        }
+    }
+    if (options.max_allocs >= 0.0 && bench.over_allocation_limit() > 0) {
+        return 3;
+    }
+    return 0;
+}
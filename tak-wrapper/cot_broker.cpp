@@ -0,0 +1,736 @@
+#include "cot_common.h"
+#include "cot_pipeline.h"
+#include <atomic>
+#include <cerrno>
+#include <deque>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+
+
+struct BrokerOptions {
+    std::string bind_address = "0.0.0.0";
+    int tls_port = 8089;     // Needs --cert/--key; 0 = disabled
+    int tcp_port = 8087;     // Plain TCP streaming; 0 = disabled
+    std::string cert_file;
+    std::string key_file;
+    std::string ca_file;     // Require client certificates signed by this CA
+    std::string passphrase;
+    size_t max_clients = 10000;
+    size_t max_queue_bytes = 4 * 1024 * 1024;  // Per client, before eviction
+    double max_lag_s = 10.0;                   // Oldest queued event, before eviction
+    size_t max_event_bytes = 64 * 1024;
+    bool echo = false;       // Also send events back to their sender
+    bool show_stats = false;
+    bool verbose = false;
+};
+
+static std::atomic<bool> broker_stop(false);
+
+// TAK-compatible streaming relay: every CoT event received from one client
+// is sent to all other connected clients.
+//
+// One thread serves all sockets from a level-triggered epoll loop. Each
+// event is copied once into a shared buffer that every recipient's queue
+// references. Queues are bounded by bytes and by age; a client that cannot
+// keep up is disconnected instead of holding back the others or growing
+// without limit.
+class CoTBroker {
+private:
+    using Clock = std::chrono::steady_clock;
+    using Payload = std::shared_ptr<const std::string>;
+
+    struct Outbound {
+        Payload payload;
+        Clock::time_point queued;
+    };
+
+    struct Client {
+        int fd;
+        SSL* ssl;                 // nullptr on the plain TCP port
+        bool handshaking;
+        std::string name;         // Peer address
+        size_t slot;              // Index in clients
+        Clock::time_point connected;
+        CoTCommon::CoTFramer framer;
+        std::deque<Outbound> queue;
+        size_t queued_bytes;
+        size_t head_offset;       // Bytes of queue.front() already written (TCP)
+        std::string tls_record;   // Queued events being written as one TLS write
+        size_t tls_offset;
+        bool want_write;          // EPOLLOUT armed
+        bool dirty;               // Has new events to flush this round
+        bool closing;
+        uint64_t events_in;
+        uint64_t events_out;
+
+        Client(int socket, SSL* tls, size_t max_event_bytes)
+            : fd(socket), ssl(tls), handshaking(tls != nullptr), slot(0), connected(Clock::now()),
+              framer(max_event_bytes), queued_bytes(0), head_offset(0), tls_offset(0), want_write(false),
+              dirty(false), closing(false), events_in(0), events_out(0) {}
+
+        size_t backlog() const { return queued_bytes + tls_record.size() - tls_offset; }
+    };
+
+    struct Counters {
+        uint64_t accepted;
+        uint64_t rejected;       // Over max_clients
+        uint64_t disconnected;
+        uint64_t evicted;        // Slow consumers
+        uint64_t events;
+        uint64_t deliveries;     // Events queued for a recipient
+        uint64_t bytes_in;
+        uint64_t bytes_out;
+    };
+
+    BrokerOptions options;
+    SSL_CTX* ssl_ctx;
+    int epoll_fd;
+    int tls_listen_fd;
+    int tcp_listen_fd;
+
+    std::vector<std::unique_ptr<Client>> clients;
+    std::vector<Client*> dirty;                  // Flushed after each epoll round
+    std::vector<Client*> closed;                 // Removed after each epoll round
+    std::vector<std::unique_ptr<Client>> released;
+    std::vector<char> read_buffer;
+    Counters counters;
+
+    bool init_ssl() {
+        SSL_library_init();
+        SSL_load_error_strings();
+
+        ssl_ctx = SSL_CTX_new(TLS_server_method());
+        if (!ssl_ctx) {
+            std::cerr << "Error creating SSL context\n";
+            ERR_print_errors_fp(stderr);
+            return false;
+        }
+
+        if (!options.passphrase.empty()) {
+            SSL_CTX_set_default_passwd_cb_userdata(ssl_ctx, (void*)options.passphrase.c_str());
+            SSL_CTX_set_default_passwd_cb(ssl_ctx, [](char *buf, int size, int rwflag, void *userdata) -> int {
+                (void)rwflag;
+                const char* pass = static_cast<const char*>(userdata);
+                int len = strlen(pass);
+                if (len > size - 1) len = size - 1;
+                memcpy(buf, pass, len);
+                buf[len] = '\0';
+                return len;
+            });
+        }
+
+        if (SSL_CTX_use_certificate_chain_file(ssl_ctx, options.cert_file.c_str()) <= 0) {
+            std::cerr << "Error loading server certificate: " << options.cert_file << std::endl;
+            ERR_print_errors_fp(stderr);
+            return false;
+        }
+        if (SSL_CTX_use_PrivateKey_file(ssl_ctx, options.key_file.c_str(), SSL_FILETYPE_PEM) <= 0) {
+            std::cerr << "Error loading private key: " << options.key_file << std::endl;
+            ERR_print_errors_fp(stderr);
+            return false;
+        }
+        if (!SSL_CTX_check_private_key(ssl_ctx)) {
+            std::cerr << "Private key does not match certificate\n";
+            return false;
+        }
+
+        // Like a TAK server, require client certificates when a CA is given
+        if (!options.ca_file.empty()) {
+            if (!SSL_CTX_load_verify_locations(ssl_ctx, options.ca_file.c_str(), nullptr)) {
+                std::cerr << "Error loading CA certificate: " << options.ca_file << std::endl;
+                ERR_print_errors_fp(stderr);
+                return false;
+            }
+            SSL_CTX_set_client_CA_list(ssl_ctx, SSL_load_client_CA_file(options.ca_file.c_str()));
+            SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, nullptr);
+        }
+
+        // Writes are retried from the same (possibly moved) buffer after WANT_WRITE
+        SSL_CTX_set_mode(ssl_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+        return true;
+    }
+
+    int open_listener(int port) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, options.bind_address.c_str(), &addr.sin_addr) != 1) {
+            std::cerr << "Invalid bind address: " << options.bind_address << std::endl;
+            return -1;
+        }
+
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            std::cerr << "Error creating socket: " << strerror(errno) << std::endl;
+            return -1;
+        }
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+            std::cerr << "Error listening on " << options.bind_address << ":" << port << ": "
+                      << strerror(errno) << std::endl;
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    bool watch(int fd, void* tag, uint32_t events) {
+        struct epoll_event ev;
+        ev.events = events;
+        ev.data.ptr = tag;
+        return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+
+    void set_write_interest(Client* client, bool enabled) {
+        if (client->want_write == enabled) return;
+        struct epoll_event ev;
+        ev.events = enabled ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.ptr = client;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+        client->want_write = enabled;
+    }
+
+    // Each client needs a descriptor
+    void raise_fd_limit() {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+        rlim_t needed = options.max_clients + 64;
+        if (limit.rlim_cur >= needed) return;
+        limit.rlim_cur = std::min(needed, limit.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur < needed) {
+            std::cerr << "Warning: descriptor limit " << limit.rlim_cur << " allows fewer than "
+                      << options.max_clients << " clients\n";
+        }
+    }
+
+    void accept_clients(int listen_fd, bool tls) {
+        while (true) {
+            struct sockaddr_in addr;
+            socklen_t len = sizeof(addr);
+            int fd = accept4(listen_fd, (struct sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    std::cerr << "Error accepting client: " << strerror(errno) << std::endl;
+                }
+                return;
+            }
+
+            if (clients.size() >= options.max_clients) {
+                counters.rejected++;
+                close(fd);
+                continue;
+            }
+
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+            SSL* ssl = nullptr;
+            if (tls) {
+                ssl = SSL_new(ssl_ctx);
+                if (!ssl) {
+                    close(fd);
+                    continue;
+                }
+                SSL_set_fd(ssl, fd);
+                SSL_set_accept_state(ssl);
+            }
+
+            std::unique_ptr<Client> client(new Client(fd, ssl, options.max_event_bytes));
+            char address[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &addr.sin_addr, address, sizeof(address));
+            client->name = std::string(address) + ":" + std::to_string(ntohs(addr.sin_port));
+            client->slot = clients.size();
+            if (!watch(fd, client.get(), EPOLLIN)) {
+                if (ssl) SSL_free(ssl);
+                close(fd);
+                continue;
+            }
+
+            if (options.verbose) {
+                std::cout << "Client connected: " << client->name << (tls ? " (TLS)" : " (TCP)") << std::endl;
+            }
+            counters.accepted++;
+            clients.push_back(std::move(client));
+        }
+    }
+
+    // Close now; the Client itself is released after the epoll round, since
+    // later events of the same round may still point at it
+    void close_client(Client* client, const char* reason) {
+        if (client->closing) return;
+        client->closing = true;
+        if (client->ssl) {
+            if (!client->handshaking) SSL_shutdown(client->ssl);
+            SSL_free(client->ssl);
+            client->ssl = nullptr;
+        }
+        close(client->fd);
+        closed.push_back(client);
+
+        if (options.verbose) {
+            std::cout << "Client " << client->name << " closed: " << reason << std::endl;
+        }
+    }
+
+    void evict(Client* client, const char* reason) {
+        if (client->closing) return;
+        counters.evicted++;
+        std::cerr << "Evicting slow consumer " << client->name << ": " << reason << " ("
+                  << client->backlog() << " bytes queued)" << std::endl;
+        close_client(client, reason);
+    }
+
+    void release_closed() {
+        for (Client* client : closed) {
+            // Swap-remove from clients
+            size_t slot = client->slot;
+            released.push_back(std::move(clients[slot]));
+            if (slot != clients.size() - 1) {
+                clients[slot] = std::move(clients.back());
+                clients[slot]->slot = slot;
+            }
+            clients.pop_back();
+            counters.disconnected++;
+        }
+        closed.clear();
+        released.clear();
+    }
+
+    void continue_handshake(Client* client) {
+        int result = SSL_accept(client->ssl);
+        if (result == 1) {
+            client->handshaking = false;
+            set_write_interest(client, false);
+            read_client(client);  // Application data may already be buffered
+            return;
+        }
+
+        int err = SSL_get_error(client->ssl, result);
+        if (err == SSL_ERROR_WANT_READ) {
+            set_write_interest(client, false);
+        } else if (err == SSL_ERROR_WANT_WRITE) {
+            set_write_interest(client, true);
+        } else {
+            if (options.verbose) ERR_print_errors_fp(stderr);
+            ERR_clear_error();
+            close_client(client, "TLS handshake failed");
+        }
+    }
+
+    void read_client(Client* client) {
+        // Read a bounded slice per round so one busy sender cannot starve the
+        // flushes (level-triggered epoll reports the rest). Bytes already
+        // buffered inside OpenSSL are invisible to epoll, so those are drained.
+        // A sender that writes a batch and exits must not lose its tail, so
+        // on EOF or error the events already read are published first
+        const size_t slice = 4 * read_buffer.size();
+        size_t total = 0;
+        const char* close_reason = nullptr;
+        while (total < slice || (client->ssl && SSL_has_pending(client->ssl))) {
+            int n;
+            if (client->ssl) {
+                n = SSL_read(client->ssl, read_buffer.data(), static_cast<int>(read_buffer.size()));
+                if (n <= 0) {
+                    int err = SSL_get_error(client->ssl, n);
+                    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) break;
+                    ERR_clear_error();
+                    close_reason = err == SSL_ERROR_ZERO_RETURN ? "disconnected" : "read error";
+                    break;
+                }
+            } else {
+                n = static_cast<int>(recv(client->fd, read_buffer.data(), read_buffer.size(), 0));
+                if (n <= 0) {
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    close_reason = n == 0 ? "disconnected" : "read error";
+                    break;
+                }
+            }
+            client->framer.append(read_buffer.data(), n);
+            total += n;
+        }
+        counters.bytes_in += total;
+
+        Clock::time_point now = Clock::now();
+        std::string_view event;
+        while (client->framer.next(event)) {
+            client->events_in++;
+            publish(client, event, now);
+        }
+        client->framer.compact();
+
+        if (close_reason) {
+            close_client(client, close_reason);
+        }
+    }
+
+    // Share one copy of the event with every other client's queue
+    void publish(Client* sender, std::string_view event, Clock::time_point now) {
+        Payload payload = std::make_shared<const std::string>(event);
+        counters.events++;
+
+        for (auto& entry : clients) {
+            Client* client = entry.get();
+            if ((client == sender && !options.echo) || client->closing || client->handshaking) continue;
+
+            if (client->backlog() + payload->size() > options.max_queue_bytes) {
+                evict(client, "queue full");
+                continue;
+            }
+            client->queue.push_back(Outbound{payload, now});
+            client->queued_bytes += payload->size();
+            counters.deliveries++;
+
+            // Clients waiting for EPOLLOUT are flushed when the socket drains
+            if (!client->dirty && !client->want_write) {
+                client->dirty = true;
+                dirty.push_back(client);
+            }
+        }
+    }
+
+    void flush_dirty() {
+        for (Client* client : dirty) {
+            client->dirty = false;
+            if (!client->closing) {
+                if (client->ssl) flush_tls(client);
+                else flush_tcp(client);
+            }
+        }
+        dirty.clear();
+    }
+
+    // Gather queued events straight from the shared buffers
+    void flush_tcp(Client* client) {
+        constexpr int MAX_IOV = 64;
+        struct iovec iov[MAX_IOV];
+
+        while (!client->queue.empty()) {
+            int count = 0;
+            size_t offset = client->head_offset;
+            for (auto it = client->queue.begin(); it != client->queue.end() && count < MAX_IOV; ++it) {
+                iov[count].iov_base = const_cast<char*>(it->payload->data()) + offset;
+                iov[count].iov_len = it->payload->size() - offset;
+                offset = 0;
+                count++;
+            }
+
+            ssize_t written = writev(client->fd, iov, count);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    set_write_interest(client, true);
+                } else {
+                    close_client(client, "write error");
+                }
+                return;
+            }
+            counters.bytes_out += written;
+
+            size_t left = static_cast<size_t>(written);
+            while (left > 0) {
+                size_t size = client->queue.front().payload->size();
+                size_t remaining = size - client->head_offset;
+                if (left < remaining) {
+                    client->head_offset += left;
+                    break;
+                }
+                left -= remaining;
+                client->queued_bytes -= size;
+                client->head_offset = 0;
+                client->queue.pop_front();
+                client->events_out++;
+            }
+        }
+        set_write_interest(client, false);
+    }
+
+    // TLS encrypts into its own records anyway, so queued events are
+    // gathered into one write of up to 16 KB (one record)
+    void flush_tls(Client* client) {
+        while (true) {
+            if (client->tls_offset == client->tls_record.size()) {
+                client->tls_record.clear();
+                client->tls_offset = 0;
+                if (client->queue.empty()) break;
+                while (!client->queue.empty() && client->tls_record.size() < 16384) {
+                    const std::string& payload = *client->queue.front().payload;
+                    client->tls_record += payload;
+                    client->queued_bytes -= payload.size();
+                    client->queue.pop_front();
+                    client->events_out++;
+                }
+            }
+
+            int n = SSL_write(client->ssl, client->tls_record.data() + client->tls_offset,
+                              static_cast<int>(client->tls_record.size() - client->tls_offset));
+            if (n > 0) {
+                client->tls_offset += n;
+                counters.bytes_out += n;
+                continue;
+            }
+
+            int err = SSL_get_error(client->ssl, n);
+            if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) {
+                set_write_interest(client, true);
+            } else {
+                ERR_clear_error();
+                close_client(client, "write error");
+            }
+            return;
+        }
+        set_write_interest(client, false);
+    }
+
+    // Evict consumers whose oldest queued event is too old, and drop
+    // connections that never finish the TLS handshake
+    void sweep(Clock::time_point now) {
+        for (auto& entry : clients) {
+            Client* client = entry.get();
+            if (client->closing) continue;
+            if (client->handshaking) {
+                if (now - client->connected > std::chrono::seconds(10)) {
+                    close_client(client, "TLS handshake timeout");
+                }
+                continue;
+            }
+            if (!client->queue.empty() &&
+                std::chrono::duration<double>(now - client->queue.front().queued).count() > options.max_lag_s) {
+                evict(client, "lagging");
+            }
+        }
+    }
+
+    void print_stats(double seconds, uint64_t events_before) {
+        size_t tls_clients = 0;
+        size_t max_backlog = 0;
+        size_t total_backlog = 0;
+        for (const auto& client : clients) {
+            if (client->ssl) tls_clients++;
+            max_backlog = std::max(max_backlog, client->backlog());
+            total_backlog += client->backlog();
+        }
+        std::cerr << "[broker] clients=" << clients.size() << " (tls=" << tls_clients
+                  << " tcp=" << clients.size() - tls_clients << ")"
+                  << " events=" << counters.events
+                  << " rate=" << std::fixed << std::setprecision(0)
+                  << (seconds > 0 ? (counters.events - events_before) / seconds : 0.0) << "/s"
+                  << " deliveries=" << counters.deliveries
+                  << " out_mb=" << std::setprecision(1) << counters.bytes_out / 1e6
+                  << " queued_kb=" << total_backlog / 1024 << " max_queued_kb=" << max_backlog / 1024
+                  << " evicted=" << counters.evicted << " rejected=" << counters.rejected << std::endl;
+    }
+
+public:
+    explicit CoTBroker(const BrokerOptions& opts)
+        : options(opts), ssl_ctx(nullptr), epoll_fd(-1), tls_listen_fd(-1), tcp_listen_fd(-1),
+          read_buffer(64 * 1024), counters{} {
+    }
+
+    ~CoTBroker() {
+        for (auto& client : clients) {
+            close_client(client.get(), "shutdown");
+        }
+        closed.clear();
+        for (int fd : {tls_listen_fd, tcp_listen_fd, epoll_fd}) {
+            if (fd >= 0) close(fd);
+        }
+        if (ssl_ctx) {
+            SSL_CTX_free(ssl_ctx);
+        }
+    }
+
+    bool start() {
+        raise_fd_limit();
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            std::cerr << "Error creating epoll instance: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        if (options.tls_port > 0) {
+            if (!init_ssl()) return false;
+            tls_listen_fd = open_listener(options.tls_port);
+            if (tls_listen_fd < 0 || !watch(tls_listen_fd, &tls_listen_fd, EPOLLIN)) return false;
+        }
+        if (options.tcp_port > 0) {
+            tcp_listen_fd = open_listener(options.tcp_port);
+            if (tcp_listen_fd < 0 || !watch(tcp_listen_fd, &tcp_listen_fd, EPOLLIN)) return false;
+        }
+        return true;
+    }
+
+    void run() {
+        std::vector<struct epoll_event> events(1024);
+        Clock::time_point last_sweep = Clock::now();
+        Clock::time_point last_stats = last_sweep;
+        uint64_t events_at_stats = 0;
+
+        while (!broker_stop) {
+            int ready = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), 250);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+                break;
+            }
+
+            for (int i = 0; i < ready; i++) {
+                void* tag = events[i].data.ptr;
+                if (tag == &tls_listen_fd) {
+                    accept_clients(tls_listen_fd, true);
+                    continue;
+                }
+                if (tag == &tcp_listen_fd) {
+                    accept_clients(tcp_listen_fd, false);
+                    continue;
+                }
+
+                Client* client = static_cast<Client*>(tag);
+                if (client->closing) continue;
+                if (client->handshaking) {
+                    continue_handshake(client);
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    read_client(client);
+                }
+                if ((events[i].events & EPOLLOUT) && !client->closing) {
+                    if (client->ssl) flush_tls(client);
+                    else flush_tcp(client);
+                }
+            }
+
+            // One write per client for everything published this round
+            flush_dirty();
+
+            Clock::time_point now = Clock::now();
+            if (now - last_sweep >= std::chrono::seconds(1)) {
+                sweep(now);
+                last_sweep = now;
+            }
+            release_closed();
+
+            if (options.show_stats && now - last_stats >= std::chrono::seconds(5)) {
+                print_stats(std::chrono::duration<double>(now - last_stats).count(), events_at_stats);
+                events_at_stats = counters.events;
+                last_stats = now;
+            }
+        }
+    }
+
+    void print_summary() const {
+        std::cout << "Clients accepted: " << counters.accepted << ", rejected: " << counters.rejected
+                  << ", evicted: " << counters.evicted << std::endl;
+        std::cout << "Events relayed: " << counters.events << " (" << counters.deliveries
+                  << " deliveries, " << counters.bytes_in << " bytes in, " << counters.bytes_out
+                  << " bytes out)" << std::endl;
+    }
+};
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --bind <address>      Address to listen on (default: 0.0.0.0)\n";
+    std::cout << "  --tls-port <port>     TLS streaming port (default: 8089; 0 to disable)\n";
+    std::cout << "  --tcp-port <port>     Plain TCP streaming port (default: 8087; 0 to disable)\n";
+    std::cout << "  --cert <file>         Server certificate file (.pem), required for TLS\n";
+    std::cout << "  --key <file>          Server private key file (.pem), required for TLS\n";
+    std::cout << "  --ca <file>           CA certificate file (.pem); clients must present a\n";
+    std::cout << "                        certificate signed by it\n";
+    std::cout << "  --passphrase <pass>   Private key passphrase\n";
+    std::cout << "  --max-clients <n>     Connections served at once (default: 10000)\n";
+    std::cout << "  --max-queue <bytes>   Per-client send queue before eviction (default: 4194304)\n";
+    std::cout << "  --max-lag <s>         Evict a client whose oldest queued event is older (default: 10)\n";
+    std::cout << "  --max-event <bytes>   Largest event accepted (default: 65536)\n";
+    std::cout << "  --echo                Also send events back to their sender\n";
+    std::cout << "  --stats               Print relay counters to stderr every 5 seconds\n";
+    std::cout << "  --verbose             Log connects and disconnects\n";
+    std::cout << "  --help                Show this help message\n";
+}
+
+int main(int argc, char* argv[]) {
+    BrokerOptions options;
+
+    // Simple argument parsing
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--bind" && i + 1 < argc) {
+            options.bind_address = argv[++i];
+        } else if (std::string(argv[i]) == "--tls-port" && i + 1 < argc) {
+            options.tls_port = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--tcp-port" && i + 1 < argc) {
+            options.tcp_port = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--cert" && i + 1 < argc) {
+            options.cert_file = argv[++i];
+        } else if (std::string(argv[i]) == "--key" && i + 1 < argc) {
+            options.key_file = argv[++i];
+        } else if (std::string(argv[i]) == "--ca" && i + 1 < argc) {
+            options.ca_file = argv[++i];
+        } else if (std::string(argv[i]) == "--passphrase" && i + 1 < argc) {
+            options.passphrase = argv[++i];
+        } else if (std::string(argv[i]) == "--max-clients" && i + 1 < argc) {
+            options.max_clients = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--max-queue" && i + 1 < argc) {
+            options.max_queue_bytes = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--max-lag" && i + 1 < argc) {
+            options.max_lag_s = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--max-event" && i + 1 < argc) {
+            options.max_event_bytes = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--echo") {
+            options.echo = true;
+        } else if (std::string(argv[i]) == "--stats") {
+            options.show_stats = true;
+        } else if (std::string(argv[i]) == "--verbose") {
+            options.verbose = true;
+        } else if (std::string(argv[i]) == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.tls_port > 0 && (options.cert_file.empty() || options.key_file.empty())) {
+        std::cerr << "Warning: no --cert/--key given, TLS port disabled\n";
+        options.tls_port = 0;
+    }
+    if (options.tls_port <= 0 && options.tcp_port <= 0) {
+        std::cerr << "Nothing to listen on: enable --tls-port or --tcp-port\n";
+        return 1;
+    }
+
+    std::cout << "TAK CoT Broker (C++)\n";
+    std::cout << "====================\n";
+    if (options.tls_port > 0) {
+        std::cout << "TLS: " << options.bind_address << ":" << options.tls_port
+                  << (options.ca_file.empty() ? "" : " (client certificates required)") << std::endl;
+    }
+    if (options.tcp_port > 0) {
+        std::cout << "TCP: " << options.bind_address << ":" << options.tcp_port << std::endl;
+    }
+    std::cout << "Max clients: " << options.max_clients << ", queue " << options.max_queue_bytes / 1024
+              << " KB, lag " << options.max_lag_s << " s per client" << std::endl;
+    std::cout << "Press Ctrl+C to stop\n" << std::endl;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, [](int) { broker_stop = true; });
+    signal(SIGTERM, [](int) { broker_stop = true; });
+
+    CoTBroker broker(options);
+    if (!broker.start()) {
+        return 1;
+    }
+    broker.run();
+
+    std::cout << "\nShutting down broker...\n";
+    broker.print_summary();
+    return 0;
+}
@@ -1,4 +1,10 @@
 #include "cot_common.h"
+#include "cot_geo.h"
+#include "cot_text.h"
+
+#include <cstdarg>
+#include <fcntl.h>
+#include <netinet/tcp.h>
 
 namespace CoTCommon {
 
@@ -268,142 +274,432 @@ std::string CoTObject::get_sidc_description() const {
 }
 
 std::string CoTObject::to_xml() const {
+    COT_TRACE_SCOPE("to_xml");
+    static const MetricsRegistry::Histogram serialize_time = MetricsRegistry::global().histogram(
+        "cot_serialize_seconds", "Time to render one CoT event", "format=\"xml\"", 1e-9, 8, 30);
+    uint64_t start = metrics_now_ns();
+    
     auto current_time = std::chrono::system_clock::now();
     auto stale_time = persistent ? 
         current_time + std::chrono::hours(24) :  // 24-hour stale time for persistent tactical objects
         current_time + std::chrono::minutes(10); // 10-minute stale time for live tracking
     
-    std::stringstream xml;
-    xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-    xml << "<event version=\"2.0\" uid=\"" << uid << "\" type=\"" << type << "\" how=\"" << how << "\"\n";
-    xml << "       time=\"" << format_timestamp(current_time) << "\"\n";
-    xml << "       start=\"" << format_timestamp(current_time) << "\"\n";
-    xml << "       stale=\"" << format_timestamp(stale_time) << "\"";
+    std::string xml;
+    xml.reserve(1536);
+    xml += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    xml += "<event version=\"2.0\" uid=\"";
+    append_xml_escaped(xml, uid);
+    xml += "\" type=\"";
+    append_xml_escaped(xml, type);
+    xml += "\" how=\"";
+    append_xml_escaped(xml, how);
+    xml += "\"\n";
+    xml += "       time=\"";
+    xml += format_timestamp(current_time);
+    xml += "\"\n       start=\"";
+    xml += format_timestamp(current_time);
+    xml += "\"\n       stale=\"";
+    xml += format_timestamp(stale_time);
+    xml += '"';
     
     // Add SIDC as event attribute for better TAK recognition
     if (!sidc.empty()) {
-        xml << "\n       sidc=\"" << sidc << "\"";
-    }
-    
-    xml << ">\n";
-    xml << "  <point\n";
-    xml << "    lat=\"" << std::fixed << std::setprecision(6) << latitude << "\"\n";
-    xml << "    lon=\"" << std::fixed << std::setprecision(6) << longitude << "\"\n";
-    xml << "    ce=\"9999999\"\n";
-    xml << "    hae=\"" << std::fixed << std::setprecision(2) << hae << "\"\n";
-    xml << "    le=\"9999999\"\n";
-    xml << "  >\n";
-    xml << "  </point>\n";
-    xml << "  <detail>\n";
-    xml << "    <contact callsign=\"" << callsign << "\" endpoint=\"*:-1:stcp\" phone=\"\" />\n";
-    xml << "    <__group name=\"" << team << "\" role=\"Team Member\"/>\n";
-    xml << "    <uid Droid=\"tactical-wrapper\"/>\n";
+        xml += "\n       sidc=\"";
+        append_xml_escaped(xml, sidc);
+        xml += '"';
+    }
+    
+    xml += ">\n";
+    xml += "  <point\n";
+    xml += "    lat=\"";
+    append_detail_number(xml, latitude, 6);
+    xml += "\"\n";
+    xml += "    lon=\"";
+    append_detail_number(xml, longitude, 6);
+    xml += "\"\n";
+    xml += "    ce=\"9999999\"\n";
+    xml += "    hae=\"";
+    append_detail_number(xml, hae, 2);
+    xml += "\"\n";
+    xml += "    le=\"9999999\"\n";
+    xml += "  >\n";
+    xml += "  </point>\n";
+    
+    // Detail children come from their declarations in cot_detail.h
+    xml += "  <detail>\n";
+    auto child = [&xml](const auto& ext) {
+        xml += "    ";
+        write_detail(xml, ext);
+        xml += '\n';
+    };
+    child(ContactDetail{callsign, "*:-1:stcp", ""});
+    child(GroupDetail{team, "Team Member"});
+    child(UidDetail{"tactical-wrapper"});
     
     // Include SIDC information if available (TAK format)
     if (!sidc.empty()) {
-        xml << "    <status readiness=\"true\"/>\n";
-        xml << "    <takv device=\"tactical-wrapper\" platform=\"Linux\" os=\"Linux\" version=\"1.0\"/>\n";
-        xml << "    <track speed=\"0.00000000\" course=\"0.00000000\"/>\n";
+        child(StatusDetail{true});
+        child(TakvDetail{"tactical-wrapper", "Linux", "Linux", "1.0"});
+        child(TrackDetail{0.0, 0.0});
         
         // TAK MIL-STD-2525 format (simplified)
-        xml << "    <usericon iconsetpath=\"34ae1613-9645-4222-a9d2-e5f243dea2865/Military/2525C-mil-std-2525c/" << type << "\"/>\n";
-        xml << "    <_flow-tags_ marti:tags=\"2525c-mil-std-2525c\"/>\n";
+        // Reused path buffer: rendering does not allocate for it
+        thread_local std::string iconsetpath;
+        iconsetpath.assign("34ae1613-9645-4222-a9d2-e5f243dea2865/Military/2525C-mil-std-2525c/");
+        iconsetpath += type;
+        child(UserIconDetail{iconsetpath});
+        child(FlowTagsDetail{"2525c-mil-std-2525c"});
     }
     
     // Mark persistent tactical objects
     if (persistent) {
-        xml << "    <remarks>Persistent tactical object</remarks>\n";
-        xml << "    <archive/>\n";  // TAK archive marker for persistence
-        xml << "    <link relation=\"p-p\" type=\"a-f-G-U-C\" uid=\"ANDROID-\" />\n";  // Link to persistent mission data
-        xml << "    <precisionlocation altsrc=\"DTED0\" geopointsrc=\"USER\" />\n";
+        child(RemarksDetail{"Persistent tactical object"});
+        child(ArchiveDetail{});  // TAK archive marker for persistence
+        child(LinkDetail{"p-p", "a-f-G-U-C", "ANDROID-"});  // Link to persistent mission data
+        child(PrecisionLocationDetail{"DTED0", "USER"});
     }
     
-    xml << "  </detail>\n";
-    xml << "</event>\n";
+    xml += "  </detail>\n";
+    xml += "</event>\n";
     
-    return xml.str();
+    serialize_time.observe_since(start);
+    return xml;
 }
 
 // CoTParser implementation
-std::string CoTParser::extract_attribute(const std::string& xml, const std::string& element, const std::string& attr) {
-    std::string pattern = "<" + element + "[^>]*" + attr + "=\"([^\"]+)\"";
-    std::regex regex_pattern(pattern);
-    std::smatch match;
-    
-    if (std::regex_search(xml, match, regex_pattern)) {
-        return match[1].str();
+namespace {
+
+// An attribute value with its entities decoded into the arena; raw itself
+// when it has none
+std::string_view decode_attribute(std::string_view raw, BatchArena& arena) {
+    if (raw.find('&') == std::string_view::npos) {
+        return raw;
     }
-    return "";
+    char* decoded = static_cast<char*>(arena.allocate(raw.size(), 1));
+    return std::string_view(decoded, unescape_xml(raw, decoded));
 }
 
-std::string CoTParser::extract_element_content(const std::string& xml, const std::string& element) {
-    std::string pattern = "<" + element + "[^>]*>([^<]*)</" + element + ">";
-    std::regex regex_pattern(pattern);
-    std::smatch match;
-    
-    if (std::regex_search(xml, match, regex_pattern)) {
-        return match[1].str();
-    }
-    return "";
+// Copy an attribute value into the arena, decoding its entities
+std::string_view copy_attribute(std::string_view raw, BatchArena& arena) {
+    std::string_view value = decode_attribute(raw, arena);
+    return value.data() == raw.data() ? arena.copy(raw) : value;
 }
 
-void CoTParser::CoTMessage::print() const {
-    std::cout << "═══════════════════════════════════════" << std::endl;
-    std::cout << "CoT Message Received" << std::endl;
-    std::cout << "═══════════════════════════════════════" << std::endl;
-    std::cout << "UID:       " << uid << std::endl;
-    std::cout << "Type:      " << type << std::endl;
-    std::cout << "How:       " << how << std::endl;
-    std::cout << "Time:      " << time << std::endl;
-    std::cout << "Position:  " << std::fixed << std::setprecision(6) 
-              << latitude << ", " << longitude << " (HAE: " << hae << "m)" << std::endl;
+bool is_xml_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Return the value of attr on the first <element> tag that carries it
+std::string_view find_attribute(std::string_view xml, std::string_view element, std::string_view attr) {
+    const size_t n = xml.size();
+    size_t pos = 0;
+    
+    while ((pos = xml.find('<', pos)) != std::string_view::npos) {
+        pos++;
+        if (xml.compare(pos, element.size(), element) != 0) continue;
+        
+        size_t p = pos + element.size();
+        if (p >= n || !(is_xml_space(xml[p]) || xml[p] == '/' || xml[p] == '>')) continue;
+        
+        // Walk the attributes up to the end of the tag
+        while (p < n && xml[p] != '>') {
+            if (is_xml_space(xml[p]) || xml[p] == '/') {
+                p++;
+                continue;
+            }
+            
+            size_t name_start = p;
+            while (p < n && xml[p] != '=' && xml[p] != '>' && xml[p] != '/' && !is_xml_space(xml[p])) p++;
+            std::string_view name = xml.substr(name_start, p - name_start);
+            
+            while (p < n && is_xml_space(xml[p])) p++;
+            if (p >= n || xml[p] != '=') continue;  // Attribute without a value
+            p++;
+            while (p < n && is_xml_space(xml[p])) p++;
+            if (p >= n || (xml[p] != '"' && xml[p] != '\'')) continue;
+            
+            char quote = xml[p++];
+            size_t value_end = xml.find(quote, p);
+            if (value_end == std::string_view::npos) return std::string_view();
+            if (name == attr) return xml.substr(p, value_end - p);
+            p = value_end + 1;
+        }
+    }
+    return std::string_view();
+}
+
+void append_printf(std::string& out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void append_printf(std::string& out, const char* fmt, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (len > 0) out.append(buf, std::min<size_t>(len, sizeof(buf) - 1));
+}
+
+void format_detailed(std::string& out, std::string_view uid, std::string_view type, std::string_view how,
+                     std::string_view time, double latitude, double longitude, double hae,
+                     std::string_view callsign, std::string_view team, std::string_view stale) {
+    static const char rule[] = "═══════════════════════════════════════\n";
+    out += rule;
+    out += "CoT Message Received\n";
+    out += rule;
+    out.append("UID:       ").append(uid) += '\n';
+    out.append("Type:      ").append(type) += '\n';
+    out.append("How:       ").append(how) += '\n';
+    out.append("Time:      ").append(time) += '\n';
+    append_printf(out, "Position:  %.6f, %.6f (HAE: %.6fm)\n", latitude, longitude, hae);
+    size_t mgrs_line = out.size();
+    out += "MGRS:      ";
+    if (append_mgrs(out, latitude, longitude)) {
+        out += '\n';
+    } else {
+        out.resize(mgrs_line);  // Polar (UPS) positions are not covered
+    }
     if (!callsign.empty()) {
-        std::cout << "Callsign:  " << callsign << std::endl;
+        out.append("Callsign:  ").append(callsign) += '\n';
     }
     if (!team.empty()) {
-        std::cout << "Team:      " << team << std::endl;
+        out.append("Team:      ").append(team) += '\n';
     }
-    std::cout << "Stale:     " << stale << std::endl;
-    std::cout << "═══════════════════════════════════════" << std::endl;
+    out.append("Stale:     ").append(stale) += '\n';
+    out += rule;
+}
+
+void format_compact_line(std::string& out, std::string_view time, std::string_view callsign,
+                         std::string_view type, double latitude, double longitude, std::string_view team) {
+    std::string_view clock = time.size() > 11 ? time.substr(11, 8) : std::string_view();
+    append_printf(out, "[%.*s] %-12.*s | %-10.*s | %-10.4f,%-11.4f | ",
+                  static_cast<int>(clock.size()), clock.data(),
+                  static_cast<int>(callsign.size()), callsign.data(),
+                  static_cast<int>(type.size()), type.data(),
+                  latitude, longitude);
+    size_t mgrs_start = out.size();
+    if (!append_mgrs(out, latitude, longitude)) {
+        out += '-';
+    }
+    out.append(15 - std::min<size_t>(out.size() - mgrs_start, 15), ' ');
+    out.append(" | ").append(team) += '\n';
+}
+
+} // namespace
+
+void CoTParser::CoTMessage::print() const {
+    std::string out;
+    format_detailed(out, uid, type, how, time, latitude, longitude, hae, callsign, team, stale);
+    std::cout << out << std::flush;
 }
 
 void CoTParser::CoTMessage::print_compact() const {
-    std::cout << "[" << time.substr(11, 8) << "] " 
-              << std::setw(12) << std::left << callsign 
-              << " | " << std::setw(10) << type 
-              << " | " << std::fixed << std::setprecision(4)
-              << std::setw(10) << latitude << "," << std::setw(11) << longitude
-              << " | " << team << std::endl;
+    std::string out;
+    format_compact_line(out, time, callsign, type, latitude, longitude, team);
+    std::cout << out << std::flush;
 }
 
-CoTParser::CoTMessage CoTParser::parse(const std::string& xml) {
+void CoTParser::CoTMessageView::format(std::string& out) const {
+    format_detailed(out, uid, type_str(), how_str(), time, latitude, longitude, hae,
+                    callsign_str(), team_str(), stale);
+}
+
+void CoTParser::CoTMessageView::format_compact(std::string& out) const {
+    format_compact_line(out, time, callsign_str(), type_str(), latitude, longitude, team_str());
+}
+
+void CoTParser::CoTMessageView::print() const {
+    std::string out;
+    format(out);
+    std::cout << out << std::flush;
+}
+
+void CoTParser::CoTMessageView::print_compact() const {
+    std::string out;
+    format_compact(out);
+    std::cout << out << std::flush;
+}
+
+CoTParser::CoTMessage CoTParser::CoTMessageView::materialize() const {
     CoTMessage msg;
-    msg.raw_xml = xml;
+    msg.uid = std::string(uid);
+    msg.type = std::string(type_str());
+    msg.how = std::string(how_str());
+    msg.time = std::string(time);
+    msg.start = std::string(start);
+    msg.stale = std::string(stale);
+    msg.latitude = latitude;
+    msg.longitude = longitude;
+    msg.hae = hae;
+    msg.callsign = std::string(callsign_str());
+    msg.team = std::string(team_str());
+    msg.raw_xml = std::string(raw_xml);
+    return msg;
+}
+
+bool CoTParser::parse_view(std::string_view xml, CoTMessageView& msg, BatchArena& arena) {
+    static const MetricsRegistry::Counter parsed = MetricsRegistry::global().counter(
+        "cot_parse_events_total", "CoT events parsed");
+    static const MetricsRegistry::Counter errors = MetricsRegistry::global().counter(
+        "cot_parse_errors_total", "CoT events that failed to parse");
+    static const MetricsRegistry::Histogram parse_time = MetricsRegistry::global().histogram(
+        "cot_parse_seconds", "Time to parse one CoT event, sampled 1 in 16", "", 1e-9, 8, 30);
     
-    // Extract event attributes
-    msg.uid = extract_attribute(xml, "event", "uid");
-    msg.type = extract_attribute(xml, "event", "type");
-    msg.how = extract_attribute(xml, "event", "how");
-    msg.time = extract_attribute(xml, "event", "time");
-    msg.start = extract_attribute(xml, "event", "start");
-    msg.stale = extract_attribute(xml, "event", "stale");
+    COT_TRACE_SCOPE("parse");
     
-    // Extract point attributes
-    std::string lat_str = extract_attribute(xml, "point", "lat");
-    std::string lon_str = extract_attribute(xml, "point", "lon");
-    std::string hae_str = extract_attribute(xml, "point", "hae");
+    // Two clock reads would cost more than the counters: time a sample.
+    // Malformed UTF-8 is rejected before anything is extracted from it.
+    bool ok;
+    if ((parse_count++ & 15) == 0) {
+        uint64_t start = metrics_now_ns();
+        ok = is_valid_utf8(xml) && extract(xml, msg, arena);
+        parse_time.observe_since(start);
+    } else {
+        ok = is_valid_utf8(xml) && extract(xml, msg, arena);
+    }
+    parsed.add();
+    if (!ok) errors.add();
+    return ok;
+}
+
+bool CoTParser::extract(std::string_view xml, CoTMessageView& msg, BatchArena& arena) {
+    StringInterner& strings = StringInterner::global();
+    msg = CoTMessageView();
     
-    if (!lat_str.empty()) msg.latitude = std::stod(lat_str);
-    if (!lon_str.empty()) msg.longitude = std::stod(lon_str);
-    if (!hae_str.empty()) msg.hae = std::stod(hae_str);
+    // Index the document once, then pull the fixed fields off the tape
+    if (!tape.build(xml) || tape.name(0) != "event") {
+        return false;
+    }
+    msg.tape = &tape;
     
-    // Extract contact callsign
-    msg.callsign = extract_attribute(xml, "contact", "callsign");
+    // Extract event attributes, decoded so they match what the TAK Protocol
+    // decoder yields for the same event
+    msg.uid = copy_attribute(tape.attribute(0, "uid"), arena);
+    msg.type = strings.intern_or_copy(decode_attribute(tape.attribute(0, "type"), arena), msg.type_spill, arena);
+    msg.how = strings.intern_or_copy(decode_attribute(tape.attribute(0, "how"), arena), msg.how_spill, arena);
+    msg.time = copy_attribute(tape.attribute(0, "time"), arena);
+    msg.start = copy_attribute(tape.attribute(0, "start"), arena);
+    msg.stale = copy_attribute(tape.attribute(0, "stale"), arena);
     
-    // Extract team/group name
-    msg.team = extract_attribute(xml, "__group", "name");
+    // Extract point attributes
+    uint32_t point = tape.child(0, "point");
+    bool ok = point == CoTTape::NONE ||
+              decode_point(tape.attribute(point, "lat"), tape.attribute(point, "lon"), tape.attribute(point, "hae"),
+                           tape.attribute(point, "ce"), tape.attribute(point, "le"), msg.latitude, msg.longitude,
+                           msg.hae, msg.position);
+    
+    // Extract contact callsign and team/group name
+    msg.callsign = strings.intern_or_copy(decode_attribute(tape.find("detail/contact@callsign"), arena),
+                                          msg.callsign_spill, arena);
+    msg.team = strings.intern_or_copy(decode_attribute(tape.find("detail/__group@name"), arena), msg.team_spill,
+                                      arena);
+    
+    if (keep_raw_xml) {
+        msg.raw_xml = arena.copy(xml);
+    }
     
-    return msg;
+    return ok;
+}
+
+CoTParser::CoTMessage CoTParser::parse(const std::string& xml) {
+    BatchArena arena(1024);
+    CoTMessageView view;
+    if (!parse_view(xml, view, arena)) {
+        throw std::invalid_argument("Malformed CoT message");
+    }
+    return view.materialize();
+}
+
+std::string_view CoTParser::peek_attribute(std::string_view xml, std::string_view element,
+                                          std::string_view attr) {
+    return find_attribute(xml, element, attr);
+}
+
+bool match_cot_type(std::string_view pattern, std::string_view type) {
+    size_t p = 0, t = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    
+    while (t < type.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == type[t])) {
+            p++;
+            t++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = t;
+        } else if (star != std::string_view::npos) {
+            // Let the last '*' swallow one more character
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+namespace {
+
+bool parse_digits(std::string_view text, size_t pos, size_t count, int& value) {
+    value = 0;
+    for (size_t i = pos; i < pos + count; i++) {
+        if (i >= text.size() || text[i] < '0' || text[i] > '9') return false;
+        value = value * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+} // namespace
+
+bool parse_cot_time(std::string_view text, int64_t& epoch_ms) {
+    int year, month, day, hour, minute, second;
+    if (!parse_digits(text, 0, 4, year) || text.size() < 19 || text[4] != '-' ||
+        !parse_digits(text, 5, 2, month) || text[7] != '-' || !parse_digits(text, 8, 2, day) ||
+        (text[10] != 'T' && text[10] != ' ') || !parse_digits(text, 11, 2, hour) || text[13] != ':' ||
+        !parse_digits(text, 14, 2, minute) || text[16] != ':' || !parse_digits(text, 17, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    size_t pos = 19;
+    int millis = 0;
+    if (pos < text.size() && text[pos] == '.') {
+        int scale = 100;
+        for (pos++; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; pos++) {
+            millis += (text[pos] - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    int offset_minutes = 0;
+    if (pos < text.size() && text[pos] == 'Z') {
+        pos++;
+    } else if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+        int offset_hours, offset_mins;
+        if (!parse_digits(text, pos + 1, 2, offset_hours) || pos + 3 >= text.size() || text[pos + 3] != ':' ||
+            !parse_digits(text, pos + 4, 2, offset_mins)) {
+            return false;
+        }
+        offset_minutes = (offset_hours * 60 + offset_mins) * (text[pos] == '-' ? -1 : 1);
+        pos += 6;
+    }
+    if (pos != text.size()) return false;
+
+    int64_t days = days_from_civil(year, month, day);
+    epoch_ms = (((days * 24 + hour) * 60 + minute - offset_minutes) * 60 + second) * 1000 + millis;
+    return true;
 }
 
 // TAKServerConnection implementation
@@ -413,7 +709,18 @@ TAKServerConnection::TAKServerConnection(const std::string& hostname, int tcp_po
                    bool verb) 
     : host(hostname), port(tcp_port), cert_file(cert_path), key_file(key_path),
       ca_file(ca_path), passphrase(pass), ssl_ctx(nullptr), ssl(nullptr), 
-      socket_fd(-1), connected(false), verbose(verb) {
+      socket_fd(-1), connected(false), verbose(verb), unsent_limit(0), low_latency(false), busy_poll_us(0) {
+    MetricsRegistry& metrics = MetricsRegistry::global();
+    std::string peer = "peer=\"" + host + ":" + std::to_string(port) + "\"";
+    bytes_sent_metric = metrics.counter("cot_tls_sent_bytes_total", "Bytes written to TLS connections", peer);
+    bytes_received_metric = metrics.counter("cot_tls_received_bytes_total", "Bytes read from TLS connections", peer);
+    connects_metric = metrics.counter("cot_tls_connects_total", "Successful TLS connects", peer);
+    connect_failures_metric = metrics.counter("cot_tls_connect_failures_total", "Failed TLS connects", peer);
+    write_time_metric = metrics.histogram("cot_tls_write_seconds",
+                                          "Time in SSL_write, including waits for a full socket buffer", peer);
+    read_time_metric = metrics.histogram("cot_tls_read_seconds",
+                                         "Time in SSL_read calls that returned data; on a blocking socket "
+                                         "this includes waiting for the data", peer);
 }
 
 TAKServerConnection::~TAKServerConnection() {
@@ -511,9 +818,17 @@ bool TAKServerConnection::create_connection() {
     if (::connect(socket_fd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
         std::cerr << "Error connecting to " << host << ":" << port << std::endl;
         close(socket_fd);
+        socket_fd = -1;
         return false;
     }
     
+    if (unsent_limit > 0) {
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &unsent_limit, sizeof(unsent_limit));
+    }
+    if (low_latency) {
+        set_low_latency(busy_poll_us);
+    }
+    
     return true;
 }
 
@@ -537,24 +852,66 @@ bool TAKServerConnection::setup_ssl_connection() {
 }
 
 bool TAKServerConnection::connect() {
-    if (!init_ssl()) {
+    // The SSL context (and decrypted key) is kept across reconnects
+    if (!ssl_ctx && !init_ssl()) {
+        if (ssl_ctx) {
+            SSL_CTX_free(ssl_ctx);
+            ssl_ctx = nullptr;
+        }
         return false;
     }
     
     if (!create_connection()) {
+        connect_failures_metric.add();
         return false;
     }
     
     if (!setup_ssl_connection()) {
+        if (ssl) {
+            SSL_free(ssl);
+            ssl = nullptr;
+        }
         close(socket_fd);
+        socket_fd = -1;
+        connect_failures_metric.add();
         return false;
     }
     
     connected = true;
+    connects_metric.add();
     if (verbose) std::cout << "Connected to TAK server at " << host << ":" << port << std::endl;
     return true;
 }
 
+bool TAKServerConnection::set_nonblocking(bool enabled) {
+    if (socket_fd < 0) return false;
+    int flags = fcntl(socket_fd, F_GETFL, 0);
+    if (flags < 0) return false;
+    flags = enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(socket_fd, F_SETFL, flags) == 0;
+}
+
+void TAKServerConnection::set_unsent_limit(int bytes) {
+    unsent_limit = bytes;
+    if (socket_fd >= 0 && bytes > 0) {
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &unsent_limit, sizeof(unsent_limit));
+    }
+}
+
+void TAKServerConnection::set_low_latency(int busy_poll) {
+    low_latency = true;
+    busy_poll_us = busy_poll;
+    if (socket_fd < 0) return;
+    
+    int on = 1;
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+    if (busy_poll_us > 0 &&
+        setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us)) != 0 && verbose) {
+        std::cerr << "SO_BUSY_POLL not available: " << strerror(errno) << std::endl;
+    }
+}
+
 void TAKServerConnection::disconnect() {
     connected = false;
     
@@ -578,13 +935,17 @@ bool TAKServerConnection::send_data(const std::string& data) {
         return false;
     }
     
+    COT_TRACE_SCOPE("ssl_write");
+    uint64_t start = metrics_now_ns();
     int bytes_sent = SSL_write(ssl, data.c_str(), data.length());
+    write_time_metric.observe_since(start);
     if (bytes_sent <= 0) {
         std::cerr << "Error sending data to TAK server\n";
         ERR_print_errors_fp(stderr);
         return false;
     }
     
+    bytes_sent_metric.add(bytes_sent);
     return true;
 }
 
@@ -594,7 +955,27 @@ int TAKServerConnection::receive_data(char* buffer, size_t buffer_size) {
         return -1;
     }
     
-    return SSL_read(ssl, buffer, buffer_size - 1);
+    COT_TRACE_SCOPE("ssl_read");
+    uint64_t start = metrics_now_ns();
+    // would_block() reads the thread's error queue; an error left there by
+    // another feed would make this one look lost
+    ERR_clear_error();
+    int bytes_received = SSL_read(ssl, buffer, buffer_size - 1);
+    if (bytes_received > 0) {
+        read_time_metric.observe_since(start);
+        bytes_received_metric.add(bytes_received);
+        if (low_latency) {
+            // The kernel falls back to delayed ACKs after each read
+            int on = 1;
+            setsockopt(socket_fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+        }
+    }
+    return bytes_received;
+}
+
+bool TAKServerConnection::would_block(int result) {
+    int ssl_error = get_last_ssl_error(result);
+    return ssl_error == SSL_ERROR_WANT_READ || ssl_error == SSL_ERROR_WANT_WRITE;
 }
 
 int TAKServerConnection::get_last_ssl_error(int result) {
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <chrono>
 #include <thread>
@@ -12,7 +13,7 @@
 #include <vector>
 #include <memory>
 #include <map>
-#include <regex>
+#include <stdexcept>
 
 // Network includes
 #include <sys/socket.h>
@@ -26,6 +27,13 @@
 #include <openssl/err.h>
 #include <openssl/bio.h>
 
+#include "cot_detail.h"
+#include "cot_intern.h"
+#include "cot_metrics.h"
+#include "cot_position.h"
+#include "cot_trace.h"
+#include "cot_tape.h"
+
 namespace CoTCommon {
 
 // MIL-STD-2525D SIDC utility class
@@ -164,11 +172,12 @@ private:
     std::string team;
     bool persistent;  // Whether this is a persistent tactical object
     std::chrono::system_clock::time_point timestamp;
-    
-    std::string generate_uuid();
-    std::string format_timestamp(const std::chrono::system_clock::time_point& tp) const;
 
 public:
+    // Rendering helpers, public so cot_bench can time them on their own
+    std::string generate_uuid();
+    std::string format_timestamp(const std::chrono::system_clock::time_point& tp) const;
+    
     // Constructor with CoT type (legacy)
     CoTObject(const std::string& obj_type = "a-f-G-U-C", 
               const std::string& how_val = "h-g-i-g-o",
@@ -184,11 +193,21 @@ public:
     void update_timestamp();
     std::string to_xml() const;
     
+    // Keep a stable UID across updates of the same unit
+    void set_uid(const std::string& new_uid) { uid = new_uid; }
+    void set_persistent(bool is_persistent) { persistent = is_persistent; }
+    
     // Getters
     const std::string& get_callsign() const { return callsign; }
     const std::string& get_uid() const { return uid; }
     const std::string& get_sidc() const { return sidc; }
     const std::string& get_type() const { return type; }
+    const std::string& get_how() const { return how; }
+    const std::string& get_team() const { return team; }
+    double get_latitude() const { return latitude; }
+    double get_longitude() const { return longitude; }
+    double get_hae() const { return hae; }
+    bool is_persistent() const { return persistent; }
     
     // SIDC utilities
     void set_sidc(const std::string& sidc_code);
@@ -197,8 +216,9 @@ public:
 
 class CoTParser {
 private:
-    std::string extract_attribute(const std::string& xml, const std::string& element, const std::string& attr);
-    std::string extract_element_content(const std::string& xml, const std::string& element);
+    bool keep_raw_xml;
+    CoTTape tape;  // Reused across parses
+    uint32_t parse_count;  // Samples 1 in 16 parses for cot_parse_seconds
 
 public:
     struct CoTMessage {
@@ -219,10 +239,122 @@ public:
         void print_compact() const;
     };
     
+    // Allocation-free parse result. Vocabulary fields are IDs in the global
+    // StringInterner and per-event strings live in the BatchArena passed to
+    // parse_view(), so a view is valid until that arena is reset.
+    struct CoTMessageView {
+        std::string_view uid;
+        StringInterner::Id type = StringInterner::EMPTY;
+        StringInterner::Id how = StringInterner::EMPTY;
+        StringInterner::Id callsign = StringInterner::EMPTY;
+        StringInterner::Id team = StringInterner::EMPTY;
+        
+        // Arena copies of vocabulary strings the full interner could not
+        // take; their IDs are EMPTY. Read them through the *_str() accessors.
+        std::string_view type_spill;
+        std::string_view how_spill;
+        std::string_view callsign_spill;
+        std::string_view team_spill;
+        std::string_view time;
+        std::string_view start;
+        std::string_view stale;
+        double latitude = 0.0;
+        double longitude = 0.0;
+        double hae = 0.0;
+        CompactPosition position;  // The same point in fixed point, plus ce/le
+        std::string_view raw_xml;  // Empty unless keep_raw_xml is enabled
+        
+        // Structural index of the source document. Only valid while the
+        // source buffer is alive and until the parser parses again.
+        const CoTTape* tape = nullptr;
+        
+        // Resolve any element/attribute on demand, e.g. "detail/track@speed"
+        std::string_view field(std::string_view path) const {
+            return tape ? tape->find(path) : std::string_view();
+        }
+        
+        // Decode a detail extension such as TrackDetail (cot_detail.h);
+        // false if the event does not carry it or a value is malformed
+        template <class T>
+        bool detail(T& ext, BatchArena& arena) const {
+            return tape && find_detail(*tape, ext, arena);
+        }
+        
+        std::string_view type_str() const { return type ? StringInterner::global().view(type) : type_spill; }
+        std::string_view how_str() const { return how ? StringInterner::global().view(how) : how_spill; }
+        std::string_view callsign_str() const {
+            return callsign ? StringInterner::global().view(callsign) : callsign_spill;
+        }
+        std::string_view team_str() const { return team ? StringInterner::global().view(team) : team_spill; }
+        
+        CoTMessage materialize() const;
+        void print() const;
+        void print_compact() const;
+        
+        // Append the print()/print_compact() text to a buffer
+        void format(std::string& out) const;
+        void format_compact(std::string& out) const;
+    };
+    
+    CoTParser() : keep_raw_xml(false), parse_count(0) {}
+    
+    // Keeping a copy of the source XML is opt-in
+    void set_keep_raw_xml(bool keep) { keep_raw_xml = keep; }
+    
+    // Parse without touching the heap in steady state. Returns false if the
+    // document is not a CoT event or a <point> value is malformed or out of
+    // range (see decode_point()).
+    bool parse_view(std::string_view xml, CoTMessageView& msg, BatchArena& arena);
+    
     CoTMessage parse(const std::string& xml);
+    
+    // Scan for a single attribute without a full parse (e.g. to shard by uid)
+    static std::string_view peek_attribute(std::string_view xml, std::string_view element,
+                                           std::string_view attr);
+
+private:
+    bool extract(std::string_view xml, CoTMessageView& msg, BatchArena& arena);
+};
+
+// Match a CoT type against a glob-style pattern: '*' matches any run of
+// characters and '?' a single one, e.g. "a-?-G*" for all ground tracks.
+bool match_cot_type(std::string_view pattern, std::string_view type);
+
+// Parse a CoT timestamp ("2024-05-01T12:00:00.123Z", optional fraction and
+// UTC offset) into milliseconds since the Unix epoch
+bool parse_cot_time(std::string_view text, int64_t& epoch_ms);
+
+// Connection to a CoT peer as seen by the injector and listener: send
+// rendered CoT, receive raw bytes to frame. Implemented by the TLS stream
+// below and by UdpTransport (cot_udp.h).
+class CoTTransport {
+public:
+    virtual ~CoTTransport() = default;
+    
+    virtual bool connect() = 0;
+    virtual void disconnect() = 0;
+    virtual bool is_connected() const = 0;
+    virtual const std::string& get_host() const = 0;
+    virtual int get_port() const = 0;
+    
+    // Underlying socket for poll()/epoll(), -1 when disconnected
+    virtual int get_socket_fd() const = 0;
+    virtual bool set_nonblocking(bool enabled) = 0;
+    
+    // Stream transports only; see TAKServerConnection
+    virtual void set_unsent_limit(int bytes) { (void)bytes; }
+    
+    // Stream transports only; see TAKServerConnection
+    virtual void set_low_latency(int busy_poll_us) { (void)busy_poll_us; }
+    
+    virtual bool send_data(const std::string& data) = 0;
+    virtual int receive_data(char* buffer, size_t buffer_size) = 0;
+    
+    // True if a receive_data() result <= 0 only means no data is ready yet
+    virtual bool would_block(int result) = 0;
 };
 
-class TAKServerConnection {
+class TAKServerConnection : public CoTTransport {
 private:
     std::string host;
     int port;
@@ -235,6 +367,17 @@ private:
     int socket_fd;
     bool connected;
     bool verbose;
+    int unsent_limit;
+    bool low_latency;
+    int busy_poll_us;
+    
+    // Labelled with the peer, see cot_metrics.h
+    MetricsRegistry::Counter bytes_sent_metric;
+    MetricsRegistry::Counter bytes_received_metric;
+    MetricsRegistry::Counter connects_metric;
+    MetricsRegistry::Counter connect_failures_metric;
+    MetricsRegistry::Histogram write_time_metric;
+    MetricsRegistry::Histogram read_time_metric;
     
     bool init_ssl();
     bool create_connection();
@@ -246,17 +389,38 @@ public:
                        const std::string& ca_path = "", const std::string& pass = "",
                        bool verb = false);
     
-    ~TAKServerConnection();
+    ~TAKServerConnection() override;
     
-    bool connect();
-    void disconnect();
-    bool is_connected() const { return connected; }
+    bool connect() override;
+    void disconnect() override;
+    bool is_connected() const override { return connected; }
+    const std::string& get_host() const override { return host; }
+    int get_port() const override { return port; }
+    
+    int get_socket_fd() const override { return socket_fd; }
+    
+    // Switch the connected socket to non-blocking reads and writes, for use
+    // from an event loop (receive_data then reports SSL_ERROR_WANT_READ)
+    bool set_nonblocking(bool enabled) override;
+    
+    // Cap data queued unsent in the kernel (TCP_NOTSENT_LOWAT) so a backlog
+    // stays in user space where it can still be reordered; 0 = kernel default
+    void set_unsent_limit(int bytes) override;
+    
+    // Send every write at once (TCP_NODELAY), acknowledge every read at once
+    // (TCP_QUICKACK, re-armed after each read) and busy-poll the NIC queue
+    // for up to busy_poll_us in blocking reads (SO_BUSY_POLL). Kept across
+    // reconnects.
+    void set_low_latency(int busy_poll_us) override;
     
     // For sending data
-    bool send_data(const std::string& data);
+    bool send_data(const std::string& data) override;
     
     // For receiving data
-    int receive_data(char* buffer, size_t buffer_size);
+    int receive_data(char* buffer, size_t buffer_size) override;
+    
+    // SSL_ERROR_WANT_READ/WANT_WRITE
+    bool would_block(int result) override;
     
     // Get last SSL error
     int get_last_ssl_error(int result);
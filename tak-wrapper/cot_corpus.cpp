@@ -0,0 +1,696 @@
+#include "cot_common.h"
+#include "cot_text.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Seeded generator of large CoT streams: reproducible inputs for the
+// benchmarks, replay mode, load tests and fuzzing.
+//
+// The same options and seed always produce the same bytes. Events describe
+// a fixed set of tracks that move between updates; each track's SIDC, CoT
+// type, callsign and team are drawn once from the configured distributions.
+// A controlled fraction of events can be malformed or truncated, and with
+// --chunk-size events are shifted so that read boundaries cut through them.
+
+struct CorpusOptions {
+    uint64_t events = 100000;
+    uint64_t max_bytes = 0;          // Stop after this much output (0: events only)
+    uint64_t seed = 1;
+    std::string output = "-";
+    std::string directory;           // One file per event (fuzzer seed corpus)
+    size_t tracks = 10000;
+    double rate = 1000.0;            // Events per simulated second
+    int64_t start_time = 1714564800; // 2024-05-01T12:00:00Z
+    std::string affiliations = "friend=4,hostile=3,neutral=1,unknown=1,suspect=1";
+    std::string dimensions = "land-unit=5,land-equipment=2,air=2,sea-surface=1,sea-subsurface=1";
+    double sidc_fraction = 0.5;      // Tracks that also carry a sidc attribute
+    size_t detail_min = 0;           // Remarks length in bytes
+    size_t detail_max = 256;
+    size_t callsign_min = 3;
+    size_t callsign_max = 16;
+    double unicode = 0.05;           // Share of non-ASCII callsigns and remark words
+    double special = 0.02;           // Share of callsigns and remark words with & < > " '
+    double malformed = 0.0;
+    double truncated = 0.0;
+    size_t chunk_size = 0;
+    double split = 1.0;              // Share of chunk boundaries placed by pick_cut()
+};
+
+// xoshiro256** seeded through splitmix64
+class Rng {
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    explicit Rng(uint64_t seed) {
+        for (auto& word : s) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, n); the modulo bias is below 2^-40 for the sizes used here
+    uint64_t below(uint64_t n) { return n ? next() % n : 0; }
+    size_t between(size_t low, size_t high) { return low + below(high - low + 1); }
+    double real() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+    double real(double low, double high) { return low + (high - low) * real(); }
+    bool chance(double p) { return p > 0.0 && real() < p; }
+};
+
+// Index drawn with probability proportional to its weight
+class WeightedChoice {
+private:
+    std::vector<double> cumulative;
+
+public:
+    void add(double weight) { cumulative.push_back((cumulative.empty() ? 0.0 : cumulative.back()) + weight); }
+    bool empty() const { return cumulative.empty() || cumulative.back() <= 0.0; }
+
+    size_t pick(Rng& rng) const {
+        double x = rng.real() * cumulative.back();
+        return std::upper_bound(cumulative.begin(), cumulative.end(), x) - cumulative.begin();
+    }
+};
+
+class CorpusGenerator {
+private:
+    using M = CoTCommon::MilStd2525;
+
+    struct TrackText {
+        std::string uid;
+        std::string type;
+        std::string sidc;   // Empty when the track has no sidc attribute
+        std::string callsign;
+        std::string team;
+        std::string how;
+    };
+
+    // What an update touches: the moving state and the track's constant
+    // markup, pre-rendered into one arena so that each event copies two
+    // spans instead of chasing six strings per track
+    struct Track {
+        double lat;
+        double lon;
+        double hae;
+        double course;
+        double speed;       // m/s
+        uint32_t attributes;  // Offsets into markup
+        uint32_t contact;
+        uint32_t end;
+    };
+
+    enum class Fault { NONE, NO_UID, BAD_NUMBER, OPEN_QUOTE, BAD_UTF8, UNCLOSED_ELEMENT };
+
+    CorpusOptions options;
+    Rng rng;
+    std::vector<Track> tracks;
+    std::vector<TrackText> texts;  // Only read to render faults
+    std::string markup;
+    std::string text;          // Remark pool, sliced at random offsets
+
+    // Output
+    int fd;
+    std::string buffer;
+    std::string event;
+    uint64_t written;
+    uint64_t malformed_count;
+    uint64_t truncated_count;
+    uint64_t split_count;
+
+    // Timestamp cache: the second only changes every `rate` events
+    int64_t cached_second;
+    std::string time_prefix;
+    std::string stale_prefix;
+
+    static bool parse_weights(const std::string& spec, const char* const* names, size_t count,
+                              std::vector<double>& weights) {
+        weights.assign(count, 0.0);
+        size_t start = 0;
+        while (start < spec.size()) {
+            size_t comma = spec.find(',', start);
+            std::string item = spec.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+            size_t eq = item.find('=');
+            std::string name = item.substr(0, eq);
+            size_t index = count;
+            for (size_t i = 0; i < count; i++) {
+                if (name == names[i]) index = i;
+            }
+            if (index == count) {
+                std::cerr << "Unknown name '" << name << "' in " << spec << std::endl;
+                return false;
+            }
+            weights[index] = eq == std::string::npos ? 1.0 : std::stod(item.substr(eq + 1));
+            if (comma == std::string::npos) break;
+            start = comma + 1;
+        }
+        return true;
+    }
+
+    // Text with a controlled share of non-ASCII and markup-significant words
+    std::string make_text(size_t bytes) {
+        static const char* const WORDS[] = {"moving", "north", "along", "ridge", "at", "grid", "contact", "lost",
+                                            "vehicle", "observed", "request", "resupply", "holding", "position",
+                                            "checkpoint", "river", "crossing", "two", "squads", "east"};
+        static const char* const UNICODE[] = {"Привет", "северо-восток", "東京", "Überwachung", "ʻokina",
+                                              "مرحبا", "서울", "Ελλάδα", "🚁", "naïve"};
+        static const char* const SPECIAL[] = {"\"Bravo\"", "A&B", "<hold>", "don't", "->", "&amp;"};
+        std::string pool;
+        while (pool.size() < bytes) {
+            if (rng.chance(options.special)) {
+                pool += SPECIAL[rng.below(6)];
+            } else if (rng.chance(options.unicode)) {
+                pool += UNICODE[rng.below(10)];
+            } else {
+                pool += WORDS[rng.below(20)];
+            }
+            pool += ' ';
+        }
+        return pool;
+    }
+
+    std::string make_callsign() {
+        static const char LETTERS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-";
+        static const char* const SYLLABLES[] = {"Ка", "ми", "東", "ß", "é", "ø", "ğ", "ñ"};
+        static const char* const SPECIAL[] = {"&", "\"", "<", ">", "'"};
+        size_t length = rng.between(options.callsign_min, options.callsign_max);
+        bool unicode = rng.chance(options.unicode);
+        bool special = rng.chance(options.special);
+        std::string callsign;
+        for (size_t i = 0; i < length; i++) {
+            if (special && i == length / 2) {
+                callsign += SPECIAL[rng.below(5)];
+            } else if (unicode && rng.chance(0.5)) {
+                callsign += SYLLABLES[rng.below(8)];
+            } else {
+                callsign += LETTERS[rng.below(sizeof(LETTERS) - 1)];
+            }
+        }
+        return callsign;
+    }
+
+    bool make_tracks() {
+        static const char* const AFFILIATIONS[] = {"pending", "unknown", "assumed-friend", "friend",
+                                                   "neutral", "suspect", "hostile"};
+        static const char* const DIMENSIONS[] = {"unknown", "land-unit", "land-equipment", "sea-surface",
+                                                 "sea-subsurface", "air", "space"};
+        static const std::vector<M::FunctionID> FUNCTIONS[] = {
+            {M::FunctionID::INFANTRY},
+            {M::FunctionID::INFANTRY, M::FunctionID::ARMOR, M::FunctionID::MECHANIZED, M::FunctionID::ARTILLERY,
+             M::FunctionID::ENGINEER, M::FunctionID::AIR_DEFENSE, M::FunctionID::RECONNAISSANCE,
+             M::FunctionID::HEADQUARTERS, M::FunctionID::LOGISTICS, M::FunctionID::MEDICAL,
+             M::FunctionID::TRANSPORTATION, M::FunctionID::SUPPLY, M::FunctionID::SPECIAL_FORCES},
+            {M::FunctionID::TANK_M1, M::FunctionID::APC, M::FunctionID::IFV, M::FunctionID::HOWITZER,
+             M::FunctionID::SAM_LAUNCHER},
+            {M::FunctionID::DESTROYER, M::FunctionID::FRIGATE, M::FunctionID::CRUISER, M::FunctionID::CARRIER},
+            {M::FunctionID::SUBMARINE},
+            {M::FunctionID::FIGHTER, M::FunctionID::ATTACK_HELO, M::FunctionID::TRANSPORT_HELO,
+             M::FunctionID::TRANSPORT_FIXED, M::FunctionID::BOMBER, M::FunctionID::CARGO_AIRCRAFT},
+            {M::FunctionID::INFANTRY}};
+        static const M::Echelon ECHELONS[] = {M::Echelon::NONE, M::Echelon::TEAM_CREW, M::Echelon::SQUAD,
+                                              M::Echelon::SECTION, M::Echelon::PLATOON, M::Echelon::COMPANY,
+                                              M::Echelon::BATTALION, M::Echelon::REGIMENT, M::Echelon::BRIGADE};
+        static const char* const TEAMS[] = {"Cyan", "Blue", "Red", "Green", "White", "Yellow", "Orange",
+                                            "Magenta", "Maroon", "Purple", "Dark Blue", "Teal", "Dark Green", "Brown"};
+        static const char* const HOWS[] = {"m-g", "h-e", "h-g-i-g-o", "m-r", "m-f"};
+
+        std::vector<double> weights;
+        WeightedChoice affiliation, dimension;
+        if (!parse_weights(options.affiliations, AFFILIATIONS, 7, weights)) return false;
+        for (double w : weights) affiliation.add(w);
+        if (!parse_weights(options.dimensions, DIMENSIONS, 7, weights)) return false;
+        for (double w : weights) dimension.add(w);
+        if (affiliation.empty() || dimension.empty()) {
+            std::cerr << "Affiliation and dimension weights must not all be zero\n";
+            return false;
+        }
+
+        // SIDC rendering is slow; tracks repeat (affiliation, dimension,
+        // function, echelon) combinations, so cache them
+        std::map<std::string, std::pair<std::string, std::string>> symbols;
+        tracks.resize(options.tracks);
+        texts.resize(options.tracks);
+        char uid[64];
+        for (size_t i = 0; i < tracks.size(); i++) {
+            Track& t = tracks[i];
+            TrackText& x = texts[i];
+            size_t a = affiliation.pick(rng);
+            size_t d = dimension.pick(rng);
+            const auto& functions = FUNCTIONS[d];
+            M::FunctionID function = functions[rng.below(functions.size())];
+            M::Echelon echelon = d == 1 ? ECHELONS[rng.below(9)] : M::Echelon::NONE;
+            std::string key = std::to_string(a) + "/" + std::to_string(d) + "/" +
+                              std::to_string(static_cast<int>(function)) + "/" +
+                              std::to_string(static_cast<int>(echelon));
+            auto it = symbols.find(key);
+            if (it == symbols.end()) {
+                std::string sidc = M::generateSIDC(static_cast<M::Affiliation>(a), static_cast<M::BattleDimension>(d),
+                                                   M::Status::REALITY, function, echelon);
+                it = symbols.emplace(key, std::make_pair(sidc, M::sidcToCoTType(sidc))).first;
+            }
+
+            snprintf(uid, sizeof(uid), "corpus-%llu-%zu", static_cast<unsigned long long>(options.seed), i);
+            x.uid = uid;
+            x.type = it->second.second;
+            if (rng.chance(options.sidc_fraction)) x.sidc = it->second.first;
+            x.callsign = make_callsign();
+            x.team = TEAMS[rng.below(14)];
+            x.how = HOWS[rng.below(5)];
+            t.lat = rng.real(-70.0, 70.0);
+            t.lon = rng.real(-179.0, 179.0);
+            t.hae = d == 5 ? rng.real(300.0, 12000.0) : rng.real(0.0, 2500.0);
+            t.course = rng.real(0.0, 360.0);
+            t.speed = d == 5 ? rng.real(50.0, 250.0) : rng.real(0.0, 20.0);
+
+            t.attributes = static_cast<uint32_t>(markup.size());
+            append_attributes(markup, x, Fault::NONE);
+            t.contact = static_cast<uint32_t>(markup.size());
+            append_contact(markup, x, Fault::NONE);
+            t.end = static_cast<uint32_t>(markup.size());
+        }
+        return true;
+    }
+
+    // Fixed-point digits by integer arithmetic: several times faster than
+    // std::to_chars for the handful of precisions used here
+    static void append_number(std::string& out, double value, int precision) {
+        static const double SCALE[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7};
+        char digits[32];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        bool negative = value < 0.0;
+        uint64_t scaled = static_cast<uint64_t>(std::llround(std::fabs(value) * SCALE[precision]));
+        for (int i = 0; i < precision; i++) {
+            *--p = static_cast<char>('0' + scaled % 10);
+            scaled /= 10;
+        }
+        if (precision > 0) *--p = '.';
+        do {
+            *--p = static_cast<char>('0' + scaled % 10);
+            scaled /= 10;
+        } while (scaled);
+        if (negative) *--p = '-';
+        out.append(p, end - p);
+    }
+
+    static void format_second(std::string& out, int64_t epoch_s) {
+        time_t tt = static_cast<time_t>(epoch_s);
+        struct tm tm_utc;
+        gmtime_r(&tt, &tm_utc);
+        char buf[32];
+        strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S.", &tm_utc);
+        out = buf;
+    }
+
+    void append_time(std::string& out, const std::string& prefix, int ms) {
+        out += prefix;
+        out += static_cast<char>('0' + ms / 100);
+        out += static_cast<char>('0' + ms / 10 % 10);
+        out += static_cast<char>('0' + ms % 10);
+        out += 'Z';
+    }
+
+    static void append_attribute(std::string& out, const char* name, std::string_view value) {
+        out += ' ';
+        out += name;
+        out += "=\"";
+        CoTCommon::append_xml_escaped(out, value);
+        out += '"';
+    }
+
+    static void append_attributes(std::string& out, const TrackText& x, Fault fault) {
+        if (fault != Fault::NO_UID) append_attribute(out, "uid", x.uid);
+        if (fault == Fault::OPEN_QUOTE) {
+            out += " type=\"";
+            out += x.type;
+        } else {
+            append_attribute(out, "type", x.type);
+        }
+        append_attribute(out, "how", x.how);
+        if (!x.sidc.empty()) append_attribute(out, "sidc", x.sidc);
+    }
+
+    static void append_contact(std::string& out, const TrackText& x, Fault fault) {
+        out += "<detail><contact";
+        if (fault == Fault::BAD_UTF8) {
+            out += " callsign=\"";
+            CoTCommon::append_xml_escaped(out, x.callsign);
+            out += "\xc3\x28\"";
+        } else {
+            append_attribute(out, "callsign", x.callsign);
+        }
+        out += " endpoint=\"*:-1:stcp\"/><__group";
+        append_attribute(out, "name", x.team);
+        out += " role=\"Team Member\"/>";
+    }
+
+    // Slice of a text pool that does not start or end inside a UTF-8 sequence
+    std::string_view slice(const std::string& pool, size_t length) {
+        size_t start = rng.below(pool.size() - length);
+        while (start > 0 && (static_cast<unsigned char>(pool[start]) & 0xc0) == 0x80) start--;
+        size_t end = start + length;
+        while (end < pool.size() && (static_cast<unsigned char>(pool[end]) & 0xc0) == 0x80) end++;
+        return std::string_view(pool).substr(start, end - start);
+    }
+
+    void render(uint64_t index, size_t track, Fault fault) {
+        Track& t = tracks[track];
+
+        // Move the track along its course since its last update
+        double step = t.speed * 0.00001;
+        t.course += rng.real(-5.0, 5.0);
+        if (t.course < 0.0) t.course += 360.0;
+        if (t.course >= 360.0) t.course -= 360.0;
+        t.lat = std::max(-80.0, std::min(80.0, t.lat + step * std::cos(t.course * M_PI / 180.0)));
+        t.lon += step * std::sin(t.course * M_PI / 180.0);
+        if (t.lon > 180.0) t.lon -= 360.0;
+        if (t.lon < -180.0) t.lon += 360.0;
+
+        double elapsed = static_cast<double>(index) / options.rate;
+        int64_t second = options.start_time + static_cast<int64_t>(elapsed);
+        int ms = static_cast<int>((elapsed - std::floor(elapsed)) * 1000.0);
+        if (second != cached_second) {
+            format_second(time_prefix, second);
+            format_second(stale_prefix, second + 120);
+            cached_second = second;
+        }
+
+        event.clear();
+        if (index & 1) {
+            event += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>";
+        }
+        event += "<event version=\"2.0\"";
+        if (fault == Fault::NO_UID || fault == Fault::OPEN_QUOTE) {
+            append_attributes(event, texts[track], fault);
+        } else {
+            event.append(markup, t.attributes, t.contact - t.attributes);
+        }
+        event += " time=\"";
+        append_time(event, time_prefix, ms);
+        event += "\" start=\"";
+        append_time(event, time_prefix, ms);
+        event += "\" stale=\"";
+        append_time(event, stale_prefix, ms);
+        event += '"';
+
+        event += "><point lat=\"";
+        if (fault == Fault::BAD_NUMBER) {
+            event += "north";
+        } else {
+            append_number(event, t.lat, 7);
+        }
+        event += "\" lon=\"";
+        append_number(event, t.lon, 7);
+        event += "\" hae=\"";
+        append_number(event, t.hae, 1);
+        event += fault == Fault::UNCLOSED_ELEMENT ? "\" ce=\"9.9\" le=\"9.9\">" : "\" ce=\"9.9\" le=\"9.9\"/>";
+
+        if (fault == Fault::BAD_UTF8) {
+            append_contact(event, texts[track], fault);
+        } else {
+            event.append(markup, t.contact, t.end - t.contact);
+        }
+        event += "<track course=\"";
+        append_number(event, t.course, 1);
+        event += "\" speed=\"";
+        append_number(event, t.speed, 1);
+        event += "\"/>";
+
+        size_t remarks = rng.between(options.detail_min, options.detail_max);
+        if (remarks > 0) {
+            event += "<remarks>";
+            CoTCommon::append_xml_escaped(event, slice(text, remarks));
+            event += "</remarks>";
+        }
+        event += "</detail></event>\n";
+    }
+
+    bool flush() {
+        size_t done = 0;
+        while (done < buffer.size()) {
+            ssize_t n = write(fd, buffer.data() + done, buffer.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Write failed: " << strerror(errno) << std::endl;
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        buffer.clear();
+        return true;
+    }
+
+    // Offset inside the event where a read boundary is most likely to
+    // expose framing bugs
+    size_t pick_cut() {
+        size_t n = event.size();
+        switch (rng.below(5)) {
+            case 0: return 1;                                       // Only the '<'
+            case 1: return n >= 9 ? n - rng.between(1, 8) : n - 1;  // Inside </event>
+            case 2: {
+                size_t amp = event.find('&', rng.below(n));          // Inside an entity
+                return amp != std::string::npos && amp + 1 < n ? amp + 1 : n - 1;
+            }
+            case 3: {
+                for (size_t i = rng.below(n); i < n; i++) {          // Inside a UTF-8 sequence
+                    if ((static_cast<unsigned char>(event[i]) & 0xc0) == 0x80) return i;
+                }
+                return n - 1;                                        // Before the newline
+            }
+            default: return rng.between(1, n - 1);
+        }
+    }
+
+    // When the next chunk boundary falls inside this event, shift the event
+    // with a few bytes of leading whitespace so that the boundary lands at
+    // a chosen offset instead. Padding never exceeds the event's size.
+    void place_chunk_boundary() {
+        if (options.chunk_size == 0 || event.size() < 2) return;
+        uint64_t room = options.chunk_size - written % options.chunk_size;
+        if (room >= event.size() || !rng.chance(options.split)) return;
+        size_t cut = pick_cut();
+        if (cut > room) cut = rng.between(1, room);
+        buffer.append(room - cut, '\n');
+        written += room - cut;
+        split_count++;
+    }
+
+public:
+    explicit CorpusGenerator(const CorpusOptions& opts)
+        : options(opts), rng(opts.seed), fd(-1), written(0), malformed_count(0), truncated_count(0),
+          split_count(0), cached_second(INT64_MIN) {}
+
+    bool run() {
+        if (!make_tracks()) return false;
+        size_t pool_bytes = std::max<size_t>(1 << 20, options.detail_max * 4 + 1024);
+        text = make_text(pool_bytes);
+
+        bool per_file = !options.directory.empty();
+        if (per_file) {
+            if (mkdir(options.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+                std::cerr << "Cannot create " << options.directory << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+        } else if (options.output == "-") {
+            fd = STDOUT_FILENO;
+        } else {
+            fd = open(options.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                std::cerr << "Cannot open " << options.output << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+        }
+
+        const size_t flush_bytes = 4 << 20;
+        buffer.reserve(flush_bytes + 65536 + options.chunk_size);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t index = 0;
+        for (; index < options.events && (options.max_bytes == 0 || written < options.max_bytes); index++) {
+            Fault fault = Fault::NONE;
+            if (rng.chance(options.malformed)) {
+                fault = static_cast<Fault>(1 + rng.below(5));
+                malformed_count++;
+            }
+            render(index, rng.below(tracks.size()), fault);
+            if (rng.chance(options.truncated)) {
+                event.resize(rng.between(1, event.size() - 2));
+                truncated_count++;
+            }
+
+            if (per_file) {
+                std::string path = options.directory + "/event-" + std::to_string(index) + ".xml";
+                fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (fd < 0) {
+                    std::cerr << "Cannot open " << path << ": " << strerror(errno) << std::endl;
+                    return false;
+                }
+                buffer = event;
+                bool ok = flush();
+                close(fd);
+                if (!ok) return false;
+                written += event.size();
+                continue;
+            }
+
+            place_chunk_boundary();
+            buffer += event;
+            written += event.size();
+            if (buffer.size() >= flush_bytes && !flush()) return false;
+        }
+        if (!per_file) {
+            if (!flush()) return false;
+            if (fd != STDOUT_FILENO) close(fd);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fprintf(stderr, "Wrote %llu events, %llu bytes in %.2f s (%.0f MB/s): %llu malformed, %llu truncated, "
+                        "%llu chunk boundaries placed\n",
+                static_cast<unsigned long long>(index), static_cast<unsigned long long>(written), seconds,
+                seconds > 0 ? written / seconds / 1e6 : 0.0, static_cast<unsigned long long>(malformed_count),
+                static_cast<unsigned long long>(truncated_count), static_cast<unsigned long long>(split_count));
+        return true;
+    }
+};
+
+// 64K, 512M, 2G
+uint64_t parse_size(const std::string& text) {
+    size_t end = 0;
+    double value = std::stod(text, &end);
+    switch (end < text.size() ? std::toupper(static_cast<unsigned char>(text[end])) : 0) {
+        case 'K': value *= 1024.0; break;
+        case 'M': value *= 1024.0 * 1024.0; break;
+        case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+        default: break;
+    }
+    return static_cast<uint64_t>(value);
+}
+
+bool parse_range(const std::string& text, size_t& low, size_t& high) {
+    size_t colon = text.find(':');
+    low = std::stoul(text.substr(0, colon));
+    high = colon == std::string::npos ? low : std::stoul(text.substr(colon + 1));
+    return low <= high;
+}
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --events <n>          Events to generate (default: 100000)\n";
+    std::cout << "  --size <bytes>        Stop at this much output instead, e.g. 512M or 4G\n";
+    std::cout << "  --seed <n>            Generator seed (default: 1)\n";
+    std::cout << "  --output <file>       Output file, or - for stdout (default: -)\n";
+    std::cout << "  --dir <path>          Write each event to its own file (fuzzer seed corpus)\n";
+    std::cout << "  --tracks <n>          Distinct tracks updated by the events (default: 10000)\n";
+    std::cout << "  --rate <n>            Events per second of simulated time (default: 1000)\n";
+    std::cout << "  --start <epoch>       Time of the first event (default: 1714564800)\n";
+    std::cout << "  --affiliation <w>     Weights, e.g. 'friend=4,hostile=3,neutral=1' (pending,\n";
+    std::cout << "                        unknown, assumed-friend, friend, neutral, suspect, hostile)\n";
+    std::cout << "  --dimension <w>       Weights, e.g. 'land-unit=5,air=2' (unknown, land-unit,\n";
+    std::cout << "                        land-equipment, sea-surface, sea-subsurface, air, space)\n";
+    std::cout << "  --sidc <fraction>     Tracks that also send a sidc attribute (default: 0.5)\n";
+    std::cout << "  --detail <min:max>    Remarks length in bytes (default: 0:256)\n";
+    std::cout << "  --callsign <min:max>  Callsign length in characters (default: 3:16)\n";
+    std::cout << "  --unicode <fraction>  Non-ASCII callsigns and remark words (default: 0.05)\n";
+    std::cout << "  --special <fraction>  Callsigns and remark words with & < > \" ' (default: 0.02)\n";
+    std::cout << "  --malformed <fraction> Events with a broken attribute, number, UTF-8 sequence\n";
+    std::cout << "                        or element (default: 0)\n";
+    std::cout << "  --truncated <fraction> Events cut short (default: 0)\n";
+    std::cout << "  --chunk-size <bytes>  Place the boundaries of reads of this size at offsets\n";
+    std::cout << "                        that stress framing: after '<', inside an entity, a UTF-8\n";
+    std::cout << "                        sequence or the closing tag (listener replay: 64K)\n";
+    std::cout << "  --split <fraction>    Chunk boundaries placed this way (default: 1)\n";
+    std::cout << "  --help                Show this help message\n";
+}
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+
+    // Simple argument parsing
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--events" && has_value) {
+                options.events = std::stoull(argv[++i]);
+            } else if (arg == "--size" && has_value) {
+                options.max_bytes = parse_size(argv[++i]);
+                options.events = UINT64_MAX;
+            } else if (arg == "--seed" && has_value) {
+                options.seed = std::stoull(argv[++i]);
+            } else if (arg == "--output" && has_value) {
+                options.output = argv[++i];
+            } else if (arg == "--dir" && has_value) {
+                options.directory = argv[++i];
+            } else if (arg == "--tracks" && has_value) {
+                options.tracks = std::max<size_t>(1, std::stoul(argv[++i]));
+            } else if (arg == "--rate" && has_value) {
+                options.rate = std::stod(argv[++i]);
+            } else if (arg == "--start" && has_value) {
+                options.start_time = std::stoll(argv[++i]);
+            } else if (arg == "--affiliation" && has_value) {
+                options.affiliations = argv[++i];
+            } else if (arg == "--dimension" && has_value) {
+                options.dimensions = argv[++i];
+            } else if (arg == "--sidc" && has_value) {
+                options.sidc_fraction = std::stod(argv[++i]);
+            } else if (arg == "--detail" && has_value) {
+                if (!parse_range(argv[++i], options.detail_min, options.detail_max)) {
+                    std::cerr << "Invalid --detail range\n";
+                    return 1;
+                }
+            } else if (arg == "--callsign" && has_value) {
+                if (!parse_range(argv[++i], options.callsign_min, options.callsign_max) || options.callsign_max == 0) {
+                    std::cerr << "Invalid --callsign range\n";
+                    return 1;
+                }
+            } else if (arg == "--unicode" && has_value) {
+                options.unicode = std::stod(argv[++i]);
+            } else if (arg == "--special" && has_value) {
+                options.special = std::stod(argv[++i]);
+            } else if (arg == "--malformed" && has_value) {
+                options.malformed = std::stod(argv[++i]);
+            } else if (arg == "--truncated" && has_value) {
+                options.truncated = std::stod(argv[++i]);
+            } else if (arg == "--chunk-size" && has_value) {
+                options.chunk_size = parse_size(argv[++i]);
+            } else if (arg == "--split" && has_value) {
+                options.split = std::stod(argv[++i]);
+            } else if (arg == "--help") {
+                print_usage(argv[0]);
+                return 0;
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Invalid option value\n";
+        return 1;
+    }
+    if (options.rate <= 0.0) {
+        std::cerr << "--rate must be positive\n";
+        return 1;
+    }
+
+    CorpusGenerator generator(options);
+    return generator.run() ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+#include "cot_dedup.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET = 1469598103934665603ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t hash_bytes(uint64_t h, const void* data, size_t len) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; i++) {
+        h ^= bytes[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+uint64_t hash_view(uint64_t h, std::string_view str) {
+    // Length prefix keeps ("ab","c") distinct from ("a","bc")
+    uint32_t len = static_cast<uint32_t>(str.size());
+    h = hash_bytes(h, &len, sizeof(len));
+    return hash_bytes(h, str.data(), str.size());
+}
+
+uint64_t hash_value(uint64_t h, uint64_t value) {
+    return hash_bytes(h, &value, sizeof(value));
+}
+
+// An interned string hashes by ID, a spilled one (ID EMPTY) by its bytes
+uint64_t hash_interned(uint64_t h, StringInterner::Id id, std::string_view spill) {
+    return id != StringInterner::EMPTY ? hash_value(h, id) : hash_view(h, spill);
+}
+
+uint64_t hash_double(uint64_t h, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return hash_value(h, bits);
+}
+
+// Raw markup of one element, from '<' to the end of its content
+std::string_view element_span(const CoTTape& tape, uint32_t index) {
+    const CoTTape::Element& e = tape.element(index);
+    size_t begin = e.name_offset - 1;
+    return tape.source().substr(begin, e.content_offset + e.content_length - begin);
+}
+
+// Equirectangular approximation, accurate for the short hops we threshold on
+double approx_distance_m(double lat1, double lon1, double lat2, double lon2) {
+    constexpr double EARTH_RADIUS_M = 6371008.8;
+    constexpr double DEG_TO_RAD = M_PI / 180.0;
+    double x = (lon2 - lon1) * DEG_TO_RAD * std::cos((lat1 + lat2) * 0.5 * DEG_TO_RAD);
+    double y = (lat2 - lat1) * DEG_TO_RAD;
+    return std::sqrt(x * x + y * y) * EARTH_RADIUS_M;
+}
+
+} // namespace
+
+DedupStage::DedupStage(const Options& opts)
+    : options(opts), stripes(new std::mutex[LOCK_STRIPES]),
+      passed(0), state_changes(0), duplicates(0), rate_limited(0), below_threshold(0), evictions(0) {
+    size_t sets = 1;
+    while (sets * WAYS < options.max_tracks) sets <<= 1;
+    slots.resize(sets * WAYS);
+    set_mask = sets - 1;
+}
+
+int32_t DedupStage::find_rule(std::string_view type) const {
+    for (size_t i = 0; i < options.rate_limits.size(); i++) {
+        if (match_cot_type(options.rate_limits[i].type_pattern, type)) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    return -1;
+}
+
+DedupStage::Decision DedupStage::emit(Slot& slot, uint64_t state_hash, uint64_t content_hash,
+                                      const CoTParser::CoTMessageView& msg, int64_t now_ms) {
+    // A spilled type has no ID to cache the rule under
+    if (slot.type != msg.type || msg.type == StringInterner::EMPTY) {
+        slot.type = msg.type;
+        slot.rule = find_rule(msg.type_str());
+    }
+    slot.state_hash = state_hash;
+    slot.content_hash = content_hash;
+    slot.last_emit_ms = now_ms;
+    slot.latitude = msg.latitude;
+    slot.longitude = msg.longitude;
+    passed.fetch_add(1, std::memory_order_relaxed);
+    return Decision::PASS;
+}
+
+DedupStage::Decision DedupStage::check(const CoTParser::CoTMessageView& msg, int64_t now_ms) {
+    // Hash everything except timestamps; track and flow tags are kinematic
+    // or per-hop noise rather than state
+    uint64_t state_hash = FNV_OFFSET;
+    state_hash = hash_interned(state_hash, msg.type, msg.type_spill);
+    state_hash = hash_interned(state_hash, msg.how, msg.how_spill);
+    state_hash = hash_interned(state_hash, msg.callsign, msg.callsign_spill);
+    state_hash = hash_interned(state_hash, msg.team, msg.team_spill);
+
+    uint64_t kinematic_hash = FNV_OFFSET;
+    kinematic_hash = hash_double(kinematic_hash, msg.latitude);
+    kinematic_hash = hash_double(kinematic_hash, msg.longitude);
+    kinematic_hash = hash_double(kinematic_hash, msg.hae);
+
+    if (msg.tape) {
+        const CoTTape& tape = *msg.tape;
+        uint32_t detail = tape.child(0, "detail");
+        if (detail != CoTTape::NONE) {
+            for (uint32_t c = tape.first_child(detail); c != CoTTape::NONE; c = tape.next_sibling(c)) {
+                std::string_view name = tape.name(c);
+                if (name == "_flow-tags_") continue;
+                if (name == "track") {
+                    kinematic_hash = hash_view(kinematic_hash, element_span(tape, c));
+                } else {
+                    state_hash = hash_view(state_hash, element_span(tape, c));
+                }
+            }
+        }
+    }
+    uint64_t content_hash = hash_value(state_hash, kinematic_hash);
+
+    uint64_t uid_hash = hash_view(FNV_OFFSET, msg.uid) | 1;  // Never 0 (empty marker)
+    size_t set = uid_hash & set_mask;
+    std::lock_guard<std::mutex> lock(stripes[set % LOCK_STRIPES]);
+
+    // Look the UID up in its set, or claim the least recently seen way
+    Slot* ways = &slots[set * WAYS];
+    Slot* slot = nullptr;
+    Slot* victim = nullptr;
+    for (size_t i = 0; i < WAYS; i++) {
+        if (ways[i].uid_hash == uid_hash) {
+            slot = &ways[i];
+            break;
+        }
+        // Prefer an empty way, then the stalest one
+        if (!victim || (victim->uid_hash != 0 &&
+                        (ways[i].uid_hash == 0 || ways[i].last_seen_ms < victim->last_seen_ms))) {
+            victim = &ways[i];
+        }
+    }
+
+    if (!slot) {
+        if (victim->uid_hash != 0) {
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        *victim = Slot();
+        victim->uid_hash = uid_hash;
+        victim->last_seen_ms = now_ms;
+        state_changes.fetch_add(1, std::memory_order_relaxed);
+        return emit(*victim, state_hash, content_hash, msg, now_ms);
+    }
+
+    slot->last_seen_ms = now_ms;
+    int64_t since_emit_ms = now_ms - slot->last_emit_ms;
+
+    if (state_hash != slot->state_hash) {
+        state_changes.fetch_add(1, std::memory_order_relaxed);
+        return emit(*slot, state_hash, content_hash, msg, now_ms);
+    }
+
+    if (options.max_silence_s > 0 && since_emit_ms >= options.max_silence_s * 1000.0) {
+        return emit(*slot, state_hash, content_hash, msg, now_ms);
+    }
+
+    if (options.drop_duplicates && content_hash == slot->content_hash) {
+        duplicates.fetch_add(1, std::memory_order_relaxed);
+        return Decision::DUPLICATE;
+    }
+
+    if (slot->rule >= 0 && since_emit_ms < options.rate_limits[slot->rule].min_interval_s * 1000.0) {
+        rate_limited.fetch_add(1, std::memory_order_relaxed);
+        return Decision::RATE_LIMITED;
+    }
+
+    if (options.min_distance_m > 0 &&
+        approx_distance_m(slot->latitude, slot->longitude, msg.latitude, msg.longitude) < options.min_distance_m) {
+        below_threshold.fetch_add(1, std::memory_order_relaxed);
+        return Decision::BELOW_THRESHOLD;
+    }
+
+    return emit(*slot, state_hash, content_hash, msg, now_ms);
+}
+
+DedupStage::Stats DedupStage::stats() const {
+    Stats s;
+    s.passed = passed.load(std::memory_order_relaxed);
+    s.state_changes = state_changes.load(std::memory_order_relaxed);
+    s.duplicates = duplicates.load(std::memory_order_relaxed);
+    s.rate_limited = rate_limited.load(std::memory_order_relaxed);
+    s.below_threshold = below_threshold.load(std::memory_order_relaxed);
+    s.evictions = evictions.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace CoTCommon
@@ -0,0 +1,99 @@
+#ifndef COT_DEDUP_H
+#define COT_DEDUP_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cot_common.h"
+
+namespace CoTCommon {
+
+// Per-UID deduplication and adaptive downsampling in front of the sinks.
+//
+// Each event is split into a state hash (type, how, callsign, team and every
+// detail child except <track> and <_flow-tags_>) and a kinematic part
+// (point and track). A state change always passes. Otherwise an event is
+// dropped if it repeats the last emitted content, arrives faster than its
+// type's rate limit, or moved less than min_distance_m, but never for longer
+// than max_silence_s so downstream tracks do not go stale.
+//
+// Memory is fixed: tracks live in a 4-way set-associative table sized at
+// construction, and the least recently seen track in a full set is evicted.
+class DedupStage {
+public:
+    struct RateRule {
+        std::string type_pattern;   // Glob, see match_cot_type()
+        double min_interval_s;      // e.g. 1.0 for at most 1 Hz
+    };
+
+    struct Options {
+        bool drop_duplicates = true;
+        std::vector<RateRule> rate_limits;  // First matching rule wins
+        double min_distance_m = 0.0;        // 0 disables the distance threshold
+        double max_silence_s = 30.0;        // Always emit after this long
+        size_t max_tracks = 65536;
+    };
+
+    enum class Decision {
+        PASS,
+        DUPLICATE,
+        RATE_LIMITED,
+        BELOW_THRESHOLD
+    };
+
+    struct Stats {
+        uint64_t passed;
+        uint64_t state_changes;
+        uint64_t duplicates;
+        uint64_t rate_limited;
+        uint64_t below_threshold;
+        uint64_t evictions;
+    };
+
+    explicit DedupStage(const Options& opts);
+
+    // Thread-safe; now_ms is a monotonic arrival timestamp
+    Decision check(const CoTParser::CoTMessageView& msg, int64_t now_ms);
+
+    Stats stats() const;
+
+private:
+    static constexpr size_t WAYS = 4;
+    static constexpr size_t LOCK_STRIPES = 64;
+
+    struct Slot {
+        uint64_t uid_hash = 0;       // 0 = empty
+        uint64_t state_hash = 0;
+        uint64_t content_hash = 0;
+        int64_t last_emit_ms = 0;
+        int64_t last_seen_ms = 0;
+        double latitude = 0.0;
+        double longitude = 0.0;
+        StringInterner::Id type = StringInterner::EMPTY;
+        int32_t rule = -1;           // Cached rate rule for type
+    };
+
+    Options options;
+    std::vector<Slot> slots;
+    size_t set_mask;
+    std::unique_ptr<std::mutex[]> stripes;
+
+    std::atomic<uint64_t> passed;
+    std::atomic<uint64_t> state_changes;
+    std::atomic<uint64_t> duplicates;
+    std::atomic<uint64_t> rate_limited;
+    std::atomic<uint64_t> below_threshold;
+    std::atomic<uint64_t> evictions;
+
+    int32_t find_rule(std::string_view type) const;
+    Decision emit(Slot& slot, uint64_t state_hash, uint64_t content_hash,
+                  const CoTParser::CoTMessageView& msg, int64_t now_ms);
+};
+
+} // namespace CoTCommon
+
+#endif // COT_DEDUP_H
@@ -0,0 +1,40 @@
+#include "cot_detail.h"
+#include "cot_position.h"
+
+namespace CoTCommon {
+
+char* put_detail_number(char* p, double value, int precision) {
+    char* end = p + DETAIL_NUMBER_MAX;
+    if (precision >= 0) {
+        auto result = std::to_chars(p, end, value, std::chars_format::fixed, precision);
+        if (result.ec == std::errc()) return result.ptr;
+    }
+    // Too many digits for fixed notation: the shortest form always fits and
+    // reads back exactly
+    return std::to_chars(p, end, value).ptr;
+}
+
+void append_detail_number(std::string& out, double value, int precision) {
+    char digits[DETAIL_NUMBER_MAX];
+    out.append(digits, put_detail_number(digits, value, precision));
+}
+
+bool parse_detail_number(std::string_view text, double& value) {
+    // Same strict syntax as <point> values
+    DecimalNumber number;
+    if (!parse_decimal(text, number)) return false;
+    value = number.to_double();
+    return true;
+}
+
+bool parse_detail_string(std::string_view raw, std::string_view& value, BatchArena& arena) {
+    if (raw.find('&') == std::string_view::npos) {
+        value = raw;
+        return true;
+    }
+    char* decoded = static_cast<char*>(arena.allocate(raw.size(), 1));
+    value = std::string_view(decoded, unescape_xml(raw, decoded));
+    return true;
+}
+
+} // namespace CoTCommon
@@ -0,0 +1,440 @@
+#ifndef COT_DETAIL_H
+#define COT_DETAIL_H
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "cot_intern.h"
+#include "cot_tape.h"
+#include "cot_text.h"
+
+// The per-field writers must inline into write_detail() so that each
+// attribute's name and length fold into constants
+#if defined(__GNUC__)
+#define COT_DETAIL_INLINE inline __attribute__((always_inline))
+#else
+#define COT_DETAIL_INLINE inline
+#endif
+
+namespace CoTCommon {
+
+// Declarative <detail> extensions. An extension is a plain struct that names
+// its element and lists each field once, next to the member it fills:
+//
+//   struct TrackDetail {
+//       static constexpr std::string_view ELEMENT = "track";
+//       double speed = 0.0;
+//       double course = 0.0;
+//       static constexpr auto FIELDS = std::make_tuple(
+//           detail_attribute("speed", &TrackDetail::speed, 8),
+//           detail_attribute("course", &TrackDetail::course, 8));
+//   };
+//
+// write_detail() and read_detail() are instantiated from FIELDS, so each
+// extension gets its own straight-line serializer and parser with the names
+// and member offsets as constants: no tables, virtual calls or allocations.
+// Adding a field is one member and one FIELDS entry.
+//
+// Member types are std::string_view (or std::string, which allocates),
+// floating point, integers and bool. Strings are escaped on output; parsed
+// strings view the source when they contain no entity and are decoded into
+// the arena otherwise. A detail_text() field is the element's content.
+
+// Attribute `name`; precision is the digits after the point for a
+// floating-point member, or -1 for the shortest exact form. open holds
+// ` name="` so the writer copies it in one go.
+template <class T, class V>
+struct DetailAttribute {
+    std::string_view name;
+    V T::*member;
+    int precision;
+    char open[32];
+    size_t open_size;
+};
+
+template <class T, class V>
+struct DetailText {
+    V T::*member;
+};
+
+template <class T, class V>
+constexpr DetailAttribute<T, V> detail_attribute(std::string_view name, V T::*member, int precision = -1) {
+    DetailAttribute<T, V> field{name, member, precision, {}, 0};
+    if (name.size() + 3 > sizeof(field.open)) throw "detail attribute name too long";
+    field.open[field.open_size++] = ' ';
+    for (char c : name) field.open[field.open_size++] = c;
+    field.open[field.open_size++] = '=';
+    field.open[field.open_size++] = '"';
+    return field;
+}
+
+template <class T, class V>
+constexpr DetailText<T, V> detail_text(V T::*member) {
+    return {member};
+}
+
+// Value codecs shared by every extension (cot_detail.cpp)
+constexpr size_t DETAIL_NUMBER_MAX = 64;   // Room put_detail_number needs at p
+constexpr size_t DETAIL_STACK_BYTES = 512; // Elements up to this bound skip the resize
+// value must be finite: "nan" and "inf" are not numbers parse_detail_number()
+// accepts. A value too large for precision fixed digits is written in its
+// shortest form instead.
+char* put_detail_number(char* p, double value, int precision);
+void append_detail_number(std::string& out, double value, int precision);
+bool parse_detail_number(std::string_view text, double& value);
+bool parse_detail_string(std::string_view raw, std::string_view& value, BatchArena& arena);
+
+// Most bytes a value can take once written
+template <class V>
+size_t detail_value_bound(const V& value) {
+    if constexpr (std::is_convertible_v<const V&, std::string_view>) {
+        return 6 * std::string_view(value).size();
+    } else if constexpr (std::is_same_v<V, bool>) {
+        return 5;
+    } else if constexpr (std::is_floating_point_v<V>) {
+        return DETAIL_NUMBER_MAX;
+    } else {
+        static_assert(std::is_integral_v<V>, "detail fields are strings, numbers or bool");
+        return 24;
+    }
+}
+
+// Short values, such as most attributes, are checked and copied inline
+COT_DETAIL_INLINE char* put_detail_string(char* p, std::string_view value) {
+    if (value.size() <= 16) {
+        bool plain = true;
+        for (char c : value) plain &= c != '&' && c != '<' && c != '>' && c != '"' && c != '\'';
+        if (plain) {
+            std::memcpy(p, value.data(), value.size());
+            return p + value.size();
+        }
+    }
+    return p + escape_xml(value, p);
+}
+
+template <class V>
+COT_DETAIL_INLINE char* put_detail_value(char* p, const V& value, int precision) {
+    if constexpr (std::is_convertible_v<const V&, std::string_view>) {
+        return put_detail_string(p, value);
+    } else if constexpr (std::is_same_v<V, bool>) {
+        std::string_view text = value ? "true" : "false";
+        return p + text.copy(p, text.size());
+    } else if constexpr (std::is_floating_point_v<V>) {
+        return put_detail_number(p, static_cast<double>(value), precision);
+    } else {
+        return std::to_chars(p, p + 24, value).ptr;
+    }
+}
+
+template <class V>
+bool parse_detail_value(std::string_view raw, V& value, BatchArena& arena) {
+    if constexpr (std::is_same_v<V, std::string_view>) {
+        return parse_detail_string(raw, value, arena);
+    } else if constexpr (std::is_same_v<V, std::string>) {
+        value.clear();
+        append_xml_unescaped(value, raw);
+        return true;
+    } else if constexpr (std::is_same_v<V, bool>) {
+        if (raw == "true" || raw == "1") {
+            value = true;
+        } else if (raw == "false" || raw == "0") {
+            value = false;
+        } else {
+            return false;
+        }
+        return true;
+    } else if constexpr (std::is_floating_point_v<V>) {
+        double number;
+        if (!parse_detail_number(raw, number)) return false;
+        value = static_cast<V>(number);
+        return true;
+    } else {
+        static_assert(std::is_integral_v<V>, "detail fields are strings, numbers or bool");
+        auto result = std::from_chars(raw.data(), raw.data() + raw.size(), value);
+        return result.ec == std::errc() && result.ptr == raw.data() + raw.size();
+    }
+}
+
+namespace detail_codec {
+
+template <class F>
+struct is_text : std::false_type {};
+
+template <class T, class V>
+struct is_text<DetailText<T, V>> : std::true_type {};
+
+// Writers take the field by index, so its name, length and precision are
+// constants of the instantiation rather than loads from the FIELDS tuple
+template <class T, size_t I>
+using field_type = std::decay_t<decltype(std::get<I>(T::FIELDS))>;
+
+template <class T, size_t I>
+COT_DETAIL_INLINE size_t field_bound(const T& ext) {
+    constexpr const auto& field = std::get<I>(T::FIELDS);
+    if constexpr (is_text<field_type<T, I>>::value) {
+        return detail_value_bound(ext.*field.member);
+    } else {
+        return field.open_size + 1 + detail_value_bound(ext.*field.member);
+    }
+}
+
+template <class T, size_t I>
+COT_DETAIL_INLINE char* write_field(char* p, const T& ext) {
+    constexpr const auto& field = std::get<I>(T::FIELDS);
+    if constexpr (is_text<field_type<T, I>>::value) {
+        return p;
+    } else {
+        std::memcpy(p, field.open, field.open_size);
+        p = put_detail_value(p + field.open_size, ext.*field.member, field.precision);
+        *p++ = '"';
+        return p;
+    }
+}
+
+template <class T, size_t I>
+COT_DETAIL_INLINE char* write_text(char* p, const T& ext) {
+    constexpr const auto& field = std::get<I>(T::FIELDS);
+    if constexpr (is_text<field_type<T, I>>::value) {
+        return put_detail_value(p, ext.*field.member, -1);
+    } else {
+        return p;
+    }
+}
+
+// False for a floating point field holding NaN or infinity
+template <class T, size_t I>
+COT_DETAIL_INLINE bool field_finite(const T& ext) {
+    constexpr const auto& field = std::get<I>(T::FIELDS);
+    if constexpr (std::is_floating_point_v<std::decay_t<decltype(ext.*field.member)>>) {
+        return std::isfinite(ext.*field.member);
+    } else {
+        return true;
+    }
+}
+
+template <class T, size_t... I>
+COT_DETAIL_INLINE bool element_finite(const T& ext, std::index_sequence<I...>) {
+    return (field_finite<T, I>(ext) && ...);
+}
+
+template <class T, size_t... I>
+COT_DETAIL_INLINE size_t element_bound(const T& ext, std::index_sequence<I...>) {
+    return 2 * T::ELEMENT.size() + 5 + (size_t(0) + ... + field_bound<T, I>(ext));
+}
+
+template <class T, size_t... I>
+COT_DETAIL_INLINE char* write_element(char* p, const T& ext, std::index_sequence<I...>) {
+    constexpr std::string_view element = T::ELEMENT;
+    *p++ = '<';
+    p += element.copy(p, element.size());
+    ((p = write_field<T, I>(p, ext)), ...);
+    if constexpr ((is_text<field_type<T, I>>::value || ...)) {
+        *p++ = '>';
+        ((p = write_text<T, I>(p, ext)), ...);
+        *p++ = '<';
+        *p++ = '/';
+        p += element.copy(p, element.size());
+        *p++ = '>';
+    } else {
+        *p++ = '/';
+        *p++ = '>';
+    }
+    return p;
+}
+
+// Decode the attribute if it is this field's; ok turns false on a bad value
+template <class T, size_t I>
+COT_DETAIL_INLINE bool read_field(std::string_view name, std::string_view raw, T& ext, BatchArena& arena,
+                                  bool& ok) {
+    constexpr const auto& field = std::get<I>(T::FIELDS);
+    if constexpr (is_text<field_type<T, I>>::value) {
+        return false;
+    } else {
+        if (name != field.name) return false;
+        ok = parse_detail_value(raw, ext.*field.member, arena) && ok;
+        return true;
+    }
+}
+
+template <class T, size_t I>
+COT_DETAIL_INLINE bool read_text(const CoTTape& tape, uint32_t element, T& ext, BatchArena& arena) {
+    constexpr const auto& field = std::get<I>(T::FIELDS);
+    if constexpr (is_text<field_type<T, I>>::value) {
+        return parse_detail_value(tape.text(element), ext.*field.member, arena);
+    } else {
+        return true;
+    }
+}
+
+template <class T, size_t... I>
+COT_DETAIL_INLINE bool read_element(const CoTTape& tape, uint32_t element, T& ext, BatchArena& arena,
+                                    std::index_sequence<I...>) {
+    bool ok = true;
+    const CoTTape::Attribute* attrs = tape.attributes_of(element);
+    for (uint32_t i = 0; i < tape.element(element).attribute_count; i++) {
+        std::string_view name = tape.attribute_name(attrs[i]);
+        std::string_view raw = tape.attribute_value(attrs[i]);
+        (read_field<T, I>(name, raw, ext, arena, ok) || ...);
+    }
+    return (read_text<T, I>(tape, element, ext, arena) && ...) && ok;
+}
+
+} // namespace detail_codec
+
+// Append <ELEMENT attr="..."/>, or <ELEMENT ...>text</ELEMENT> for an
+// extension with a text field. False, with nothing appended, if a floating
+// point field is NaN or infinite, as read_detail() could not read it back.
+template <class T>
+bool write_detail(std::string& out, const T& ext) {
+    using namespace detail_codec;
+    constexpr auto fields = std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(T::FIELDS)>>>();
+    if (!element_finite(ext, fields)) {
+        return false;
+    }
+
+    // Most elements fit on the stack and are appended once; larger ones are
+    // written in place into the most they can take, then trimmed
+    size_t bound = element_bound(ext, fields);
+    char buffer[DETAIL_STACK_BYTES];
+    if (bound <= sizeof(buffer)) {
+        out.append(buffer, write_element(buffer, ext, fields) - buffer);
+        return true;
+    }
+    size_t size = out.size();
+    out.resize(size + bound);
+    out.resize(write_element(&out[size], ext, fields) - out.data());
+    return true;
+}
+
+// Fill ext from one element of a parsed document. Attributes that are not
+// fields are ignored and missing ones keep their value. False if a value
+// does not parse as its member's type.
+template <class T>
+bool read_detail(const CoTTape& tape, uint32_t element, T& ext, BatchArena& arena) {
+    using namespace detail_codec;
+    return read_element(tape, element, ext, arena,
+                        std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(T::FIELDS)>>>());
+}
+
+// The event's detail/ELEMENT; false if it is absent or malformed
+template <class T>
+bool find_detail(const CoTTape& tape, T& ext, BatchArena& arena) {
+    uint32_t detail = tape.child(0, "detail");
+    uint32_t element = detail == CoTTape::NONE ? CoTTape::NONE : tape.child(detail, T::ELEMENT);
+    return element != CoTTape::NONE && read_detail(tape, element, ext, arena);
+}
+
+// Extensions in common use
+
+struct ContactDetail {
+    static constexpr std::string_view ELEMENT = "contact";
+    std::string_view callsign;
+    std::string_view endpoint;
+    std::string_view phone;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("callsign", &ContactDetail::callsign),
+        detail_attribute("endpoint", &ContactDetail::endpoint),
+        detail_attribute("phone", &ContactDetail::phone));
+};
+
+struct GroupDetail {
+    static constexpr std::string_view ELEMENT = "__group";
+    std::string_view name;
+    std::string_view role;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("name", &GroupDetail::name),
+        detail_attribute("role", &GroupDetail::role));
+};
+
+struct UidDetail {
+    static constexpr std::string_view ELEMENT = "uid";
+    std::string_view droid;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("Droid", &UidDetail::droid));
+};
+
+struct StatusDetail {
+    static constexpr std::string_view ELEMENT = "status";
+    bool readiness = true;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("readiness", &StatusDetail::readiness));
+};
+
+struct TakvDetail {
+    static constexpr std::string_view ELEMENT = "takv";
+    std::string_view device;
+    std::string_view platform;
+    std::string_view os;
+    std::string_view version;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("device", &TakvDetail::device),
+        detail_attribute("platform", &TakvDetail::platform),
+        detail_attribute("os", &TakvDetail::os),
+        detail_attribute("version", &TakvDetail::version));
+};
+
+struct TrackDetail {
+    static constexpr std::string_view ELEMENT = "track";
+    double speed = 0.0;      // m/s
+    double course = 0.0;     // Degrees true
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("speed", &TrackDetail::speed, 8),
+        detail_attribute("course", &TrackDetail::course, 8));
+};
+
+struct UserIconDetail {
+    static constexpr std::string_view ELEMENT = "usericon";
+    std::string_view iconsetpath;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("iconsetpath", &UserIconDetail::iconsetpath));
+};
+
+struct FlowTagsDetail {
+    static constexpr std::string_view ELEMENT = "_flow-tags_";
+    std::string_view marti_tags;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("marti:tags", &FlowTagsDetail::marti_tags));
+};
+
+struct RemarksDetail {
+    static constexpr std::string_view ELEMENT = "remarks";
+    std::string_view text;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_text(&RemarksDetail::text));
+};
+
+struct ArchiveDetail {
+    static constexpr std::string_view ELEMENT = "archive";
+    static constexpr auto FIELDS = std::make_tuple();
+};
+
+struct LinkDetail {
+    static constexpr std::string_view ELEMENT = "link";
+    std::string_view relation;
+    std::string_view type;
+    std::string_view uid;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("relation", &LinkDetail::relation),
+        detail_attribute("type", &LinkDetail::type),
+        detail_attribute("uid", &LinkDetail::uid));
+};
+
+struct PrecisionLocationDetail {
+    static constexpr std::string_view ELEMENT = "precisionlocation";
+    std::string_view altsrc;
+    std::string_view geopointsrc;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("altsrc", &PrecisionLocationDetail::altsrc),
+        detail_attribute("geopointsrc", &PrecisionLocationDetail::geopointsrc));
+};
+
+} // namespace CoTCommon
+
+#endif // COT_DETAIL_H
@@ -0,0 +1,233 @@
+#include "cot_common.h"
+#include "cot_detail.h"
+#include "cot_takproto.h"
+#include <cstdio>
+#include <limits>
+#include <string>
+
+// Round trips through the generated detail codecs: write_detail() output
+// read back with read_detail(), CoTObject::to_xml() parsed back into the
+// extension structs, and the same details carried over TAK Protocol. Event
+// fields must decode the same way on the XML and TAK Protocol paths.
+// Prints every check that fails and exits nonzero, so it can run under
+// CTest.
+
+using namespace CoTCommon;
+
+namespace {
+
+// One member of every supported type
+struct SampleDetail {
+    static constexpr std::string_view ELEMENT = "__sample";
+    std::string label;
+    std::string_view note;
+    int32_t level = 0;
+    uint64_t serial = 0;
+    float ratio = 0.0f;
+    double exact = 0.0;
+    bool active = false;
+    static constexpr auto FIELDS = std::make_tuple(
+        detail_attribute("label", &SampleDetail::label),
+        detail_attribute("note", &SampleDetail::note),
+        detail_attribute("level", &SampleDetail::level),
+        detail_attribute("serial", &SampleDetail::serial),
+        detail_attribute("ratio", &SampleDetail::ratio, 3),
+        detail_attribute("exact", &SampleDetail::exact),
+        detail_attribute("active", &SampleDetail::active));
+};
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// Parse "<event><detail>body</detail></event>" into doc and read T from it;
+// string members view doc
+template <class T>
+bool read_back(std::string& doc, const std::string& body, T& ext, BatchArena& arena) {
+    CoTParser parser;
+    CoTParser::CoTMessageView msg;
+    doc = "<event version=\"2.0\" uid=\"u\" type=\"a-f-G\" how=\"m-g\"><detail>" + body + "</detail></event>";
+    return parser.parse_view(doc, msg, arena) && msg.detail(ext, arena);
+}
+
+void check_sample() {
+    BatchArena arena;
+    std::string doc;
+    SampleDetail in;
+    in.label = "x&y \"z\" <w>";
+    in.note = "it's";
+    in.level = -42;
+    in.serial = 1ULL << 60;
+    in.ratio = 0.125f;
+    in.exact = 0.1;
+    in.active = true;
+
+    std::string xml;
+    write_detail(xml, in);
+    check(xml == "<__sample label=\"x&amp;y &quot;z&quot; &lt;w&gt;\" note=\"it&apos;s\" level=\"-42\" "
+                 "serial=\"1152921504606846976\" ratio=\"0.125\" exact=\"0.1\" active=\"true\"/>",
+          "write_detail output of every member type");
+
+    SampleDetail out;
+    check(read_back(doc, xml, out, arena), "read_detail of every member type");
+    check(out.label == in.label && out.note == in.note, "escaped strings round trip");
+    check(out.level == in.level && out.serial == in.serial, "integers round trip");
+    check(out.ratio == in.ratio && out.exact == in.exact, "floating point round trips");
+    check(out.active, "bool round trips");
+
+    // Fields in declaration order, as the header example shows
+    xml.clear();
+    write_detail(xml, TrackDetail{12.5, 270.0});
+    check(xml == "<track speed=\"12.50000000\" course=\"270.00000000\"/>", "track writes speed then course");
+
+    // Too many digits for fixed notation falls back to the shortest form
+    xml.clear();
+    check(write_detail(xml, TrackDetail{1e60, -2.5e300}), "huge track values are written");
+    TrackDetail huge;
+    check(read_back(doc, xml, huge, arena) && huge.speed == 1e60 && huge.course == -2.5e300,
+          "huge track values round trip");
+
+    // NaN and infinity are rejected before anything is written
+    xml = "kept";
+    check(!write_detail(xml, TrackDetail{std::numeric_limits<double>::quiet_NaN(), 0.0}) && xml == "kept",
+          "NaN is rejected");
+    check(!write_detail(xml, TrackDetail{0.0, std::numeric_limits<double>::infinity()}) && xml == "kept",
+          "infinity is rejected");
+    SampleDetail inf_ratio = in;
+    inf_ratio.ratio = -std::numeric_limits<float>::infinity();
+    check(!write_detail(xml, inf_ratio) && xml == "kept", "infinite float is rejected");
+
+    // Past the stack buffer the element is written in place
+    std::string long_remarks(DETAIL_STACK_BYTES, 'r');
+    long_remarks += " & more";
+    xml.clear();
+    write_detail(xml, RemarksDetail{long_remarks});
+    RemarksDetail remarks;
+    check(read_back(doc, xml, remarks, arena) && remarks.text == long_remarks, "long text field round trips");
+
+    // Unknown attributes are ignored, missing ones keep their value and a
+    // bad number fails the read
+    TrackDetail track{1.0, 2.0};
+    check(read_back(doc, "<track extra=\"x\" course=\"90\"/>", track, arena) && track.speed == 1.0 && track.course == 90.0,
+          "missing and unknown attributes");
+    check(!read_back(doc, "<track speed=\"fast\"/>", track, arena), "malformed number is rejected");
+    StatusDetail status;
+    check(!read_back(doc, "<status readiness=\"maybe\"/>", status, arena), "malformed bool is rejected");
+    check(!read_back(doc, "<contact callsign=\"a\"/>", track, arena), "absent element is reported");
+}
+
+void check_object() {
+    BatchArena arena;
+    CoTParser parser;
+    CoTParser::CoTMessageView msg;
+    CoTObject obj("SFGPUCI----D", 38.5, -77.25, 10.0, "Alpha & <1>", "Cyan", "h-e", true);
+    std::string xml = obj.to_xml();
+    if (!parser.parse_view(xml, msg, arena)) {
+        check(false, "to_xml output parses");
+        return;
+    }
+
+    ContactDetail contact;
+    GroupDetail group;
+    TrackDetail track;
+    RemarksDetail remarks;
+    LinkDetail link;
+    UserIconDetail icon;
+    PrecisionLocationDetail location;
+    check(msg.detail(contact, arena) && contact.callsign == "Alpha & <1>" && contact.endpoint == "*:-1:stcp",
+          "to_xml contact");
+    check(msg.callsign_str() == "Alpha & <1>" && msg.team_str() == "Cyan", "to_xml callsign and team as parsed");
+    check(msg.detail(group, arena) && group.name == "Cyan" && group.role == "Team Member", "to_xml group");
+    check(msg.detail(track, arena) && track.speed == 0.0 && track.course == 0.0, "to_xml track");
+    check(msg.detail(remarks, arena) && remarks.text == "Persistent tactical object", "to_xml remarks");
+    check(msg.detail(link, arena) && link.uid == "ANDROID-" && link.relation == "p-p", "to_xml link");
+    check(msg.detail(icon, arena) && icon.iconsetpath.find("2525C") != std::string_view::npos, "to_xml usericon");
+    check(msg.detail(location, arena) && location.altsrc == "DTED0", "to_xml precisionlocation");
+
+    // The TAK Protocol encoder carries the same elements
+    TakEncoder encoder;
+    std::string framed;
+    encoder.encode(obj, framed);
+    TakFramer framer;
+    framer.append(framed.data(), framed.size());
+    std::string_view payload;
+    std::string back;
+    if (!framer.next(payload) || !tak_to_xml(payload, back)) {
+        check(false, "TAK Protocol message decodes");
+        return;
+    }
+    CoTParser::CoTMessageView decoded;
+    check(parser.parse_view(back, decoded, arena), "decoded TAK Protocol event parses");
+    ContactDetail contact2;
+    RemarksDetail remarks2;
+    LinkDetail link2;
+    check(decoded.detail(contact2, arena) && contact2.callsign == contact.callsign, "TAK Protocol contact");
+    check(decoded.callsign_str() == "Alpha & <1>" && decoded.team_str() == "Cyan",
+          "TAK Protocol callsign and team as parsed");
+    check(decoded.detail(remarks2, arena) && remarks2.text == remarks.text, "TAK Protocol remarks");
+    check(decoded.detail(link2, arena) && link2.uid == link.uid, "TAK Protocol link");
+}
+
+// Frame xml as TAK Protocol and decode it straight into a view
+bool decode_framed(TakEncoder& encoder, std::string_view xml, CoTParser::CoTMessageView& msg, BatchArena& arena) {
+    std::string framed;
+    if (!encoder.encode_xml(xml, framed)) return false;
+    TakFramer framer;
+    framer.append(framed.data(), framed.size());
+    std::string_view payload;
+    return framer.next(payload) && decode_tak_message(payload, msg, arena);
+}
+
+void check_escaped_event() {
+    BatchArena arena;
+    CoTParser parser;
+    CoTParser::CoTMessageView msg;
+    CoTObject obj("SFGPUCI----D", 38.5, -77.25, 10.0, "Alpha \"1\" & Co", "R&D", "h-e", true);
+    obj.set_uid("uid<&>'1'");
+    std::string xml = obj.to_xml();
+
+    // Event fields come back decoded from XML and from TAK Protocol alike
+    check(parser.parse_view(xml, msg, arena) && msg.uid == "uid<&>'1'" && msg.callsign_str() == "Alpha \"1\" & Co" &&
+              msg.team_str() == "R&D",
+          "parse_view decodes uid, callsign and team");
+    TakEncoder encoder;
+    CoTParser::CoTMessageView decoded;
+    check(decode_framed(encoder, xml, decoded, arena) && decoded.uid == msg.uid &&
+              decoded.callsign_str() == msg.callsign_str() && decoded.team_str() == msg.team_str(),
+          "TAK Protocol decodes uid, callsign and team");
+
+    // A contact the schema cannot hold stays in xmlDetail, still escaped
+    std::string extra = "<event version=\"2.0\" uid=\"u\" type=\"a-f-G\" how=\"m-g\"><point lat=\"1\" lon=\"2\" "
+                        "hae=\"0\" ce=\"9\" le=\"9\"/><detail><contact callsign=\"A &amp; B\" extra=\"1\"/></detail></event>";
+    check(decode_framed(encoder, extra, decoded, arena) && decoded.callsign_str() == "A & B",
+          "TAK Protocol decodes a callsign from xmlDetail");
+
+    // Strings that are not UTF-8 are rejected on both paths
+    std::string bad = extra;
+    bad.replace(bad.find("A &amp; B"), 9, "A \xC3\x28 B");
+    check(!parser.parse_view(bad, msg, arena), "parse_view rejects malformed UTF-8");
+    check(!decode_framed(encoder, bad, decoded, arena), "TAK Protocol rejects a malformed UTF-8 callsign");
+    bad = extra;
+    bad.replace(bad.find("uid=\"u\""), 7, "uid=\"\xFF\"");
+    check(!decode_framed(encoder, bad, decoded, arena), "TAK Protocol rejects a malformed UTF-8 uid");
+}
+
+} // namespace
+
+int main() {
+    check_sample();
+    check_object();
+    check_escaped_event();
+
+    if (failures > 0) {
+        printf("%d detail check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All detail checks passed\n");
+    return 0;
+}
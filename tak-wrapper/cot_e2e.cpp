@@ -0,0 +1,660 @@
+#include "cot_common.h"
+#include "cot_latency.h"
+#include "cot_pipeline.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+
+struct E2EOptions {
+    std::string broker_path;     // Default: cot_broker next to this executable
+    int receivers = 2;
+    double start_rate = 1000.0;  // Events/s of the first step
+    double step_factor = 2.0;
+    double max_rate = 1000000.0;
+    double step_seconds = 2.0;
+    double max_p99_ms = 50.0;    // A step with a slower p99 is not sustained
+    double require_rate = 0.0;   // Fail unless at least this rate is sustained
+    std::string json_file;
+    bool keep_going = false;     // Run every step even after one fails
+    bool low_latency = false;    // Sender and receivers as cot_listener --low-latency
+    int spin_us = 200;
+    bool verbose = false;
+};
+
+// Self-contained end-to-end load test over loopback TLS.
+//
+// The harness generates a CA and server/client certificates, starts
+// cot_broker on a free port with client certificates required, and connects
+// one sender and several receivers to it through TAKServerConnection. The
+// sender paces events at each step's rate. Receivers frame and parse them
+// as the listener does (CoTFramer, CoTParser::parse_view), and read the
+// sequence number and send time from a <__e2e> detail element.
+//
+// Latency is measured from each event's scheduled send time rather than
+// the time it was actually written. When the sender falls behind, the
+// backlog shows up as latency instead of being hidden. A step is sustained
+// when the sender kept up, every receiver got every event, and the p99
+// latency stayed under the limit.
+class LoopbackHarness {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct StepData {
+        uint64_t received = 0;
+        std::vector<int64_t> latency_ns;
+    };
+
+    struct Receiver {
+        std::unique_ptr<CoTCommon::TAKServerConnection> connection;
+        std::thread thread;
+        std::mutex mutex;            // Guards steps and errors
+        std::vector<StepData> steps;
+        uint64_t errors = 0;         // Events that failed to parse
+    };
+
+    struct StepResult {
+        double target_rate;
+        double send_rate;            // Achieved by the sender
+        uint64_t sent;
+        uint64_t delivered;          // Summed over receivers
+        uint64_t expected;
+        double p50_ms, p90_ms, p99_ms, p999_ms, max_ms;
+        bool sustained;
+    };
+
+    E2EOptions options;
+    std::string work_dir;
+    int port;
+    pid_t broker_pid;
+    Clock::time_point epoch;
+    std::atomic<bool> stopping;
+
+    std::unique_ptr<CoTCommon::TAKServerConnection> sender;
+    std::vector<std::unique_ptr<Receiver>> receivers;
+    std::vector<double> rates;
+    std::vector<StepResult> results;
+
+    // Rendered event split around the spot where <__e2e> goes
+    std::string event_head;
+    std::string event_tail;
+
+    std::string path(const char* name) const { return work_dir + "/" + name; }
+
+    static EVP_PKEY* generate_key() {
+        EVP_PKEY* key = nullptr;
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        if (ctx && EVP_PKEY_keygen_init(ctx) > 0 &&
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) > 0) {
+            EVP_PKEY_keygen(ctx, &key);
+        }
+        EVP_PKEY_CTX_free(ctx);
+        return key;
+    }
+
+    // Issue a certificate for key, signed by issuer (self-signed if null)
+    static X509* issue(EVP_PKEY* key, const char* common_name, long serial, X509* issuer, EVP_PKEY* issuer_key,
+                       bool is_ca) {
+        X509* cert = X509_new();
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), serial);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 7 * 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>(common_name), -1, -1, 0);
+        X509_set_issuer_name(cert, issuer ? X509_get_subject_name(issuer) : name);
+
+        X509V3_CTX ctx;
+        X509V3_set_ctx_nodb(&ctx);
+        X509V3_set_ctx(&ctx, issuer ? issuer : cert, cert, nullptr, nullptr, 0);
+        const char* constraints = is_ca ? "critical,CA:TRUE" : "critical,CA:FALSE";
+        X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &ctx, NID_basic_constraints, constraints);
+        if (ext) {
+            X509_add_ext(cert, ext, -1);
+            X509_EXTENSION_free(ext);
+        }
+        if (X509_sign(cert, issuer_key ? issuer_key : key, EVP_sha256()) <= 0) {
+            X509_free(cert);
+            return nullptr;
+        }
+        return cert;
+    }
+
+    static bool write_pem(const std::string& file, X509* cert, EVP_PKEY* key) {
+        FILE* f = fopen(file.c_str(), "w");
+        if (!f) return false;
+        bool ok = cert ? PEM_write_X509(f, cert) == 1
+                       : PEM_write_PrivateKey(f, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        return fclose(f) == 0 && ok;
+    }
+
+    // CA plus server and client certificates, valid for a week
+    bool generate_certificates() {
+        EVP_PKEY* ca_key = generate_key();
+        EVP_PKEY* server_key = generate_key();
+        EVP_PKEY* client_key = generate_key();
+        X509* ca = ca_key ? issue(ca_key, "cot_e2e CA", 1, nullptr, nullptr, true) : nullptr;
+        X509* server = ca && server_key ? issue(server_key, "localhost", 2, ca, ca_key, false) : nullptr;
+        X509* client = ca && client_key ? issue(client_key, "cot_e2e client", 3, ca, ca_key, false) : nullptr;
+
+        bool ok = ca && server && client &&
+                  write_pem(path("ca.pem"), ca, nullptr) &&
+                  write_pem(path("server.pem"), server, nullptr) &&
+                  write_pem(path("server.key"), nullptr, server_key) &&
+                  write_pem(path("client.pem"), client, nullptr) &&
+                  write_pem(path("client.key"), nullptr, client_key);
+        if (!ok) {
+            std::cerr << "Error generating test certificates\n";
+            ERR_print_errors_fp(stderr);
+        }
+        X509_free(ca);
+        X509_free(server);
+        X509_free(client);
+        EVP_PKEY_free(ca_key);
+        EVP_PKEY_free(server_key);
+        EVP_PKEY_free(client_key);
+        return ok;
+    }
+
+    static int free_port() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        int result = -1;
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+            getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+            result = ntohs(addr.sin_port);
+        }
+        close(fd);
+        return result;
+    }
+
+    bool port_open() const {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bool open = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        close(fd);
+        return open;
+    }
+
+    bool start_broker() {
+        port = free_port();
+        if (port <= 0) {
+            std::cerr << "No free port on 127.0.0.1\n";
+            return false;
+        }
+        // Queue limits high enough that an overloaded step shows up as
+        // latency and loss rather than evictions
+        std::vector<std::string> args = {options.broker_path, "--bind", "127.0.0.1",
+                                         "--tls-port", std::to_string(port), "--tcp-port", "0",
+                                         "--cert", path("server.pem"), "--key", path("server.key"),
+                                         "--ca", path("ca.pem"), "--max-queue", "268435456",
+                                         "--max-lag", "60", "--max-clients", "64"};
+        broker_pid = fork();
+        if (broker_pid < 0) {
+            std::cerr << "fork failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (broker_pid == 0) {
+            if (!options.verbose) {
+                FILE* null_out = freopen("/dev/null", "w", stdout);
+                (void)null_out;
+            }
+            std::vector<char*> argv;
+            for (auto& arg : args) argv.push_back(&arg[0]);
+            argv.push_back(nullptr);
+            execv(argv[0], argv.data());
+            std::cerr << "Cannot run " << args[0] << ": " << strerror(errno) << std::endl;
+            _exit(127);
+        }
+
+        for (int i = 0; i < 500; i++) {
+            int status;
+            if (waitpid(broker_pid, &status, WNOHANG) == broker_pid) {
+                std::cerr << "cot_broker exited during startup\n";
+                broker_pid = -1;
+                return false;
+            }
+            if (port_open()) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::cerr << "cot_broker did not start listening on port " << port << std::endl;
+        return false;
+    }
+
+    void stop_broker() {
+        if (broker_pid <= 0) return;
+        kill(broker_pid, SIGTERM);
+        int status;
+        waitpid(broker_pid, &status, 0);
+        broker_pid = -1;
+    }
+
+    std::unique_ptr<CoTCommon::TAKServerConnection> make_connection() const {
+        auto connection = std::make_unique<CoTCommon::TAKServerConnection>("127.0.0.1", port, path("client.pem"),
+                                                                           path("client.key"), path("ca.pem"), "",
+                                                                           false);
+        if (options.low_latency) {
+            connection->set_low_latency(0);  // Nothing to busy-poll on loopback
+        }
+        return connection;
+    }
+
+    int64_t now_ns() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+    }
+
+    static bool read_number(std::string_view text, int64_t& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    void receive_loop(Receiver& receiver) {
+        CoTCommon::CoTFramer framer(1024 * 1024);
+        CoTCommon::CoTParser parser;
+        CoTCommon::BatchArena arena;
+        CoTCommon::CoTParser::CoTMessageView view;
+        std::vector<char> buffer(65536);
+        std::vector<std::pair<int64_t, int64_t>> batch;  // (step, latency)
+        uint64_t errors = 0;
+
+        receiver.connection->set_nonblocking(true);
+        CoTCommon::SpinReader reader(*receiver.connection, options.low_latency ? options.spin_us : 0);
+        while (!stopping) {
+            int received = reader.read(buffer.data(), buffer.size(), 50);
+            if (received < 0) break;
+            if (received == 0) continue;
+            int64_t arrived = now_ns();
+            framer.append(buffer.data(), received);
+            std::string_view event;
+            arena.reset();
+            batch.clear();
+            while (framer.next(event)) {
+                int64_t step, sent;
+                if (!parser.parse_view(event, view, arena) || !read_number(view.field("detail/__e2e@step"), step) ||
+                    !read_number(view.field("detail/__e2e@sent"), sent) || step < 0 ||
+                    step >= static_cast<int64_t>(rates.size())) {
+                    errors++;
+                    continue;
+                }
+                batch.emplace_back(step, arrived - sent);
+            }
+            framer.compact();
+
+            std::lock_guard<std::mutex> lock(receiver.mutex);
+            for (const auto& entry : batch) {
+                StepData& data = receiver.steps[entry.first];
+                data.received++;
+                data.latency_ns.push_back(entry.second);
+            }
+            receiver.errors = errors;
+        }
+    }
+
+    // Pace one step's events and return how many were sent
+    uint64_t send_step(size_t step, double rate, double& send_rate) {
+        const uint64_t total = static_cast<uint64_t>(rate * options.step_seconds);
+        const size_t max_batch = 512;
+        std::string batch;
+        std::string prefix = "<__e2e step=\"" + std::to_string(step) + "\" seq=\"";
+        int64_t start = now_ns();
+        uint64_t sent = 0;
+        while (sent < total) {
+            // Everything scheduled up to now goes out in one write
+            int64_t now = now_ns();
+            uint64_t due = std::min<uint64_t>(total, static_cast<uint64_t>((now - start) * rate / 1e9) + 1);
+            if (due <= sent) {
+                int64_t next = start + static_cast<int64_t>(sent * 1e9 / rate);
+                std::this_thread::sleep_for(std::chrono::nanoseconds(std::min<int64_t>(next - now, 1000000)));
+                continue;
+            }
+            batch.clear();
+            for (uint64_t end = std::min<uint64_t>(due, sent + max_batch); sent < end; sent++) {
+                int64_t scheduled = start + static_cast<int64_t>(sent * 1e9 / rate);
+                batch += event_head;
+                batch += prefix;
+                batch += std::to_string(sent);
+                batch += "\" sent=\"";
+                batch += std::to_string(scheduled);
+                batch += "\"/>";
+                batch += event_tail;
+            }
+            if (!sender->send_data(batch)) {
+                std::cerr << "Sender lost its connection\n";
+                break;
+            }
+        }
+        double elapsed = (now_ns() - start) / 1e9;
+        send_rate = elapsed > 0.0 ? sent / elapsed : 0.0;
+        return sent;
+    }
+
+    // Wait until every receiver has the step's events, or time runs out
+    void drain(size_t step, uint64_t sent) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(
+            static_cast<int64_t>(std::max(1000.0, options.step_seconds * 1000.0)));
+        while (Clock::now() < deadline) {
+            bool complete = true;
+            for (auto& receiver : receivers) {
+                std::lock_guard<std::mutex> lock(receiver->mutex);
+                complete = complete && receiver->steps[step].received >= sent;
+            }
+            if (complete) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    StepResult collect(size_t step, double rate, uint64_t sent, double send_rate) {
+        StepResult result{};
+        result.target_rate = rate;
+        result.send_rate = send_rate;
+        result.sent = sent;
+        result.expected = sent * receivers.size();
+
+        std::vector<int64_t> latency;
+        for (auto& receiver : receivers) {
+            std::lock_guard<std::mutex> lock(receiver->mutex);
+            StepData& data = receiver->steps[step];
+            result.delivered += data.received;
+            latency.insert(latency.end(), data.latency_ns.begin(), data.latency_ns.end());
+            // Free the samples; stragglers still count against this step
+            std::vector<int64_t>().swap(data.latency_ns);
+        }
+        std::sort(latency.begin(), latency.end());
+        auto percentile = [&latency](double p) {
+            if (latency.empty()) return 0.0;
+            size_t index = std::min(latency.size() - 1, static_cast<size_t>(p * latency.size()));
+            return latency[index] / 1e6;
+        };
+        result.p50_ms = percentile(0.50);
+        result.p90_ms = percentile(0.90);
+        result.p99_ms = percentile(0.99);
+        result.p999_ms = percentile(0.999);
+        result.max_ms = latency.empty() ? 0.0 : latency.back() / 1e6;
+        result.sustained = sent > 0 && result.delivered >= result.expected && send_rate >= rate * 0.95 &&
+                           result.p99_ms <= options.max_p99_ms;
+        return result;
+    }
+
+    static void print_row(const StepResult& r) {
+        printf("%10.0f %10.0f %10llu %9.3f%% %8.2f %8.2f %8.2f %8.2f %8.2f  %s\n", r.target_rate, r.send_rate,
+               static_cast<unsigned long long>(r.sent),
+               r.expected ? 100.0 * (r.expected - std::min(r.expected, r.delivered)) / r.expected : 0.0,
+               r.p50_ms, r.p90_ms, r.p99_ms, r.p999_ms, r.max_ms, r.sustained ? "ok" : "NOT SUSTAINED");
+        fflush(stdout);
+    }
+
+public:
+    explicit LoopbackHarness(const E2EOptions& opts)
+        : options(opts), port(0), broker_pid(-1), epoch(Clock::now()), stopping(false) {
+        options.receivers = std::max(1, options.receivers);
+        options.step_factor = std::max(1.01, options.step_factor);
+        for (double rate = options.start_rate; rate <= options.max_rate * 1.0001; rate *= options.step_factor) {
+            rates.push_back(rate);
+        }
+    }
+
+    ~LoopbackHarness() {
+        shutdown();
+    }
+
+    bool setup() {
+        char dir_template[] = "/tmp/cot_e2e.XXXXXX";
+        if (!mkdtemp(dir_template)) {
+            std::cerr << "Cannot create a temporary directory: " << strerror(errno) << std::endl;
+            return false;
+        }
+        work_dir = dir_template;
+        if (rates.empty()) {
+            std::cerr << "No steps between --start-rate and --max-rate\n";
+            return false;
+        }
+        if (!generate_certificates() || !start_broker()) {
+            return false;
+        }
+
+        for (int i = 0; i < options.receivers; i++) {
+            auto receiver = std::make_unique<Receiver>();
+            receiver->connection = make_connection();
+            receiver->steps.resize(rates.size());
+            if (!receiver->connection->connect()) {
+                std::cerr << "Receiver " << i << " could not connect to the broker\n";
+                return false;
+            }
+            receivers.push_back(std::move(receiver));
+        }
+        sender = make_connection();
+        if (!sender->connect()) {
+            std::cerr << "Sender could not connect to the broker\n";
+            return false;
+        }
+        for (auto& receiver : receivers) {
+            Receiver* r = receiver.get();
+            r->thread = std::thread([this, r] { receive_loop(*r); });
+        }
+
+        // A typical injector event with the marker spliced into <detail>
+        CoTCommon::CoTObject obj(CoTCommon::MilStd2525::friendlyInfantry(), 39.7392, -104.9903, 1609.0,
+                                 "E2E-Sender", "Cyan");
+        std::string xml = obj.to_xml();
+        size_t split = xml.find("</detail>");
+        if (split == std::string::npos) {
+            std::cerr << "Rendered event has no <detail>\n";
+            return false;
+        }
+        event_head = xml.substr(0, split);
+        event_tail = xml.substr(split) + "\n";
+
+        // Let the broker register every client before the first step
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return true;
+    }
+
+    void shutdown() {
+        stopping = true;
+        for (auto& receiver : receivers) {
+            if (receiver->thread.joinable()) receiver->thread.join();
+            receiver->connection->disconnect();
+        }
+        receivers.clear();
+        if (sender) {
+            sender->disconnect();
+            sender.reset();
+        }
+        stop_broker();
+        if (!work_dir.empty()) {
+            for (const char* name : {"ca.pem", "server.pem", "server.key", "client.pem", "client.key"}) {
+                unlink(path(name).c_str());
+            }
+            rmdir(work_dir.c_str());
+            work_dir.clear();
+        }
+    }
+
+    void run() {
+        printf("%10s %10s %10s %10s %8s %8s %8s %8s %8s\n", "target/s", "sent/s", "events", "loss", "p50 ms",
+               "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+        for (size_t step = 0; step < rates.size(); step++) {
+            double send_rate = 0.0;
+            uint64_t sent = send_step(step, rates[step], send_rate);
+            drain(step, sent);
+            results.push_back(collect(step, rates[step], sent, send_rate));
+            print_row(results.back());
+            if (!results.back().sustained && !options.keep_going) break;
+        }
+    }
+
+    // Highest step rate sustained with every lower step also sustained
+    double max_sustained() const {
+        double best = 0.0;
+        for (const auto& r : results) {
+            if (!r.sustained) break;
+            best = r.target_rate;
+        }
+        return best;
+    }
+
+    int receiver_count() const { return options.receivers; }
+
+    uint64_t parse_errors() {
+        uint64_t total = 0;
+        for (auto& receiver : receivers) {
+            std::lock_guard<std::mutex> lock(receiver->mutex);
+            total += receiver->errors;
+        }
+        return total;
+    }
+
+    bool write_json(const std::string& file) const {
+        std::ofstream out(file);
+        if (!out) {
+            std::cerr << "Cannot write " << file << std::endl;
+            return false;
+        }
+        char line[512];
+        out << "{\n  \"format\": \"cot_e2e/1\",\n  \"receivers\": " << options.receivers
+            << ",\n  \"step_seconds\": " << options.step_seconds << ",\n  \"max_p99_ms\": " << options.max_p99_ms
+            << ",\n  \"max_sustained_rate\": " << max_sustained() << ",\n  \"steps\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const StepResult& r = results[i];
+            snprintf(line, sizeof(line),
+                     "    {\"target_rate\": %.0f, \"send_rate\": %.1f, \"sent\": %llu, \"delivered\": %llu, "
+                     "\"expected\": %llu, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, "
+                     "\"p999_ms\": %.3f, \"max_ms\": %.3f, \"sustained\": %s}%s\n",
+                     r.target_rate, r.send_rate, static_cast<unsigned long long>(r.sent),
+                     static_cast<unsigned long long>(r.delivered), static_cast<unsigned long long>(r.expected),
+                     r.p50_ms, r.p90_ms, r.p99_ms, r.p999_ms, r.max_ms, r.sustained ? "true" : "false",
+                     i + 1 < results.size() ? "," : "");
+            out << line;
+        }
+        out << "  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+};
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --broker <path>       cot_broker executable (default: next to this program)\n";
+    std::cout << "  --receivers <n>       Receiving clients (default: 2)\n";
+    std::cout << "  --start-rate <n>      Events/s of the first step (default: 1000)\n";
+    std::cout << "  --step-factor <x>     Rate multiplier between steps (default: 2)\n";
+    std::cout << "  --max-rate <n>        Highest rate to try (default: 1000000)\n";
+    std::cout << "  --step-seconds <s>    Duration of each step (default: 2)\n";
+    std::cout << "  --max-p99 <ms>        p99 latency above which a step is not sustained (default: 50)\n";
+    std::cout << "  --require-rate <n>    Exit with status 2 unless at least this rate is sustained\n";
+    std::cout << "  --keep-going          Run every step, even after one is not sustained\n";
+    std::cout << "  --json <file>         Write results as JSON\n";
+    std::cout << "  --low-latency         TCP_NODELAY/TCP_QUICKACK on all clients; receivers spin on\n";
+    std::cout << "                        empty reads before blocking\n";
+    std::cout << "  --spin-us <us>        Receiver spin budget with --low-latency (default: 200)\n";
+    std::cout << "  --verbose             Show the broker's output\n";
+    std::cout << "  --help                Show this help message\n";
+}
+
+int main(int argc, char* argv[]) {
+    E2EOptions options;
+
+    // Simple argument parsing
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--broker" && i + 1 < argc) {
+            options.broker_path = argv[++i];
+        } else if (std::string(argv[i]) == "--receivers" && i + 1 < argc) {
+            options.receivers = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--start-rate" && i + 1 < argc) {
+            options.start_rate = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--step-factor" && i + 1 < argc) {
+            options.step_factor = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--max-rate" && i + 1 < argc) {
+            options.max_rate = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--step-seconds" && i + 1 < argc) {
+            options.step_seconds = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--max-p99" && i + 1 < argc) {
+            options.max_p99_ms = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--require-rate" && i + 1 < argc) {
+            options.require_rate = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--keep-going") {
+            options.keep_going = true;
+        } else if (std::string(argv[i]) == "--low-latency") {
+            options.low_latency = true;
+        } else if (std::string(argv[i]) == "--spin-us" && i + 1 < argc) {
+            options.spin_us = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--json" && i + 1 < argc) {
+            options.json_file = argv[++i];
+        } else if (std::string(argv[i]) == "--verbose") {
+            options.verbose = true;
+        } else if (std::string(argv[i]) == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.broker_path.empty()) {
+        std::string self = argv[0];
+        size_t slash = self.rfind('/');
+        options.broker_path = (slash == std::string::npos ? std::string(".") : self.substr(0, slash)) + "/cot_broker";
+    }
+    if (access(options.broker_path.c_str(), X_OK) != 0) {
+        std::cerr << "Cannot run " << options.broker_path << "; pass --broker <path>\n";
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "CoT Loopback End-to-End Test (C++)\n";
+    std::cout << "==================================\n";
+    std::cout << "1 sender -> cot_broker (TLS, client certificates) -> " << options.receivers << " receivers, "
+              << options.step_seconds << " s per step, p99 limit " << options.max_p99_ms << " ms\n";
+#ifndef __OPTIMIZE__
+    std::cout << "Warning: built without optimization; configure with -DCMAKE_BUILD_TYPE=Release\n";
+#endif
+    std::cout << std::endl;
+
+    LoopbackHarness harness(options);
+    if (!harness.setup()) {
+        return 1;
+    }
+    harness.run();
+    uint64_t errors = harness.parse_errors();
+    harness.shutdown();
+
+    double best = harness.max_sustained();
+    std::cout << "\nMax sustained: " << static_cast<uint64_t>(best) << " events/s ("
+              << static_cast<uint64_t>(best * harness.receiver_count()) << " deliveries/s)" << std::endl;
+    if (errors > 0) {
+        std::cerr << errors << " received events could not be parsed\n";
+    }
+    if (!options.json_file.empty() && !harness.write_json(options.json_file)) {
+        return 1;
+    }
+
+    if (best <= 0.0) {
+        std::cerr << "The first step was not sustained\n";
+        return 2;
+    }
+    if (options.require_rate > 0.0 && best < options.require_rate) {
+        std::cerr << "Required " << options.require_rate << " events/s\n";
+        return 2;
+    }
+    return 0;
+}
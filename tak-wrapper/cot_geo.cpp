@@ -0,0 +1,531 @@
+#include "cot_geo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// Batch kernels are also built for AVX2 and picked at load time
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define COT_GEO_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#define COT_GEO_KERNEL
+#endif
+
+// Helpers must inline into the kernel loops for them to vectorise
+#if defined(__GNUC__)
+#define COT_GEO_INLINE inline __attribute__((always_inline))
+#define COT_GEO_UNROLL _Pragma("GCC unroll 16")
+#else
+#define COT_GEO_INLINE inline
+#define COT_GEO_UNROLL
+#endif
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double DEG = PI / 180.0;
+
+// WGS84
+constexpr double A = 6378137.0;
+constexpr double F = 1.0 / 298.257223563;
+constexpr double E2 = F * (2.0 - F);
+constexpr double E = 0.08181919084262149;  // sqrt(E2)
+constexpr double B = A * (1.0 - F);
+constexpr double EP2 = E2 / (1.0 - E2);
+constexpr double EARTH_RADIUS = 6371008.8;
+
+// Transverse Mercator (Krüger series, Karney 2011)
+constexpr double K0 = 0.9996;
+constexpr double N1 = F / (2.0 - F);
+constexpr double N2 = N1 * N1;
+constexpr double N3 = N2 * N1;
+constexpr double N4 = N3 * N1;
+constexpr double N5 = N4 * N1;
+constexpr double N6 = N5 * N1;
+constexpr double KA = K0 * A / (1.0 + N1) * (1.0 + N2 / 4.0 + N4 / 64.0 + N6 / 256.0);
+
+constexpr double ALPHA[6] = {
+    N1 / 2 - 2 * N2 / 3 + 5 * N3 / 16 + 41 * N4 / 180 - 127 * N5 / 288 + 7891 * N6 / 37800,
+    13 * N2 / 48 - 3 * N3 / 5 + 557 * N4 / 1440 + 281 * N5 / 630 - 1983433 * N6 / 1935360,
+    61 * N3 / 240 - 103 * N4 / 140 + 15061 * N5 / 26880 + 167603 * N6 / 181440,
+    49561 * N4 / 161280 - 179 * N5 / 168 + 6601661 * N6 / 7257600,
+    34729 * N5 / 80640 - 3418889 * N6 / 1995840,
+    212378941 * N6 / 319334400,
+};
+
+constexpr double BETA[6] = {
+    N1 / 2 - 2 * N2 / 3 + 37 * N3 / 96 - N4 / 360 - 81 * N5 / 512 + 96199 * N6 / 604800,
+    N2 / 48 + N3 / 15 - 437 * N4 / 1440 + 46 * N5 / 105 - 1118711 * N6 / 3870720,
+    17 * N3 / 480 - 37 * N4 / 840 - 209 * N5 / 4480 + 5569 * N6 / 90720,
+    4397 * N4 / 161280 - 11 * N5 / 504 - 830251 * N6 / 7257600,
+    4583 * N5 / 161280 - 108847 * N6 / 3991680,
+    20648693 * N6 / 638668800,
+};
+
+constexpr double FALSE_EASTING = 500000.0;
+constexpr double FALSE_NORTHING = 10000000.0;
+
+constexpr double ROUND_MAGIC = 6755399441055744.0;
+
+// The math below replaces libm so the kernels stay vectorisable: Taylor
+// polynomials after range reduction, selects instead of branches.
+
+// Round to nearest by adding and subtracting 1.5 * 2^52
+COT_GEO_INLINE double round_magic(double x) {
+    return (x + ROUND_MAGIC) - ROUND_MAGIC;
+}
+
+// sin and cos of r (|r| <= pi/4) shifted by q quarter turns. Only q mod 4
+// matters, taken as q - 4 round(q / 4) in {-2, -1, 0, 1, 2}; all selects
+// are on doubles so they become vector blends.
+COT_GEO_INLINE void sincos_reduced(double r, double q, double& s, double& c) {
+    double r2 = r * r;
+    double ps = r + r * r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 + r2 * (1.0 / 362880 +
+                r2 * (-1.0 / 39916800 + r2 * (1.0 / 6227020800 + r2 * (-1.0 / 1307674368000)))))));
+    double pc = 1.0 + r2 * (-0.5 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 + r2 * (1.0 / 40320 +
+                r2 * (-1.0 / 3628800 + r2 * (1.0 / 479001600 + r2 * (-1.0 / 87178291200 +
+                r2 * (1.0 / 20922789888000))))))));
+
+    double m = q - 4.0 * round_magic(q * 0.25);
+    double am = std::fabs(m);
+    double sv = am == 1.0 ? pc : ps;
+    double cv = am == 1.0 ? ps : pc;
+    s = (m < 0.0 || m == 2.0) ? -sv : sv;
+    c = (m == 1.0 || am == 2.0) ? -cv : cv;
+}
+
+// Reduced in degrees, where multiples of 90 are exact
+COT_GEO_INLINE void sincos_deg(double degrees, double& s, double& c) {
+    double q = round_magic(degrees * (1.0 / 90.0));
+    sincos_reduced((degrees - q * 90.0) * DEG, q, s, c);
+}
+
+COT_GEO_INLINE void sincos_rad(double x, double& s, double& c) {
+    constexpr double PIO2_HI = 1.57079632673412561417e+00;  // First 33 bits of pi/2
+    constexpr double PIO2_LO = 6.07710050650619224932e-11;  // pi/2 - PIO2_HI
+    double q = round_magic(x * (2.0 / PI));
+    sincos_reduced((x - q * PIO2_HI) - q * PIO2_LO, q, s, c);
+}
+
+// Cephes atan rational approximation on [0, 1], then octant fix-up
+COT_GEO_INLINE double atan2_kernel(double y, double x) {
+    constexpr double MOREBITS = 6.123233995736765886130e-17;  // pi/2 - double(pi/2)
+    double ax = std::fabs(x);
+    double ay = std::fabs(y);
+    double hi = ax > ay ? ax : ay;
+    double lo = ax > ay ? ay : ax;
+    double a = lo / (hi > 0.0 ? hi : 1.0);
+
+    // Both candidates are computed so the select needs no branch
+    bool upper = a > 0.66;
+    double shifted = (a - 1.0) / (a + 1.0);
+    double t = upper ? shifted : a;
+    double z = t * t;
+    double p = (((-8.750608600031904122785e-1 * z - 1.615753718733365076637e1) * z -
+                 7.500855792314704667340e1) * z - 1.228866684490136173410e2) * z - 6.485021904942025371773e1;
+    double q = ((((z + 2.485846490142306297962e1) * z + 1.650270098316988542046e2) * z +
+                 4.328810604912902668951e2) * z + 4.853903996359136964868e2) * z + 1.945506571482613964425e2;
+    double r = t + t * z * p / q;
+    r = upper ? r + (PI / 4 + 0.5 * MOREBITS) : r;
+
+    r = ay > ax ? (PI / 2 - r) + MOREBITS : r;
+    r = x < 0.0 ? PI - r : r;
+    return std::copysign(r, y);
+}
+
+// Series for small arguments: |z| < 0.3 and |x| < 1 respectively
+COT_GEO_INLINE double atanh_small(double z) {
+    double z2 = z * z;
+    double p = 1.0 / 25;
+    COT_GEO_UNROLL
+    for (int k = 11; k >= 1; k--) {
+        p = p * z2 + 1.0 / (2 * k + 1);
+    }
+    return z + z * z2 * p;
+}
+
+COT_GEO_INLINE double sinh_small(double x) {
+    double x2 = x * x;
+    double p = 1.0;
+    COT_GEO_UNROLL
+    for (int k = 9; k >= 1; k--) {
+        p = 1.0 + p * x2 * (1.0 / ((2 * k) * (2 * k + 1)));
+    }
+    return x * p;
+}
+
+// Complex Clenshaw sum of c[j] sin(2(j+1) zeta), given sin/cos(2 xi) and
+// sinh/cosh(2 eta) of zeta = xi + i eta
+COT_GEO_INLINE void clenshaw(const double* c, double s2x, double c2x, double sh2e, double ch2e,
+                     double& dxi, double& deta) {
+    double ar = 2.0 * c2x * ch2e;
+    double ai = -2.0 * s2x * sh2e;
+    double y1r = 0.0, y1i = 0.0, y2r = 0.0, y2i = 0.0;
+    COT_GEO_UNROLL
+    for (int j = 5; j >= 0; j--) {
+        double yr = ar * y1r - ai * y1i - y2r + c[j];
+        double yi = ar * y1i + ai * y1r - y2i;
+        y2r = y1r;
+        y2i = y1i;
+        y1r = yr;
+        y1i = yi;
+    }
+    double sr = s2x * ch2e;
+    double si = c2x * sh2e;
+    dxi = sr * y1r - si * y1i;
+    deta = sr * y1i + si * y1r;
+}
+
+// Conformal latitude: tan(chi) from sin(phi) and cos(phi)
+COT_GEO_INLINE double conformal_tan(double sphi, double cphi) {
+    double sigma = sinh_small(E * atanh_small(E * sphi));
+    return (sphi * std::sqrt(1.0 + sigma * sigma) - sigma) / cphi;
+}
+
+COT_GEO_INLINE void utm_forward(double latitude, double longitude, double central_meridian,
+                        double& easting, double& northing) {
+    double sphi, cphi, slam, clam;
+    sincos_deg(latitude, sphi, cphi);
+    sincos_deg(longitude - central_meridian, slam, clam);
+
+    double taup = conformal_tan(sphi, cphi);
+    double h = std::sqrt(taup * taup + clam * clam);
+    double xip = atan2_kernel(taup, clam);
+    double u = slam / std::sqrt(1.0 + taup * taup);  // tanh(eta')
+    double etap = atanh_small(u);
+
+    double sx = taup / h;
+    double cx = clam / h;
+    double d = 1.0 - u * u;
+    double dxi, deta;
+    clenshaw(ALPHA, 2.0 * sx * cx, cx * cx - sx * sx, 2.0 * u / d, (1.0 + u * u) / d, dxi, deta);
+
+    easting = FALSE_EASTING + KA * (etap + deta);
+    northing = KA * (xip + dxi) + (latitude < 0.0 ? FALSE_NORTHING : 0.0);
+}
+
+// northing is measured from the equator (negative in the south)
+COT_GEO_INLINE void utm_inverse(double easting, double northing, double central_meridian,
+                        double& latitude, double& longitude) {
+    double xi = northing / KA;
+    double eta = (easting - FALSE_EASTING) / KA;
+
+    double s2x, c2x;
+    sincos_rad(2.0 * xi, s2x, c2x);
+    double sh2e = sinh_small(2.0 * eta);
+    double dxi, deta;
+    clenshaw(BETA, s2x, c2x, sh2e, std::sqrt(1.0 + sh2e * sh2e), dxi, deta);
+
+    double sxp, cxp;
+    sincos_rad(xi - dxi, sxp, cxp);
+    double shep = sinh_small(eta - deta);
+    double taup = sxp / std::sqrt(shep * shep + cxp * cxp);
+    double lam = atan2_kernel(shep, cxp);
+
+    // Newton's method for tan(phi) from the conformal tan(chi)
+    constexpr double E2M = 1.0 - E2;
+    double tau = taup / E2M;
+    COT_GEO_UNROLL
+    for (int i = 0; i < 3; i++) {
+        double st = std::sqrt(1.0 + tau * tau);
+        double sigma = sinh_small(E * atanh_small(E * tau / st));
+        double taupa = tau * std::sqrt(1.0 + sigma * sigma) - sigma * st;
+        tau += (taup - taupa) * (1.0 + E2M * tau * tau) / (E2M * st * std::sqrt(1.0 + taupa * taupa));
+    }
+
+    latitude = atan2_kernel(tau, 1.0) * (180.0 / PI);
+    longitude = central_meridian + lam * (180.0 / PI);
+}
+
+COT_GEO_INLINE void ecef_forward(double latitude, double longitude, double hae, double& x, double& y, double& z) {
+    double sphi, cphi, slam, clam;
+    sincos_deg(latitude, sphi, cphi);
+    sincos_deg(longitude, slam, clam);
+    double n = A / std::sqrt(1.0 - E2 * sphi * sphi);
+    x = (n + hae) * cphi * clam;
+    y = (n + hae) * cphi * slam;
+    z = (n * (1.0 - E2) + hae) * sphi;
+}
+
+// Bowring's method, iterating on the parametric latitude algebraically
+COT_GEO_INLINE void ecef_inverse(double x, double y, double z, double& latitude, double& longitude, double& hae) {
+    double p = std::sqrt(x * x + y * y);
+    double u = z;                 // Parametric latitude beta as (sin, cos),
+    double v = (1.0 - F) * p;     // unnormalised
+    double num = 0.0, den = 0.0;  // tan(phi) = num / den
+    COT_GEO_UNROLL
+    for (int i = 0; i < 2; i++) {
+        double r = std::sqrt(u * u + v * v);
+        r = r > 0.0 ? r : 1.0;
+        double sb = u / r;
+        double cb = v / r;
+        num = z + EP2 * B * sb * sb * sb;
+        den = p - E2 * A * cb * cb * cb;
+        u = (1.0 - F) * num;  // tan(beta) = (1 - f) tan(phi)
+        v = den;
+    }
+
+    double r = std::sqrt(num * num + den * den);
+    r = r > 0.0 ? r : 1.0;
+    double sphi = num / r;
+    double cphi = den / r;
+    latitude = atan2_kernel(num, den) * (180.0 / PI);
+    longitude = atan2_kernel(y, x) * (180.0 / PI);
+    hae = p * cphi + z * sphi - A * std::sqrt(1.0 - E2 * sphi * sphi);
+}
+
+COT_GEO_INLINE double haversine(double lat1, double lon1, double lat2, double lon2) {
+    double sdlat, cdlat, sdlon, cdlon, s1, c1, s2, c2;
+    sincos_deg((lat2 - lat1) * 0.5, sdlat, cdlat);
+    sincos_deg((lon2 - lon1) * 0.5, sdlon, cdlon);
+    sincos_deg(lat1, s1, c1);
+    sincos_deg(lat2, s2, c2);
+    double h = sdlat * sdlat + c1 * c2 * sdlon * sdlon;
+    h = h < 1.0 ? h : 1.0;
+    return 2.0 * EARTH_RADIUS * atan2_kernel(std::sqrt(h), std::sqrt(1.0 - h));
+}
+
+COT_GEO_INLINE double bearing(double lat1, double lon1, double lat2, double lon2) {
+    double sdlon, cdlon, s1, c1, s2, c2;
+    sincos_deg(lon2 - lon1, sdlon, cdlon);
+    sincos_deg(lat1, s1, c1);
+    sincos_deg(lat2, s2, c2);
+    double degrees = atan2_kernel(sdlon * c2, c1 * s2 - s1 * c2 * cdlon) * (180.0 / PI);
+    return degrees < 0.0 ? degrees + 360.0 : degrees;
+}
+
+// Zone number (0 outside the UTM area) as a double, with selects only so
+// it vectorises along with the projection
+COT_GEO_INLINE double utm_zone(double latitude, double longitude) {
+    double lon = longitude - 360.0 * std::floor((longitude + 180.0) * (1.0 / 360.0));  // [-180, 180)
+    double zone = std::floor((lon + 180.0) * (1.0 / 6.0)) + 1.0;
+    zone = zone < 60.0 ? zone : 60.0;
+
+    // Norway and Svalbard
+    bool norway = (latitude >= 56.0) & (latitude < 64.0) & (lon >= 3.0) & (lon < 12.0);
+    bool svalbard = (latitude >= 72.0) & (lon >= 0.0) & (lon < 42.0);
+    double svalbard_zone = 31.0 + (lon >= 9.0 ? 2.0 : 0.0) + (lon >= 21.0 ? 2.0 : 0.0) + (lon >= 33.0 ? 2.0 : 0.0);
+    zone = norway ? 32.0 : zone;
+    zone = svalbard ? svalbard_zone : zone;
+
+    // NaN or infinite input fails every comparison
+    bool inside = (latitude >= -80.0) & (latitude <= 84.0) & (lon >= -180.0) & (lon < 180.0);
+    return inside ? zone : 0.0;
+}
+
+// Bands C-X skip I and O; X spans 72-84
+COT_GEO_INLINE char utm_band(double latitude) {
+    double index = std::floor((latitude + 80.0) * (1.0 / 8.0));
+    index = index >= 0.0 ? index : 0.0;
+    index = index < 19.0 ? index : 19.0;
+    int i = static_cast<int>(index);
+    return static_cast<char>('C' + i + (i > 5) + (i > 10));
+}
+
+COT_GEO_INLINE double central_meridian(double zone) {
+    return zone * 6.0 - 183.0;
+}
+
+COT_GEO_INLINE bool valid_band(char band) {
+    return band >= 'C' && band <= 'X' && band != 'I' && band != 'O';
+}
+
+// MGRS 100 km square letters (AA scheme): column letters cycle with the
+// zone in sets of eight, row letters every 2,000 km, offset in even zones
+const char* const MGRS_COLUMNS[3] = {"STUVWXYZ", "ABCDEFGH", "JKLMNPQR"};
+const char MGRS_ROWS[] = "ABCDEFGHJKLMNPQRSTUV";
+
+// Lowest northing in each band C-X, rounded down to 100 km
+const double BAND_MIN_NORTHING[20] = {
+    1100000, 2000000, 2800000, 3700000, 4600000, 5500000, 6400000, 7300000, 8200000, 9100000,
+    0, 800000, 1700000, 2600000, 3500000, 4400000, 5300000, 6200000, 7000000, 7900000,
+};
+
+} // namespace
+
+// Scalar conversions
+EcefPoint geodetic_to_ecef(double latitude, double longitude, double hae) {
+    EcefPoint ecef;
+    ecef_forward(latitude, longitude, hae, ecef.x, ecef.y, ecef.z);
+    return ecef;
+}
+
+void ecef_to_geodetic(const EcefPoint& ecef, double& latitude, double& longitude, double& hae) {
+    ecef_inverse(ecef.x, ecef.y, ecef.z, latitude, longitude, hae);
+}
+
+bool latlon_to_utm(double latitude, double longitude, UtmPoint& utm) {
+    double zone = utm_zone(latitude, longitude);
+    if (zone == 0.0) {
+        return false;
+    }
+    utm.zone = static_cast<int>(zone);
+    utm.band = utm_band(latitude);
+    utm_forward(latitude, longitude, central_meridian(zone), utm.easting, utm.northing);
+    return true;
+}
+
+bool utm_to_latlon(const UtmPoint& utm, double& latitude, double& longitude) {
+    if (utm.zone < 1 || utm.zone > 60 || !valid_band(utm.band)) {
+        return false;
+    }
+    double northing = utm.band < 'N' ? utm.northing - FALSE_NORTHING : utm.northing;
+    utm_inverse(utm.easting, northing, central_meridian(utm.zone), latitude, longitude);
+    return true;
+}
+
+bool append_mgrs(std::string& out, double latitude, double longitude, int digits) {
+    UtmPoint utm;
+    if (!latlon_to_utm(latitude, longitude, utm)) {
+        return false;
+    }
+    digits = std::min(std::max(digits, 1), 5);
+
+    int column = std::min(std::max(static_cast<int>(utm.easting / 100000.0), 1), 8);
+    int row = static_cast<int>(std::floor(utm.northing / 100000.0)) % 20;
+    row = (row + (utm.zone % 2 == 0 ? 5 : 0)) % 20;
+
+    static const int scale[6] = {100000, 10000, 1000, 100, 10, 1};
+    int divisor = scale[digits];
+    long easting = static_cast<long>(std::fmod(utm.easting, 100000.0)) / divisor;
+    long northing = static_cast<long>(std::fmod(utm.northing, 100000.0)) / divisor;
+
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%d%c%c%c%0*ld%0*ld", utm.zone, utm.band,
+                       MGRS_COLUMNS[utm.zone % 3][column - 1], MGRS_ROWS[row],
+                       digits, easting, digits, northing);
+    out.append(buf, len);
+    return true;
+}
+
+bool parse_mgrs(std::string_view mgrs, double& latitude, double& longitude) {
+    char text[32];
+    size_t len = 0;
+    for (char c : mgrs) {
+        if (c == ' ') continue;
+        if (len == sizeof(text)) return false;
+        text[len++] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+    }
+
+    size_t pos = 0;
+    int zone = 0;
+    while (pos < len && pos < 2 && text[pos] >= '0' && text[pos] <= '9') {
+        zone = zone * 10 + (text[pos++] - '0');
+    }
+    if (zone < 1 || zone > 60 || len < pos + 3 || !valid_band(text[pos])) {
+        return false;
+    }
+    char band = text[pos];
+    const char* column = strchr(MGRS_COLUMNS[zone % 3], text[pos + 1]);
+    const char* row = strchr(MGRS_ROWS, text[pos + 2]);
+    if (!column || !row || text[pos + 1] == '\0' || text[pos + 2] == '\0') {
+        return false;
+    }
+    pos += 3;
+
+    size_t digits = len - pos;
+    if (digits % 2 != 0 || digits > 10) {
+        return false;
+    }
+    digits /= 2;
+    long easting = 0, northing = 0;
+    for (size_t i = 0; i < digits; i++) {
+        if (text[pos + i] < '0' || text[pos + i] > '9' ||
+            text[pos + digits + i] < '0' || text[pos + digits + i] > '9') {
+            return false;
+        }
+        easting = easting * 10 + (text[pos + i] - '0');
+        northing = northing * 10 + (text[pos + digits + i] - '0');
+    }
+    for (size_t i = digits; i < 5; i++) {
+        easting *= 10;
+        northing *= 10;
+    }
+
+    int row_index = static_cast<int>(row - MGRS_ROWS) - (zone % 2 == 0 ? 5 : 0);
+    UtmPoint utm;
+    utm.zone = zone;
+    utm.band = band;
+    utm.easting = (column - MGRS_COLUMNS[zone % 3] + 1) * 100000.0 + easting;
+    utm.northing = ((row_index + 20) % 20) * 100000.0 + northing;
+
+    // Row letters repeat every 2,000 km; the band picks the cycle
+    double min_northing = BAND_MIN_NORTHING[band - 'C' - (band > 'I') - (band > 'O')];
+    while (utm.northing < min_northing) {
+        utm.northing += 2000000.0;
+    }
+    return utm_to_latlon(utm, latitude, longitude);
+}
+
+double great_circle_distance(double lat1, double lon1, double lat2, double lon2) {
+    return haversine(lat1, lon1, lat2, lon2);
+}
+
+double initial_bearing(double lat1, double lon1, double lat2, double lon2) {
+    return bearing(lat1, lon1, lat2, lon2);
+}
+
+// Batch kernels. Outputs must not overlap the inputs (restrict lets the
+// compiler skip the runtime alias checks).
+COT_GEO_KERNEL
+void geodetic_to_ecef(const double* __restrict latitude, const double* __restrict longitude, const double* __restrict hae, size_t n,
+                      double* __restrict x, double* __restrict y, double* __restrict z) {
+    for (size_t i = 0; i < n; i++) {
+        ecef_forward(latitude[i], longitude[i], hae[i], x[i], y[i], z[i]);
+    }
+}
+
+COT_GEO_KERNEL
+void ecef_to_geodetic(const double* __restrict x, const double* __restrict y, const double* __restrict z, size_t n,
+                      double* __restrict latitude, double* __restrict longitude, double* __restrict hae) {
+    for (size_t i = 0; i < n; i++) {
+        ecef_inverse(x[i], y[i], z[i], latitude[i], longitude[i], hae[i]);
+    }
+}
+
+COT_GEO_KERNEL
+void latlon_to_utm(const double* __restrict latitude, const double* __restrict longitude, size_t n,
+                   int* __restrict zone, char* __restrict band, double* __restrict easting,
+                   double* __restrict northing) {
+    for (size_t i = 0; i < n; i++) {
+        double z = utm_zone(latitude[i], longitude[i]);
+        zone[i] = static_cast<int>(z);
+        band[i] = utm_band(latitude[i]);
+        utm_forward(latitude[i], longitude[i], central_meridian(z), easting[i], northing[i]);
+    }
+}
+
+COT_GEO_KERNEL
+void utm_to_latlon(const int* __restrict zone, const char* __restrict band, const double* __restrict easting,
+                   const double* __restrict northing, size_t n, double* __restrict latitude,
+                   double* __restrict longitude) {
+    for (size_t i = 0; i < n; i++) {
+        double lat, lon;
+        double offset = band[i] < 'N' ? FALSE_NORTHING : 0.0;
+        utm_inverse(easting[i], northing[i] - offset, central_meridian(zone[i]), lat, lon);
+        bool valid = zone[i] >= 1 && zone[i] <= 60 && valid_band(band[i]);
+        latitude[i] = valid ? lat : NAN;
+        longitude[i] = valid ? lon : NAN;
+    }
+}
+
+COT_GEO_KERNEL
+void great_circle_distance(const double* __restrict lat1, const double* __restrict lon1, const double* __restrict lat2, const double* __restrict lon2,
+                           size_t n, double* __restrict meters) {
+    for (size_t i = 0; i < n; i++) {
+        meters[i] = haversine(lat1[i], lon1[i], lat2[i], lon2[i]);
+    }
+}
+
+COT_GEO_KERNEL
+void initial_bearing(const double* __restrict lat1, const double* __restrict lon1, const double* __restrict lat2, const double* __restrict lon2,
+                     size_t n, double* __restrict degrees) {
+    for (size_t i = 0; i < n; i++) {
+        degrees[i] = bearing(lat1[i], lon1[i], lat2[i], lon2[i]);
+    }
+}
+
+} // namespace CoTCommon
@@ -0,0 +1,77 @@
+#ifndef COT_GEO_H
+#define COT_GEO_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace CoTCommon {
+
+// Coordinate conversions on the WGS84 ellipsoid: ECEF, UTM/MGRS, and
+// great-circle distance and bearing. Angles are in degrees and lengths in
+// meters.
+//
+// Every conversion comes as a scalar call and as a batch kernel over
+// contiguous arrays (one array per coordinate). The kernels use no libm
+// calls and no branches in their loops, so the compiler can vectorise them.
+// UTM uses Krüger's series to sixth order in n (sub-millimeter inside the
+// UTM area); ECEF to geodetic uses two Bowring iterations (sub-millimeter
+// from the Earth's center out to geostationary altitude).
+
+struct EcefPoint {
+    double x;
+    double y;
+    double z;
+};
+
+struct UtmPoint {
+    int zone;          // 1-60
+    char band;         // Latitude band C-X (N and up: northern hemisphere)
+    double easting;
+    double northing;   // Southern hemisphere: false northing 10,000,000 m
+};
+
+// Scalar conversions
+EcefPoint geodetic_to_ecef(double latitude, double longitude, double hae);
+void ecef_to_geodetic(const EcefPoint& ecef, double& latitude, double& longitude, double& hae);
+
+// False outside the UTM area (80S to 84N). Zone exceptions for Norway and
+// Svalbard are applied.
+bool latlon_to_utm(double latitude, double longitude, UtmPoint& utm);
+bool utm_to_latlon(const UtmPoint& utm, double& latitude, double& longitude);
+
+// Append the MGRS reference, e.g. "56HLH3349552380" for digits = 5 (1 m);
+// digits 1-5 per axis, truncated as MGRS requires. Appends nothing and
+// returns false outside the UTM area.
+bool append_mgrs(std::string& out, double latitude, double longitude, int digits = 5);
+
+// Parse "56HLH3349552380" or "56H LH 33495 52380" to the south-west corner
+// of the referenced square
+bool parse_mgrs(std::string_view mgrs, double& latitude, double& longitude);
+
+// Haversine distance on the mean Earth sphere (R = 6371008.8 m)
+double great_circle_distance(double lat1, double lon1, double lat2, double lon2);
+
+// Initial bearing from point 1 to point 2, 0-360 degrees clockwise from north
+double initial_bearing(double lat1, double lon1, double lat2, double lon2);
+
+// Batch kernels over n positions. Output arrays must not overlap the inputs.
+void geodetic_to_ecef(const double* latitude, const double* longitude, const double* hae, size_t n,
+                      double* x, double* y, double* z);
+void ecef_to_geodetic(const double* x, const double* y, const double* z, size_t n,
+                      double* latitude, double* longitude, double* hae);
+
+// Positions outside the UTM area get zone 0
+void latlon_to_utm(const double* latitude, const double* longitude, size_t n,
+                   int* zone, char* band, double* easting, double* northing);
+void utm_to_latlon(const int* zone, const char* band, const double* easting, const double* northing,
+                   size_t n, double* latitude, double* longitude);
+
+void great_circle_distance(const double* lat1, const double* lon1, const double* lat2, const double* lon2,
+                           size_t n, double* meters);
+void initial_bearing(const double* lat1, const double* lon1, const double* lat2, const double* lon2,
+                     size_t n, double* degrees);
+
+} // namespace CoTCommon
+
+#endif // COT_GEO_H
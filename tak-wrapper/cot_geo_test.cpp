@@ -0,0 +1,204 @@
+#include "cot_geo.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+// Accuracy checks for cot_geo against reference values from PROJ (pyproj
+// 3.7, EPSG:4978/4979 and the WGS84 UTM zones). Prints every tolerance that
+// is exceeded and exits nonzero, so it can run under CTest.
+
+using namespace CoTCommon;
+
+namespace {
+
+struct ReferencePoint {
+    const char* name;
+    double latitude;
+    double longitude;
+    double hae;
+    double x, y, z;      // ECEF
+    int zone;
+    char band;
+    double easting;
+    double northing;
+    const char* mgrs;    // 1 m, truncated
+};
+
+// Ordinary zones, the Norway (32V) and Svalbard (31X-37X) exceptions, the
+// southern bands down to C and both edges of the UTM area
+const ReferencePoint POINTS[] = {
+    {"Washington", 38.8895, -77.0352, 30.0, 1115269.5707, -4844339.5285, 3982795.0963, 18, 'S', 323486.7372, 4306483.0483, "18SUJ2348606483"},
+    {"Sydney", -33.8568, 151.2153, 5.0, -4646972.2765, 2553078.9195, -3533269.9131, 56, 'H', 334900.5697, 6252288.7529, "56HLH3490052288"},
+    {"Bergen (32V)", 60.3913, 5.3221, 12.0, 3145660.6547, 293037.9387, 5522156.9327, 32, 'V', 297353.9327, 6700648.3452, "32VKN9735300648"},
+    {"West of Stavanger (32V)", 58.97, 3.2, 0.0, 3290816.9848, 183985.2331, 5442214.2764, 32, 'V', 166754.1789, 6551183.8367, "32VJL6675451183"},
+    {"Longyearbyen (33X)", 78.2232, 15.6267, 10.0, 1257701.1973, 351788.3476, 6222079.8351, 33, 'X', 514278.7151, 8683355.4695, "33XWG1427883355"},
+    {"Svalbard (31X)", 79.5, 8.5, 0.0, 1153294.1850, 172360.9708, 6249608.5632, 31, 'X', 611732.6603, 8831056.3374, "31XFJ1173231056"},
+    {"Svalbard (35X)", 78.9, 25.0, 0.0, 1116488.2625, 520627.0270, 6237055.4611, 35, 'X', 457023.5639, 8759549.3573, "35XMH5702359549"},
+    {"Svalbard (37X)", 80.2, 33.5, 0.0, 908239.5019, 601150.6124, 6263382.5006, 37, 'X', 395640.6292, 8908848.8185, "37XCK9564008848"},
+    {"Ushuaia (19F)", -54.8019, -68.303, 20.0, 1362207.3067, -3423597.5858, -5188719.6792, 19, 'F', 544805.0975, 3927029.8847, "19FEV4480527029"},
+    {"McMurdo (58C)", -77.8419, 166.6863, 10.0, -1311400.0435, 310332.9440, -6213252.6102, 58, 'C', 539641.2846, 1358704.0461, "58CEU3964158704"},
+    {"Cape Town (34H)", -33.9249, 18.4241, 0.0, 5026357.7692, 1674395.1796, -3539537.4473, 34, 'H', 261881.5985, 6243182.3545, "34HBH6188143182"},
+    {"South of the equator (37M)", -0.0001, 36.8219, 1795.0, 5107150.5550, 3823682.1956, -11.0606, 37, 'M', 257573.2122, 9999988.9390, "37MBV5757399988"},
+    {"Quito (17M)", -0.1807, -78.4678, 2850.0, 1275671.7923, -6252139.9770, -19989.7275, 17, 'M', 781861.4575, 9980007.5669, "17MQV8186180007"},
+    {"Top of band X", 83.9, -40.0, 0.0, 520926.3070, -437109.0721, 6320519.5276, 24, 'X', 488136.7308, 9317033.0971, "24XVU8813617033"},
+    {"Bottom of band C", -79.9, 100.0, 0.0, -194860.9518, 1105111.3732, -6257594.4173, 47, 'C', 519576.6110, 1129407.4826, "47CNM1957629407"},
+};
+
+struct ReferencePair {
+    double lat1, lon1, lat2, lon2;
+    double meters;       // Haversine, R = 6371008.8 m
+    double bearing;
+};
+
+const ReferencePair PAIRS[] = {
+    {38.8895, -77.0352, -33.8568, 151.2153, 15709264.7684, 262.054139},
+    {51.4779, -0.0015, 40.7128, -74.006, 5579562.1014, 288.431206},
+    {78.2232, 15.6267, -77.8419, 166.6863, 19353334.9242, 100.610330},
+    {0.0, 0.0, 0.0, 90.0, 10007557.2210, 90.000000},
+    {-54.8019, -68.303, -33.9249, 18.4241, 6793381.5225, 108.859948},
+};
+
+// Tolerances
+const double ECEF_METERS = 0.001;
+const double UTM_METERS = 0.001;
+const double ROUND_TRIP_DEGREES = 1e-9;      // About 0.1 mm
+const double ROUND_TRIP_METERS = 0.001;
+const double MGRS_CORNER_METERS = 1.5;       // Truncation to 1 m in both axes
+const double DISTANCE_METERS = 0.001;
+const double BEARING_DEGREES = 1e-6;
+
+int failures = 0;
+
+void check(bool ok, const char* name, const char* what, double error = 0.0) {
+    if (!ok) {
+        printf("FAIL %-28s %s (error %.3g)\n", name, what, error);
+        failures++;
+    }
+}
+
+void check_point(const ReferencePoint& p) {
+    EcefPoint ecef = geodetic_to_ecef(p.latitude, p.longitude, p.hae);
+    double error = std::hypot(ecef.x - p.x, ecef.y - p.y, ecef.z - p.z);
+    check(error <= ECEF_METERS, p.name, "geodetic_to_ecef", error);
+
+    double latitude, longitude, hae;
+    ecef_to_geodetic(ecef, latitude, longitude, hae);
+    error = std::fmax(std::fabs(latitude - p.latitude), std::fabs(longitude - p.longitude));
+    check(error <= ROUND_TRIP_DEGREES, p.name, "ecef_to_geodetic position", error);
+    check(std::fabs(hae - p.hae) <= ROUND_TRIP_METERS, p.name, "ecef_to_geodetic height", hae - p.hae);
+
+    UtmPoint utm;
+    if (!latlon_to_utm(p.latitude, p.longitude, utm)) {
+        check(false, p.name, "latlon_to_utm rejected the point");
+        return;
+    }
+    check(utm.zone == p.zone && utm.band == p.band, p.name, "latlon_to_utm zone or band");
+    error = std::hypot(utm.easting - p.easting, utm.northing - p.northing);
+    check(error <= UTM_METERS, p.name, "latlon_to_utm", error);
+
+    check(utm_to_latlon(utm, latitude, longitude), p.name, "utm_to_latlon rejected the point");
+    error = std::fmax(std::fabs(latitude - p.latitude), std::fabs(longitude - p.longitude));
+    check(error <= ROUND_TRIP_DEGREES, p.name, "utm_to_latlon", error);
+
+    std::string mgrs;
+    check(append_mgrs(mgrs, p.latitude, p.longitude) && mgrs == p.mgrs, p.name, "append_mgrs");
+    if (!parse_mgrs(mgrs, latitude, longitude)) {
+        check(false, p.name, "parse_mgrs rejected the reference");
+        return;
+    }
+    error = great_circle_distance(latitude, longitude, p.latitude, p.longitude);
+    check(error <= MGRS_CORNER_METERS, p.name, "parse_mgrs corner", error);
+}
+
+// The batch kernels must agree with the scalar calls
+void check_kernels() {
+    const size_t n = sizeof(POINTS) / sizeof(POINTS[0]);
+    double lat[n], lon[n], hae[n], x[n], y[n], z[n], lat2[n], lon2[n], hae2[n];
+    double easting[n], northing[n];
+    int zone[n];
+    char band[n];
+    for (size_t i = 0; i < n; i++) {
+        lat[i] = POINTS[i].latitude;
+        lon[i] = POINTS[i].longitude;
+        hae[i] = POINTS[i].hae;
+    }
+    geodetic_to_ecef(lat, lon, hae, n, x, y, z);
+    ecef_to_geodetic(x, y, z, n, lat2, lon2, hae2);
+    latlon_to_utm(lat, lon, n, zone, band, easting, northing);
+    for (size_t i = 0; i < n; i++) {
+        const ReferencePoint& p = POINTS[i];
+        double error = std::hypot(x[i] - p.x, y[i] - p.y, z[i] - p.z);
+        check(error <= ECEF_METERS, p.name, "geodetic_to_ecef kernel", error);
+        error = std::fmax(std::fabs(lat2[i] - p.latitude), std::fabs(lon2[i] - p.longitude));
+        check(error <= ROUND_TRIP_DEGREES && std::fabs(hae2[i] - p.hae) <= ROUND_TRIP_METERS,
+              p.name, "ecef_to_geodetic kernel", error);
+        check(zone[i] == p.zone && band[i] == p.band, p.name, "latlon_to_utm kernel zone or band");
+        error = std::hypot(easting[i] - p.easting, northing[i] - p.northing);
+        check(error <= UTM_METERS, p.name, "latlon_to_utm kernel", error);
+    }
+    utm_to_latlon(zone, band, easting, northing, n, lat2, lon2);
+    for (size_t i = 0; i < n; i++) {
+        double error = std::fmax(std::fabs(lat2[i] - lat[i]), std::fabs(lon2[i] - lon[i]));
+        check(error <= ROUND_TRIP_DEGREES, POINTS[i].name, "utm_to_latlon kernel", error);
+    }
+}
+
+void check_pairs() {
+    const size_t n = sizeof(PAIRS) / sizeof(PAIRS[0]);
+    double lat1[n], lon1[n], lat2[n], lon2[n], meters[n], degrees[n];
+    for (size_t i = 0; i < n; i++) {
+        const ReferencePair& p = PAIRS[i];
+        lat1[i] = p.lat1;
+        lon1[i] = p.lon1;
+        lat2[i] = p.lat2;
+        lon2[i] = p.lon2;
+    }
+    great_circle_distance(lat1, lon1, lat2, lon2, n, meters);
+    initial_bearing(lat1, lon1, lat2, lon2, n, degrees);
+    for (size_t i = 0; i < n; i++) {
+        const ReferencePair& p = PAIRS[i];
+        double error = std::fabs(great_circle_distance(p.lat1, p.lon1, p.lat2, p.lon2) - p.meters);
+        check(error <= DISTANCE_METERS, "great_circle_distance", "reference pair", error);
+        error = std::fabs(meters[i] - p.meters);
+        check(error <= DISTANCE_METERS, "great_circle_distance", "kernel", error);
+        error = std::fabs(initial_bearing(p.lat1, p.lon1, p.lat2, p.lon2) - p.bearing);
+        check(std::fmin(error, 360.0 - error) <= BEARING_DEGREES, "initial_bearing", "reference pair", error);
+        error = std::fabs(degrees[i] - p.bearing);
+        check(std::fmin(error, 360.0 - error) <= BEARING_DEGREES, "initial_bearing", "kernel", error);
+    }
+}
+
+void check_outside() {
+    UtmPoint utm;
+    std::string mgrs;
+    double latitude, longitude;
+    check(!latlon_to_utm(84.1, 0.0, utm), "84.1N", "latlon_to_utm accepted a point north of the UTM area");
+    check(!latlon_to_utm(-80.1, 0.0, utm), "80.1S", "latlon_to_utm accepted a point south of the UTM area");
+    check(!latlon_to_utm(NAN, 0.0, utm), "NaN", "latlon_to_utm accepted NaN");
+    check(!append_mgrs(mgrs, 84.1, 0.0) && mgrs.empty(), "84.1N", "append_mgrs wrote a reference");
+    check(!parse_mgrs("61NAA", latitude, longitude), "61NAA", "parse_mgrs accepted zone 61");
+    check(!parse_mgrs("31IAA", latitude, longitude), "31IAA", "parse_mgrs accepted band I");
+    check(!parse_mgrs("31NAA123", latitude, longitude), "31NAA123", "parse_mgrs accepted odd digits");
+    check(parse_mgrs("18s uj 23486 06483", latitude, longitude) &&
+              great_circle_distance(latitude, longitude, 38.8895, -77.0352) <= MGRS_CORNER_METERS,
+          "18s uj 23486 06483", "parse_mgrs with lower case and spaces");
+}
+
+} // namespace
+
+int main() {
+    for (const ReferencePoint& p : POINTS) {
+        check_point(p);
+    }
+    check_kernels();
+    check_pairs();
+    check_outside();
+
+    if (failures > 0) {
+        printf("%d geo check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All geo checks passed (%zu reference points, %zu pairs)\n",
+           sizeof(POINTS) / sizeof(POINTS[0]), sizeof(PAIRS) / sizeof(PAIRS[0]));
+    return 0;
+}
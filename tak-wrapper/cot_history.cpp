@@ -0,0 +1,311 @@
+#include "cot_history.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET = 1469598103934665603ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+// A track's time base moves up to the start of the window before an
+// offset would pass this, so offsets never wrap; the window must fit in it
+constexpr int64_t MAX_WINDOW_MS = INT32_MAX;
+
+// Meters per CompactPosition unit of latitude (1e-7 degree)
+constexpr double METERS_PER_UNIT = 6371008.8 * M_PI / 180.0 / CompactPosition::DEGREE;
+
+uint64_t hash_uid(std::string_view uid) {
+    uint64_t h = FNV_OFFSET;
+    for (unsigned char c : uid) {
+        h ^= c;
+        h *= FNV_PRIME;
+    }
+    return h | 1;  // Never 0 (empty marker)
+}
+
+// Longitude difference in units, the short way around
+double lon_delta(double from, double to) {
+    return std::remainder(to - from, 360.0 * CompactPosition::DEGREE);
+}
+
+// Local east/north meters of a point relative to an origin (equirectangular,
+// accurate for the short distances between trail points)
+struct Offset {
+    double x;
+    double y;
+};
+
+Offset local_offset(const CompactPosition& origin, const CompactPosition& p) {
+    double cos_lat = std::cos(origin.latitude() * M_PI / 180.0);
+    return {lon_delta(origin.lon, p.lon) * cos_lat * METERS_PER_UNIT,
+            (static_cast<double>(p.lat) - origin.lat) * METERS_PER_UNIT};
+}
+
+// Distance from p to the segment a-b
+double segment_distance(Offset p, Offset a, Offset b) {
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double length2 = dx * dx + dy * dy;
+    double t = length2 > 0 ? std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / length2, 0.0, 1.0) : 0.0;
+    double ex = p.x - (a.x + t * dx);
+    double ey = p.y - (a.y + t * dy);
+    return std::sqrt(ex * ex + ey * ey);
+}
+
+} // namespace
+
+TrackHistory::TrackHistory(const Options& opts)
+    : options(opts), stripes(new std::mutex[LOCK_STRIPES]), sequence(0), updates(0), kept(0),
+      out_of_order(0), evictions(0), tracks(0), stored(0) {
+    window_ms = std::min(static_cast<int64_t>(options.window_s * 1000.0), MAX_WINDOW_MS);
+    ring_size = static_cast<uint32_t>(std::clamp<size_t>(options.points_per_track, 2, UINT16_MAX));
+
+    // As many sets of WAYS tracks as the budget pays for
+    size_t per_track = sizeof(Slot) + ring_size * sizeof(Point);
+    sets = std::max<size_t>(1, options.memory_budget / (WAYS * per_track));
+    slots.resize(sets * WAYS);
+    points.resize(slots.size() * ring_size);
+}
+
+size_t TrackHistory::memory_bytes() const {
+    return slots.size() * sizeof(Slot) + points.size() * sizeof(Point);
+}
+
+const TrackHistory::Point& TrackHistory::kept_point(const Slot& slot, uint32_t age) const {
+    return ring(slot)[(slot.head + ring_size - 1 - age) % ring_size];
+}
+
+const TrackHistory::Slot* TrackHistory::find(uint64_t uid_hash) const {
+    const Slot* ways = &slots[(uid_hash % sets) * WAYS];
+    for (size_t i = 0; i < WAYS; i++) {
+        if (ways[i].uid_hash == uid_hash) return &ways[i];
+    }
+    return nullptr;
+}
+
+void TrackHistory::push(Slot& slot, const Point& point) {
+    ring(slot)[slot.head] = point;
+    slot.head = (slot.head + 1) % ring_size;
+    if (slot.count < ring_size) slot.count++;  // Otherwise the oldest point was overwritten
+    kept.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TrackHistory::expire(Slot& slot, int64_t time_ms) {
+    int64_t cutoff = time_ms - window_ms;
+    const Point& newest = slot.has_pending ? slot.pending : kept_point(slot, 0);
+    if (slot.base_ms + newest.offset_ms < cutoff) {
+        slot.count = 0;
+        slot.has_pending = false;
+        return;
+    }
+    // The last point before the cutoff stays, so the path reaches back to
+    // the start of the window even along a leg with no kept points in it
+    while (slot.count > 1 && slot.base_ms + kept_point(slot, slot.count - 2).offset_ms < cutoff) {
+        slot.count--;
+    }
+}
+
+void TrackHistory::rebase(Slot& slot, int64_t time_ms) {
+    // The point the path into the window starts from can be any age: a track
+    // that has not turned since keeps it. Move it along its leg up to the
+    // start of the window, so the base can follow and offsets stay small.
+    int64_t cutoff = time_ms - window_ms;
+    if (slot.count > 1 || (slot.count == 1 && slot.has_pending)) {
+        Point& oldest = ring(slot)[(slot.head + ring_size - slot.count) % ring_size];
+        const Point& next = slot.count > 1 ? kept_point(slot, slot.count - 2) : slot.pending;
+        if (slot.base_ms + oldest.offset_ms < cutoff) {
+            double t = (static_cast<double>(cutoff - slot.base_ms) - oldest.offset_ms) /
+                       (static_cast<double>(next.offset_ms) - oldest.offset_ms);
+            int64_t lon = oldest.lon + std::llround(lon_delta(oldest.lon, next.lon) * t);
+            if (lon > 180LL * CompactPosition::DEGREE) lon -= 360LL * CompactPosition::DEGREE;
+            if (lon < -180LL * CompactPosition::DEGREE) lon += 360LL * CompactPosition::DEGREE;
+            oldest.lat += static_cast<int32_t>(std::lround((static_cast<double>(next.lat) - oldest.lat) * t));
+            oldest.lon = static_cast<int32_t>(lon);
+            oldest.hae += static_cast<int32_t>(std::lround((static_cast<double>(next.hae) - oldest.hae) * t));
+            oldest.offset_ms = static_cast<uint32_t>(cutoff - slot.base_ms);
+        }
+    }
+
+    // Move the base up to the oldest point still held
+    int64_t base = time_ms;
+    if (slot.count > 0) {
+        base = slot.base_ms + kept_point(slot, slot.count - 1).offset_ms;
+    } else if (slot.has_pending) {
+        base = slot.base_ms + slot.pending.offset_ms;
+    }
+    uint32_t shift = static_cast<uint32_t>(base - slot.base_ms);
+    Point* data = ring(slot);
+    for (uint32_t age = 0; age < slot.count; age++) {
+        data[(slot.head + ring_size - 1 - age) % ring_size].offset_ms -= shift;
+    }
+    slot.pending.offset_ms -= slot.has_pending ? shift : 0;
+    slot.base_ms = base;
+}
+
+bool TrackHistory::significant(const Slot& slot, const Point& point) const {
+    // Dead reckoning from the last two kept points; a single point (or only
+    // the tentative one, once the kept ones have expired) predicts no motion
+    const Point& last = slot.count > 0 ? kept_point(slot, 0) : slot.pending;
+    double lat = last.lat;
+    double lon = last.lon;
+    if (slot.count >= 2) {
+        const Point& before = kept_point(slot, 1);
+        double span = static_cast<double>(last.offset_ms) - before.offset_ms;
+        if (span > 0) {
+            double ahead = (static_cast<double>(point.offset_ms) - last.offset_ms) / span;
+            lat += (static_cast<double>(last.lat) - before.lat) * ahead;
+            lon += lon_delta(before.lon, last.lon) * ahead;
+        }
+    }
+
+    double cos_lat = std::cos(static_cast<double>(last.lat) / CompactPosition::DEGREE * M_PI / 180.0);
+    double dx = lon_delta(lon, point.lon) * cos_lat * METERS_PER_UNIT;
+    double dy = (point.lat - lat) * METERS_PER_UNIT;
+    return dx * dx + dy * dy > options.tolerance_m * options.tolerance_m;
+}
+
+void TrackHistory::update(std::string_view uid, int64_t time_ms, const CompactPosition& position) {
+    updates.fetch_add(1, std::memory_order_relaxed);
+    uint64_t uid_hash = hash_uid(uid);
+    size_t set = uid_hash % sets;
+    std::lock_guard<std::mutex> lock(stripes[set % LOCK_STRIPES]);
+
+    // Look the UID up in its set, or claim the least recently updated way
+    Slot* ways = &slots[set * WAYS];
+    Slot* slot = nullptr;
+    Slot* victim = nullptr;
+    for (size_t i = 0; i < WAYS; i++) {
+        if (ways[i].uid_hash == uid_hash) {
+            slot = &ways[i];
+            break;
+        }
+        if (!victim || (victim->uid_hash != 0 &&
+                        (ways[i].uid_hash == 0 || ways[i].last_update < victim->last_update))) {
+            victim = &ways[i];
+        }
+    }
+
+    if (!slot) {
+        if (victim->uid_hash != 0) {
+            evictions.fetch_add(1, std::memory_order_relaxed);
+            stored.fetch_sub(victim->count + victim->has_pending, std::memory_order_relaxed);
+        } else {
+            tracks.fetch_add(1, std::memory_order_relaxed);
+        }
+        *victim = Slot();
+        slot = victim;
+        slot->uid_hash = uid_hash;
+        slot->base_ms = time_ms;
+    } else {
+        const Point& newest = slot->has_pending ? slot->pending : kept_point(*slot, 0);
+        if (time_ms <= slot->base_ms + newest.offset_ms) {
+            out_of_order.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    slot->last_update = sequence.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t held = slot->count + slot->has_pending;
+    expire(*slot, time_ms);
+    if (time_ms - slot->base_ms > MAX_WINDOW_MS) {
+        rebase(*slot, time_ms);
+    }
+
+    Point point = {position.lat, position.lon, position.hae, static_cast<uint32_t>(time_ms - slot->base_ms)};
+    if (slot->count == 0 && !slot->has_pending) {
+        push(*slot, point);
+    } else {
+        if (slot->has_pending && significant(*slot, point)) {
+            push(*slot, slot->pending);
+        }
+        slot->pending = point;
+        slot->has_pending = true;
+    }
+    stored.fetch_add(slot->count + slot->has_pending - held, std::memory_order_relaxed);
+}
+
+bool TrackHistory::trail(std::string_view uid, int64_t from_ms, int64_t to_ms, double tolerance_m,
+                         std::vector<TrailPoint>& out) const {
+    out.clear();
+    uint64_t uid_hash = hash_uid(uid);
+    {
+        std::lock_guard<std::mutex> lock(stripes[(uid_hash % sets) % LOCK_STRIPES]);
+        const Slot* slot = find(uid_hash);
+        if (!slot) return false;
+
+        auto add = [&](const Point& p) {
+            int64_t time_ms = slot->base_ms + p.offset_ms;
+            if (time_ms < from_ms || time_ms > to_ms) return;
+            TrailPoint point = {time_ms, CompactPosition()};
+            point.position.lat = p.lat;
+            point.position.lon = p.lon;
+            point.position.hae = p.hae;
+            out.push_back(point);
+        };
+        for (uint32_t age = slot->count; age-- > 0;) {
+            add(kept_point(*slot, age));
+        }
+        if (slot->has_pending) {
+            add(slot->pending);
+        }
+    }
+
+    if (tolerance_m > options.tolerance_m) {
+        simplify(out, tolerance_m);
+    }
+    return true;
+}
+
+void TrackHistory::simplify(std::vector<TrailPoint>& trail, double tolerance_m) {
+    if (trail.size() < 3) return;
+
+    std::vector<Offset> xy(trail.size());
+    for (size_t i = 0; i < trail.size(); i++) {
+        xy[i] = local_offset(trail[0].position, trail[i].position);
+    }
+
+    // Split each span at its furthest point until every span is within tolerance
+    std::vector<bool> keep(trail.size(), false);
+    keep.front() = keep.back() = true;
+    std::vector<std::pair<size_t, size_t>> spans = {{0, trail.size() - 1}};
+    while (!spans.empty()) {
+        auto [first, last] = spans.back();
+        spans.pop_back();
+        double furthest = tolerance_m;
+        size_t split = 0;
+        for (size_t i = first + 1; i < last; i++) {
+            double distance = segment_distance(xy[i], xy[first], xy[last]);
+            if (distance > furthest) {
+                furthest = distance;
+                split = i;
+            }
+        }
+        if (split) {
+            keep[split] = true;
+            spans.push_back({first, split});
+            spans.push_back({split, last});
+        }
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < trail.size(); i++) {
+        if (keep[i]) trail[n++] = trail[i];
+    }
+    trail.resize(n);
+}
+
+TrackHistory::Stats TrackHistory::stats() const {
+    Stats s;
+    s.updates = updates.load(std::memory_order_relaxed);
+    s.kept = kept.load(std::memory_order_relaxed);
+    s.out_of_order = out_of_order.load(std::memory_order_relaxed);
+    s.evictions = evictions.load(std::memory_order_relaxed);
+    s.tracks = static_cast<size_t>(tracks.load(std::memory_order_relaxed));
+    s.points = static_cast<size_t>(stored.load(std::memory_order_relaxed));
+    return s;
+}
+
+} // namespace CoTCommon
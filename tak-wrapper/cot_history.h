@@ -0,0 +1,125 @@
+#ifndef COT_HISTORY_H
+#define COT_HISTORY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "cot_position.h"
+
+namespace CoTCommon {
+
+// One point of a trail; ce/le are not kept and read as unknown
+struct TrailPoint {
+    int64_t time_ms;
+    CompactPosition position;
+};
+
+// Recent trail of every track within a fixed memory budget.
+//
+// Each track owns a ring of `points_per_track` 16-byte points (fixed-point
+// lat/lon/hae and a millisecond offset from the track's time base), and only
+// significant points are written to it. A new point is compared with where
+// the last two kept points say the track should be by now (dead reckoning);
+// while it stays within tolerance_m it only replaces the track's newest,
+// tentative point. Once the track turns, speeds up or stops, the tentative
+// point is kept and the new one becomes tentative. Straight, steady legs
+// therefore cost two points however many updates they had.
+//
+// Points older than window_s behind a track's newest point are dropped,
+// except the one the path into the window starts from (moved along its leg
+// to the start of the window when the time base is rebased), and a full ring
+// overwrites its oldest point. Tracks live in a 4-way
+// set-associative table sized from memory_budget at construction; the least
+// recently updated track in a full set is evicted.
+class TrackHistory {
+public:
+    struct Options {
+        double window_s = 600.0;              // Keep this much trail per track
+        size_t points_per_track = 64;
+        size_t memory_budget = 64 * 1024 * 1024;
+        double tolerance_m = 10.0;            // Dead-reckoning error allowed between kept points
+    };
+
+    struct Stats {
+        uint64_t updates;        // Points offered
+        uint64_t kept;           // Written to a ring
+        uint64_t out_of_order;   // Not newer than the track's newest point
+        uint64_t evictions;      // Tracks pushed out by others
+        size_t tracks;
+        size_t points;           // Kept points currently stored, tentative ones included
+    };
+
+    explicit TrackHistory(const Options& options);
+
+    // Thread-safe; time_ms is the event's own time
+    void update(std::string_view uid, int64_t time_ms, const CompactPosition& position);
+
+    // The track's points with from_ms <= time <= to_ms, oldest first, reduced
+    // further with Douglas-Peucker when tolerance_m is above the stored
+    // tolerance. False if the track is not known.
+    bool trail(std::string_view uid, int64_t from_ms, int64_t to_ms, double tolerance_m,
+               std::vector<TrailPoint>& out) const;
+
+    Stats stats() const;
+    size_t capacity() const { return slots.size(); }   // Tracks that fit in the budget
+    size_t memory_bytes() const;
+
+    // Douglas-Peucker on a trail in place: keep the fewest points such that
+    // none of the dropped ones is further than tolerance_m from the path
+    static void simplify(std::vector<TrailPoint>& points, double tolerance_m);
+
+private:
+    static constexpr size_t WAYS = 4;
+    static constexpr size_t LOCK_STRIPES = 64;
+
+    struct Point {
+        int32_t lat;
+        int32_t lon;
+        int32_t hae;
+        uint32_t offset_ms;      // From the slot's base_ms
+    };
+
+    struct Slot {
+        uint64_t uid_hash = 0;   // 0 = empty
+        uint64_t last_update = 0;
+        int64_t base_ms = 0;
+        uint32_t head = 0;       // Next write in the ring
+        uint32_t count = 0;      // Kept points, oldest at head - count
+        bool has_pending = false;
+        Point pending = {};      // Newest point, not yet known to be significant
+    };
+
+    Options options;
+    int64_t window_ms;
+    uint32_t ring_size;
+    std::vector<Slot> slots;
+    std::vector<Point> points;   // ring_size per slot
+    size_t sets;
+    std::unique_ptr<std::mutex[]> stripes;
+
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> updates;
+    std::atomic<uint64_t> kept;
+    std::atomic<uint64_t> out_of_order;
+    std::atomic<uint64_t> evictions;
+    std::atomic<int64_t> tracks;
+    std::atomic<int64_t> stored;
+
+    Point* ring(const Slot& slot) { return &points[(&slot - slots.data()) * ring_size]; }
+    const Point* ring(const Slot& slot) const { return &points[(&slot - slots.data()) * ring_size]; }
+    const Point& kept_point(const Slot& slot, uint32_t age) const;   // 0 = newest
+    const Slot* find(uint64_t uid_hash) const;
+
+    void push(Slot& slot, const Point& point);
+    void expire(Slot& slot, int64_t time_ms);
+    void rebase(Slot& slot, int64_t time_ms);
+    bool significant(const Slot& slot, const Point& point) const;
+};
+
+} // namespace CoTCommon
+
+#endif // COT_HISTORY_H
@@ -0,0 +1,561 @@
+#include "cot_ingest.h"
+#include "cot_common.h"
+
+#include <cerrno>
+#include <cmath>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/un.h>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr size_t MAX_XML_BYTES = 4 * 1024 * 1024;
+constexpr size_t MAX_CLIENT_INPUT = 16 * 1024 * 1024;
+constexpr size_t MAX_CLIENT_OUTPUT = 1024 * 1024;
+
+bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool fill_unix_address(const std::string& path, struct sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+// Same strict syntax as <point> values: no "nan", "inf" or trailing text
+bool parse_double_field(const std::string& field, double& value) {
+    DecimalNumber number;
+    if (!parse_decimal(field, number)) return false;
+    value = number.to_double();
+    return std::isfinite(value);
+}
+
+} // namespace
+
+// IngestServer implementation
+IngestServer::IngestServer(const std::string& path, SendBatch send_batch, size_t max_batch_bytes)
+    : socket_path(path), send(std::move(send_batch)), max_batch(max_batch_bytes), listen_fd(-1),
+      next_client_id(1), counters{}, published{}, fanout(nullptr), wake_fds{-1, -1} {
+    MetricsRegistry& metrics = MetricsRegistry::global();
+    std::string labels = "socket=\"" + path + "\"";
+    accepted_metric = metrics.counter("cot_ingest_accepted_total", "Submissions acknowledged with OK", labels);
+    rejected_metric = metrics.counter("cot_ingest_rejected_total", "Malformed or failed submissions", labels);
+    bytes_metric = metrics.counter("cot_ingest_sent_bytes_total", "Bytes written directly to the server", labels);
+    send_failures_metric = metrics.counter("cot_ingest_send_failures_total", "Failed server writes", labels);
+    clients_metric = metrics.gauge("cot_ingest_clients", "Connected ingest clients", labels);
+}
+
+IngestServer::~IngestServer() {
+    for (auto& client : clients) {
+        close(client.fd);
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+    for (int fd : wake_fds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+bool IngestServer::start() {
+    struct sockaddr_un addr;
+    if (!fill_unix_address(socket_path, addr)) {
+        return false;
+    }
+
+    if (pipe(wake_fds) < 0) {
+        std::cerr << "Error creating ingest wake pipe\n";
+        return false;
+    }
+    set_nonblocking(wake_fds[0]);
+    set_nonblocking(wake_fds[1]);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Error creating ingest socket\n";
+        return false;
+    }
+
+    unlink(socket_path.c_str());  // Remove a stale socket from a previous run
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listen_fd, 128) < 0) {
+        std::cerr << "Error binding ingest socket " << socket_path << ": " << strerror(errno) << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    set_nonblocking(listen_fd);
+    return true;
+}
+
+void IngestServer::set_fanout(SendFanout* send_fanout) {
+    fanout = send_fanout;
+}
+
+void IngestServer::run(const std::atomic<bool>& stop) {
+    std::vector<struct pollfd> fds;
+
+    while (!stop) {
+        publish_metrics();
+        fds.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        fds.push_back({wake_fds[0], POLLIN, 0});
+        for (const auto& client : clients) {
+            // A closing client has nothing more to read: recv() would return
+            // 0 at once. Wait only to write its acks, and leave it out of the
+            // poll (fd -1) while they are still pending.
+            short events = client.closing ? 0 : POLLIN;
+            if (!client.output.empty()) events |= POLLOUT;
+            fds.push_back({events ? client.fd : -1, events, 0});
+        }
+
+        int ready = poll(fds.data(), fds.size(), 200);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Ingest poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (ready == 0) continue;
+
+        // Clients accepted now are polled next round
+        size_t polled_clients = fds.size() - 2;
+        if (fds[0].revents & POLLIN) {
+            accept_clients();
+        }
+        if (fds[1].revents & POLLIN) {
+            char drain[256];
+            while (read(wake_fds[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        for (size_t i = 0; i < polled_clients; i++) {
+            if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) {
+                read_client(i);
+            }
+        }
+
+        // Everything that arrived this round goes out as one write
+        flush_batch();
+        drain_completed();
+
+        for (auto& client : clients) {
+            if (!client.output.empty()) {
+                write_client(client);
+            }
+        }
+
+        // Keep half-closed clients until their outstanding acks are written
+        for (size_t i = clients.size(); i-- > 0;) {
+            const Client& client = clients[i];
+            if (client.closing && client.output.empty() &&
+                (client.broken || client.next_reply > client.requests)) {
+                close(client.fd);
+                clients.erase(clients.begin() + i);
+            }
+        }
+        counters.clients = clients.size();
+    }
+
+    flush_batch();
+    drain_completed();
+    publish_metrics();
+}
+
+void IngestServer::publish_metrics() {
+    accepted_metric.add(counters.accepted - published.accepted);
+    rejected_metric.add(counters.rejected - published.rejected);
+    bytes_metric.add(counters.bytes - published.bytes);
+    send_failures_metric.add(counters.send_failures - published.send_failures);
+    clients_metric.set(static_cast<int64_t>(counters.clients));
+    published = counters;
+}
+
+void IngestServer::accept_clients() {
+    while (true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) break;
+        set_nonblocking(fd);
+
+        Client client{};
+        client.fd = fd;
+        client.id = next_client_id++;
+        client.next_reply = 1;
+        clients.push_back(std::move(client));
+    }
+    counters.clients = clients.size();
+}
+
+void IngestServer::read_client(size_t index) {
+    Client& client = clients[index];
+    char buffer[65536];
+
+    while (!client.closing) {
+        ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            client.input.append(buffer, n);
+            if (client.input.size() > MAX_CLIENT_INPUT) {
+                client.closing = true;
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+
+        // Peer closed; still answer what it already sent
+        client.closing = true;
+    }
+
+    handle_requests(client);
+}
+
+void IngestServer::handle_requests(Client& client) {
+    size_t pos = 0;
+
+    while (true) {
+        size_t newline = client.input.find('\n', pos);
+        if (newline == std::string::npos) break;
+
+        std::string line = client.input.substr(pos, newline - pos);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t next = newline + 1;
+
+        if (line.compare(0, 4, "XML ") == 0) {
+            char* end = nullptr;
+            unsigned long long length = std::strtoull(line.c_str() + 4, &end, 10);
+            if (!end || *end != '\0' || length == 0 || length > MAX_XML_BYTES) {
+                // The stream can no longer be framed, so drop the client
+                reply(client, ++client.requests, "ERR " + std::to_string(++client.submissions) + " invalid length");
+                counters.rejected++;
+                client.closing = true;
+                pos = client.input.size();
+                break;
+            }
+            if (next + length > client.input.size()) break;  // Body not complete yet
+
+            uint64_t request = ++client.requests;
+            uint64_t submission = ++client.submissions;
+            std::string_view xml = std::string_view(client.input).substr(next, length);
+            CoTParser::CoTMessageView view;
+            arena.reset();
+            if (parser.parse_view(xml, view, arena)) {
+                submit(client, request, submission, std::string(xml));
+            } else {
+                counters.rejected++;
+                reply(client, request, "ERR " + std::to_string(submission) + " malformed CoT event");
+            }
+            next += length;
+        } else if (line.compare(0, 4, "POS ") == 0) {
+            std::string xml, error;
+            uint64_t request = ++client.requests;
+            uint64_t submission = ++client.submissions;
+            if (render_position(std::string_view(line).substr(4), xml, error)) {
+                submit(client, request, submission, std::move(xml));
+            } else {
+                counters.rejected++;
+                reply(client, request, "ERR " + std::to_string(submission) + " " + error);
+            }
+        } else if (line == "STATS") {
+            reply(client, ++client.requests, stats_line());
+        } else if (line == "PING") {
+            reply(client, ++client.requests, "PONG");
+        } else if (!line.empty()) {
+            reply(client, ++client.requests, "ERR 0 unknown command");
+        }
+
+        pos = next;
+        if (batch.size() >= max_batch) {
+            flush_batch();
+        }
+    }
+
+    client.input.erase(0, pos);
+}
+
+void IngestServer::submit(Client& client, uint64_t request, uint64_t submission, std::string xml) {
+    PendingAck ack{client.id, request, submission};
+
+    if (!fanout) {
+        batch += xml;
+        pending.push_back(ack);
+        return;
+    }
+
+    auto payload = std::make_shared<const std::string>(std::move(xml));
+    std::string_view uid = CoTParser::peek_attribute(*payload, "event", "uid");
+    std::string_view type = CoTParser::peek_attribute(*payload, "event", "type");
+
+    fanout->submit(uid, type, payload, [this, ack](SendScheduler::Outcome outcome) {
+        {
+            std::lock_guard<std::mutex> lock(completed_mutex);
+            completed.push_back(Completed{ack, outcome});
+        }
+        char byte = 0;
+        ssize_t written = write(wake_fds[1], &byte, 1);  // A full pipe means poll is already woken
+        (void)written;
+    });
+}
+
+void IngestServer::flush_batch() {
+    if (pending.empty()) return;
+
+    bool ok = send(batch);
+    counters.batches++;
+    if (ok) {
+        counters.bytes += batch.size();
+        counters.accepted += pending.size();
+    } else {
+        counters.send_failures++;
+        counters.rejected += pending.size();
+    }
+
+    for (const auto& ack : pending) {
+        Client* client = find_client(ack.client);
+        if (!client) continue;
+        std::string n = std::to_string(ack.submission);
+        reply(*client, ack.request, ok ? "OK " + n : "ERR " + n + " send failed");
+    }
+
+    batch.clear();
+    pending.clear();
+}
+
+void IngestServer::drain_completed() {
+    std::vector<Completed> done;
+    {
+        std::lock_guard<std::mutex> lock(completed_mutex);
+        done.swap(completed);
+    }
+
+    for (const auto& item : done) {
+        std::string n = std::to_string(item.ack.submission);
+        std::string line;
+        switch (item.outcome) {
+            case SendScheduler::Outcome::SENT:
+            case SendScheduler::Outcome::SUPERSEDED:
+                counters.accepted++;
+                line = "OK " + n;
+                break;
+            case SendScheduler::Outcome::REJECTED:
+                counters.rejected++;
+                line = "ERR " + n + " queue full";
+                break;
+            case SendScheduler::Outcome::FAILED:
+                counters.rejected++;
+                counters.send_failures++;
+                line = "ERR " + n + " send failed";
+                break;
+        }
+
+        // The client may have gone away while its event was queued
+        Client* client = find_client(item.ack.client);
+        if (client) {
+            reply(*client, item.ack.request, line);
+        }
+    }
+}
+
+IngestServer::Client* IngestServer::find_client(uint64_t id) {
+    for (auto& client : clients) {
+        if (client.id == id) return &client;
+    }
+    return nullptr;
+}
+
+void IngestServer::reply(Client& client, uint64_t request, const std::string& line) {
+    if (client.broken) return;
+
+    // Hold replies that finish ahead of an earlier request
+    if (request != client.next_reply) {
+        client.early_replies.emplace(request, line);
+        return;
+    }
+
+    client.output += line;
+    client.output += '\n';
+    client.next_reply++;
+    while (!client.early_replies.empty() && client.early_replies.begin()->first == client.next_reply) {
+        client.output += client.early_replies.begin()->second;
+        client.output += '\n';
+        client.early_replies.erase(client.early_replies.begin());
+        client.next_reply++;
+    }
+
+    // A client that never reads its acks must not grow the daemon
+    if (client.output.size() > MAX_CLIENT_OUTPUT) {
+        client.output.clear();
+        client.early_replies.clear();
+        client.closing = true;
+        client.broken = true;
+    }
+}
+
+void IngestServer::write_client(Client& client) {
+    while (!client.output.empty()) {
+        ssize_t sent = ::send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent > 0) {
+            client.output.erase(0, sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+
+        client.output.clear();
+        client.early_replies.clear();
+        client.closing = true;
+        client.broken = true;
+    }
+}
+
+std::string IngestServer::stats_line() const {
+    std::string line = "STATS clients=" + std::to_string(counters.clients) +
+                       " accepted=" + std::to_string(counters.accepted) +
+                       " rejected=" + std::to_string(counters.rejected) +
+                       " batches=" + std::to_string(counters.batches) +
+                       " bytes=" + std::to_string(counters.bytes) +
+                       " send_failures=" + std::to_string(counters.send_failures);
+
+    if (fanout) {
+        // Targets are numbered t1, t2, ... in the order they were added
+        char buffer[256];
+        std::vector<SendFanout::TargetStats> targets = fanout->stats();
+        for (size_t i = 0; i < targets.size(); i++) {
+            const auto& t = targets[i];
+            std::string prefix = "t" + std::to_string(i + 1);
+            snprintf(buffer, sizeof(buffer), " %s_queued=%zu %s_lag_ms=%.1f %s_sent=%llu %s_dropped=%llu %s_failed=%llu",
+                     prefix.c_str(), t.queued, prefix.c_str(), t.lag_ms,
+                     prefix.c_str(), static_cast<unsigned long long>(t.sent),
+                     prefix.c_str(), static_cast<unsigned long long>(t.dropped),
+                     prefix.c_str(), static_cast<unsigned long long>(t.failed));
+            line += buffer;
+            for (const auto& c : t.classes) {
+                snprintf(buffer, sizeof(buffer), " %s_%s_queued=%zu %s_%s_max_ms=%.1f",
+                         prefix.c_str(), c.name.c_str(), c.depth, prefix.c_str(), c.name.c_str(), c.max_latency_ms);
+                line += buffer;
+            }
+        }
+    }
+    return line;
+}
+
+IngestServer::Stats IngestServer::stats() const {
+    return counters;
+}
+
+bool IngestServer::render_position(std::string_view record, std::string& xml, std::string& error) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t comma = record.find(',', start);
+        fields.emplace_back(record.substr(start, comma - start));
+        if (comma == std::string_view::npos) break;
+        start = comma + 1;
+    }
+
+    if (fields.size() != 7 && fields.size() != 8) {
+        error = "expected uid,type,lat,lon,hae,callsign,team[,how]";
+        return false;
+    }
+
+    double lat, lon, hae;
+    if (!parse_double_field(fields[2], lat) || !parse_double_field(fields[3], lon) ||
+        !parse_double_field(fields[4], hae) || lat < -90 || lat > 90 || lon < -180 || lon > 180) {
+        error = "invalid position";
+        return false;
+    }
+    if (fields[0].empty() || fields[1].empty()) {
+        error = "uid and type are required";
+        return false;
+    }
+
+    // Position reports are live tracks, not persistent objects
+    std::string how = fields.size() == 8 ? fields[7] : "m-g";
+    CoTObject obj(fields[1], how, lat, lon, hae, fields[5], fields[6]);
+    obj.set_uid(fields[0]);
+    obj.set_persistent(false);
+    xml = obj.to_xml();
+    return true;
+}
+
+// IngestClient implementation
+bool IngestClient::connect(const std::string& path) {
+    struct sockaddr_un addr;
+    if (!fill_unix_address(path, addr)) {
+        return false;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Error creating socket\n";
+        return false;
+    }
+
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "Error connecting to injector daemon at " << path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void IngestClient::disconnect() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool IngestClient::send_xml(const std::string& xml) {
+    std::string header = "XML " + std::to_string(xml.size()) + "\n";
+    return send_all(fd, header.data(), header.size()) && send_all(fd, xml.data(), xml.size());
+}
+
+bool IngestClient::send_position(const std::string& record) {
+    return send_command("POS " + record);
+}
+
+bool IngestClient::send_command(const std::string& command) {
+    std::string line = command + "\n";
+    return send_all(fd, line.data(), line.size());
+}
+
+bool IngestClient::read_reply(std::string& line) {
+    while (true) {
+        size_t newline = input.find('\n');
+        if (newline != std::string::npos) {
+            line = input.substr(0, newline);
+            input.erase(0, newline + 1);
+            return true;
+        }
+
+        char buffer[4096];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        input.append(buffer, n);
+    }
+}
+
+} // namespace CoTCommon
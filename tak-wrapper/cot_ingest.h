@@ -0,0 +1,167 @@
+#ifndef COT_INGEST_H
+#define COT_INGEST_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cot_common.h"
+#include "cot_metrics.h"
+#include "cot_scheduler.h"
+
+namespace CoTCommon {
+
+// Local ingest API served by `cot_injector --daemon` over a Unix domain
+// socket. Requests are newline-terminated commands:
+//
+//   XML <length>\n<length bytes of CoT XML>
+//   POS <uid>,<type>,<lat>,<lon>,<hae>,<callsign>,<team>[,<how>]\n
+//   STATS\n
+//   PING\n
+//
+// XML submissions must parse as a CoT event. Every XML/POS submission is
+// answered with "OK <n>" once it has been
+// written to the TAK server (or superseded by a newer report for the same
+// UID), or "ERR <n> <reason>", where n counts the submissions on that client
+// connection starting at 1. STATS answers with a single "STATS key=value ..."
+// line and PING with "PONG". Replies always come back in request order.
+//
+// By default submissions from all clients that arrive in the same poll round
+// are coalesced into one write on the shared server connection. With a
+// SendFanout attached each submission is queued by priority class on every
+// target instead, and acknowledged asynchronously once a target has written
+// it.
+class IngestServer {
+public:
+    // Writes one coalesced batch of CoT XML to the server
+    using SendBatch = std::function<bool(const std::string& batch)>;
+
+    struct Stats {
+        uint64_t clients;       // Currently connected
+        uint64_t accepted;      // Submissions acknowledged with OK
+        uint64_t rejected;      // Malformed or failed submissions
+        uint64_t batches;       // Direct writes only; see SendScheduler::stats()
+        uint64_t bytes;
+        uint64_t send_failures;
+    };
+
+    IngestServer(const std::string& path, SendBatch send_batch, size_t max_batch_bytes = 256 * 1024);
+    ~IngestServer();
+
+    IngestServer(const IngestServer&) = delete;
+    IngestServer& operator=(const IngestServer&) = delete;
+
+    // Bind and listen on the socket path (replacing a stale socket file)
+    bool start();
+
+    // Serve clients until stop becomes true
+    void run(const std::atomic<bool>& stop);
+
+    // Route submissions through priority schedulers (which must outlive
+    // run()) instead of writing batches directly
+    void set_fanout(SendFanout* send_fanout);
+
+    Stats stats() const;
+
+    // Render a POS record body into CoT XML
+    static bool render_position(std::string_view record, std::string& xml, std::string& error);
+
+private:
+    struct Client {
+        int fd;
+        uint64_t id;
+        std::string input;
+        std::string output;
+        uint64_t submissions;   // XML/POS requests, numbered in acks
+        uint64_t requests;      // All requests, for reply ordering
+        uint64_t next_reply;
+        std::map<uint64_t, std::string> early_replies;  // Finished out of order
+        bool closing;
+        bool broken;            // Peer gone or not reading; drop further replies
+    };
+
+    struct PendingAck {
+        uint64_t client;
+        uint64_t request;
+        uint64_t submission;
+    };
+
+    struct Completed {
+        PendingAck ack;
+        SendScheduler::Outcome outcome;
+    };
+
+    std::string socket_path;
+    SendBatch send;
+    size_t max_batch;
+    int listen_fd;
+    std::vector<Client> clients;
+    std::string batch;
+    std::vector<PendingAck> pending;
+    uint64_t next_client_id;
+    Stats counters;
+
+    // XML submissions are parsed before they are forwarded
+    CoTParser parser;
+    BatchArena arena;
+
+    // Counter deltas are exported once per poll round, so the metrics
+    // thread never reads the loop's own counters
+    Stats published;
+    MetricsRegistry::Counter accepted_metric;
+    MetricsRegistry::Counter rejected_metric;
+    MetricsRegistry::Counter bytes_metric;
+    MetricsRegistry::Counter send_failures_metric;
+    MetricsRegistry::Gauge clients_metric;
+
+    // Asynchronous acks from the writer threads, signalled through a pipe
+    SendFanout* fanout;
+    std::mutex completed_mutex;
+    std::vector<Completed> completed;
+    int wake_fds[2];
+
+    void accept_clients();
+    void read_client(size_t index);
+    void handle_requests(Client& client);
+    void submit(Client& client, uint64_t request, uint64_t submission, std::string xml);
+    void flush_batch();
+    void drain_completed();
+    void publish_metrics();
+    void write_client(Client& client);
+    Client* find_client(uint64_t id);
+    void reply(Client& client, uint64_t request, const std::string& line);
+    std::string stats_line() const;
+};
+
+// Blocking client for the ingest socket
+class IngestClient {
+private:
+    int fd;
+    std::string input;
+
+public:
+    IngestClient() : fd(-1) {}
+    ~IngestClient() { disconnect(); }
+
+    IngestClient(const IngestClient&) = delete;
+    IngestClient& operator=(const IngestClient&) = delete;
+
+    bool connect(const std::string& path);
+    void disconnect();
+
+    bool send_xml(const std::string& xml);
+    bool send_position(const std::string& record);
+    bool send_command(const std::string& command);
+
+    // Read one response line (without the newline)
+    bool read_reply(std::string& line);
+};
+
+} // namespace CoTCommon
+
+#endif // COT_INGEST_H
@@ -1,48 +1,307 @@
 #include "cot_common.h"
-
+#include "cot_ingest.h"
+#include "cot_takproto.h"
+#include "cot_udp.h"
+#include <atomic>
+#include <functional>
+#include <signal.h>
 
 class TAKServerClient {
 private:
-    CoTCommon::TAKServerConnection connection;
+    std::unique_ptr<CoTCommon::CoTTransport> connection;
+    CoTCommon::UdpTransport* udp;  // Set when sending plain CoT over UDP
+    std::string name;
+    uint64_t reconnects = 0;
+    std::chrono::steady_clock::time_point last_reconnect;
+    
+    // TAK Protocol, when requested and the server agrees
+    bool negotiate_proto;
+    bool proto;
+    CoTCommon::TakEncoder encoder;
+    std::string encoded;
+    uint64_t encode_failures = 0;
+    bool unencodable = false;  // Last write() had no event left to send
+    
+    CoTCommon::MetricsRegistry::Counter events_metric;
+    CoTCommon::MetricsRegistry::Counter failures_metric;
+    CoTCommon::MetricsRegistry::Counter reconnects_metric;
+    CoTCommon::MetricsRegistry::Counter encode_failures_metric;
+    
+    // Rendered XML is re-encoded once TAK Protocol is negotiated. Events that
+    // do not encode are dropped and counted; false if none of them did.
+    bool write(const std::string& data) {
+        unencodable = false;
+        if (!proto) {
+            return connection->send_data(data);
+        }
+        encoded.clear();
+        size_t failed = 0;
+        size_t count = encoder.encode_stream(data, encoded, &failed);
+        if (failed > 0) {
+            encode_failures += failed;
+            encode_failures_metric.add(failed);
+            std::cerr << "Dropped " << failed << " event(s) that could not be encoded for " << name << std::endl;
+        }
+        if (count == 0) {
+            unencodable = true;
+            return false;
+        }
+        return connection->send_data(encoded);
+    }
 
 public:
     TAKServerClient(const std::string& hostname, int tcp_port, 
                    const std::string& cert_path = "", const std::string& key_path = "",
-                   const std::string& ca_path = "", const std::string& pass = "") 
-        : connection(hostname, tcp_port, cert_path, key_path, ca_path, pass, true) {
+                   const std::string& ca_path = "", const std::string& pass = "",
+                   const CoTCommon::UdpTransport::Options* udp_options = nullptr, bool use_proto = false) 
+        : udp(nullptr), name(hostname + ":" + std::to_string(tcp_port)), negotiate_proto(use_proto && !udp_options),
+          proto(false) {
+        if (udp_options) {
+            udp = new CoTCommon::UdpTransport(hostname, tcp_port, CoTCommon::UdpTransport::Mode::SEND,
+                                              *udp_options, true);
+            connection.reset(udp);
+            name = "udp://" + name;
+        } else {
+            connection.reset(new CoTCommon::TAKServerConnection(hostname, tcp_port, cert_path, key_path,
+                                                                ca_path, pass, true));
+        }
+        
+        CoTCommon::MetricsRegistry& metrics = CoTCommon::MetricsRegistry::global();
+        std::string labels = "target=\"" + name + "\"";
+        events_metric = metrics.counter("cot_injector_writes_total", "Events or batches written", labels);
+        failures_metric = metrics.counter("cot_injector_write_failures_total", "Writes that failed", labels);
+        reconnects_metric = metrics.counter("cot_injector_reconnects_total", "Reconnects after a failed write",
+                                            labels);
+        encode_failures_metric = metrics.counter("cot_injector_encode_failures_total",
+                                                 "Events dropped because they could not be encoded", labels);
+    }
+    
+    const std::string& get_name() const {
+        return name;
     }
     
     bool connect() {
-        return connection.connect();
+        proto = false;
+        if (!connection->connect()) {
+            return false;
+        }
+        if (negotiate_proto) {
+            std::string leftover;  // The injector never reads what the server sends
+            proto = CoTCommon::negotiate_tak_protocol(*connection, 2000, leftover, true);
+            std::cout << "Sending " << (proto ? "TAK Protocol v1" : "XML") << " to " << name << std::endl;
+        }
+        return true;
     }
     
     bool send_cot(const CoTCommon::CoTObject& cot_obj) {
-        if (!connection.is_connected()) {
+        if (!connection->is_connected()) {
             std::cerr << "Not connected to TAK server\n";
             return false;
         }
         
-        std::string xml_data = cot_obj.to_xml();
-        
-        std::cout << "Sending CoT XML:\n" << xml_data << std::endl;
-        
-        if (!connection.send_data(xml_data)) {
-            return false;
+        if (proto) {
+            encoded.clear();
+            encoder.encode(cot_obj, encoded);
+            std::cout << "Sending CoT as TAK Protocol v1 (" << encoded.size() << " bytes)\n";
+            if (!connection->send_data(encoded)) {
+                failures_metric.add();
+                return false;
+            }
+        } else {
+            std::string xml_data = cot_obj.to_xml();
+            
+            std::cout << "Sending CoT XML:\n" << xml_data << std::endl;
+            
+            if (!connection->send_data(xml_data)) {
+                failures_metric.add();
+                return false;
+            }
         }
+        events_metric.add();
         
         std::cout << "Sent CoT object " << cot_obj.get_uid() << " (" << cot_obj.get_callsign() << ")\n";
         return true;
     }
     
+    // Write pre-rendered CoT, reconnecting if the server went away. Reconnects
+    // are tried at most once a second so writes to a dead server fail fast.
+    bool send_raw(const std::string& data) {
+        COT_TRACE_SCOPE("send");
+        if (connection->is_connected() && write(data)) {
+            events_metric.add();
+            return true;
+        }
+        if (unencodable) {
+            failures_metric.add();  // The connection is fine; reconnecting would not help
+            return false;
+        }
+        
+        if (connection->is_connected()) {
+            connection->disconnect();
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_reconnect < std::chrono::seconds(1)) {
+            failures_metric.add();
+            return false;
+        }
+        last_reconnect = now;
+        if (!connect()) {
+            failures_metric.add();
+            return false;
+        }
+        reconnects++;
+        reconnects_metric.add();
+        bool ok = write(data);
+        (ok ? events_metric : failures_metric).add();
+        return ok;
+    }
+    
+    void set_unsent_limit(int bytes) {
+        connection->set_unsent_limit(bytes);
+    }
+    
+    uint64_t get_reconnects() const {
+        return reconnects;
+    }
+    
+    uint64_t get_encode_failures() const {
+        return encode_failures;
+    }
+    
+    const CoTCommon::UdpTransport* get_udp() const {
+        return udp;
+    }
+    
     void disconnect() {
-        connection.disconnect();
+        connection->disconnect();
     }
     
     bool is_connected() const {
-        return connection.is_connected();
+        return connection->is_connected();
     }
 };
 
+using TargetList = std::vector<std::unique_ptr<TAKServerClient>>;
+
+static std::atomic<bool> daemon_stop(false);
+
+// One scheduler per target, all sharing each rendered event
+void add_targets(CoTCommon::SendFanout& fanout, TargetList& targets,
+                 const CoTCommon::SendScheduler::Options& schedule) {
+    for (auto& target : targets) {
+        TAKServerClient* client = target.get();
+        fanout.add_target(client->get_name(), schedule, [client](const std::string& data) {
+            return client->send_raw(data);
+        });
+        // Keep the backlog in the scheduler rather than the socket buffer
+        client->set_unsent_limit(static_cast<int>(schedule.max_write_bytes));
+    }
+}
+
+// Queue depth, lag and drops of each target, read from the schedulers
+std::vector<uint64_t> add_fanout_metrics(const CoTCommon::SendFanout& fanout) {
+    using Type = CoTCommon::MetricsRegistry::Type;
+    CoTCommon::MetricsRegistry& metrics = CoTCommon::MetricsRegistry::global();
+    std::vector<uint64_t> ids;
+    std::vector<CoTCommon::SendFanout::TargetStats> stats = fanout.stats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        const CoTCommon::SendFanout* f = &fanout;
+        std::string labels = "target=\"" + stats[i].name + "\"";
+        ids.push_back(metrics.add_callback("cot_injector_queued_events", "Events waiting in the target's queue",
+                                           labels, Type::GAUGE,
+                                           [f, i] { return static_cast<double>(f->stats()[i].queued); }));
+        ids.push_back(metrics.add_callback("cot_injector_queue_lag_seconds", "Age of the oldest queued event",
+                                           labels, Type::GAUGE, [f, i] { return f->stats()[i].lag_ms / 1000.0; }));
+        ids.push_back(metrics.add_callback("cot_injector_dropped_events_total",
+                                           "Events rejected because the target's queue was full", labels,
+                                           Type::COUNTER,
+                                           [f, i] { return static_cast<double>(f->stats()[i].dropped); }));
+    }
+    return ids;
+}
+
+void remove_metrics(const std::vector<uint64_t>& ids) {
+    for (uint64_t id : ids) {
+        CoTCommon::MetricsRegistry::global().remove_callback(id);
+    }
+}
+
+void print_target_stats(const CoTCommon::SendFanout& fanout, const TargetList& targets) {
+    std::vector<CoTCommon::SendFanout::TargetStats> stats = fanout.stats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        const auto& t = stats[i];
+        printf("  %-21s sent %-8llu dropped %-6llu failed %-6llu latency mean %.1f ms, max %.1f ms, lag %.1f ms, %llu reconnects, %llu not encodable\n",
+               t.name.c_str(), static_cast<unsigned long long>(t.sent),
+               static_cast<unsigned long long>(t.dropped), static_cast<unsigned long long>(t.failed),
+               t.mean_latency_ms, t.max_latency_ms, t.lag_ms,
+               static_cast<unsigned long long>(targets[i]->get_reconnects()),
+               static_cast<unsigned long long>(targets[i]->get_encode_failures()));
+        for (const auto& c : t.classes) {
+            printf("    %-8s sent %-8llu coalesced %-8llu rejected %-6llu latency mean %.1f ms, max %.1f ms, %llu over budget\n",
+                   c.name.c_str(), static_cast<unsigned long long>(c.sent),
+                   static_cast<unsigned long long>(c.coalesced), static_cast<unsigned long long>(c.rejected),
+                   c.mean_latency_ms, c.max_latency_ms, static_cast<unsigned long long>(c.budget_misses));
+        }
+    }
+}
+
+void print_udp_stats(const TargetList& targets) {
+    for (const auto& target : targets) {
+        const CoTCommon::UdpTransport* udp = target->get_udp();
+        if (!udp) continue;
+        CoTCommon::UdpTransport::Stats u = udp->stats();
+        printf("  %-21s %llu datagrams, %llu bytes in %llu sendmmsg calls, %llu oversized\n",
+               target->get_name().c_str(), static_cast<unsigned long long>(u.datagrams),
+               static_cast<unsigned long long>(u.bytes), static_cast<unsigned long long>(u.syscalls),
+               static_cast<unsigned long long>(u.oversized));
+    }
+}
+
+// Hold warm server connections and serve the local ingest socket. With a
+// schedule, submissions are queued by priority class for every target;
+// without one the single target is written FIFO.
+int run_daemon(TargetList& targets, const std::string& socket_path,
+               const CoTCommon::SendScheduler::Options* schedule) {
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, [](int) { daemon_stop = true; });
+    signal(SIGTERM, [](int) { daemon_stop = true; });
+    
+    TAKServerClient& primary = *targets[0];
+    CoTCommon::IngestServer server(socket_path, [&primary](const std::string& batch) {
+        return primary.send_raw(batch);
+    });
+    if (!server.start()) {
+        return 1;
+    }
+    
+    CoTCommon::SendFanout fanout;
+    std::vector<uint64_t> fanout_metrics;
+    if (schedule) {
+        add_targets(fanout, targets, *schedule);
+        fanout.start();
+        server.set_fanout(&fanout);
+        fanout_metrics = add_fanout_metrics(fanout);
+    }
+    
+    std::cout << "Injector daemon listening on " << socket_path << std::endl;
+    server.run(daemon_stop);
+    remove_metrics(fanout_metrics);
+    fanout.stop();
+    
+    CoTCommon::IngestServer::Stats stats = server.stats();
+    std::cout << "\nInjector daemon stopped: " << stats.accepted << " accepted, "
+              << stats.rejected << " rejected\n";
+    if (schedule) {
+        print_target_stats(fanout, targets);
+    } else {
+        std::cout << "  " << stats.batches << " batches, " << stats.bytes << " bytes, "
+                  << primary.get_reconnects() << " reconnects, " << primary.get_encode_failures()
+                  << " events not encodable\n";
+    }
+    print_udp_stats(targets);
+    return 0;
+}
+
 // Generate random coordinates within Australia
 std::pair<double, double> generate_random_australia_coords() {
     std::random_device rd;
@@ -109,33 +368,64 @@ std::vector<CoTCommon::CoTObject> create_sample_units() {
 void print_usage(const char* program_name) {
     std::cout << "Usage: " << program_name << " [options]\n";
     std::cout << "Options:\n";
-    std::cout << "  --host <hostname>     TAK server hostname (default: localhost)\n";
-    std::cout << "  --port <port>         TAK server TCP port (default: 8089)\n";
+    std::cout << "  --host <hostname>     TAK server hostname (default: localhost, repeatable)\n";
+    std::cout << "  --port <port>         TAK server TCP port (default: 8089; one, or one per --host)\n";
     std::cout << "  --cert <file>         Client certificate file (.pem)\n";
     std::cout << "  --key <file>          Client private key file (.pem)\n";
     std::cout << "  --ca <file>           CA certificate file (.pem)\n";
     std::cout << "  --passphrase <pass>   Private key passphrase\n";
     std::cout << "  --count <number>      Number of iterations (default: 1)\n";
     std::cout << "  --interval <seconds>  Interval between sends (default: 1.0)\n";
+    std::cout << "  --daemon              Stay running and accept CoT on a local Unix socket\n";
+    std::cout << "  --socket <path>       Daemon socket path (default: /tmp/cot_injector.sock)\n";
+    std::cout << "  --via <path>          Send through a running daemon instead of connecting\n";
+    std::cout << "  --schedule <policy>   Daemon send order: strict (default), weighted or fifo\n";
+    std::cout << "  --urgent <type>       Also send this type pattern as urgent (repeatable)\n";
+    std::cout << "  --bulk <type>         Also coalesce this type pattern as bulk (repeatable)\n";
+    std::cout << "  --budget <class>=<ms> Latency budget for urgent, routine or bulk\n";
+    std::cout << "  --udp                 Send plain CoT datagrams to --host/--port instead of TLS\n";
+    std::cout << "                        (default: multicast 239.2.3.1:6969)\n";
+    std::cout << "  --ttl <hops>          Multicast TTL (default: 1)\n";
+    std::cout << "  --interface <addr>    Local interface address to send multicast from\n";
+    std::cout << "  --stamp               Append sequence/time stamps so listeners can count drops\n";
+    std::cout << "  --proto               Negotiate TAK Protocol v1 (protobuf) with each server,\n";
+    std::cout << "                        sending XML to servers that do not offer it\n";
+    std::cout << "  --metrics-port <port> Serve Prometheus metrics on 127.0.0.1:port/metrics\n";
+    std::cout << "                        (SIGUSR1 always prints them to stderr)\n";
+    std::cout << "  --trace <file>        Record hot-path trace points; write Chrome trace JSON\n";
+    std::cout << "                        to file on SIGUSR2 and at exit\n";
+    std::cout << "  --trace-sample <n>    Record one in n top-level trace scopes (default: 1)\n";
     std::cout << "  --help               Show this help message\n";
 }
 
 int main(int argc, char* argv[]) {
-    std::string host = "localhost";
-    int port = 8089;
+    std::vector<std::string> hosts;
+    std::vector<int> ports;
     std::string cert_file;
     std::string key_file;
     std::string ca_file;
     std::string passphrase;
     int count = 1;
     double interval = 1.0;
+    bool daemon_mode = false;
+    std::string socket_path = "/tmp/cot_injector.sock";
+    std::string via_socket;
+    std::string schedule_policy = "strict";
+    CoTCommon::SendScheduler::Options schedule;
+    schedule.classes = CoTCommon::SendScheduler::default_classes();
+    bool use_udp = false;
+    bool use_proto = false;
+    CoTCommon::UdpTransport::Options udp_options;
+    int metrics_port = 0;
+    std::string trace_file;
+    uint32_t trace_sample = 1;
     
     // Simple argument parsing
     for (int i = 1; i < argc; i++) {
         if (std::string(argv[i]) == "--host" && i + 1 < argc) {
-            host = argv[++i];
+            hosts.push_back(argv[++i]);
         } else if (std::string(argv[i]) == "--port" && i + 1 < argc) {
-            port = std::stoi(argv[++i]);
+            ports.push_back(std::stoi(argv[++i]));
         } else if (std::string(argv[i]) == "--cert" && i + 1 < argc) {
             cert_file = argv[++i];
         } else if (std::string(argv[i]) == "--key" && i + 1 < argc) {
@@ -148,24 +438,170 @@ int main(int argc, char* argv[]) {
             count = std::stoi(argv[++i]);
         } else if (std::string(argv[i]) == "--interval" && i + 1 < argc) {
             interval = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--daemon") {
+            daemon_mode = true;
+        } else if (std::string(argv[i]) == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (std::string(argv[i]) == "--via" && i + 1 < argc) {
+            via_socket = argv[++i];
+        } else if (std::string(argv[i]) == "--schedule" && i + 1 < argc) {
+            schedule_policy = argv[++i];
+            if (schedule_policy != "strict" && schedule_policy != "weighted" && schedule_policy != "fifo") {
+                std::cerr << "Invalid --schedule (expected strict, weighted or fifo)\n";
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--urgent" && i + 1 < argc) {
+            schedule.classes[0].type_patterns.push_back(argv[++i]);
+        } else if (std::string(argv[i]) == "--bulk" && i + 1 < argc) {
+            schedule.classes[2].type_patterns.push_back(argv[++i]);
+        } else if (std::string(argv[i]) == "--budget" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t eq = spec.find('=');
+            bool found = false;
+            for (auto& c : schedule.classes) {
+                if (eq != std::string::npos && spec.compare(0, eq, c.name) == 0 && eq == c.name.size()) {
+                    c.latency_budget_ms = std::stod(spec.substr(eq + 1));
+                    found = true;
+                }
+            }
+            if (!found) {
+                std::cerr << "Invalid --budget (expected urgent|routine|bulk=<ms>)\n";
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--udp") {
+            use_udp = true;
+        } else if (std::string(argv[i]) == "--ttl" && i + 1 < argc) {
+            udp_options.ttl = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--interface" && i + 1 < argc) {
+            udp_options.interface_address = argv[++i];
+        } else if (std::string(argv[i]) == "--stamp") {
+            udp_options.stamp = true;
+        } else if (std::string(argv[i]) == "--proto") {
+            use_proto = true;
+        } else if (std::string(argv[i]) == "--metrics-port" && i + 1 < argc) {
+            metrics_port = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--trace" && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (std::string(argv[i]) == "--trace-sample" && i + 1 < argc) {
+            trace_sample = static_cast<uint32_t>(std::stoul(argv[++i]));
         } else if (std::string(argv[i]) == "--help") {
             print_usage(argv[0]);
             return 0;
         }
     }
     
+    if (hosts.empty()) {
+        hosts.push_back(use_udp ? "239.2.3.1" : "localhost");
+    }
+    int default_port = use_udp ? 6969 : 8089;
+    if (use_udp && use_proto) {
+        std::cerr << "--proto applies to TLS connections; UDP datagrams stay XML\n";
+    }
+    if (ports.size() > 1 && ports.size() != hosts.size()) {
+        std::cerr << "Give one --port for all hosts, or one per --host\n";
+        return 1;
+    }
+    
     std::cout << "TAK Server CoT Injector (C++)\n";
     std::cout << "==============================\n";
-    std::cout << "Target: " << host << ":" << port << std::endl;
-    std::cout << "Count: " << count << ", Interval: " << interval << "s\n\n";
+    if (via_socket.empty()) {
+        for (size_t i = 0; i < hosts.size(); i++) {
+            int port = ports.empty() ? default_port : ports[ports.size() == 1 ? 0 : i];
+            std::cout << "Target: " << (use_udp ? "udp://" : "") << hosts[i] << ":" << port << std::endl;
+        }
+    } else {
+        std::cout << "Target: daemon at " << via_socket << std::endl;
+    }
+    if (!daemon_mode) {
+        std::cout << "Count: " << count << ", Interval: " << interval << "s\n";
+    }
+    CoTCommon::MetricsServer metrics;
+    if (!metrics.start(metrics_port)) {
+        return 1;
+    }
+    if (!trace_file.empty() &&
+        (!CoTCommon::Tracer::enable(65536, trace_sample) || !CoTCommon::Tracer::export_on_signal(trace_file))) {
+        return 1;
+    }
+    if (metrics_port > 0) {
+        std::cout << "Metrics: http://127.0.0.1:" << metrics_port << "/metrics\n";
+    }
+    std::cout << std::endl;
     
-    // Create TAK server client
-    TAKServerClient client(host, port, cert_file, key_file, ca_file, passphrase);
+    std::function<bool(const CoTCommon::CoTObject&)> send_unit;
+    TargetList targets;
+    CoTCommon::SendFanout fanout;
+    std::vector<uint64_t> fanout_metrics;
+    CoTCommon::IngestClient ingest;
     
-    // Connect to server
-    if (!client.connect()) {
-        std::cerr << "Failed to connect to TAK server\n";
-        return 1;
+    schedule.policy = schedule_policy == "weighted" ? CoTCommon::SendScheduler::Policy::WEIGHTED
+                                                    : CoTCommon::SendScheduler::Policy::STRICT;
+    if (schedule_policy == "fifo") {
+        // A single class keeps arrival order for every target
+        schedule.classes.assign(1, CoTCommon::SendScheduler::PriorityClass());
+        schedule.classes[0].name = "fifo";
+    }
+    
+    if (!via_socket.empty()) {
+        // Hand events to the daemon and wait for each acknowledgment
+        if (!ingest.connect(via_socket)) {
+            return 1;
+        }
+        send_unit = [&ingest](const CoTCommon::CoTObject& unit) {
+            std::string reply;
+            if (!ingest.send_xml(unit.to_xml()) || !ingest.read_reply(reply)) {
+                std::cerr << "Lost connection to injector daemon\n";
+                return false;
+            }
+            if (reply.compare(0, 3, "OK ") != 0) {
+                std::cerr << "Daemon rejected " << unit.get_callsign() << ": " << reply << std::endl;
+                return false;
+            }
+            std::cout << "Sent CoT object " << unit.get_uid() << " (" << unit.get_callsign() << ") via daemon\n";
+            return true;
+        };
+    } else {
+        // Connect to every target; one that is down is retried on later writes
+        size_t connected = 0;
+        for (size_t i = 0; i < hosts.size(); i++) {
+            int port = ports.empty() ? default_port : ports[ports.size() == 1 ? 0 : i];
+            targets.emplace_back(new TAKServerClient(hosts[i], port, cert_file, key_file, ca_file, passphrase,
+                                                     use_udp ? &udp_options : nullptr, use_proto));
+            if (targets.back()->connect()) {
+                connected++;
+            } else {
+                std::cerr << "Failed to connect to TAK server " << targets.back()->get_name() << std::endl;
+            }
+        }
+        if (connected == 0) {
+            return 1;
+        }
+        
+        if (daemon_mode) {
+            bool direct = schedule_policy == "fifo" && targets.size() == 1;
+            return run_daemon(targets, socket_path, direct ? nullptr : &schedule);
+        }
+        
+        if (targets.size() == 1) {
+            TAKServerClient& client = *targets[0];
+            send_unit = [&client](const CoTCommon::CoTObject& unit) {
+                return client.send_cot(unit);
+            };
+        } else {
+            // Render each event once; every target's queue shares the buffer
+            add_targets(fanout, targets, schedule);
+            fanout.start();
+            fanout_metrics = add_fanout_metrics(fanout);
+            send_unit = [&fanout](const CoTCommon::CoTObject& unit) {
+                auto payload = std::make_shared<const std::string>(unit.to_xml());
+                if (!fanout.submit(unit.get_uid(), unit.get_type(), payload)) {
+                    return false;
+                }
+                std::cout << "Queued CoT object " << unit.get_uid() << " (" << unit.get_callsign() << ") for "
+                          << fanout.target_count() << " targets\n";
+                return true;
+            };
+        }
     }
     
     try {
@@ -176,7 +612,7 @@ int main(int argc, char* argv[]) {
             std::cout << "=== Batch " << (i + 1) << " of " << count << " ===\n";
             
             for (auto& unit : units) {
-                if (!client.send_cot(unit)) {
+                if (!send_unit(unit)) {
                     std::cerr << "Failed to send unit " << unit.get_callsign() << std::endl;
                 }
                 
@@ -194,9 +630,18 @@ int main(int argc, char* argv[]) {
         
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
+        remove_metrics(fanout_metrics);
         return 1;
     }
     
+    remove_metrics(fanout_metrics);
+    if (fanout.target_count() > 0) {
+        fanout.stop();
+        std::cout << "\nPer-target delivery:\n";
+        print_target_stats(fanout, targets);
+    }
+    print_udp_stats(targets);
+    
     std::cout << "\nCoT injection completed successfully\n";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,192 @@
+#include "cot_intern.h"
+#include "cot_metrics.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace CoTCommon {
+
+// StringInterner implementation
+StringInterner::StringInterner(size_t max_entries)
+    : max_entries(std::min(max_entries, ENTRIES_PER_CHUNK * MAX_CHUNKS)), storage_used(0), storage_capacity(0),
+      slots(1024, EMPTY), count(0), overflow_count(0) {
+    for (auto& chunk : entry_chunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // Reserve ID 0 for the empty string
+    owned_chunks.emplace_back(new std::string_view[ENTRIES_PER_CHUNK]);
+    entry_chunks[0].store(owned_chunks.back().get(), std::memory_order_release);
+    owned_chunks.back()[0] = std::string_view();
+    count.store(1, std::memory_order_release);
+}
+
+StringInterner& StringInterner::global() {
+    static StringInterner instance;
+    [[maybe_unused]] static const uint64_t overflow_metric = MetricsRegistry::global().add_callback(
+        "cot_intern_overflows_total", "Vocabulary strings kept per event because the interner was full", "",
+        MetricsRegistry::Type::COUNTER, [] { return static_cast<double>(instance.overflows()); });
+    return instance;
+}
+
+uint64_t StringInterner::hash(std::string_view str) {
+    // FNV-1a, plenty for short vocabulary strings
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : str) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+StringInterner::Id StringInterner::lookup(std::string_view str, uint64_t h, size_t& slot) const {
+    size_t mask = slots.size() - 1;
+    slot = h & mask;
+    while (true) {
+        Id id = slots[slot];
+        if (id == EMPTY || view(id) == str) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+std::string_view StringInterner::store(std::string_view str) {
+    if (str.size() > storage_capacity - storage_used) {
+        storage_capacity = std::max(STORAGE_BLOCK_SIZE, str.size());
+        storage_blocks.emplace_back(new char[storage_capacity]);
+        storage_used = 0;
+    }
+
+    char* dest = storage_blocks.back().get() + storage_used;
+    memcpy(dest, str.data(), str.size());
+    storage_used += str.size();
+    return std::string_view(dest, str.size());
+}
+
+void StringInterner::grow_slots() {
+    std::vector<Id> grown(slots.size() * 2, EMPTY);
+    size_t mask = grown.size() - 1;
+    size_t n = count.load(std::memory_order_relaxed);
+
+    for (Id id = 1; id < n; id++) {
+        size_t slot = hash(view(id)) & mask;
+        while (grown[slot] != EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        grown[slot] = id;
+    }
+
+    slots.swap(grown);
+}
+
+StringInterner::Id StringInterner::find(std::string_view str) const {
+    if (str.empty()) return EMPTY;
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t slot;
+    return lookup(str, hash(str), slot);
+}
+
+StringInterner::Id StringInterner::intern(std::string_view str) {
+    if (str.empty()) return EMPTY;
+
+    uint64_t h = hash(str);
+    size_t slot;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        Id id = lookup(str, h, slot);
+        if (id != EMPTY) return id;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Id id = lookup(str, h, slot);  // Another thread may have won the race
+    if (id != EMPTY) return id;
+
+    size_t n = count.load(std::memory_order_relaxed);
+    if (n >= max_entries) {
+        overflow_count.fetch_add(1, std::memory_order_relaxed);
+        return EMPTY;
+    }
+
+    // Keep the load factor at or below one half
+    if ((n + 1) * 2 > slots.size()) {
+        grow_slots();
+        lookup(str, h, slot);
+    }
+
+    size_t chunk_index = n / ENTRIES_PER_CHUNK;
+    std::string_view* chunk = entry_chunks[chunk_index].load(std::memory_order_relaxed);
+    if (!chunk) {
+        owned_chunks.emplace_back(new std::string_view[ENTRIES_PER_CHUNK]);
+        chunk = owned_chunks.back().get();
+        entry_chunks[chunk_index].store(chunk, std::memory_order_release);
+    }
+
+    chunk[n % ENTRIES_PER_CHUNK] = store(str);
+    slots[slot] = static_cast<Id>(n);
+    count.store(n + 1, std::memory_order_release);
+    return static_cast<Id>(n);
+}
+
+StringInterner::Id StringInterner::intern_or_copy(std::string_view str, std::string_view& spill,
+                                                  BatchArena& arena) {
+    Id id = intern(str);
+    spill = id == EMPTY ? arena.copy(str) : std::string_view();
+    return id;
+}
+
+std::string_view StringInterner::view(Id id) const {
+    const std::string_view* chunk = entry_chunks[id / ENTRIES_PER_CHUNK].load(std::memory_order_acquire);
+    return chunk[id % ENTRIES_PER_CHUNK];
+}
+
+// BatchArena implementation
+BatchArena::BatchArena(size_t default_block_size)
+    : block_size(default_block_size), current(0), offset(0) {
+}
+
+void* BatchArena::allocate(size_t size, size_t align) {
+    while (current < blocks.size()) {
+        Block& block = blocks[current];
+        size_t aligned = (offset + align - 1) & ~(align - 1);
+        if (aligned + size <= block.size) {
+            offset = aligned + size;
+            return block.data.get() + aligned;
+        }
+
+        // Move on to the next retained block
+        current++;
+        offset = 0;
+    }
+
+    // Out of retained blocks, grow the arena
+    size_t new_size = std::max(block_size, size + align);
+    blocks.push_back(Block{std::unique_ptr<char[]>(new char[new_size]), new_size});
+    current = blocks.size() - 1;
+
+    char* base = blocks.back().data.get();
+    size_t misalign = reinterpret_cast<uintptr_t>(base) & (align - 1);
+    size_t aligned = misalign ? align - misalign : 0;
+    offset = aligned + size;
+    return base + aligned;
+}
+
+std::string_view BatchArena::copy(std::string_view str) {
+    if (str.empty()) return std::string_view();
+
+    char* dest = static_cast<char*>(allocate(str.size(), 1));
+    memcpy(dest, str.data(), str.size());
+    return std::string_view(dest, str.size());
+}
+
+size_t BatchArena::capacity() const {
+    size_t total = 0;
+    for (const auto& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+} // namespace CoTCommon
@@ -0,0 +1,130 @@
+#ifndef COT_INTERN_H
+#define COT_INTERN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CoTCommon {
+
+class BatchArena;
+
+// Maps the small, highly repetitive CoT vocabulary (type, how, team, callsign)
+// to stable 32-bit IDs. Interned strings are never freed, so the views handed
+// out stay valid for the lifetime of the table. Lookups of known strings only
+// take a shared lock and never allocate.
+//
+// The table is bounded. Once it is full, new strings are not added: intern()
+// returns EMPTY and counts an overflow, and intern_or_copy() hands the caller
+// a copy in its arena instead, so a long-running reader keeps going. Code
+// that compares or keeps IDs must therefore fall back to the string when an
+// ID is EMPTY (see InternedString).
+class StringInterner {
+public:
+    using Id = uint32_t;
+    static constexpr Id EMPTY = 0;  // ID 0 is always the empty string
+
+    explicit StringInterner(size_t max_entries = ENTRIES_PER_CHUNK * MAX_CHUNKS);
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    // Return the ID for a string, adding it to the table if needed; EMPTY
+    // for a new string once the table is full
+    Id intern(std::string_view str);
+
+    // intern(), or EMPTY with str copied into the arena as `spill` when the
+    // table is full (spill is cleared otherwise)
+    Id intern_or_copy(std::string_view str, std::string_view& spill, BatchArena& arena);
+
+    // Return the ID for a string, or EMPTY if it has not been interned
+    Id find(std::string_view str) const;
+
+    // Resolve an ID back to its string (lock-free)
+    std::string_view view(Id id) const;
+
+    size_t size() const { return count.load(std::memory_order_acquire); }
+    uint64_t overflows() const { return overflow_count.load(std::memory_order_relaxed); }
+
+    // Process-wide table shared by all parsers
+    static StringInterner& global();
+
+private:
+    static constexpr size_t ENTRIES_PER_CHUNK = 1024;
+    static constexpr size_t MAX_CHUNKS = 4096;
+    static constexpr size_t STORAGE_BLOCK_SIZE = 16 * 1024;
+
+    size_t max_entries;
+
+    mutable std::shared_mutex mutex;
+    std::atomic<std::string_view*> entry_chunks[MAX_CHUNKS];
+    std::vector<std::unique_ptr<std::string_view[]>> owned_chunks;
+    std::vector<std::unique_ptr<char[]>> storage_blocks;
+    size_t storage_used;
+    size_t storage_capacity;
+    std::vector<Id> slots;  // Open-addressing hash table of IDs
+    std::atomic<size_t> count;
+    std::atomic<uint64_t> overflow_count;
+
+    static uint64_t hash(std::string_view str);
+    Id lookup(std::string_view str, uint64_t h, size_t& slot) const;
+    std::string_view store(std::string_view str);
+    void grow_slots();
+};
+
+// A vocabulary string kept past its event: the interned ID, or an owned copy
+// of the spill when the full table returned EMPTY. Assigning a known string
+// does not allocate.
+struct InternedString {
+    StringInterner::Id id = StringInterner::EMPTY;
+    std::string spill;
+
+    void assign(StringInterner::Id new_id, std::string_view new_spill) {
+        id = new_id;
+        if (id == StringInterner::EMPTY) {
+            spill.assign(new_spill.data(), new_spill.size());
+        } else {
+            spill.clear();
+        }
+    }
+
+    std::string_view view() const { return id ? StringInterner::global().view(id) : std::string_view(spill); }
+};
+
+// Bump allocator for data that must outlive the receive buffer but only for
+// one read batch. reset() rewinds to the first block in O(1) and keeps every
+// block for reuse, so steady-state batches allocate nothing.
+class BatchArena {
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t block_size;
+    size_t current;
+    size_t offset;
+
+public:
+    explicit BatchArena(size_t default_block_size = 64 * 1024);
+    BatchArena(const BatchArena&) = delete;
+    BatchArena& operator=(const BatchArena&) = delete;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    // Copy a string into the arena and return a view of the copy
+    std::string_view copy(std::string_view str);
+
+    void reset() { current = 0; offset = 0; }
+
+    size_t capacity() const;
+};
+
+} // namespace CoTCommon
+
+#endif // COT_INTERN_H
@@ -0,0 +1,121 @@
+#include "cot_common.h"
+#include "cot_dedup.h"
+#include "cot_merge.h"
+#include "cot_query.h"
+#include <cstdio>
+#include <string>
+
+// Consumers of interned IDs when the table is full: a spilled string has ID
+// EMPTY and lives only in its *_spill view, so anything that compares or
+// keeps IDs must fall back to the string. Views are built by hand here, as
+// filling the process-wide table would take millions of strings. Prints every
+// check that fails and exits nonzero, so it can run under CTest.
+
+using namespace CoTCommon;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// An event whose callsign and team did not fit in the table
+CoTParser::CoTMessageView spilled(std::string_view uid, std::string_view callsign, std::string_view team) {
+    CoTParser::CoTMessageView msg;
+    msg.uid = uid;
+    msg.type = StringInterner::global().intern("a-f-G-U-C");
+    msg.callsign_spill = callsign;
+    msg.team_spill = team;
+    msg.time = "2026-01-01T00:00:00Z";
+    msg.latitude = 38.5;
+    msg.longitude = -77.25;
+    CompactPosition::from_degrees(msg.latitude, msg.longitude, 0.0, msg.position);
+    return msg;
+}
+
+void check_dedup() {
+    DedupStage::Options options;
+    DedupStage dedup(options);
+    check(dedup.check(spilled("u1", "Alpha", "Spilled Team A"), 0) == DedupStage::Decision::PASS, "first event passes");
+    check(dedup.check(spilled("u1", "Alpha", "Spilled Team A"), 10) == DedupStage::Decision::DUPLICATE,
+          "repeat of a spilled event is a duplicate");
+    check(dedup.check(spilled("u1", "Bravo", "Spilled Team A"), 20) == DedupStage::Decision::PASS,
+          "spilled callsign change passes");
+    check(dedup.check(spilled("u1", "Bravo", "Spilled Team B"), 30) == DedupStage::Decision::PASS,
+          "spilled team change passes");
+    check(dedup.stats().state_changes == 3, "spilled changes are counted as state changes");
+}
+
+void check_store() {
+    TrackStore store;
+    uint32_t holder;
+    check(store.update(spilled("u1", "Alpha", "Spilled Team A"), "<event/>", 1000, 0, holder) ==
+              TrackStore::Result::NEWER,
+          "store accepts a spilled event");
+    const TrackStore::Track* track = store.find("u1");
+    check(track && track->callsign.view() == "Alpha" && track->team.view() == "Spilled Team A" &&
+              track->type.view() == "a-f-G-U-C",
+          "store keeps spilled strings");
+
+    StringInterner::Id known = StringInterner::global().intern("Known Team");
+    CoTParser::CoTMessageView msg = spilled("u1", "", "");
+    msg.team = known;
+    store.update(msg, "<event/>", 2000, 0, holder);
+    check(track->team.id == known && track->team.view() == "Known Team", "interned string replaces a spill");
+}
+
+void check_query() {
+    QueryFilter filter;
+    std::string error;
+    size_t before = StringInterner::global().size();
+    check(QueryFilter::parse("team=Query-Only-Team", filter, error), "team filter parses");
+    check(StringInterner::global().size() == before, "team filter does not intern client input");
+
+    CoTParser::CoTMessageView same = spilled("u1", "", "Query-Only-Team");
+    CoTParser::CoTMessageView other = spilled("u2", "", "Other-Spilled-Team");
+    CoTParser::CoTMessageView none = spilled("u3", "", "");
+    check(filter.matches(same.type, same.type_str(), same.team, same.team_str(), same.position),
+          "spilled team matches by name");
+    check(!filter.matches(other.type, other.type_str(), other.team, other.team_str(), other.position),
+          "another spilled team does not match");
+    check(!filter.matches(none.type, none.type_str(), none.team, none.team_str(), none.position),
+          "no team does not match");
+
+    // A team interned after the filter was parsed still matches
+    CoTParser::CoTMessageView later = same;
+    later.team = StringInterner::global().intern("Query-Only-Team");
+    check(filter.matches(later.type, later.type_str(), later.team, later.team_str(), later.position),
+          "team interned later matches");
+
+    QueryFilter types;
+    check(QueryFilter::parse("type=a-h-*", types, error), "type filter parses");
+    CoTParser::CoTMessageView hostile = spilled("u4", "", "");
+    hostile.type = StringInterner::EMPTY;
+    hostile.type_spill = "a-h-G-spilled";
+    CoTParser::CoTMessageView friendly = hostile;
+    friendly.type_spill = "a-f-G-spilled";
+    check(types.matches(hostile.type, hostile.type_str(), hostile.team, hostile.team_str(), hostile.position) &&
+              !types.matches(friendly.type, friendly.type_str(), friendly.team, friendly.team_str(),
+                             friendly.position),
+          "spilled types are matched by name, not by the EMPTY cache entry");
+}
+
+} // namespace
+
+int main() {
+    check_dedup();
+    check_store();
+    check_query();
+
+    if (failures > 0) {
+        printf("%d interner check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All interner checks passed\n");
+    return 0;
+}
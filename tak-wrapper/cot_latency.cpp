@@ -0,0 +1,124 @@
+#include "cot_latency.h"
+#include "cot_common.h"
+
+#include <alloca.h>
+#include <cerrno>
+#include <charconv>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr size_t PAGE_SIZE = 4096;
+
+bool parse_cpu(std::string_view text, int& cpu) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), cpu);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size() && cpu >= 0 && cpu < CPU_SETSIZE;
+}
+
+// Touch the stack below the caller; kept out of line so it is not elided
+__attribute__((noinline)) void touch_stack(size_t bytes) {
+    volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+    for (size_t i = 0; i < bytes; i += PAGE_SIZE) {
+        stack[i] = 0;
+    }
+}
+
+} // namespace
+
+bool parse_cpu_list(std::string_view text, std::vector<int>& cpus) {
+    cpus.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        std::string_view item = text.substr(start, comma - start);
+        size_t dash = item.find('-');
+        int first, last;
+        if (dash == std::string_view::npos) {
+            if (!parse_cpu(item, first)) return false;
+            last = first;
+        } else if (!parse_cpu(item.substr(0, dash), first) || !parse_cpu(item.substr(dash + 1), last) ||
+                   last < first) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+        if (comma == std::string_view::npos) break;
+        start = comma + 1;
+    }
+    return !cpus.empty();
+}
+
+bool pin_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        std::cerr << "Cannot pin thread to CPU " << cpu << ": " << strerror(result) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool lock_memory(size_t stack_bytes) {
+    touch_stack(stack_bytes);
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::cerr << "Cannot lock memory (mlockall: " << strerror(errno)
+                  << "); raise RLIMIT_MEMLOCK (ulimit -l) or run with CAP_IPC_LOCK" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void prefault(void* data, size_t size) {
+    volatile char* bytes = static_cast<volatile char*>(data);
+    for (size_t i = 0; i < size; i += PAGE_SIZE) {
+        bytes[i] = bytes[i];
+    }
+}
+
+uint64_t page_faults() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_minflt) + static_cast<uint64_t>(usage.ru_majflt);
+}
+
+// SpinReader implementation
+SpinReader::SpinReader(CoTTransport& transport, int spin_us)
+    : connection(transport), spin(std::chrono::microseconds(spin_us)), counters{} {}
+
+int SpinReader::read(char* buffer, size_t buffer_size, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + spin;
+    bool spinning = spin.count() > 0;
+
+    while (true) {
+        int received = connection.receive_data(buffer, buffer_size);
+        if (received > 0) {
+            counters.reads++;
+            if (spinning) counters.spin_hits++;
+            return received;
+        }
+        if (!connection.would_block(received)) return -1;
+
+        if (spinning && std::chrono::steady_clock::now() < deadline) {
+            continue;
+        }
+
+        // Budget spent: sleep until the socket is readable
+        counters.blocks++;
+        struct pollfd fd = {connection.get_socket_fd(), POLLIN, 0};
+        int ready = poll(&fd, 1, timeout_ms);
+        if (ready < 0 && errno != EINTR) return -1;
+        if (ready == 0) return 0;
+        spinning = false;
+    }
+}
+
+} // namespace CoTCommon
@@ -0,0 +1,68 @@
+#ifndef COT_LATENCY_H
+#define COT_LATENCY_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace CoTCommon {
+
+class CoTTransport;
+
+// Opt-in tuning for a latency-sensitive receive path. Instead of sleeping
+// in poll() between events, a reader spins on non-blocking reads for a
+// short budget, and the threads involved stay on their own cores with all
+// memory resident. This trades CPU for latency: each spinning thread keeps
+// a core busy, so it only pays off with a core to spare per thread.
+struct LowLatencyOptions {
+    bool enabled = false;
+    std::vector<int> cpus;         // I/O thread, then each worker; empty = no pinning
+    int spin_us = 200;             // Spin this long on empty reads before blocking in poll()
+    int busy_poll_us = 50;         // SO_BUSY_POLL on the feed sockets (NIC queues only)
+    bool lock_memory = true;       // mlockall() and pre-fault the I/O thread's stack
+};
+
+// "2,3,6-8" -> {2, 3, 6, 7, 8}
+bool parse_cpu_list(std::string_view text, std::vector<int>& cpus);
+
+// Pin the calling thread to one core
+bool pin_thread(int cpu);
+
+// Lock current and future mappings into RAM and touch stack_bytes of the
+// calling thread's stack, so the steady state takes no page faults
+bool lock_memory(size_t stack_bytes = 256 * 1024);
+
+// Write every page of a buffer so it is backed before it is needed
+void prefault(void* data, size_t size);
+
+// Minor and major page faults of this process so far
+uint64_t page_faults();
+
+// Spin-then-block reads on one transport, which must be non-blocking
+class SpinReader {
+public:
+    struct Stats {
+        uint64_t reads;            // Reads that returned data
+        uint64_t spin_hits;        // Of those, found while spinning
+        uint64_t blocks;           // Spin budgets that ran out, followed by poll()
+    };
+
+    SpinReader(CoTTransport& transport, int spin_us);
+
+    // Same result as receive_data(): bytes, or <= 0 once the connection is
+    // gone. Waits at most timeout_ms in poll() (then returns 0).
+    int read(char* buffer, size_t buffer_size, int timeout_ms = 1000);
+
+    const Stats& stats() const { return counters; }
+
+private:
+    CoTTransport& connection;
+    std::chrono::steady_clock::duration spin;
+    Stats counters;
+};
+
+} // namespace CoTCommon
+
+#endif // COT_LATENCY_H
@@ -1,147 +1,893 @@
 #include "cot_common.h"
+#include "cot_dedup.h"
+#include "cot_latency.h"
+#include "cot_merge.h"
+#include "cot_pipeline.h"
+#include "cot_history.h"
+#include "cot_query.h"
+#include "cot_snapshot.h"
+#include "cot_table.h"
+#include "cot_takproto.h"
+#include "cot_udp.h"
+#include <fstream>
+#include <poll.h>
 #include <signal.h>
 
 
+struct ListenerOptions {
+    bool compact_mode = false;
+    std::string filter_type;
+    std::vector<std::pair<std::string, std::string>> matches;  // Path, required substring
+    std::vector<std::string> fields;                           // Extra paths to display
+    size_t workers = 0;  // 0 = parse on the I/O thread
+    CoTCommon::ParsePipeline::Ordering ordering = CoTCommon::ParsePipeline::Ordering::ARRIVAL;
+    bool show_stats = false;
+    bool downsample = false;  // Run events through a DedupStage
+    CoTCommon::DedupStage::Options dedup;
+    std::string snapshot_path;      // Warm-start snapshot of the track picture
+    double snapshot_interval_s = 10.0;
+    bool table = false;             // Live track table instead of one line per event
+    CoTCommon::TrackTable::Options table_options;
+    CoTCommon::LowLatencyOptions low_latency;
+};
+
 class TAKServerListener {
 private:
-    CoTCommon::TAKServerConnection connection;
+    // One connection (or replay file) per feed, each with its own framer
+    std::vector<std::unique_ptr<CoTCommon::CoTTransport>> connections;
+    std::vector<CoTCommon::UdpTransport*> udp_feeds;  // Per feed, nullptr for TLS
+    std::vector<std::string> feed_names;
+    std::vector<CoTCommon::CoTFramer> framers;
+    std::vector<bool> feed_ready;
+    size_t next_feed;
+    
+    // Feeds that negotiated TAK Protocol, with what arrived during negotiation
+    bool use_proto;
+    std::vector<bool> feed_proto;
+    std::vector<std::string> negotiated;
+    std::vector<CoTCommon::TakFramer> tak_framers;
+    std::string tak_xml;
+    
+    std::string cert_file;
+    std::string key_file;
+    std::string ca_file;
+    std::string passphrase;
+    bool use_udp;
+    CoTCommon::UdpTransport::Options udp_options;
+    
     CoTCommon::CoTParser parser;
+    CoTCommon::BatchArena arena;
+    ListenerOptions options;
+    std::unique_ptr<CoTCommon::DedupStage> dedup;
+    std::unique_ptr<CoTCommon::FeedMerger> merger;
+    std::unique_ptr<CoTCommon::TrackSnapshotter> snapshotter;
+    std::unique_ptr<CoTCommon::TrackTable> table;
+    CoTCommon::QueryServer* query;  // Local query API, owned by main()
+    CoTCommon::TrackHistory* history;  // Per-track trails, owned by main()
+    bool expire_tracks;  // Live feeds only; replayed events are historical
+    
+    // Low-latency mode: spin on empty reads before blocking (see cot_latency.h)
+    std::unique_ptr<CoTCommon::SpinReader> spin_reader;
+    std::chrono::steady_clock::time_point spin_deadline;
+    bool spinning;
+    uint64_t faults_at_start;
     bool verbose;
     
+    // Runtime metrics (cot_metrics.h); the read-out callbacks are replaced
+    // whenever the listener is reconfigured
+    CoTCommon::MetricsRegistry::Counter bytes_metric;
+    CoTCommon::MetricsRegistry::Counter xml_events_metric;
+    CoTCommon::MetricsRegistry::Counter tak_events_metric;
+    CoTCommon::MetricsRegistry::Counter output_metric;
+    CoTCommon::MetricsRegistry::Counter merged_metric;
+    CoTCommon::MetricsRegistry::Counter filtered_metric;
+    CoTCommon::MetricsRegistry::Counter downsampled_metric;
+    std::vector<uint64_t> metric_callbacks;
+    
+    // Merge, filter and format one event. Also runs on pipeline worker
+    // threads, so it must only read listener state (the merger and dedup
+    // stage are thread-safe).
+    void handle_event(const CoTCommon::CoTParser::CoTMessageView& msg, std::string_view raw_xml,
+                      uint32_t feed, std::string& out) const {
+        COT_TRACE_SCOPE("handle_event");
+        
+        // Only the first arrival of a track's newest version, across all feeds
+        if (merger && !merger->accept(msg, raw_xml, feed)) {
+            merged_metric.add();
+            return;
+        }
+        
+        // Query clients get the whole picture, not what is displayed
+        if (query) {
+            query->publish(msg, raw_xml);
+        }
+        int64_t time_ms;
+        if (history && CoTCommon::parse_cot_time(msg.time, time_ms)) {
+            history->update(msg.uid, time_ms, msg.position);
+        }
+        
+        // Apply filter if specified
+        if (!options.filter_type.empty() &&
+            msg.type_str().find(options.filter_type) == std::string_view::npos) {
+            filtered_metric.add();
+            return;
+        }
+        
+        // Arbitrary detail filters are resolved lazily from the parse tape
+        for (const auto& match : options.matches) {
+            if (msg.field(match.first).find(match.second) == std::string_view::npos) {
+                filtered_metric.add();
+                return;
+            }
+        }
+        
+        if (dedup) {
+            int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            if (dedup->check(msg, now_ms) != CoTCommon::DedupStage::Decision::PASS) {
+                downsampled_metric.add();
+                return;
+            }
+        }
+        output_metric.add();
+        
+        // The table is drawn at its own frame rate; nothing to format here
+        if (table) {
+            table->update(msg);
+            return;
+        }
+        
+        COT_TRACE_SCOPE("format");
+        if (options.compact_mode) {
+            msg.format_compact(out);
+            if (!options.fields.empty()) {
+                out.pop_back();  // Extend the line before its newline
+                for (const auto& path : options.fields) {
+                    out.append(" | ").append(path).append("=").append(msg.field(path));
+                }
+                out += '\n';
+            }
+        } else {
+            msg.format(out);
+            for (const auto& path : options.fields) {
+                out.append(path).append(": ").append(msg.field(path)) += '\n';
+            }
+        }
+        
+        if (verbose) {
+            out.append("\nRaw XML:\n").append(raw_xml).append("\n\n");
+        }
+    }
+    
+    // Parse and display one XML event, or hand it to the worker pipeline
+    void process_xml(std::string_view xml, uint32_t feed, CoTCommon::ParsePipeline* pipeline,
+                     std::string& output) {
+        if (pipeline) {
+            pipeline->submit(xml, feed);
+            return;
+        }
+        
+        try {
+            CoTCommon::CoTParser::CoTMessageView msg;
+            if (!parser.parse_view(xml, msg, arena)) {
+                throw std::invalid_argument("malformed CoT message");
+            }
+            handle_event(msg, xml, feed, output);
+        } catch (const std::exception& e) {
+            if (verbose) {
+                std::cerr << "Error parsing CoT message: " << e.what() << std::endl;
+                std::cerr << "Raw message: " << xml << std::endl;
+            }
+        }
+    }
+    
+    // TAK Protocol events are decoded straight into the view unless
+    // something needs the XML document: raw output, detail paths, the merged
+    // track store, the query API or the worker pipeline
+    void process_tak(std::string_view payload, uint32_t feed, CoTCommon::ParsePipeline* pipeline,
+                     std::string& output) {
+        bool needs_xml = verbose || merger || query || pipeline || !options.matches.empty() || !options.fields.empty();
+        if (needs_xml) {
+            tak_xml.clear();
+            if (CoTCommon::tak_to_xml(payload, tak_xml)) {
+                process_xml(tak_xml, feed, pipeline, output);
+                return;
+            }
+        } else {
+            CoTCommon::CoTParser::CoTMessageView msg;
+            if (CoTCommon::decode_tak_message(payload, msg, arena)) {
+                handle_event(msg, std::string_view(), feed, output);
+                return;
+            }
+        }
+        if (verbose) {
+            std::cerr << "Error decoding TAK Protocol message (" << payload.size() << " bytes)" << std::endl;
+        }
+    }
+    
+    // Returns bytes read, 0 to retry or -1 when the connection is gone
+    int read_connection(char* buffer, size_t buffer_size) {
+        CoTCommon::CoTTransport& connection = *connections[0];
+        int bytes_received = connection.receive_data(buffer, buffer_size);
+        
+        if (bytes_received <= 0) {
+            if (connection.would_block(bytes_received)) {
+                // Non-blocking operation, try again
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                return 0;
+            }
+            
+            std::cerr << "\nConnection lost or error reading from server\n";
+            if (verbose) {
+                ERR_print_errors_fp(stderr);
+            }
+            return -1;
+        }
+        
+        return bytes_received;
+    }
+    
+    // Mark every live feed for a read; a lost feed stays out of the loop
+    void arm_feeds() {
+        for (size_t i = 0; i < feed_ready.size() && i < connections.size(); i++) {
+            feed_ready[i] = connections[i]->is_connected();
+        }
+    }
+    
+    // Event loop over several non-blocking connections: drain ready feeds
+    // round-robin, poll when all are drained. Returns bytes read into buffer
+    // (from feed), 0 to retry or -1 once every connection is gone.
+    int read_feeds(char* buffer, size_t buffer_size, uint32_t& feed) {
+        for (size_t n = 0; n < connections.size(); n++) {
+            size_t i = (next_feed + n) % connections.size();
+            if (!feed_ready[i]) continue;
+            
+            int bytes_received = connections[i]->receive_data(buffer, buffer_size);
+            if (bytes_received > 0) {
+                spinning = false;
+                feed = static_cast<uint32_t>(i);
+                next_feed = (i + 1) % connections.size();
+                return bytes_received;
+            }
+            
+            feed_ready[i] = false;
+            if (!connections[i]->would_block(bytes_received)) {
+                std::cerr << "\nConnection lost to " << feed_names[i] << std::endl;
+                connections[i]->disconnect();
+            }
+        }
+        
+        // Low latency: keep retrying every feed until the spin budget runs out
+        if (options.low_latency.enabled && options.low_latency.spin_us > 0) {
+            auto now = std::chrono::steady_clock::now();
+            if (!spinning) {
+                spinning = true;
+                spin_deadline = now + std::chrono::microseconds(options.low_latency.spin_us);
+            }
+            if (now < spin_deadline) {
+                arm_feeds();
+                return 0;
+            }
+            spinning = false;
+        }
+        
+        std::vector<struct pollfd> fds;
+        std::vector<size_t> polled;
+        for (size_t i = 0; i < connections.size(); i++) {
+            if (connections[i]->is_connected()) {
+                fds.push_back({connections[i]->get_socket_fd(), POLLIN, 0});
+                polled.push_back(i);
+            }
+        }
+        if (fds.empty()) {
+            std::cerr << "\nAll feeds lost\n";
+            return -1;
+        }
+        
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            return -1;
+        }
+        for (size_t j = 0; j < fds.size(); j++) {
+            if (fds[j].revents) feed_ready[polled[j]] = true;
+        }
+        return 0;
+    }
+    
+    void print_header() {
+        if (table) {
+            std::cout.flush();
+            table->start();
+            return;
+        }
+        std::cout << "\n=== TAK Server CoT Listener Active ===\n";
+        if (options.compact_mode) {
+            std::cout << "Time     | Callsign     | Type       | Position (Lat,Lon)      | MGRS            | Team\n";
+            std::cout << "---------|--------------|------------|-------------------------|-----------------|----------\n";
+        }
+        std::cout.flush();
+    }
+    
+    void print_stats(uint64_t events, const CoTCommon::ParsePipeline* pipeline) const {
+        std::cerr << "[stats] events=" << events;
+        if (pipeline) {
+            CoTCommon::ParsePipeline::Stats s = pipeline->stats();
+            std::cerr << " parsed=" << s.events << " batches=" << s.batches
+                      << " queued=" << s.input_queue_depth << " reorder=" << s.reorder_pending
+                      << " free=" << s.free_batches << " errors=" << s.parse_errors;
+        }
+        if (dedup) {
+            CoTCommon::DedupStage::Stats d = dedup->stats();
+            std::cerr << " passed=" << d.passed << " state_changes=" << d.state_changes
+                      << " duplicates=" << d.duplicates << " rate_limited=" << d.rate_limited
+                      << " below_threshold=" << d.below_threshold << " evictions=" << d.evictions;
+        }
+        std::cerr << std::endl;
+        
+        if (merger) {
+            std::cerr << "[merge] tracks=" << merger->track_count() << std::endl;
+            for (const auto& f : merger->stats()) {
+                std::cerr << "[feed] " << f.name << " events=" << f.events << " rate=" << std::fixed
+                          << std::setprecision(1) << f.rate << "/s accepted=" << f.accepted
+                          << " duplicates=" << f.duplicates << " stale=" << f.stale
+                          << " untimed=" << f.untimed << " overlap=";
+                for (size_t j = 0; j < f.overlap.size(); j++) {
+                    std::cerr << (j ? "," : "") << f.overlap[j];
+                }
+                std::cerr << std::endl;
+            }
+        }
+        
+        if (options.low_latency.enabled) {
+            std::cerr << "[latency] page_faults=" << CoTCommon::page_faults() - faults_at_start;
+            if (spin_reader) {
+                const CoTCommon::SpinReader::Stats& r = spin_reader->stats();
+                std::cerr << " reads=" << r.reads << " spin_hits=" << r.spin_hits << " blocks=" << r.blocks;
+            }
+            std::cerr << std::endl;
+        }
+        
+        if (table) {
+            CoTCommon::TrackTable::Stats t = table->stats();
+            std::cerr << "[table] tracks=" << t.tracks << " events=" << t.events << " frames=" << t.frames
+                      << " rows_drawn=" << t.rows_drawn << " bytes=" << t.bytes << " frame_ms=" << std::fixed
+                      << std::setprecision(3) << t.frame_ms << std::endl;
+        }
+        
+        if (query) {
+            CoTCommon::QueryServer::Stats q = query->stats();
+            std::cerr << "[query] clients=" << q.clients << " subscribers=" << q.subscribers << " tracks=" << q.tracks
+                      << " published=" << q.published << " delivered=" << q.delivered << " resyncs=" << q.resyncs
+                      << " dropped=" << q.dropped << std::endl;
+        }
+        
+        if (history) {
+            CoTCommon::TrackHistory::Stats h = history->stats();
+            std::cerr << "[history] tracks=" << h.tracks << " points=" << h.points << " updates=" << h.updates
+                      << " kept=" << h.kept << " out_of_order=" << h.out_of_order << " evictions=" << h.evictions
+                      << std::endl;
+        }
+        
+        if (snapshotter) {
+            CoTCommon::TrackSnapshotter::Stats s = snapshotter->stats();
+            std::cerr << "[snapshot] written=" << s.snapshots << " failures=" << s.failures
+                      << " tracks=" << s.tracks << " bytes=" << s.bytes << " changed=" << s.changed
+                      << " lock_ms=" << std::fixed << std::setprecision(3) << s.lock_ms
+                      << " write_ms=" << s.write_ms << std::endl;
+        }
+        
+        for (size_t i = 0; i < udp_feeds.size(); i++) {
+            if (!udp_feeds[i] || !udp_feeds[i]->is_connected()) continue;
+            CoTCommon::UdpTransport::Stats u = udp_feeds[i]->stats();
+            std::cerr << "[udp] " << feed_names[i] << " datagrams=" << u.datagrams << " recvmmsg=" << u.syscalls
+                      << " truncated=" << u.truncated << " stamped=" << u.stamped << " senders=" << u.sources
+                      << " lost=" << u.lost << " reordered=" << u.reordered << " duplicates=" << u.duplicates
+                      << " latency_ms=" << std::fixed << std::setprecision(2) << u.mean_latency_ms
+                      << "/" << u.max_latency_ms << std::endl;
+        }
+        
+        for (size_t i = 0; i < tak_framers.size(); i++) {
+            if (!feed_proto[i]) continue;
+            std::cerr << "[takp] " << feed_names[i] << " pending=" << tak_framers[i].pending()
+                      << " skipped_bytes=" << tak_framers[i].skipped_bytes() << std::endl;
+        }
+    }
+    
+    void clear_metric_callbacks() {
+        for (uint64_t id : metric_callbacks) {
+            CoTCommon::MetricsRegistry::global().remove_callback(id);
+        }
+        metric_callbacks.clear();
+    }
+    
+    // Gauges and counters kept by other components, read at export time
+    void register_metric_callbacks() {
+        using Type = CoTCommon::MetricsRegistry::Type;
+        CoTCommon::MetricsRegistry& metrics = CoTCommon::MetricsRegistry::global();
+        clear_metric_callbacks();
+        if (merger) {
+            CoTCommon::FeedMerger* m = merger.get();
+            metric_callbacks.push_back(metrics.add_callback(
+                "cot_listener_tracks", "Tracks in the merged picture", "", Type::GAUGE,
+                [m] { return static_cast<double>(m->track_count()); }));
+        }
+        for (size_t i = 0; i < udp_feeds.size(); i++) {
+            if (!udp_feeds[i]) continue;
+            CoTCommon::UdpTransport* udp = udp_feeds[i];
+            std::string labels = "feed=\"" + feed_names[i] + "\"";
+            metric_callbacks.push_back(metrics.add_callback(
+                "cot_udp_received_datagrams_total", "Datagrams received", labels, Type::COUNTER,
+                [udp] { return static_cast<double>(udp->stats().datagrams); }));
+            metric_callbacks.push_back(metrics.add_callback(
+                "cot_udp_lost_datagrams_total", "Stamped datagrams missing from the sequence", labels,
+                Type::COUNTER, [udp] { return static_cast<double>(udp->stats().lost); }));
+        }
+    }
+    
+    void configure(const ListenerOptions& opts) {
+        options = opts;
+        dedup.reset(options.downsample ? new CoTCommon::DedupStage(options.dedup) : nullptr);
+        framers.assign(feed_names.size(), CoTCommon::CoTFramer());
+        tak_framers.assign(feed_names.size(), CoTCommon::TakFramer());
+        feed_proto.resize(feed_names.size(), false);
+        feed_ready.assign(feed_names.size(), false);
+        arm_feeds();
+        next_feed = 0;
+        if (options.table) {
+            options.table_options.expire = expire_tracks;
+            table.reset(new CoTCommon::TrackTable(options.table_options));
+        } else {
+            table.reset();
+        }
+        
+        // Merging only matters once there is more than one feed, or a
+        // snapshot to seed the picture from (as one more feed)
+        if (!options.snapshot_path.empty()) {
+            std::vector<std::string> names = feed_names;
+            names.push_back("snapshot");
+            merger.reset(new CoTCommon::FeedMerger(names));
+        } else {
+            merger.reset(feed_names.size() > 1 ? new CoTCommon::FeedMerger(feed_names) : nullptr);
+        }
+        register_metric_callbacks();
+    }
+    
+    // Everything the receive path touches is allocated and faulted in once:
+    // buffers reserved and written, then the process locked into memory.
+    // The I/O thread moves to the first configured core.
+    void prepare_low_latency(char* buffer, size_t buffer_size, std::string& output) {
+        const CoTCommon::LowLatencyOptions& low_latency = options.low_latency;
+        if (!low_latency.cpus.empty()) {
+            CoTCommon::pin_thread(low_latency.cpus[0]);
+        }
+        for (auto& framer : framers) {
+            framer.reserve(4 * buffer_size);
+        }
+        for (auto& framer : tak_framers) {
+            framer.reserve(4 * buffer_size);
+        }
+        output.reserve(4 * buffer_size);
+        tak_xml.reserve(buffer_size);
+        arena.allocate(buffer_size);  // First block, kept by reset()
+        arena.reset();
+        CoTCommon::prefault(buffer, buffer_size);
+        
+        if (low_latency.lock_memory) {
+            CoTCommon::lock_memory();
+        }
+        faults_at_start = CoTCommon::page_faults();
+    }
+    
+    // Show and re-seed the tracks of the last snapshot that are not stale yet
+    void warm_start() {
+        auto start = std::chrono::steady_clock::now();
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        uint32_t feed = static_cast<uint32_t>(feed_names.size());
+        std::string output;
+        CoTCommon::SnapshotInfo info;
+        bool loaded = CoTCommon::load_track_snapshot(options.snapshot_path, now_ms,
+            [this, feed, &output](const CoTCommon::SnapshotTrack& track) {
+                process_xml(track.xml, feed, nullptr, output);
+            }, info);
+        std::cout.write(output.data(), output.size());
+        std::cout.flush();
+        arena.reset();
+        
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (loaded) {
+            std::cerr << "Warm start: " << info.loaded << " tracks from " << options.snapshot_path << " ("
+                      << (now_ms - info.written_ms) / 1000 << "s old, " << info.dropped << " stale) in "
+                      << std::fixed << std::setprecision(1) << ms << " ms" << std::endl;
+        } else if (info.bytes == 0) {
+            std::cerr << "No snapshot at " << options.snapshot_path << "; starting empty" << std::endl;
+        }
+    }
+    
+    // Frame, parse and display everything read_chunk() produces. Returns the
+    // number of framed events.
+    template <typename ReadFn>
+    uint64_t process_stream(ReadFn read_chunk) {
+        std::unique_ptr<CoTCommon::ParsePipeline> pipeline;
+        if (options.workers > 0) {
+            CoTCommon::ParsePipeline::Options pipeline_options;
+            pipeline_options.workers = options.workers;
+            pipeline_options.ordering = options.ordering;
+            if (options.low_latency.enabled && options.low_latency.cpus.size() > 1) {
+                pipeline_options.cpus.assign(options.low_latency.cpus.begin() + 1, options.low_latency.cpus.end());
+            }
+            pipeline.reset(new CoTCommon::ParsePipeline(
+                pipeline_options,
+                [this](const CoTCommon::CoTParser::CoTMessageView& msg, std::string_view raw_xml,
+                       uint32_t feed, std::string& out) {
+                    handle_event(msg, raw_xml, feed, out);
+                },
+                [](const std::string& out) {
+                    std::cout.write(out.data(), out.size());
+                    std::cout.flush();
+                }));
+            pipeline->start();
+        }
+        
+        std::vector<uint64_t> pipeline_callbacks;
+        if (pipeline) {
+            using Type = CoTCommon::MetricsRegistry::Type;
+            CoTCommon::MetricsRegistry& metrics = CoTCommon::MetricsRegistry::global();
+            CoTCommon::ParsePipeline* p = pipeline.get();
+            pipeline_callbacks.push_back(metrics.add_callback(
+                "cot_pipeline_queued_batches", "Batches waiting for a parse worker", "", Type::GAUGE,
+                [p] { return static_cast<double>(p->stats().input_queue_depth); }));
+            pipeline_callbacks.push_back(metrics.add_callback(
+                "cot_pipeline_reorder_batches", "Parsed batches waiting for their turn in arrival order", "",
+                Type::GAUGE, [p] { return static_cast<double>(p->stats().reorder_pending); }));
+            pipeline_callbacks.push_back(metrics.add_callback(
+                "cot_pipeline_free_batches", "Pooled batches available to the I/O thread", "", Type::GAUGE,
+                [p] { return static_cast<double>(p->stats().free_batches); }));
+        }
+        
+        static char buffer[65536];
+        std::string output;
+        uint64_t events = 0;
+        if (options.low_latency.enabled) {
+            prepare_low_latency(buffer, sizeof(buffer), output);
+        }
+        auto last_report = std::chrono::steady_clock::now();
+        auto last_expire = last_report;
+        
+        while (true) {
+            uint32_t feed = 0;
+            int bytes_received;
+            {
+                COT_TRACE_SCOPE("read");
+                bytes_received = read_chunk(buffer, sizeof(buffer), feed);
+            }
+            if (bytes_received < 0) break;
+            if (bytes_received == 0) continue;
+            bytes_metric.add(bytes_received);
+            COT_TRACE_SCOPE("batch");
+            
+            uint64_t batch_start = events;
+            if (feed_proto[feed]) {
+                CoTCommon::TakFramer& framer = tak_framers[feed];
+                framer.append(buffer, bytes_received);
+                
+                std::string_view payload;
+                while (framer.next(payload)) {
+                    events++;
+                    process_tak(payload, feed, pipeline.get(), output);
+                }
+                tak_events_metric.add(events - batch_start);
+            } else {
+                CoTCommon::CoTFramer& framer = framers[feed];
+                framer.append(buffer, bytes_received);
+                
+                // Process complete XML messages
+                std::string_view complete_message;
+                while (framer.next(complete_message)) {
+                    events++;
+                    process_xml(complete_message, feed, pipeline.get(), output);
+                }
+                xml_events_metric.add(events - batch_start);
+            }
+            
+            // Everything from this read batch has been handed off or printed
+            if (pipeline) {
+                pipeline->flush();
+            } else {
+                if (!output.empty()) {
+                    COT_TRACE_SCOPE("print");
+                    std::cout.write(output.data(), output.size());
+                    std::cout.flush();
+                    output.clear();
+                }
+                arena.reset();
+            }
+            if (feed_proto[feed]) {
+                tak_framers[feed].compact();
+            } else {
+                framers[feed].compact();
+            }
+            
+            if (merger && expire_tracks && std::chrono::steady_clock::now() - last_expire >= std::chrono::seconds(1)) {
+                merger->expire(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count());
+                last_expire = std::chrono::steady_clock::now();
+            }
+            
+            if (options.show_stats && std::chrono::steady_clock::now() - last_report >= std::chrono::seconds(1)) {
+                print_stats(events, pipeline.get());
+                last_report = std::chrono::steady_clock::now();
+            }
+        }
+        
+        if (pipeline) {
+            pipeline->stop();
+        }
+        if (table) {
+            table->stop();
+        }
+        for (uint64_t id : pipeline_callbacks) {
+            CoTCommon::MetricsRegistry::global().remove_callback(id);
+        }
+        if (options.show_stats) {
+            print_stats(events, pipeline.get());
+        }
+        return events;
+    }
 
 public:
     TAKServerListener(const std::string& hostname, int tcp_port, 
                      const std::string& cert_path = "", const std::string& key_path = "",
                      const std::string& ca_path = "", const std::string& pass = "",
-                     bool verb = false) 
-        : connection(hostname, tcp_port, cert_path, key_path, ca_path, pass, verb), verbose(verb) {
+                     bool verb = false, const CoTCommon::UdpTransport::Options* udp = nullptr) 
+        : next_feed(0), use_proto(false), cert_file(cert_path), key_file(key_path), ca_file(ca_path), passphrase(pass),
+          use_udp(udp != nullptr), query(nullptr), history(nullptr), expire_tracks(false), spinning(false), faults_at_start(0),
+          verbose(verb) {
+        if (udp) {
+            udp_options = *udp;
+        }
+        add_server(hostname, tcp_port);
+        
+        CoTCommon::MetricsRegistry& metrics = CoTCommon::MetricsRegistry::global();
+        bytes_metric = metrics.counter("cot_listener_received_bytes_total", "Bytes read from all feeds");
+        xml_events_metric = metrics.counter("cot_listener_events_total", "Events framed from all feeds",
+                                            "protocol=\"xml\"");
+        tak_events_metric = metrics.counter("cot_listener_events_total", "Events framed from all feeds",
+                                            "protocol=\"takp\"");
+        output_metric = metrics.counter("cot_listener_output_events_total", "Events displayed");
+        const char* dropped_help = "Parsed events not displayed";
+        merged_metric = metrics.counter("cot_listener_dropped_events_total", dropped_help, "reason=\"merge\"");
+        filtered_metric = metrics.counter("cot_listener_dropped_events_total", dropped_help, "reason=\"filter\"");
+        downsampled_metric = metrics.counter("cot_listener_dropped_events_total", dropped_help, "reason=\"dedup\"");
     }
     
     ~TAKServerListener() {
         disconnect();
+        clear_metric_callbacks();
+    }
+    
+    // Subscribe to another server with the same credentials; events from all
+    // servers are merged into one picture
+    void add_server(const std::string& hostname, int tcp_port) {
+        if (use_udp) {
+            CoTCommon::UdpTransport* udp = new CoTCommon::UdpTransport(
+                hostname, tcp_port, CoTCommon::UdpTransport::Mode::RECEIVE, udp_options, verbose);
+            connections.emplace_back(udp);
+            udp_feeds.push_back(udp);
+            feed_names.push_back("udp://" + hostname + ":" + std::to_string(tcp_port));
+        } else {
+            connections.emplace_back(new CoTCommon::TAKServerConnection(
+                hostname, tcp_port, cert_file, key_file, ca_file, passphrase, verbose));
+            udp_feeds.push_back(nullptr);
+            feed_names.push_back(hostname + ":" + std::to_string(tcp_port));
+        }
+        feed_proto.push_back(false);
+        negotiated.emplace_back();
+    }
+    
+    // Publish every new track version to a local query server
+    void set_query_server(CoTCommon::QueryServer* server) {
+        query = server;
     }
     
+    // Record every track's recent path, before filters like the query API
+    void set_history(CoTCommon::TrackHistory* trails) {
+        history = trails;
+    }
+    
+    // Ask every TLS server to switch to TAK Protocol after connecting
+    void enable_tak_protocol() {
+        use_proto = true;
+    }
+    
+    // Succeeds if at least one server is reachable
     bool connect() {
-        return connection.connect();
+        size_t connected = 0;
+        for (size_t i = 0; i < connections.size(); i++) {
+            if (connections[i]->connect()) {
+                connected++;
+                if (use_proto && !udp_feeds[i]) {
+                    feed_proto[i] = CoTCommon::negotiate_tak_protocol(*connections[i], 2000, negotiated[i], verbose);
+                    std::cerr << feed_names[i] << ": " << (feed_proto[i] ? "TAK Protocol v1" : "XML") << std::endl;
+                }
+            } else if (connections.size() > 1) {
+                std::cerr << "Failed to connect to " << feed_names[i] << std::endl;
+            }
+        }
+        return connected > 0;
     }
     
-    void listen(bool compact_mode = false, const std::string& filter_type = "") {
-        if (!connection.is_connected()) {
+    void listen(const ListenerOptions& opts) {
+        if (!is_connected()) {
             std::cerr << "Not connected to TAK server\n";
             return;
         }
         
-        std::cout << "\n=== TAK Server CoT Listener Active ===\n";
-        if (compact_mode) {
-            std::cout << "Time     | Callsign     | Type       | Position (Lat,Lon)      | Team\n";
-            std::cout << "---------|--------------|------------|-------------------------|----------\n";
+        expire_tracks = true;
+        configure(opts);
+        for (size_t i = 0; i < negotiated.size(); i++) {
+            // Events that arrived while negotiating
+            if (feed_proto[i]) {
+                tak_framers[i].append(negotiated[i].data(), negotiated[i].size());
+            } else {
+                framers[i].append(negotiated[i].data(), negotiated[i].size());
+            }
+        }
+        print_header();
+        if (!options.snapshot_path.empty()) {
+            warm_start();
+            snapshotter.reset(new CoTCommon::TrackSnapshotter(*merger, options.snapshot_path,
+                                                              options.snapshot_interval_s, verbose));
+            snapshotter->start();
         }
-        std::cout.flush();
         
-        char buffer[8192];
-        std::string message_buffer;
+        if (options.low_latency.enabled) {
+            for (auto& connection : connections) {
+                if (connection->is_connected()) {
+                    connection->set_low_latency(options.low_latency.busy_poll_us);
+                }
+            }
+        }
         
-        while (connection.is_connected()) {
-            int bytes_received = connection.receive_data(buffer, sizeof(buffer));
-            
-            if (bytes_received <= 0) {
-                int ssl_error = connection.get_last_ssl_error(bytes_received);
-                if (ssl_error == SSL_ERROR_WANT_READ || ssl_error == SSL_ERROR_WANT_WRITE) {
-                    // Non-blocking operation, try again
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                    continue;
-                } else {
+        if (connections.size() == 1 && options.low_latency.enabled) {
+            connections[0]->set_nonblocking(true);
+            spin_reader.reset(new CoTCommon::SpinReader(*connections[0], options.low_latency.spin_us));
+            process_stream([this](char* buffer, size_t size, uint32_t& feed) {
+                feed = 0;
+                int bytes_received = spin_reader->read(buffer, size);
+                if (bytes_received < 0) {
                     std::cerr << "\nConnection lost or error reading from server\n";
-                    if (verbose) {
-                        std::cerr << "SSL Error: " << ssl_error << std::endl;
-                        ERR_print_errors_fp(stderr);
-                    }
-                    break;
                 }
+                return bytes_received;
+            });
+            return;
+        }
+        
+        if (connections.size() == 1) {
+            process_stream([this](char* buffer, size_t size, uint32_t& feed) {
+                feed = 0;
+                return connections[0]->is_connected() ? read_connection(buffer, size) : -1;
+            });
+            return;
+        }
+        
+        for (auto& connection : connections) {
+            if (connection->is_connected()) {
+                connection->set_nonblocking(true);
             }
-            
-            buffer[bytes_received] = '\0';
-            message_buffer += std::string(buffer, bytes_received);
-            
-            // Process complete XML messages
-            size_t start_pos = 0;
-            while (true) {
-                // Look for XML declaration or event start
-                size_t xml_start = message_buffer.find("<?xml", start_pos);
-                if (xml_start == std::string::npos) {
-                    xml_start = message_buffer.find("<event", start_pos);
-                }
-                
-                if (xml_start == std::string::npos) {
-                    break;
-                }
-                
-                // Find the end of the event
-                size_t event_end = message_buffer.find("</event>", xml_start);
-                if (event_end == std::string::npos) {
-                    break; // Incomplete message, wait for more data
-                }
-                
-                // Extract complete message
-                std::string complete_message = message_buffer.substr(xml_start, event_end - xml_start + 8);
-                
-                // Parse and display the message
-                try {
-                    CoTCommon::CoTParser::CoTMessage msg = parser.parse(complete_message);
-                    
-                    // Apply filter if specified
-                    bool should_display = true;
-                    if (!filter_type.empty()) {
-                        should_display = (msg.type.find(filter_type) != std::string::npos);
-                    }
-                    
-                    if (should_display) {
-                        if (compact_mode) {
-                            msg.print_compact();
-                        } else {
-                            msg.print();
-                        }
-                        
-                        if (verbose) {
-                            std::cout << "\nRaw XML:\n" << complete_message << "\n" << std::endl;
-                        }
-                    }
-                } catch (const std::exception& e) {
-                    if (verbose) {
-                        std::cerr << "Error parsing CoT message: " << e.what() << std::endl;
-                        std::cerr << "Raw message: " << complete_message << std::endl;
-                    }
-                }
-                
-                start_pos = event_end + 8;
+        }
+        process_stream([this](char* buffer, size_t size, uint32_t& feed) {
+            return read_feeds(buffer, size, feed);
+        });
+    }
+    
+    // Feed captured streams from disk through the same path as live data.
+    // Several files are read as interleaved feeds and merged.
+    bool replay(const std::vector<std::string>& paths, const ListenerOptions& opts) {
+        std::vector<std::unique_ptr<std::ifstream>> files;
+        for (const auto& path : paths) {
+            files.emplace_back(new std::ifstream(path, std::ios::binary));
+            if (!*files.back()) {
+                std::cerr << "Error opening replay file: " << path << std::endl;
+                return false;
             }
-            
-            // Remove processed messages from buffer
-            if (start_pos > 0) {
-                message_buffer = message_buffer.substr(start_pos);
+        }
+        
+        feed_names = paths;
+        expire_tracks = false;
+        configure(opts);
+        print_header();
+        
+        auto start = std::chrono::steady_clock::now();
+        size_t next = 0;
+        uint64_t events = process_stream([&files, &next](char* buffer, size_t size, uint32_t& feed) {
+            // Round-robin chunks across the files still open
+            for (size_t n = 0; n < files.size(); n++) {
+                size_t i = (next + n) % files.size();
+                if (!*files[i]) continue;
+                files[i]->read(buffer, size);
+                if (files[i]->gcount() > 0) {
+                    feed = static_cast<uint32_t>(i);
+                    next = (i + 1) % files.size();
+                    return static_cast<int>(files[i]->gcount());
+                }
             }
-            
-            // Prevent buffer from growing too large
-            if (message_buffer.length() > 16384) {
-                message_buffer.clear();
+            return -1;
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        std::cerr << "Replayed " << events << " events in " << std::fixed << std::setprecision(3)
+                  << seconds << "s (" << std::setprecision(0) << (seconds > 0 ? events / seconds : 0.0)
+                  << " events/s)" << std::endl;
+        return true;
+    }
+    
+    // Display the live picture another listener serves on its query endpoint
+    bool subscribe(const std::string& endpoint, const std::string& filter, const ListenerOptions& opts) {
+        CoTCommon::QueryClient client;
+        if (!client.connect(endpoint) || !client.send_command(filter.empty() ? "SUBSCRIBE" : "SUBSCRIBE " + filter)) {
+            return false;
+        }
+        
+        feed_names = {endpoint};
+        expire_tracks = true;
+        configure(opts);
+        print_header();
+        
+        std::string line, xml, output;
+        uint64_t events = 0;
+        while (client.read_message(line, xml)) {
+            if (line.compare(0, 6, "EVENT ") == 0) {
+                events++;
+                bytes_metric.add(xml.size());
+                xml_events_metric.add();
+                process_xml(xml, 0, nullptr, output);
+                std::cout.write(output.data(), output.size());
+                std::cout.flush();
+                output.clear();
+                arena.reset();
+            } else if (line.compare(0, 4, "ERR ") == 0) {
+                std::cerr << "Query endpoint " << endpoint << ": " << line.substr(4) << std::endl;
+                return false;
+            } else if (line.compare(0, 7, "RESYNC ") == 0) {
+                std::cerr << "Fell behind " << endpoint << " (" << line.substr(7)
+                          << " events dropped); resyncing" << std::endl;
+            } else if (verbose) {
+                std::cerr << line << std::endl;
             }
         }
+        if (table) {
+            table->stop();
+        }
+        
+        std::cerr << "\nQuery endpoint " << endpoint << " closed after " << events << " events" << std::endl;
+        return true;
     }
     
     void disconnect() {
-        connection.disconnect();
+        if (snapshotter) {
+            snapshotter->stop();  // Writes a final snapshot
+        }
+        for (auto& connection : connections) {
+            if (connection->is_connected()) {
+                connection->disconnect();
+            }
+        }
     }
     
     bool is_connected() const {
-        return connection.is_connected();
+        for (const auto& connection : connections) {
+            if (connection->is_connected()) return true;
+        }
+        return false;
     }
 };
 
 void print_usage(const char* program_name) {
     std::cout << "Usage: " << program_name << " [options]\n";
     std::cout << "Options:\n";
-    std::cout << "  --host <hostname>     TAK server hostname (default: localhost)\n";
-    std::cout << "  --port <port>         TAK server TCP port (default: 8089)\n";
+    std::cout << "  --host <hostname>     TAK server hostname (default: localhost); repeat to merge\n";
+    std::cout << "                        several servers into one picture\n";
+    std::cout << "  --port <port>         TAK server TCP port (default: 8089; one, or one per --host)\n";
     std::cout << "  --cert <file>         Client certificate file (.pem)\n";
     std::cout << "  --key <file>          Client private key file (.pem)\n";
     std::cout << "  --ca <file>           CA certificate file (.pem)\n";
@@ -149,6 +895,54 @@ void print_usage(const char* program_name) {
     std::cout << "  --compact             Use compact display format\n";
     std::cout << "  --filter <type>       Filter messages by type (e.g., 'a-f' for friendly)\n";
     std::cout << "  --verbose             Show detailed information and raw XML\n";
+    std::cout << "  --table               Live table of current tracks, redrawn at a fixed frame rate\n";
+    std::cout << "                        (keys: a/c/t/g/u sort, r reverse, / filter, q quit)\n";
+    std::cout << "  --frame-rate <hz>     Table redraws per second (default: 10)\n";
+    std::cout << "  --sort <key>          Initial table order: age, callsign, type, team or updates\n";
+    std::cout << "  --match <path>=<text> Only show events whose field contains text\n";
+    std::cout << "                        (e.g. 'detail/__group@name=Red'), repeatable\n";
+    std::cout << "  --field <path>        Also display a field (e.g. 'detail/track@speed'), repeatable\n";
+    std::cout << "  --dedup               Drop repeated position reports per UID\n";
+    std::cout << "  --rate <type>=<hz>    Limit updates per UID for a type pattern (e.g. 'a-?-G*=1'), repeatable\n";
+    std::cout << "  --min-distance <m>    Suppress updates that moved less than m meters\n";
+    std::cout << "  --max-silence <s>     Always pass an update after s seconds (default: 30)\n";
+    std::cout << "  --max-tracks <n>      Tracks remembered by the dedup stage (default: 65536)\n";
+    std::cout << "  --workers <n>         Parse on a pool of n worker threads (default: 0, inline)\n";
+    std::cout << "  --ordering <mode>     Worker output order: arrival (default) or uid; always uid\n";
+    std::cout << "                        with --dedup, --rate, --min-distance or --history\n";
+    std::cout << "  --replay <file>       Read a captured CoT stream from file instead of the server;\n";
+    std::cout << "                        repeat to merge several captures\n";
+    std::cout << "  --stats               Print pipeline counters and queue depths to stderr\n";
+    std::cout << "  --udp                 Receive plain CoT datagrams on --host/--port instead of TLS\n";
+    std::cout << "                        (default: multicast 239.2.3.1:6969)\n";
+    std::cout << "  --interface <addr>    Local interface address to join the multicast group on\n";
+    std::cout << "  --rcvbuf <bytes>      UDP socket receive buffer (default: 8388608)\n";
+    std::cout << "  --low-latency         Spin on empty reads instead of sleeping, lock memory and\n";
+    std::cout << "                        disable Nagle/delayed ACKs (costs a busy core)\n";
+    std::cout << "  --cpus <list>         With --low-latency: pin the I/O thread, then each worker\n";
+    std::cout << "                        (e.g. '2,3-5')\n";
+    std::cout << "  --spin-us <us>        Spin budget before blocking in poll() (default: 200)\n";
+    std::cout << "  --busy-poll-us <us>   SO_BUSY_POLL on feed sockets (default: 50)\n";
+    std::cout << "  --proto               Negotiate TAK Protocol v1 (protobuf) with each server,\n";
+    std::cout << "                        staying with XML if a server does not offer it\n";
+    std::cout << "  --snapshot <file>     Keep a snapshot of live tracks in file and show it on startup\n";
+    std::cout << "  --snapshot-interval <s> Seconds between snapshots (default: 10)\n";
+    std::cout << "  --query <endpoint>    Serve track queries and live subscriptions on a Unix socket\n";
+    std::cout << "                        path, or a port number on 127.0.0.1\n";
+    std::cout << "  --subscribe <endpoint> Show another listener's --query picture instead of\n";
+    std::cout << "                        connecting to a server\n";
+    std::cout << "  --subscribe-filter <f> Filter for --subscribe, e.g. 'type=a-h-* team=Red\n";
+    std::cout << "                        bbox=<south>,<west>,<north>,<east>'\n";
+    std::cout << "  --history <minutes>   Keep each track's recent trail, served by TRAIL on --query\n";
+    std::cout << "  --history-points <n>  Trail points kept per track (default: 64)\n";
+    std::cout << "  --history-budget <MB> Memory for all trails (default: 64)\n";
+    std::cout << "  --history-tolerance <m> Keep a point only once dead reckoning from the\n";
+    std::cout << "                        previous ones is off by more than m meters (default: 10)\n";
+    std::cout << "  --metrics-port <port> Serve Prometheus metrics on 127.0.0.1:port/metrics\n";
+    std::cout << "                        (SIGUSR1 always prints them to stderr)\n";
+    std::cout << "  --trace <file>        Record hot-path trace points; write Chrome trace JSON\n";
+    std::cout << "                        to file on SIGUSR2 and at exit\n";
+    std::cout << "  --trace-sample <n>    Record one in n top-level trace scopes (default: 1)\n";
     std::cout << "  --help               Show this help message\n";
     std::cout << "\nCoT Type Examples:\n";
     std::cout << "  a-f-*    Friendly units\n";
@@ -158,22 +952,34 @@ void print_usage(const char* program_name) {
 }
 
 int main(int argc, char* argv[]) {
-    std::string host = "localhost";
-    int port = 8089;
+    std::vector<std::string> hosts;
+    std::vector<int> ports;
     std::string cert_file;
     std::string key_file;
     std::string ca_file;
     std::string passphrase;
-    bool compact_mode = false;
     bool verbose = false;
-    std::string filter_type;
+    std::vector<std::string> replay_files;
+    ListenerOptions options;
+    options.dedup.drop_duplicates = false;  // Only with --dedup
+    bool use_udp = false;
+    bool use_proto = false;
+    CoTCommon::UdpTransport::Options udp_options;
+    int metrics_port = 0;
+    std::string query_endpoint;
+    std::string subscribe_endpoint;
+    std::string subscribe_filter;
+    bool keep_history = false;
+    CoTCommon::TrackHistory::Options history_options;
+    std::string trace_file;
+    uint32_t trace_sample = 1;
     
     // Simple argument parsing
     for (int i = 1; i < argc; i++) {
         if (std::string(argv[i]) == "--host" && i + 1 < argc) {
-            host = argv[++i];
+            hosts.push_back(argv[++i]);
         } else if (std::string(argv[i]) == "--port" && i + 1 < argc) {
-            port = std::stoi(argv[++i]);
+            ports.push_back(std::stoi(argv[++i]));
         } else if (std::string(argv[i]) == "--cert" && i + 1 < argc) {
             cert_file = argv[++i];
         } else if (std::string(argv[i]) == "--key" && i + 1 < argc) {
@@ -183,44 +989,252 @@ int main(int argc, char* argv[]) {
         } else if (std::string(argv[i]) == "--passphrase" && i + 1 < argc) {
             passphrase = argv[++i];
         } else if (std::string(argv[i]) == "--compact") {
-            compact_mode = true;
+            options.compact_mode = true;
         } else if (std::string(argv[i]) == "--filter" && i + 1 < argc) {
-            filter_type = argv[++i];
+            options.filter_type = argv[++i];
         } else if (std::string(argv[i]) == "--verbose") {
             verbose = true;
+        } else if (std::string(argv[i]) == "--table") {
+            options.table = true;
+        } else if (std::string(argv[i]) == "--frame-rate" && i + 1 < argc) {
+            options.table_options.frame_rate = std::stod(argv[++i]);
+            if (options.table_options.frame_rate <= 0) {
+                std::cerr << "--frame-rate must be positive\n";
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--sort" && i + 1 < argc) {
+            if (!CoTCommon::TrackTable::parse_sort_key(argv[++i], options.table_options.sort)) {
+                std::cerr << "Unknown sort key: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--match" && i + 1 < argc) {
+            std::string match = argv[++i];
+            size_t eq = match.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "Expected <path>=<text> for --match: " << match << std::endl;
+                return 1;
+            }
+            options.matches.emplace_back(match.substr(0, eq), match.substr(eq + 1));
+        } else if (std::string(argv[i]) == "--field" && i + 1 < argc) {
+            options.fields.push_back(argv[++i]);
+        } else if (std::string(argv[i]) == "--dedup") {
+            options.downsample = true;
+            options.dedup.drop_duplicates = true;
+        } else if (std::string(argv[i]) == "--rate" && i + 1 < argc) {
+            std::string rule = argv[++i];
+            size_t eq = rule.find('=');
+            if (eq == std::string::npos || std::stod(rule.substr(eq + 1)) <= 0) {
+                std::cerr << "Expected <type-pattern>=<hz> for --rate: " << rule << std::endl;
+                return 1;
+            }
+            options.downsample = true;
+            options.dedup.rate_limits.push_back({rule.substr(0, eq), 1.0 / std::stod(rule.substr(eq + 1))});
+        } else if (std::string(argv[i]) == "--min-distance" && i + 1 < argc) {
+            options.downsample = true;
+            options.dedup.min_distance_m = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--max-silence" && i + 1 < argc) {
+            options.dedup.max_silence_s = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--max-tracks" && i + 1 < argc) {
+            options.dedup.max_tracks = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--workers" && i + 1 < argc) {
+            options.workers = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--ordering" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "uid") {
+                options.ordering = CoTCommon::ParsePipeline::Ordering::PER_UID;
+            } else if (mode == "arrival") {
+                options.ordering = CoTCommon::ParsePipeline::Ordering::ARRIVAL;
+            } else {
+                std::cerr << "Unknown ordering mode: " << mode << std::endl;
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--replay" && i + 1 < argc) {
+            replay_files.push_back(argv[++i]);
+        } else if (std::string(argv[i]) == "--stats") {
+            options.show_stats = true;
+        } else if (std::string(argv[i]) == "--udp") {
+            use_udp = true;
+        } else if (std::string(argv[i]) == "--interface" && i + 1 < argc) {
+            udp_options.interface_address = argv[++i];
+        } else if (std::string(argv[i]) == "--rcvbuf" && i + 1 < argc) {
+            udp_options.receive_buffer = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--low-latency") {
+            options.low_latency.enabled = true;
+        } else if (std::string(argv[i]) == "--cpus" && i + 1 < argc) {
+            if (!CoTCommon::parse_cpu_list(argv[++i], options.low_latency.cpus)) {
+                std::cerr << "Expected a CPU list like '2,3-5' for --cpus: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--spin-us" && i + 1 < argc) {
+            options.low_latency.spin_us = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--busy-poll-us" && i + 1 < argc) {
+            options.low_latency.busy_poll_us = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--proto") {
+            use_proto = true;
+        } else if (std::string(argv[i]) == "--snapshot" && i + 1 < argc) {
+            options.snapshot_path = argv[++i];
+        } else if (std::string(argv[i]) == "--snapshot-interval" && i + 1 < argc) {
+            options.snapshot_interval_s = std::stod(argv[++i]);
+            if (options.snapshot_interval_s <= 0) {
+                std::cerr << "--snapshot-interval must be positive\n";
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--query" && i + 1 < argc) {
+            query_endpoint = argv[++i];
+        } else if (std::string(argv[i]) == "--subscribe" && i + 1 < argc) {
+            subscribe_endpoint = argv[++i];
+        } else if (std::string(argv[i]) == "--subscribe-filter" && i + 1 < argc) {
+            subscribe_filter = argv[++i];
+        } else if (std::string(argv[i]) == "--history" && i + 1 < argc) {
+            history_options.window_s = std::stod(argv[++i]) * 60.0;
+            keep_history = history_options.window_s > 0;
+        } else if (std::string(argv[i]) == "--history-points" && i + 1 < argc) {
+            history_options.points_per_track = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--history-budget" && i + 1 < argc) {
+            history_options.memory_budget = static_cast<size_t>(std::stod(argv[++i]) * 1024 * 1024);
+        } else if (std::string(argv[i]) == "--history-tolerance" && i + 1 < argc) {
+            history_options.tolerance_m = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "--metrics-port" && i + 1 < argc) {
+            metrics_port = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--trace" && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (std::string(argv[i]) == "--trace-sample" && i + 1 < argc) {
+            trace_sample = static_cast<uint32_t>(std::stoul(argv[++i]));
         } else if (std::string(argv[i]) == "--help") {
             print_usage(argv[0]);
             return 0;
         }
     }
     
+    if (hosts.empty()) {
+        hosts.push_back(use_udp ? "239.2.3.1" : "localhost");
+    }
+    if (ports.size() > 1 && ports.size() != hosts.size()) {
+        std::cerr << "Give one --port for all hosts, or one per --host\n";
+        return 1;
+    }
+    int default_port = use_udp ? 6969 : 8089;
+    if (use_udp && use_proto) {
+        std::cerr << "--proto applies to TLS connections; UDP datagrams stay XML\n";
+    }
+    if ((!replay_files.empty() || !subscribe_endpoint.empty()) && !options.snapshot_path.empty()) {
+        std::cerr << "--snapshot applies to server feeds; ignored with --replay and --subscribe\n";
+        options.snapshot_path.clear();
+    }
+    auto port_for = [&ports, default_port](size_t i) {
+        return ports.empty() ? default_port : ports[ports.size() == 1 ? 0 : i];
+    };
+    
     std::cout << "TAK Server CoT Listener (C++)\n";
     std::cout << "=============================\n";
-    std::cout << "Target: " << host << ":" << port << std::endl;
-    if (!filter_type.empty()) {
-        std::cout << "Filter: " << filter_type << std::endl;
+    if (!subscribe_endpoint.empty()) {
+        std::cout << "Subscribe: " << subscribe_endpoint
+                  << (subscribe_filter.empty() ? "" : " (" + subscribe_filter + ")") << std::endl;
+    } else if (replay_files.empty()) {
+        for (size_t i = 0; i < hosts.size(); i++) {
+            std::cout << "Target: " << (use_udp ? "udp://" : "") << hosts[i] << ":" << port_for(i) << std::endl;
+        }
+    } else {
+        for (const auto& file : replay_files) {
+            std::cout << "Replay: " << file << std::endl;
+        }
+    }
+    if (!options.filter_type.empty()) {
+        std::cout << "Filter: " << options.filter_type << std::endl;
+    }
+    std::cout << "Mode: " << (options.table ? "Table" : options.compact_mode ? "Compact" : "Detailed") << std::endl;
+    // Dedup and history decide from each UID's previous event, so a UID's
+    // events must reach them in order. Arrival ordering only reorders the
+    // output; the workers themselves run batches concurrently.
+    bool per_uid_state = options.downsample || keep_history;
+    if (options.workers > 0 && per_uid_state) {
+        options.ordering = CoTCommon::ParsePipeline::Ordering::PER_UID;
+    }
+    if (options.workers > 0) {
+        std::cout << "Workers: " << options.workers << " ("
+                  << (options.ordering == CoTCommon::ParsePipeline::Ordering::PER_UID ? "per-UID" : "arrival")
+                  << " order" << (per_uid_state ? ", required by --dedup/--history" : "") << ")" << std::endl;
+    }
+    CoTCommon::MetricsServer metrics;
+    if (!metrics.start(metrics_port)) {
+        return 1;
+    }
+    if (!trace_file.empty() &&
+        (!CoTCommon::Tracer::enable(65536, trace_sample) || !CoTCommon::Tracer::export_on_signal(trace_file))) {
+        return 1;
+    }
+    if (metrics_port > 0) {
+        std::cout << "Metrics: http://127.0.0.1:" << metrics_port << "/metrics" << std::endl;
+    }
+    
+    // Declared before the query server and the listener, which read and feed it
+    std::unique_ptr<CoTCommon::TrackHistory> history;
+    if (keep_history) {
+        history.reset(new CoTCommon::TrackHistory(history_options));
+        std::cout << "History: " << history_options.window_s / 60.0 << " min, " << history->capacity()
+                  << " tracks in " << history->memory_bytes() / (1024 * 1024) << " MB" << std::endl;
+    }
+    
+    // Declared before the listener, which publishes into it
+    std::unique_ptr<CoTCommon::QueryServer> query;
+    if (!query_endpoint.empty()) {
+        CoTCommon::QueryServer::Options query_options;
+        query_options.trails = history.get();
+        if (query_endpoint.find_first_not_of("0123456789") == std::string::npos) {
+            query_options.port = std::stoi(query_endpoint);
+        } else {
+            query_options.socket_path = query_endpoint;
+        }
+        query_options.expire = replay_files.empty();  // Replayed events are historical
+        query.reset(new CoTCommon::QueryServer(query_options));
+        if (!query->start()) {
+            return 1;
+        }
+        std::cout << "Query: " << query->endpoint() << std::endl;
     }
-    std::cout << "Mode: " << (compact_mode ? "Compact" : "Detailed") << std::endl;
     std::cout << "Press Ctrl+C to stop listening\n" << std::endl;
     
     // Create TAK server listener
-    TAKServerListener listener(host, port, cert_file, key_file, ca_file, passphrase, verbose);
-    
-    // Connect to server
-    if (!listener.connect()) {
-        std::cerr << "Failed to connect to TAK server\n";
-        return 1;
+    TAKServerListener listener(hosts[0], port_for(0), cert_file, key_file, ca_file, passphrase, verbose,
+                               use_udp ? &udp_options : nullptr);
+    for (size_t i = 1; i < hosts.size(); i++) {
+        listener.add_server(hosts[i], port_for(i));
+    }
+    if (use_proto) {
+        listener.enable_tak_protocol();
     }
+    listener.set_query_server(query.get());
+    listener.set_history(history.get());
     
-    // Set up signal handler for graceful shutdown
+    // Set up signal handler for graceful shutdown (exit() also restores the
+    // terminal after --table)
     signal(SIGINT, [](int) {
         std::cout << "\n\nShutting down listener...\n";
         exit(0);
     });
     
+    if (!subscribe_endpoint.empty()) {
+        return listener.subscribe(subscribe_endpoint, subscribe_filter, options) ? 0 : 1;
+    }
+    
+    if (!replay_files.empty()) {
+        try {
+            return listener.replay(replay_files, options) ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    
+    // Connect to server
+    if (!listener.connect()) {
+        std::cerr << "Failed to connect to TAK server\n";
+        return 1;
+    }
+    
     try {
         // Start listening for messages
-        listener.listen(compact_mode, filter_type);
+        listener.listen(options);
         
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -228,4 +1242,4 @@ int main(int argc, char* argv[]) {
     }
     
     return 0;
-}
\ No newline at end of file
+}
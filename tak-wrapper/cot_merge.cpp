@@ -0,0 +1,160 @@
+#include "cot_merge.h"
+
+#include <functional>
+
+namespace CoTCommon {
+
+// TrackStore implementation
+TrackStore::TrackStore() : current_revision(0), index(1024, 0), mask(1023) {
+}
+
+size_t TrackStore::probe(std::string_view uid, uint64_t hash) const {
+    size_t slot = hash & mask;
+    while (index[slot] != 0) {
+        const Track& track = entries[index[slot] - 1];
+        if (track.uid_hash == hash && track.uid == uid) break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void TrackStore::rebuild(size_t slots) {
+    index.assign(slots, 0);
+    mask = slots - 1;
+    for (size_t i = 0; i < entries.size(); i++) {
+        size_t slot = entries[i].uid_hash & mask;
+        while (index[slot] != 0) slot = (slot + 1) & mask;
+        index[slot] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+TrackStore::Result TrackStore::update(const CoTParser::CoTMessageView& msg, std::string_view raw_xml,
+                                      int64_t time_ms, uint32_t feed, uint32_t& holder) {
+    uint64_t hash = std::hash<std::string_view>()(msg.uid);
+    size_t slot = probe(msg.uid, hash);
+
+    Track* track;
+    if (index[slot] != 0) {
+        track = &entries[index[slot] - 1];
+        if (time_ms <= track->time_ms) {
+            holder = track->feed;
+            return time_ms == track->time_ms ? Result::DUPLICATE : Result::STALE;
+        }
+    } else {
+        // Keep the table at most 70% full
+        if ((entries.size() + 1) * 10 > index.size() * 7) {
+            rebuild(index.size() * 2);
+            slot = probe(msg.uid, hash);
+        }
+        entries.emplace_back();
+        index[slot] = static_cast<uint32_t>(entries.size());
+        track = &entries.back();
+        track->uid.assign(msg.uid.data(), msg.uid.size());
+        track->uid_hash = hash;
+        track->versions = 0;
+    }
+
+    track->type.assign(msg.type, msg.type_spill);
+    track->how.assign(msg.how, msg.how_spill);
+    track->callsign.assign(msg.callsign, msg.callsign_spill);
+    track->team.assign(msg.team, msg.team_spill);
+    track->position = msg.position;
+    track->time_ms = time_ms;
+    if (!parse_cot_time(msg.stale, track->stale_ms)) {
+        track->stale_ms = 0;
+    }
+    track->feed = feed;
+    track->versions++;
+    track->revision = ++current_revision;
+    track->xml.assign(raw_xml.data(), raw_xml.size());  // Reuses the track's capacity
+    return Result::NEWER;
+}
+
+const TrackStore::Track* TrackStore::find(std::string_view uid) const {
+    size_t slot = probe(uid, std::hash<std::string_view>()(uid));
+    return index[slot] != 0 ? &entries[index[slot] - 1] : nullptr;
+}
+
+size_t TrackStore::expire(int64_t now_ms) {
+    size_t before = entries.size();
+    for (size_t i = entries.size(); i-- > 0;) {
+        if (entries[i].stale_ms != 0 && entries[i].stale_ms < now_ms) {
+            if (i != entries.size() - 1) {
+                entries[i] = std::move(entries.back());
+            }
+            entries.pop_back();
+        }
+    }
+
+    size_t removed = before - entries.size();
+    if (removed > 0) {
+        rebuild(index.size());
+    }
+    return removed;
+}
+
+// FeedMerger implementation
+FeedMerger::FeedMerger(const std::vector<std::string>& feed_names)
+    : feeds(feed_names.size()), window_events(feed_names.size(), 0), window_start(Clock::now()) {
+    for (size_t i = 0; i < feeds.size(); i++) {
+        feeds[i].name = feed_names[i];
+        feeds[i].overlap.assign(feeds.size(), 0);
+    }
+}
+
+bool FeedMerger::accept(const CoTParser::CoTMessageView& msg, std::string_view raw_xml, uint32_t feed) {
+    // Parse outside the lock
+    int64_t time_ms;
+    bool timed = parse_cot_time(msg.time, time_ms);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    FeedStats& stats = feeds[feed];
+    stats.events++;
+
+    if (!timed) {
+        // Cannot be ordered against other versions
+        stats.untimed++;
+        return true;
+    }
+
+    uint32_t holder = feed;
+    switch (store.update(msg, raw_xml, time_ms, feed, holder)) {
+        case TrackStore::Result::NEWER:
+            stats.accepted++;
+            return true;
+        case TrackStore::Result::DUPLICATE:
+            stats.duplicates++;
+            stats.overlap[holder]++;
+            return false;
+        case TrackStore::Result::STALE:
+            stats.stale++;
+            return false;
+    }
+    return false;
+}
+
+size_t FeedMerger::expire(int64_t now_ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return store.expire(now_ms);
+}
+
+std::vector<FeedMerger::FeedStats> FeedMerger::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - window_start).count();
+
+    std::vector<FeedStats> result = feeds;
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i].rate = elapsed > 0 ? (result[i].events - window_events[i]) / elapsed : 0.0;
+        window_events[i] = result[i].events;
+    }
+    window_start = now;
+    return result;
+}
+
+size_t FeedMerger::track_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return store.size();
+}
+
+} // namespace CoTCommon
@@ -0,0 +1,123 @@
+#ifndef COT_MERGE_H
+#define COT_MERGE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cot_common.h"
+
+namespace CoTCommon {
+
+// Newest known version of every track, keyed by UID. Versions are ordered
+// by the event's time attribute, so the same event arriving again (from
+// another feed, or echoed by the same one) is recognised by (uid, time).
+//
+// Not thread-safe; FeedMerger serialises access.
+class TrackStore {
+public:
+    struct Track {
+        std::string uid;
+        uint64_t uid_hash;
+        InternedString type;
+        InternedString how;
+        InternedString callsign;
+        InternedString team;
+        CompactPosition position;
+        int64_t time_ms;
+        int64_t stale_ms;       // 0 if the event carried no stale time
+        uint32_t feed;          // Feed that delivered this version first
+        uint64_t versions;      // Versions accepted for this track
+        uint64_t revision;      // Store revision of the last update
+        std::string xml;        // Raw event of this version
+    };
+
+    enum class Result {
+        NEWER,       // Stored as the track's current version
+        DUPLICATE,   // Same uid and time as the stored version
+        STALE        // Older than the stored version
+    };
+
+    TrackStore();
+
+    // Keep msg if it is newer than the stored version of its track. On
+    // DUPLICATE/STALE, holder is set to the feed of the stored version.
+    Result update(const CoTParser::CoTMessageView& msg, std::string_view raw_xml, int64_t time_ms,
+                  uint32_t feed, uint32_t& holder);
+
+    const Track* find(std::string_view uid) const;
+
+    // Drop tracks whose stale time has passed; returns how many
+    size_t expire(int64_t now_ms);
+
+    const std::vector<Track>& tracks() const { return entries; }
+    size_t size() const { return entries.size(); }
+
+    // Bumped by every accepted version; tracks with a revision above one
+    // seen earlier have changed since
+    uint64_t revision() const { return current_revision; }
+
+private:
+    std::vector<Track> entries;
+    uint64_t current_revision;
+    std::vector<uint32_t> index;   // Open addressing: entry + 1, 0 = empty
+    size_t mask;
+
+    size_t probe(std::string_view uid, uint64_t hash) const;
+    void rebuild(size_t slots);
+};
+
+// Merges events from several feeds into one picture. Each event is checked
+// against the TrackStore: only the first arrival of a track's newest version
+// passes, and every feed is credited with how often it delivered first,
+// repeated another feed's event, or was behind.
+class FeedMerger {
+public:
+    struct FeedStats {
+        std::string name;
+        uint64_t events;
+        uint64_t accepted;       // First to deliver a new version
+        uint64_t duplicates;     // Version already delivered (by any feed)
+        uint64_t stale;          // Older than the stored version
+        uint64_t untimed;        // No parsable time; always passed
+        double rate;             // Events/s since the previous stats() call
+        std::vector<uint64_t> overlap;  // overlap[j]: duplicates of versions feed j delivered first
+    };
+
+    explicit FeedMerger(const std::vector<std::string>& feed_names);
+
+    // Thread-safe; true if the event is a track's newest version and should
+    // be passed on
+    bool accept(const CoTParser::CoTMessageView& msg, std::string_view raw_xml, uint32_t feed);
+
+    // Drop tracks past their stale time
+    size_t expire(int64_t now_ms);
+
+    std::vector<FeedStats> stats() const;
+    size_t track_count() const;
+
+    // Run fn with the store locked, e.g. to take a snapshot
+    template <typename Fn>
+    void with_tracks(Fn fn) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        fn(store);
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    mutable std::mutex mutex;
+    TrackStore store;
+    std::vector<FeedStats> feeds;
+
+    // Rate window for stats()
+    mutable std::vector<uint64_t> window_events;
+    mutable Clock::time_point window_start;
+};
+
+} // namespace CoTCommon
+
+#endif // COT_MERGE_H
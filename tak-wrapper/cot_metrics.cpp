@@ -0,0 +1,490 @@
+#include "cot_metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace CoTCommon {
+
+namespace detail {
+thread_local MetricsShard* metrics_shard = nullptr;
+} // namespace detail
+
+std::atomic<int64_t> MetricsRegistry::Gauge::discard(0);
+
+// Hands the thread's block back to the registry when the thread exits
+struct ShardRelease {
+    detail::MetricsShard* shard = nullptr;
+    ~ShardRelease() {
+        if (shard) {
+            MetricsRegistry::global().release_shard(shard);
+            detail::metrics_shard = nullptr;
+        }
+    }
+};
+
+namespace detail {
+MetricsShard* attach_metrics_shard() {
+    thread_local ShardRelease release;
+    metrics_shard = MetricsRegistry::global().acquire_shard();
+    release.shard = metrics_shard;
+    return metrics_shard;
+}
+} // namespace detail
+
+namespace {
+
+void append_number(std::string& out, double value) {
+    char buf[32];
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        snprintf(buf, sizeof(buf), "%.0f", value);
+    } else {
+        snprintf(buf, sizeof(buf), "%.9g", value);
+    }
+    out += buf;
+}
+
+void append_series(std::string& out, const std::string& name, const char* suffix, const std::string& labels,
+                   const std::string& extra_label) {
+    out += name;
+    out += suffix;
+    if (!labels.empty() || !extra_label.empty()) {
+        out += '{';
+        out += labels;
+        if (!labels.empty() && !extra_label.empty()) out += ',';
+        out += extra_label;
+        out += '}';
+    }
+    out += ' ';
+}
+
+const char* type_name(MetricsRegistry::Type type) {
+    switch (type) {
+        case MetricsRegistry::Type::COUNTER: return "counter";
+        case MetricsRegistry::Type::GAUGE: return "gauge";
+        case MetricsRegistry::Type::HISTOGRAM: return "histogram";
+    }
+    return "untyped";
+}
+
+// Upper bound of the bucket holding the given rank
+double bucket_quantile(const uint64_t* buckets, uint64_t total, double q) {
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * total));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < MetricsRegistry::HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank && seen > 0) return i == 0 ? 0.0 : std::ldexp(1.0, i);
+    }
+    return std::ldexp(1.0, 64);
+}
+
+int dump_pipe_write = -1;
+
+void dump_signal_handler(int) {
+    int saved_errno = errno;
+    if (dump_pipe_write >= 0) {
+        char c = 'd';
+        ssize_t written = write(dump_pipe_write, &c, 1);
+        (void)written;
+    }
+    errno = saved_errno;
+}
+
+} // namespace
+
+// MetricsRegistry implementation
+MetricsRegistry::MetricsRegistry() : next_cell(SCRATCH_CELLS), next_callback(1) {
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    // Never destroyed: threads may still update metrics during exit
+    static MetricsRegistry* registry = new MetricsRegistry();
+    return *registry;
+}
+
+detail::MetricsShard* MetricsRegistry::acquire_shard() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!free_shards.empty()) {
+        detail::MetricsShard* shard = free_shards.back();
+        free_shards.pop_back();
+        return shard;
+    }
+    auto* shard = new detail::MetricsShard();
+    for (auto& cell : shard->cells) {
+        cell.store(0, std::memory_order_relaxed);
+    }
+    shards.push_back(shard);
+    return shard;
+}
+
+void MetricsRegistry::release_shard(detail::MetricsShard* shard) {
+    std::lock_guard<std::mutex> lock(mutex);
+    free_shards.push_back(shard);
+}
+
+uint32_t MetricsRegistry::allocate_cells(uint32_t count, const std::string& name) {
+    if (next_cell + count > detail::METRIC_CELLS) {
+        std::cerr << "Metrics registry full; " << name << " is not recorded" << std::endl;
+        return 0;
+    }
+    uint32_t cell = next_cell;
+    next_cell += count;
+    return cell;
+}
+
+// A series the registry had no cells for is not exported; its handle
+// writes to the scratch cells
+void MetricsRegistry::drop_series(const std::string& name) {
+    families[family_index.at(name)].series.pop_back();
+}
+
+MetricsRegistry::Series* MetricsRegistry::find_or_add(const std::string& name, const std::string& help,
+                                                      const std::string& labels, Type type, bool& added) {
+    added = false;
+    auto it = family_index.find(name);
+    if (it == family_index.end()) {
+        it = family_index.emplace(name, families.size()).first;
+        families.push_back(Family{name, help, type, {}});
+    }
+    Family& family = families[it->second];
+    if (family.type != type) {
+        std::cerr << "Metric " << name << " registered with two types" << std::endl;
+        return nullptr;
+    }
+    for (auto& series : family.series) {
+        if (series.labels == labels && series.callback_id == 0) return &series;
+    }
+    family.series.push_back(Series{labels, 0, nullptr, 0, nullptr, 1.0, 0, 0});
+    added = true;
+    return &family.series.back();
+}
+
+MetricsRegistry::Counter MetricsRegistry::counter(const std::string& name, const std::string& help,
+                                                  const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Counter handle;
+    bool added;
+    Series* series = find_or_add(name, help, labels, Type::COUNTER, added);
+    if (series && added) {
+        series->cell = allocate_cells(1, name);
+        if (series->cell == 0) {
+            drop_series(name);
+            return handle;
+        }
+    }
+    if (series) handle.cell = series->cell;
+    return handle;
+}
+
+MetricsRegistry::Gauge MetricsRegistry::gauge(const std::string& name, const std::string& help,
+                                              const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Gauge handle;
+    bool added;
+    Series* series = find_or_add(name, help, labels, Type::GAUGE, added);
+    if (series && added) {
+        gauges.emplace_back(0);
+        series->gauge = &gauges.back();
+    }
+    if (series) handle.target = series->gauge;
+    return handle;
+}
+
+MetricsRegistry::Histogram MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                                      const std::string& labels, double scale,
+                                                      uint32_t first_bucket, uint32_t last_bucket) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Histogram handle;
+    bool added;
+    Series* series = find_or_add(name, help, labels, Type::HISTOGRAM, added);
+    if (series && added) {
+        series->cell = allocate_cells(HISTOGRAM_BUCKETS + 1, name);
+        if (series->cell == 0) {
+            drop_series(name);
+            return handle;
+        }
+        series->scale = scale;
+        series->first_bucket = std::min<uint32_t>(first_bucket, HISTOGRAM_BUCKETS - 1);
+        series->last_bucket = std::min<uint32_t>(std::max(last_bucket, series->first_bucket), HISTOGRAM_BUCKETS - 1);
+    }
+    if (series) handle.cell = series->cell;
+    return handle;
+}
+
+uint64_t MetricsRegistry::add_callback(const std::string& name, const std::string& help, const std::string& labels,
+                                       Type type, std::function<double()> read) {
+    if (type == Type::HISTOGRAM) return 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = family_index.find(name);
+    if (it == family_index.end()) {
+        it = family_index.emplace(name, families.size()).first;
+        families.push_back(Family{name, help, type, {}});
+    }
+    Family& family = families[it->second];
+    if (family.type != type) {
+        std::cerr << "Metric " << name << " registered with two types" << std::endl;
+        return 0;
+    }
+    uint64_t id = next_callback++;
+    family.series.push_back(Series{labels, 0, nullptr, id, std::move(read), 1.0, 0, 0});
+    return id;
+}
+
+void MetricsRegistry::remove_callback(uint64_t id) {
+    if (id == 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& family : families) {
+        auto& series = family.series;
+        series.erase(std::remove_if(series.begin(), series.end(),
+                                    [id](const Series& s) { return s.callback_id == id; }),
+                     series.end());
+    }
+}
+
+std::vector<uint64_t> MetricsRegistry::collect() const {
+    std::vector<uint64_t> totals(next_cell, 0);
+    for (const auto* shard : shards) {
+        for (uint32_t i = 0; i < next_cell; i++) {
+            totals[i] += shard->cells[i].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+void MetricsRegistry::render_prometheus(std::string& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<uint64_t> totals = collect();
+
+    for (const auto& family : families) {
+        if (family.series.empty()) continue;
+        out += "# HELP " + family.name + " " + family.help + "\n";
+        out += "# TYPE " + family.name + " " + type_name(family.type) + "\n";
+        for (const auto& series : family.series) {
+            if (series.read) {
+                append_series(out, family.name, "", series.labels, "");
+                append_number(out, series.read());
+                out += '\n';
+            } else if (family.type == Type::COUNTER) {
+                append_series(out, family.name, "", series.labels, "");
+                out += std::to_string(totals[series.cell]) + "\n";
+            } else if (family.type == Type::GAUGE) {
+                append_series(out, family.name, "", series.labels, "");
+                out += std::to_string(series.gauge->load(std::memory_order_relaxed)) + "\n";
+            } else {
+                // Cumulative buckets; everything below the first exported
+                // bound is folded into it
+                const uint64_t* buckets = &totals[series.cell];
+                uint64_t count = 0;
+                for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) count += buckets[i];
+                uint64_t cumulative = 0;
+                for (uint32_t i = 0; i <= series.last_bucket; i++) {
+                    cumulative += buckets[i];
+                    if (i < series.first_bucket) continue;
+                    std::string le = "le=\"";
+                    char bound[32];
+                    snprintf(bound, sizeof(bound), "%.9g", std::ldexp(1.0, i) * series.scale);
+                    le += bound;
+                    le += '"';
+                    append_series(out, family.name, "_bucket", series.labels, le);
+                    out += std::to_string(cumulative) + "\n";
+                }
+                append_series(out, family.name, "_bucket", series.labels, "le=\"+Inf\"");
+                out += std::to_string(count) + "\n";
+                append_series(out, family.name, "_sum", series.labels, "");
+                append_number(out, static_cast<double>(buckets[HISTOGRAM_BUCKETS]) * series.scale);
+                out += '\n';
+                append_series(out, family.name, "_count", series.labels, "");
+                out += std::to_string(count) + "\n";
+            }
+        }
+    }
+}
+
+void MetricsRegistry::render_summary(std::string& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<uint64_t> totals = collect();
+
+    for (const auto& family : families) {
+        for (const auto& series : family.series) {
+            out += "[metrics] ";
+            append_series(out, family.name, "", series.labels, "");
+            if (series.read) {
+                append_number(out, series.read());
+            } else if (family.type == Type::COUNTER) {
+                out += std::to_string(totals[series.cell]);
+            } else if (family.type == Type::GAUGE) {
+                out += std::to_string(series.gauge->load(std::memory_order_relaxed));
+            } else {
+                const uint64_t* buckets = &totals[series.cell];
+                uint64_t count = 0;
+                for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) count += buckets[i];
+                out += "count=" + std::to_string(count);
+                if (count > 0) {
+                    out += " mean=";
+                    append_number(out, static_cast<double>(buckets[HISTOGRAM_BUCKETS]) / count * series.scale);
+                    const char* names[] = {" p50<=", " p90<=", " p99<="};
+                    const double quantiles[] = {0.5, 0.9, 0.99};
+                    for (int q = 0; q < 3; q++) {
+                        out += names[q];
+                        append_number(out, bucket_quantile(buckets, count, quantiles[q]) * series.scale);
+                    }
+                }
+            }
+            out += '\n';
+        }
+    }
+}
+
+// MetricsServer implementation
+MetricsServer::MetricsServer(MetricsRegistry& metrics)
+    : registry(metrics), listen_fd(-1), port(0), signal_pipe{-1, -1}, stopping(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(int http_port, const std::string& bind_address) {
+    if (server_thread.joinable()) return true;
+
+    if (http_port > 0) {
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(http_port);
+        if (listen_fd < 0 || inet_pton(AF_INET, bind_address.c_str(), &addr.sin_addr) != 1 ||
+            bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+            std::cerr << "Cannot serve metrics on " << bind_address << ":" << http_port << ": "
+                      << strerror(errno) << std::endl;
+            if (listen_fd >= 0) close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        port = http_port;
+    }
+
+    if (pipe2(signal_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        std::cerr << "Cannot create metrics signal pipe: " << strerror(errno) << std::endl;
+        return false;
+    }
+    dump_pipe_write = signal_pipe[1];
+
+    // SA_RESTART so blocking reads elsewhere are not cut short by a dump
+    struct sigaction action {};
+    action.sa_handler = dump_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, nullptr);
+
+    stopping = false;
+    server_thread = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!server_thread.joinable()) return;
+    stopping = true;
+    char c = 'q';
+    ssize_t written = write(signal_pipe[1], &c, 1);
+    (void)written;
+    server_thread.join();
+
+    signal(SIGUSR1, SIG_DFL);
+    dump_pipe_write = -1;
+    close(signal_pipe[0]);
+    close(signal_pipe[1]);
+    signal_pipe[0] = signal_pipe[1] = -1;
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+}
+
+void MetricsServer::serve() {
+    while (!stopping) {
+        pollfd fds[2] = {{signal_pipe[0], POLLIN, 0}, {listen_fd, POLLIN, 0}};
+        int ready = poll(fds, listen_fd >= 0 ? 2 : 1, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char buf[16];
+            ssize_t n = read(signal_pipe[0], buf, sizeof(buf));
+            bool dump = false;
+            for (ssize_t i = 0; i < n; i++) dump = dump || buf[i] == 'd';
+            if (dump && !stopping) {
+                std::string summary;
+                registry.render_summary(summary);
+                std::cerr << summary << std::flush;
+            }
+        }
+
+        if (listen_fd >= 0 && (fds[1].revents & POLLIN)) {
+            int client = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0) {
+                handle_client(client);
+                close(client);
+            }
+        }
+    }
+}
+
+void MetricsServer::handle_client(int fd) {
+    // Scrapes are rare and small: serve them one at a time, with timeouts
+    // so a stalled client cannot hold up the dump signal for long
+    timeval timeout = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        request.append(buf, n);
+    }
+
+    std::string body;
+    std::string status = "200 OK";
+    size_t line_end = request.find("\r\n");
+    std::string line = request.substr(0, line_end);
+    if (line.compare(0, 4, "GET ") != 0) {
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported\n";
+    } else {
+        std::string path = line.substr(4, line.find(' ', 4) - 4);
+        if (path == "/metrics" || path == "/") {
+            registry.render_prometheus(body);
+        } else {
+            status = "404 Not Found";
+            body = "Metrics are served at /metrics\n";
+        }
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    const char* data = response.data();
+    size_t left = response.size();
+    while (left > 0) {
+        ssize_t n = send(fd, data, left, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        data += n;
+        left -= n;
+    }
+}
+
+} // namespace CoTCommon
@@ -0,0 +1,205 @@
+#ifndef COT_METRICS_H
+#define COT_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CoTCommon {
+
+// Process-wide runtime metrics: counters, gauges and log2-bucketed
+// histograms, read out as Prometheus text (MetricsServer below).
+//
+// Counters and histograms are sharded per thread. Every thread that updates
+// a metric gets its own block of cells and is the only writer of it, so an
+// update is a plain load and store to a cache line no other thread writes:
+// no lock, no atomic read-modify-write. Readers sum the cells over all
+// blocks. A thread's block is handed to the next new thread when it exits,
+// so its counts are kept and memory stays bounded by the number of threads
+// alive at once.
+//
+// Registering returns a small handle. The same name and labels always
+// return the same metric, so modules can register lazily from function-
+// local statics.
+namespace detail {
+constexpr size_t METRIC_CELLS = 4096;
+
+struct MetricsShard {
+    std::atomic<uint64_t> cells[METRIC_CELLS];
+};
+
+extern thread_local MetricsShard* metrics_shard;
+MetricsShard* attach_metrics_shard();
+
+inline void metrics_add(uint32_t cell, uint64_t n) {
+    MetricsShard* shard = metrics_shard;
+    if (!shard) shard = attach_metrics_shard();
+    std::atomic<uint64_t>& c = shard->cells[cell];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+} // namespace detail
+
+// Steady-clock nanoseconds, for timing with Histogram::observe_since()
+inline uint64_t metrics_now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+class MetricsRegistry {
+public:
+    enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+    // Histogram cells: bucket 0 holds 0, bucket i holds [2^(i-1), 2^i)
+    static constexpr uint32_t HISTOGRAM_BUCKETS = 65;
+
+    // Handles registered when the cells ran out point at cell 0. The first
+    // cells are a scratch block as large as a histogram, so their updates
+    // stay out of other metrics' cells without a branch on the hot path.
+    static constexpr uint32_t SCRATCH_CELLS = HISTOGRAM_BUCKETS + 1;
+
+    class Counter {
+    public:
+        void add(uint64_t n = 1) const { detail::metrics_add(cell, n); }
+
+    private:
+        friend class MetricsRegistry;
+        uint32_t cell = 0;  // SCRATCH_CELLS: never exported
+    };
+
+    class Histogram {
+    public:
+        void observe(uint64_t value) const {
+            uint32_t bucket = value ? 64 - static_cast<uint32_t>(__builtin_clzll(value)) : 0;
+            detail::metrics_add(cell + bucket, 1);
+            detail::metrics_add(cell + HISTOGRAM_BUCKETS, value);
+        }
+
+        void observe_since(uint64_t start_ns) const { observe(metrics_now_ns() - start_ns); }
+
+    private:
+        friend class MetricsRegistry;
+        uint32_t cell = 0;
+    };
+
+    // Last-value metric shared by all threads (one atomic)
+    class Gauge {
+    public:
+        void set(int64_t value) const { target->store(value, std::memory_order_relaxed); }
+        void add(int64_t delta) const { target->fetch_add(delta, std::memory_order_relaxed); }
+
+    private:
+        friend class MetricsRegistry;
+        std::atomic<int64_t>* target = &discard;
+        static std::atomic<int64_t> discard;
+    };
+
+    static MetricsRegistry& global();
+
+    // labels is the Prometheus label list without braces, e.g. peer="a:8089"
+    Counter counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    // Values are recorded as integers (e.g. nanoseconds) and exported times
+    // scale (1e-9 for seconds). Buckets 2^first_bucket to 2^last_bucket are
+    // exported; the default range suits nanosecond timings (1 us to 69 s).
+    Histogram histogram(const std::string& name, const std::string& help, const std::string& labels = "",
+                        double scale = 1e-9, uint32_t first_bucket = 10, uint32_t last_bucket = 36);
+
+    // Value read at export time, e.g. a queue depth or another component's
+    // statistics. Returns an id for remove_callback(); the callback must
+    // stay valid until then.
+    uint64_t add_callback(const std::string& name, const std::string& help, const std::string& labels,
+                          Type type, std::function<double()> read);
+    void remove_callback(uint64_t id);
+
+    // Prometheus text exposition format 0.0.4
+    void render_prometheus(std::string& out) const;
+
+    // One line per metric; histograms as count, mean and percentiles
+    void render_summary(std::string& out) const;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+private:
+    struct Series {
+        std::string labels;
+        uint32_t cell;
+        std::atomic<int64_t>* gauge;
+        uint64_t callback_id;
+        std::function<double()> read;
+        double scale;
+        uint32_t first_bucket;
+        uint32_t last_bucket;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<Series> series;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Family> families;
+    std::map<std::string, size_t> family_index;
+    std::deque<std::atomic<int64_t>> gauges;
+    uint32_t next_cell;
+    uint64_t next_callback;
+
+    std::vector<detail::MetricsShard*> shards;
+    std::vector<detail::MetricsShard*> free_shards;
+
+    MetricsRegistry();
+
+    Series* find_or_add(const std::string& name, const std::string& help, const std::string& labels,
+                        Type type, bool& added);
+    uint32_t allocate_cells(uint32_t count, const std::string& name);
+    void drop_series(const std::string& name);
+    std::vector<uint64_t> collect() const;
+
+    friend detail::MetricsShard* detail::attach_metrics_shard();
+    friend struct ShardRelease;
+    detail::MetricsShard* acquire_shard();
+    void release_shard(detail::MetricsShard* shard);
+};
+
+// Serves the registry as Prometheus text over HTTP (GET /metrics) on a
+// local port, and writes a summary to stderr on SIGUSR1. Both are handled
+// on one background thread; the signal handler only writes to a pipe.
+class MetricsServer {
+public:
+    explicit MetricsServer(MetricsRegistry& metrics = MetricsRegistry::global());
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // http_port 0 serves only the SIGUSR1 dump
+    bool start(int http_port, const std::string& bind_address = "127.0.0.1");
+    void stop();
+
+    int get_port() const { return port; }
+
+private:
+    MetricsRegistry& registry;
+    int listen_fd;
+    int port;
+    int signal_pipe[2];
+    std::atomic<bool> stopping;
+    std::thread server_thread;
+
+    void serve();
+    void handle_client(int fd);
+};
+
+} // namespace CoTCommon
+
+#endif // COT_METRICS_H
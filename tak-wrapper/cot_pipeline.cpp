@@ -0,0 +1,247 @@
+#include "cot_pipeline.h"
+#include "cot_latency.h"
+
+#include <algorithm>
+
+namespace CoTCommon {
+
+// CoTFramer implementation
+CoTFramer::CoTFramer(size_t max_pending_bytes)
+    : consumed(0), max_pending(max_pending_bytes) {
+}
+
+void CoTFramer::append(const char* data, size_t len) {
+    buffer.append(data, len);
+}
+
+bool CoTFramer::next(std::string_view& event) {
+    COT_TRACE_SCOPE("frame");
+    // An event starts at whichever comes first: XML declaration or <event
+    size_t decl_start = buffer.find("<?xml", consumed);
+    size_t event_start = buffer.find("<event", consumed);
+    size_t start = std::min(decl_start, event_start);
+    if (start == std::string::npos) {
+        return false;
+    }
+
+    size_t end = buffer.find("</event>", start);
+    if (end == std::string::npos) {
+        consumed = start;  // Skip leading noise, wait for more data
+        return false;
+    }
+
+    end += 8;
+    event = std::string_view(buffer.data() + start, end - start);
+    consumed = end;
+    return true;
+}
+
+void CoTFramer::compact() {
+    if (consumed > 0) {
+        buffer.erase(0, consumed);
+        consumed = 0;
+    }
+
+    // Prevent buffer from growing too large
+    if (buffer.size() > max_pending) {
+        buffer.clear();
+    }
+}
+
+// ParsePipeline implementation
+void ParsePipeline::Batch::clear() {
+    data.clear();
+    events.clear();
+    output.clear();
+}
+
+ParsePipeline::Options ParsePipeline::normalize(Options opts) {
+    opts.workers = std::max<size_t>(1, opts.workers);
+    opts.batch_events = std::max<size_t>(1, opts.batch_events);
+    if (opts.batches_in_flight == 0) {
+        opts.batches_in_flight = opts.workers * 4;
+    }
+    return opts;
+}
+
+size_t ParsePipeline::shard_count() const {
+    return options.ordering == Ordering::PER_UID ? options.workers : 1;
+}
+
+size_t ParsePipeline::pool_size() const {
+    // Open batches (one per shard) come out of the same pool
+    return options.batches_in_flight + shard_count();
+}
+
+ParsePipeline::ParsePipeline(const Options& opts, Handler event_handler, Sink output_sink)
+    : options(normalize(opts)), handler(std::move(event_handler)), sink(std::move(output_sink)),
+      free_batches(pool_size()), done_queue(pool_size()), next_sequence(0), running(false),
+      reorder_depth(0), batch_count(0), event_count(0), error_count(0) {
+    for (size_t i = 0; i < pool_size(); i++) {
+        pool.emplace_back(new Batch());
+        free_batches.push(pool.back().get());
+    }
+
+    for (size_t i = 0; i < shard_count(); i++) {
+        input_queues.emplace_back(new BoundedQueue<Batch*>(pool_size()));
+    }
+    open_batches.assign(shard_count(), nullptr);
+}
+
+ParsePipeline::~ParsePipeline() {
+    stop();
+}
+
+void ParsePipeline::start() {
+    if (running) return;
+    running = true;
+
+    for (size_t i = 0; i < options.workers; i++) {
+        workers.emplace_back(&ParsePipeline::worker_loop, this, i);
+    }
+    sink_thread = std::thread(&ParsePipeline::sink_loop, this);
+}
+
+ParsePipeline::Batch* ParsePipeline::acquire_batch() {
+    Batch* batch = nullptr;
+    free_batches.pop(batch);  // Blocks when every batch is in flight (backpressure)
+    return batch;
+}
+
+void ParsePipeline::submit(std::string_view event, uint32_t source) {
+    size_t slot = 0;
+    if (options.ordering == Ordering::PER_UID) {
+        std::string_view uid = CoTParser::peek_attribute(event, "event", "uid");
+        slot = std::hash<std::string_view>()(uid) % options.workers;
+    }
+
+    Batch*& batch = open_batches[slot];
+    if (!batch) {
+        batch = acquire_batch();
+    }
+
+    batch->events.push_back(EventSpan{static_cast<uint32_t>(batch->data.size()),
+                                      static_cast<uint32_t>(event.size()), source});
+    batch->data.append(event.data(), event.size());
+
+    if (batch->events.size() >= options.batch_events) {
+        dispatch(slot);
+    }
+}
+
+void ParsePipeline::dispatch(size_t slot) {
+    Batch* batch = open_batches[slot];
+    if (!batch || batch->events.empty()) return;
+
+    batch->sequence = next_sequence++;
+    open_batches[slot] = nullptr;
+    input_queues[slot]->push(batch);
+}
+
+void ParsePipeline::flush() {
+    for (size_t slot = 0; slot < open_batches.size(); slot++) {
+        dispatch(slot);
+    }
+}
+
+void ParsePipeline::stop() {
+    if (!running) return;
+
+    flush();
+    for (auto& queue : input_queues) {
+        queue->close();
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    done_queue.close();
+    sink_thread.join();
+    running = false;
+}
+
+void ParsePipeline::worker_loop(size_t index) {
+    BoundedQueue<Batch*>& queue = *input_queues[options.ordering == Ordering::PER_UID ? index : 0];
+    if (!options.cpus.empty()) {
+        pin_thread(options.cpus[index % options.cpus.size()]);
+    }
+    CoTParser parser;
+    BatchArena arena;
+    CoTParser::CoTMessageView msg;
+
+    Batch* batch = nullptr;
+    while (queue.pop(batch)) {
+        COT_TRACE_SCOPE("parse_batch");
+        for (const auto& span : batch->events) {
+            std::string_view raw(batch->data.data() + span.offset, span.length);
+            try {
+                if (!parser.parse_view(raw, msg, arena)) {
+                    error_count.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                handler(msg, raw, span.source, batch->output);
+            } catch (const std::exception&) {
+                error_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        arena.reset();
+        event_count.fetch_add(batch->events.size(), std::memory_order_relaxed);
+        batch_count.fetch_add(1, std::memory_order_relaxed);
+        done_queue.push(batch);
+    }
+}
+
+void ParsePipeline::sink_loop() {
+    // Slots are indexed by sequence; at most pool.size() batches are in flight
+    std::vector<Batch*> reorder(pool.size(), nullptr);
+    uint64_t expected = 0;
+
+    auto emit = [this](Batch* batch) {
+        if (!batch->output.empty()) {
+            COT_TRACE_SCOPE("print");
+            sink(batch->output);
+        }
+        batch->clear();
+        free_batches.push(batch);
+    };
+
+    Batch* batch = nullptr;
+    while (done_queue.pop(batch)) {
+        if (options.ordering == Ordering::PER_UID) {
+            emit(batch);
+            continue;
+        }
+
+        reorder[batch->sequence % reorder.size()] = batch;
+        reorder_depth.fetch_add(1, std::memory_order_relaxed);
+
+        // Release every batch that is now in arrival order
+        while (true) {
+            Batch*& slot = reorder[expected % reorder.size()];
+            if (!slot || slot->sequence != expected) break;
+            Batch* ready = slot;
+            slot = nullptr;
+            reorder_depth.fetch_sub(1, std::memory_order_relaxed);
+            expected++;
+            emit(ready);
+        }
+    }
+}
+
+ParsePipeline::Stats ParsePipeline::stats() const {
+    Stats s;
+    s.input_queue_depth = 0;
+    for (const auto& queue : input_queues) {
+        s.input_queue_depth += queue->size();
+    }
+    s.reorder_pending = reorder_depth.load(std::memory_order_relaxed);
+    s.free_batches = free_batches.size();
+    s.batches = batch_count.load(std::memory_order_relaxed);
+    s.events = event_count.load(std::memory_order_relaxed);
+    s.parse_errors = error_count.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace CoTCommon
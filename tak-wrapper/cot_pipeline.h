@@ -0,0 +1,196 @@
+#ifndef COT_PIPELINE_H
+#define COT_PIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cot_common.h"
+
+namespace CoTCommon {
+
+// Splits a TCP byte stream into complete <event>...</event> documents.
+// Views returned by next() stay valid until the next append() or compact().
+class CoTFramer {
+private:
+    std::string buffer;
+    size_t consumed;
+    size_t max_pending;
+
+public:
+    explicit CoTFramer(size_t max_pending_bytes = 16384);
+
+    void append(const char* data, size_t len);
+
+    // Return the next complete event (including any XML declaration)
+    bool next(std::string_view& event);
+
+    // Drop consumed bytes; discard the remainder if it exceeds max_pending
+    void compact();
+
+    // Preallocate, so steady-state appends do not allocate
+    void reserve(size_t bytes) { buffer.reserve(bytes); }
+
+    size_t pending() const { return buffer.size() - consumed; }
+};
+
+// Mutex/condition variable queue with a fixed capacity
+template <typename T>
+class BoundedQueue {
+private:
+    mutable std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+
+public:
+    explicit BoundedQueue(size_t max_items) : capacity(max_items), closed(false) {}
+
+    // Blocks while full; returns false once the queue is closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Blocks while empty; returns false once closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+};
+
+// Listener processing pipeline: the I/O thread frames events into batches,
+// a worker pool parses, filters and formats them, and a single sink thread
+// writes the formatted output.
+//
+// ARRIVAL ordering restores the exact arrival order with a reorder stage in
+// front of the sink. PER_UID ordering shards events by UID so each unit's
+// updates stay in order without a global reorder (head-of-line) stage.
+class ParsePipeline {
+public:
+    enum class Ordering {
+        ARRIVAL,
+        PER_UID
+    };
+
+    struct Options {
+        size_t workers = 4;
+        Ordering ordering = Ordering::ARRIVAL;
+        size_t batch_events = 64;   // Events per batch before hand-off
+        size_t batches_in_flight = 0;  // 0 = four per worker
+        std::vector<int> cpus;      // Pin worker i to cpus[i % size]; empty = no pinning
+    };
+
+    // Runs on a worker: filter and format one event into out. source is the
+    // tag the event was submitted with (e.g. the feed it arrived on).
+    using Handler = std::function<void(const CoTParser::CoTMessageView& msg, std::string_view raw_xml,
+                                       uint32_t source, std::string& out)>;
+    // Runs on the sink thread with the formatted output of one batch
+    using Sink = std::function<void(const std::string& out)>;
+
+    struct Stats {
+        size_t input_queue_depth;    // Batches waiting for a worker
+        size_t reorder_pending;      // Finished batches waiting for their turn
+        size_t free_batches;         // Pooled batches available to the I/O thread
+        uint64_t batches;
+        uint64_t events;
+        uint64_t parse_errors;
+    };
+
+    ParsePipeline(const Options& opts, Handler event_handler, Sink output_sink);
+    ~ParsePipeline();
+
+    ParsePipeline(const ParsePipeline&) = delete;
+    ParsePipeline& operator=(const ParsePipeline&) = delete;
+
+    void start();
+
+    // Called from the I/O thread only
+    void submit(std::string_view event, uint32_t source = 0);
+
+    // Hand partially filled batches to the workers (end of a read)
+    void flush();
+
+    // Drain everything submitted so far and join all threads
+    void stop();
+
+    Stats stats() const;
+
+private:
+    struct EventSpan {
+        uint32_t offset;
+        uint32_t length;
+        uint32_t source;
+    };
+
+    struct Batch {
+        uint64_t sequence = 0;
+        std::string data;
+        std::vector<EventSpan> events;
+        std::string output;
+
+        void clear();
+    };
+
+    Options options;
+    Handler handler;
+    Sink sink;
+
+    std::vector<std::unique_ptr<Batch>> pool;
+    BoundedQueue<Batch*> free_batches;
+    std::vector<std::unique_ptr<BoundedQueue<Batch*>>> input_queues;  // One shared, or one per worker
+    BoundedQueue<Batch*> done_queue;
+
+    std::vector<Batch*> open_batches;  // Batches being filled by the I/O thread
+    uint64_t next_sequence;
+
+    std::vector<std::thread> workers;
+    std::thread sink_thread;
+    bool running;
+
+    std::atomic<size_t> reorder_depth;
+    std::atomic<uint64_t> batch_count;
+    std::atomic<uint64_t> event_count;
+    std::atomic<uint64_t> error_count;
+
+    static Options normalize(Options opts);
+    size_t shard_count() const;
+    size_t pool_size() const;
+    Batch* acquire_batch();
+    void dispatch(size_t slot);
+    void worker_loop(size_t index);
+    void sink_loop();
+};
+
+} // namespace CoTCommon
+
+#endif // COT_PIPELINE_H
@@ -0,0 +1,170 @@
+#include "cot_position.h"
+
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr uint64_t POW10[] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+                              100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+                              10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+                              10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+                              10000000000000000000ULL};
+
+// Powers of ten that are exact doubles
+constexpr double EXACT_POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+constexpr int MAX_DIGITS = 19;
+constexpr int32_t MAX_EXPONENT = 100000;  // Far past any double; keeps the arithmetic in range
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// One numeric attribute of <point>: empty keeps the defaults
+bool decode_field(std::string_view text, int decimals, double limit, double& value, int64_t& fixed) {
+    if (text.empty()) return true;
+    DecimalNumber number;
+    if (!parse_decimal(text, number)) return false;
+    double parsed = number.to_double();
+    if (!(std::fabs(parsed) <= limit) || !number.to_fixed(decimals, fixed)) return false;
+    value = parsed;
+    return true;
+}
+
+bool decode_error(std::string_view text, uint16_t& error) {
+    if (text.empty()) return true;
+    DecimalNumber number;
+    if (!parse_decimal(text, number) || (number.negative && number.digits != 0)) return false;
+    error = CompactPosition::error_from_meters(number.to_double());
+    return true;
+}
+
+} // namespace
+
+bool CompactPosition::from_degrees(double latitude, double longitude, double hae, CompactPosition& out) {
+    // Negated comparisons also reject NaN
+    if (!(std::fabs(latitude) <= 90.0) || !(std::fabs(longitude) <= 180.0) ||
+        !(std::fabs(hae) * METER <= static_cast<double>(INT32_MAX))) {
+        return false;
+    }
+    out = CompactPosition();
+    out.lat = static_cast<int32_t>(std::llround(latitude * DEGREE));
+    out.lon = static_cast<int32_t>(std::llround(longitude * DEGREE));
+    out.hae = static_cast<int32_t>(std::llround(hae * METER));
+    return true;
+}
+
+uint16_t CompactPosition::error_from_meters(double meters) {
+    return meters >= 0.0 && meters < UNKNOWN_ERROR - 0.5 ? static_cast<uint16_t>(std::lround(meters)) : UNKNOWN_ERROR;
+}
+
+double DecimalNumber::to_double() const {
+    // Both operands are exact doubles, so one IEEE multiply or divide gives
+    // the correctly rounded result (Clinger's fast path). That covers
+    // everything CoT senders write; the rest goes through from_chars.
+    double value;
+    if (digits == 0) {
+        value = 0.0;
+    } else if (exact && digits <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        value = static_cast<double>(digits);
+        value = exponent < 0 ? value / EXACT_POW10[-exponent] : value * EXACT_POW10[exponent];
+    } else {
+        std::string_view unsigned_text = text.substr(text[0] == '-' || text[0] == '+' ? 1 : 0);
+        auto result = std::from_chars(unsigned_text.data(), unsigned_text.data() + unsigned_text.size(), value);
+        if (result.ec == std::errc::result_out_of_range) {
+            value = exponent > 0 ? std::numeric_limits<double>::infinity() : 0.0;
+        }
+    }
+    return negative ? -value : value;
+}
+
+bool DecimalNumber::to_fixed(int decimals, int64_t& value) const {
+    int64_t shift = static_cast<int64_t>(exponent) + decimals;
+    uint64_t magnitude;
+    if (digits == 0 || shift < -MAX_DIGITS) {
+        magnitude = 0;
+    } else if (shift >= 0) {
+        if (shift > MAX_DIGITS || digits > std::numeric_limits<uint64_t>::max() / POW10[shift]) return false;
+        magnitude = digits * POW10[shift];
+    } else {
+        uint64_t scale = POW10[-shift];
+        uint64_t remainder = digits % scale;
+        magnitude = digits / scale + (remainder >= scale - remainder ? 1 : 0);
+    }
+    if (magnitude > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) return false;
+    value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+bool parse_decimal(std::string_view text, DecimalNumber& number) {
+    number = DecimalNumber();
+    number.text = text;
+    const char* p = text.data();
+    const char* end = p + text.size();
+    if (p < end && (*p == '-' || *p == '+')) {
+        number.negative = *p == '-';
+        p++;
+    }
+
+    // Leading zeros are skipped; past 19 significant digits, integer digits
+    // only raise the exponent and fraction digits are dropped
+    int significant = 0;
+    bool any = false;
+    bool fraction = false;
+    for (; p < end; p++) {
+        if (*p == '.' && !fraction) {
+            fraction = true;
+            continue;
+        }
+        if (!is_digit(*p)) break;
+        any = true;
+        int digit = *p - '0';
+        if (significant == 0 && digit == 0) {
+            number.exponent -= fraction;
+        } else if (significant < MAX_DIGITS) {
+            number.digits = number.digits * 10 + static_cast<uint64_t>(digit);
+            number.exponent -= fraction;
+            significant++;
+        } else {
+            number.exponent += !fraction;
+            number.exact = number.exact && digit == 0;
+        }
+    }
+    if (!any) return false;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negative_exponent = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) p++;
+        if (p == end || !is_digit(*p)) return false;
+        int32_t exponent = 0;
+        for (; p < end && is_digit(*p); p++) {
+            if (exponent < MAX_EXPONENT) exponent = exponent * 10 + (*p - '0');
+        }
+        number.exponent += negative_exponent ? -exponent : exponent;
+    }
+    return p == end;
+}
+
+bool decode_point(std::string_view lat, std::string_view lon, std::string_view hae, std::string_view ce,
+                  std::string_view le, double& latitude, double& longitude, double& height,
+                  CompactPosition& position) {
+    position = CompactPosition();
+    int64_t lat_fixed = 0, lon_fixed = 0, hae_fixed = 0;
+    if (!decode_field(lat, 7, 90.0, latitude, lat_fixed) || !decode_field(lon, 7, 180.0, longitude, lon_fixed) ||
+        !decode_field(hae, 1, INT32_MAX / 10.0, height, hae_fixed) || !decode_error(ce, position.ce) ||
+        !decode_error(le, position.le)) {
+        return false;
+    }
+    position.lat = static_cast<int32_t>(lat_fixed);
+    position.lon = static_cast<int32_t>(lon_fixed);
+    position.hae = static_cast<int32_t>(hae_fixed);
+    return true;
+}
+
+} // namespace CoTCommon
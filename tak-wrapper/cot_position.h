@@ -0,0 +1,76 @@
+#ifndef COT_POSITION_H
+#define COT_POSITION_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace CoTCommon {
+
+// Received positions as integers: 1e-7 degree (about 1.1 cm) for latitude
+// and longitude, decimeters for height and whole meters for the circular
+// and linear error. Sixteen bytes against the 40 of five doubles, and
+// comparisons, hashing and deltas are integer operations.
+//
+// The doubles are exactly recoverable: latitude() is the double nearest
+// lat / 1e7, and from_degrees(latitude(), ...) gives back the same lat.
+struct CompactPosition {
+    static constexpr int32_t DEGREE = 10000000;             // lat/lon units per degree
+    static constexpr int32_t METER = 10;                    // hae units per meter
+    static constexpr uint16_t UNKNOWN_ERROR = UINT16_MAX;   // ce/le 9999999 (CoT's "unknown")
+
+    int32_t lat = 0;
+    int32_t lon = 0;
+    int32_t hae = 0;
+    uint16_t ce = UNKNOWN_ERROR;
+    uint16_t le = UNKNOWN_ERROR;
+
+    double latitude() const { return static_cast<double>(lat) / DEGREE; }
+    double longitude() const { return static_cast<double>(lon) / DEGREE; }
+    double height() const { return static_cast<double>(hae) / METER; }
+
+    bool operator==(const CompactPosition& other) const {
+        return lat == other.lat && lon == other.lon && hae == other.hae && ce == other.ce && le == other.le;
+    }
+
+    // Nearest compact position; false if a value is not finite or out of
+    // range (|lat| > 90, |lon| > 180, |hae| > 214,748 km)
+    static bool from_degrees(double latitude, double longitude, double hae, CompactPosition& out);
+
+    // ce/le in whole meters; 65535 and above, negative or NaN are unknown
+    static uint16_t error_from_meters(double meters);
+};
+
+static_assert(sizeof(CompactPosition) == 16, "CompactPosition is stored in tracks and snapshots");
+
+// A decimal number as significant digits and a power of ten, scanned once
+// and converted to a double or a fixed-point integer as needed
+struct DecimalNumber {
+    uint64_t digits = 0;        // First 19 significant digits
+    int32_t exponent = 0;       // Value is digits * 10^exponent
+    bool negative = false;
+    bool exact = true;          // False if nonzero digits past the 19th were dropped
+    std::string_view text;
+
+    // Correctly rounded, like strtod
+    double to_double() const;
+
+    // Rounded to a multiple of 10^-decimals, halves away from zero; false
+    // if it does not fit in an int64
+    bool to_fixed(int decimals, int64_t& value) const;
+};
+
+// Strict decimal syntax: an optional sign, digits with an optional point,
+// and an optional exponent ("-104.9903", "1e-3"). Unlike strtod there is no
+// locale, leading whitespace, trailing text, hex, "inf" or "nan".
+bool parse_decimal(std::string_view text, DecimalNumber& number);
+
+// Decode a <point>'s attribute values into doubles and a CompactPosition.
+// Empty values keep the defaults (0, unknown error). False if a value is
+// malformed or out of range, or ce/le is negative.
+bool decode_point(std::string_view lat, std::string_view lon, std::string_view hae, std::string_view ce,
+                  std::string_view le, double& latitude, double& longitude, double& height,
+                  CompactPosition& position);
+
+} // namespace CoTCommon
+
+#endif // COT_POSITION_H
@@ -0,0 +1,685 @@
+#include "cot_query.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/un.h>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr size_t MAX_CLIENT_INPUT = 64 * 1024;
+constexpr int EXPIRE_INTERVAL_MS = 1000;
+
+bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool fill_unix_address(const std::string& path, struct sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+// A port number selects loopback TCP; anything else is a socket path
+bool is_port(const std::string& endpoint) {
+    if (endpoint.empty() || endpoint.size() > 5) return false;
+    for (char c : endpoint) {
+        if (c < '0' || c > '9') return false;
+    }
+    return true;
+}
+
+void append_event(std::string& out, std::string_view xml) {
+    out += "EVENT ";
+    out += std::to_string(xml.size());
+    out += '\n';
+    out.append(xml.data(), xml.size());
+    out += '\n';
+}
+
+// One bbox corner coordinate in CompactPosition units
+bool parse_coordinate(std::string_view text, double limit, int32_t& value) {
+    DecimalNumber number;
+    int64_t fixed;
+    if (!parse_decimal(text, number) || !(std::abs(number.to_double()) <= limit) || !number.to_fixed(7, fixed)) {
+        return false;
+    }
+    value = static_cast<int32_t>(fixed);
+    return true;
+}
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// QueryFilter implementation
+bool QueryFilter::parse(std::string_view args, QueryFilter& filter, std::string& error) {
+    filter = QueryFilter();
+    size_t pos = 0;
+    while (pos < args.size()) {
+        if (args[pos] == ' ') {
+            pos++;
+            continue;
+        }
+        size_t end = args.find(' ', pos);
+        if (end == std::string_view::npos) end = args.size();
+        std::string_view term = args.substr(pos, end - pos);
+        pos = end;
+
+        size_t eq = term.find('=');
+        if (eq == std::string_view::npos || eq + 1 == term.size()) {
+            error = "expected key=value: " + std::string(term);
+            return false;
+        }
+        std::string_view key = term.substr(0, eq);
+        std::string_view value = term.substr(eq + 1);
+
+        if (key == "type") {
+            size_t start = 0;
+            while (true) {
+                size_t comma = value.find(',', start);
+                std::string_view pattern = value.substr(start, comma - start);
+                if (!pattern.empty()) filter.types.emplace_back(pattern);
+                if (comma == std::string_view::npos) break;
+                start = comma + 1;
+            }
+        } else if (key == "team") {
+            // Never interned: clients must not be able to fill the table
+            filter.team.assign(value.data(), value.size());
+            filter.team_id = StringInterner::global().find(value);
+            filter.has_team = true;
+        } else if (key == "bbox") {
+            std::string_view parts[4];
+            size_t count = 0, start = 0;
+            while (count < 4) {
+                size_t comma = value.find(',', start);
+                parts[count++] = value.substr(start, comma - start);
+                if (comma == std::string_view::npos) break;
+                start = comma + 1;
+            }
+            if (count != 4 || value.find(',', start) != std::string_view::npos ||
+                !parse_coordinate(parts[0], 90.0, filter.south) || !parse_coordinate(parts[1], 180.0, filter.west) ||
+                !parse_coordinate(parts[2], 90.0, filter.north) || !parse_coordinate(parts[3], 180.0, filter.east) ||
+                filter.south > filter.north) {
+                error = "expected bbox=<south>,<west>,<north>,<east>";
+                return false;
+            }
+            filter.has_bbox = true;
+        } else {
+            error = "unknown filter: " + std::string(key);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool QueryFilter::matches(StringInterner::Id type, std::string_view type_str, StringInterner::Id event_team,
+                          std::string_view event_team_str, const CompactPosition& position) const {
+    if (has_team) {
+        bool same = team_id != StringInterner::EMPTY && event_team != StringInterner::EMPTY
+                        ? event_team == team_id
+                        : event_team_str == team;
+        if (!same) return false;
+    }
+
+    if (has_bbox) {
+        if (position.lat < south || position.lat > north) return false;
+        bool inside = west <= east ? position.lon >= west && position.lon <= east
+                                   : position.lon >= west || position.lon <= east;
+        if (!inside) return false;
+    }
+
+    if (types.empty()) return true;
+    auto match_type = [this, type_str]() {
+        for (const auto& pattern : types) {
+            if (match_cot_type(pattern, type_str)) return true;
+        }
+        return false;
+    };
+    if (type == StringInterner::EMPTY) {
+        return match_type();  // Spilled: no ID to cache under
+    }
+    if (type >= type_cache.size()) {
+        type_cache.resize(type + 1, 0);
+    }
+    if (type_cache[type] == 0) {
+        type_cache[type] = match_type() ? 1 : 2;
+    }
+    return type_cache[type] == 1;
+}
+
+// QueryServer implementation
+QueryServer::QueryServer(const Options& server_options)
+    : options(server_options), listen_fd(-1), wake_fds{-1, -1}, stopping(false), wake_pending(false),
+      next_client_id(1), counters{}, published_stats{} {
+    MetricsRegistry& metrics = MetricsRegistry::global();
+    std::string labels = "endpoint=\"" + endpoint() + "\"";
+    published_metric = metrics.counter("cot_query_published_events_total", "Track versions offered to subscribers",
+                                       labels);
+    delivered_metric = metrics.counter("cot_query_delivered_events_total", "Events queued to query clients", labels);
+    resyncs_metric = metrics.counter("cot_query_resyncs_total", "Subscribers that fell behind and were resynced",
+                                     labels);
+    dropped_metric = metrics.counter("cot_query_dropped_events_total", "Events dropped from slow subscribers' queues",
+                                     labels);
+    clients_metric = metrics.gauge("cot_query_clients", "Connected query clients", labels);
+    subscribers_metric = metrics.gauge("cot_query_subscribers", "Query clients streaming live events", labels);
+}
+
+QueryServer::~QueryServer() {
+    stop();
+    for (auto& client : clients) {
+        close(client->fd);
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        if (!options.socket_path.empty()) unlink(options.socket_path.c_str());
+    }
+    for (int fd : wake_fds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+std::string QueryServer::endpoint() const {
+    return options.socket_path.empty() ? "127.0.0.1:" + std::to_string(options.port) : options.socket_path;
+}
+
+bool QueryServer::start() {
+    if (server_thread.joinable()) return true;
+
+    if (pipe(wake_fds) < 0) {
+        std::cerr << "Error creating query wake pipe\n";
+        return false;
+    }
+    set_nonblocking(wake_fds[0]);
+    set_nonblocking(wake_fds[1]);
+
+    if (!options.socket_path.empty()) {
+        struct sockaddr_un addr;
+        if (!fill_unix_address(options.socket_path, addr)) {
+            return false;
+        }
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd >= 0) {
+            unlink(options.socket_path.c_str());  // Remove a stale socket from a previous run
+            if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listen_fd, 128) < 0) {
+                close(listen_fd);
+                listen_fd = -1;
+            }
+        }
+    } else if (options.port > 0) {
+        // Loopback only: the API is for consumers on this host
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd >= 0) {
+            int on = 1;
+            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            struct sockaddr_in addr {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(options.port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listen_fd, 128) < 0) {
+                close(listen_fd);
+                listen_fd = -1;
+            }
+        }
+    } else {
+        std::cerr << "Query server needs a socket path or a port\n";
+        return false;
+    }
+
+    if (listen_fd < 0) {
+        std::cerr << "Error binding query endpoint " << endpoint() << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    set_nonblocking(listen_fd);
+
+    stopping = false;
+    server_thread = std::thread(&QueryServer::serve, this);
+    return true;
+}
+
+void QueryServer::stop() {
+    if (!server_thread.joinable()) return;
+    stopping = true;
+    wake();
+    server_thread.join();
+    publish_metrics();
+}
+
+void QueryServer::wake() {
+    char byte = 0;
+    ssize_t written = write(wake_fds[1], &byte, 1);  // A full pipe means poll is already woken
+    (void)written;
+}
+
+void QueryServer::publish(const CoTParser::CoTMessageView& msg, std::string_view raw_xml) {
+    if (raw_xml.empty()) return;
+
+    // Parse outside the lock
+    int64_t time_ms;
+    bool timed = parse_cot_time(msg.time, time_ms);
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t holder;
+        if (timed && store.update(msg, raw_xml, time_ms, 0, holder) != TrackStore::Result::NEWER) {
+            return;
+        }
+        counters.published++;
+
+        for (auto& client : clients) {
+            if (!client->subscribed || client->resync ||
+                !client->filter.matches(msg.type, msg.type_str(), msg.team, msg.team_str(), msg.position)) {
+                continue;
+            }
+
+            // Too far behind: drop the queue rather than grow it, and
+            // resend the picture once the client has caught up
+            if (client->queued.size() + raw_xml.size() > options.max_queue_bytes) {
+                client->dropped += client->queued_events + 1;
+                counters.dropped += client->queued_events + 1;
+                counters.resyncs++;
+                client->queued.clear();
+                client->queued_events = 0;
+                client->resync = true;
+                queued = true;
+                continue;
+            }
+            append_event(client->queued, raw_xml);
+            client->queued_events++;
+            counters.delivered++;
+            queued = true;
+        }
+    }
+
+    // One wake-up per poll round, however many events arrive
+    if (queued && !wake_pending.exchange(true)) {
+        wake();
+    }
+}
+
+void QueryServer::serve() {
+    std::vector<struct pollfd> fds;
+    std::vector<Client*> polled;
+    auto last_expire = std::chrono::steady_clock::now();
+
+    while (!stopping) {
+        publish_metrics();
+        fds.clear();
+        polled.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        fds.push_back({wake_fds[0], POLLIN, 0});
+        for (auto& client : clients) {
+            // A closing client only drains its reply: its reads would
+            // return 0 at once and spin the loop
+            short events = client->closing ? 0 : POLLIN;
+            if (!client->sending.empty()) events |= POLLOUT;
+            fds.push_back({client->fd, events, 0});
+            polled.push_back(client.get());
+        }
+
+        int ready = poll(fds.data(), fds.size(), 200);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Query poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            accept_clients();
+        }
+        if (fds[1].revents & POLLIN) {
+            char drain[256];
+            while (read(wake_fds[0], drain, sizeof(drain)) > 0) {}
+            wake_pending = false;
+        }
+        for (size_t i = 0; i < polled.size(); i++) {
+            if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) {
+                read_client(*polled[i]);
+            }
+        }
+
+        for (auto& client : clients) {
+            write_client(*client);
+        }
+
+        if (options.expire && std::chrono::steady_clock::now() - last_expire >=
+                                  std::chrono::milliseconds(EXPIRE_INTERVAL_MS)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            store.expire(now_ms());
+            last_expire = std::chrono::steady_clock::now();
+        }
+
+        // Subscribers stay until they hang up; everyone else once answered
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = clients.size(); i-- > 0;) {
+            if (clients[i]->closing && clients[i]->sending.empty()) {
+                close(clients[i]->fd);
+                clients.erase(clients.begin() + i);
+            }
+        }
+    }
+}
+
+void QueryServer::accept_clients() {
+    while (true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) break;
+        set_nonblocking(fd);
+
+        std::unique_ptr<Client> client(new Client{});
+        client->fd = fd;
+        client->id = next_client_id++;
+        std::lock_guard<std::mutex> lock(mutex);
+        clients.push_back(std::move(client));
+    }
+}
+
+void QueryServer::read_client(Client& client) {
+    char buffer[4096];
+
+    while (!client.closing) {
+        ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            // A subscription only streams; further requests are ignored
+            if (!client.subscribed) client.input.append(buffer, n);
+            if (client.input.size() > MAX_CLIENT_INPUT) {
+                client.closing = true;
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+
+        // Peer closed; still answer what it already sent
+        client.closing = true;
+    }
+
+    handle_requests(client);
+    if (client.closing && client.subscribed) {
+        // Nobody is reading the stream any more
+        client.sending.clear();
+    }
+}
+
+void QueryServer::handle_requests(Client& client) {
+    size_t pos = 0;
+
+    while (!client.subscribed) {
+        size_t newline = client.input.find('\n', pos);
+        if (newline == std::string::npos) break;
+
+        std::string line = client.input.substr(pos, newline - pos);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        pos = newline + 1;
+
+        std::string_view command = line;
+        std::string_view args;
+        size_t space = command.find(' ');
+        if (space != std::string_view::npos) {
+            args = command.substr(space + 1);
+            command = command.substr(0, space);
+        }
+
+        if (command == "QUERY" || command == "SUBSCRIBE") {
+            QueryFilter filter;
+            std::string error;
+            if (!QueryFilter::parse(args, filter, error)) {
+                client.sending += "ERR " + error + "\n";
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            counters.queries++;
+            client.filter = std::move(filter);
+            append_snapshot(client, client.sending);
+            if (command == "QUERY") {
+                client.sending += "END\n";
+            } else {
+                // From here on publish() queues this client's events
+                client.sending += "LIVE\n";
+                client.subscribed = true;
+            }
+        } else if (command == "TRAIL") {
+            append_trail(args, client.sending);
+        } else if (command == "STATS" && args.empty()) {
+            client.sending += stats_line() + "\n";
+        } else if (command == "PING" && args.empty()) {
+            client.sending += "PONG\n";
+        } else if (!line.empty()) {
+            client.sending += "ERR unknown command\n";
+        }
+    }
+
+    client.input.erase(0, pos);
+}
+
+void QueryServer::append_trail(std::string_view args, std::string& out) const {
+    if (!options.trails) {
+        out += "ERR no trails kept (start the listener with --history)\n";
+        return;
+    }
+
+    size_t space = args.find(' ');
+    std::string_view uid = args.substr(0, space);
+    int64_t from_ms = INT64_MIN;
+    int64_t to_ms = INT64_MAX;
+    double tolerance_m = 0;
+    while (space != std::string_view::npos) {
+        args = args.substr(space + 1);
+        space = args.find(' ');
+        std::string_view term = args.substr(0, space);
+        size_t equals = term.find('=');
+        std::string_view key = term.substr(0, equals);
+        std::string_view value = equals == std::string_view::npos ? std::string_view() : term.substr(equals + 1);
+        if (term.empty()) continue;
+
+        bool valid = false;
+        if (key == "from" || key == "to") {
+            int64_t& time_ms = key == "from" ? from_ms : to_ms;
+            auto result = std::from_chars(value.data(), value.data() + value.size(), time_ms);
+            valid = (result.ec == std::errc() && result.ptr == value.data() + value.size()) ||
+                    parse_cot_time(value, time_ms);
+        } else if (key == "tolerance") {
+            DecimalNumber number;
+            valid = parse_decimal(value, number) && number.to_double() >= 0;
+            tolerance_m = valid ? number.to_double() : 0;
+        }
+        if (!valid) {
+            out += "ERR bad trail term '" + std::string(term) + "'\n";
+            return;
+        }
+    }
+    if (uid.empty()) {
+        out += "ERR TRAIL needs a uid\n";
+        return;
+    }
+
+    std::vector<TrailPoint> trail;
+    if (!options.trails->trail(uid, from_ms, to_ms, tolerance_m, trail)) {
+        out += "ERR no trail for " + std::string(uid) + "\n";
+        return;
+    }
+    out += "TRAIL " + std::to_string(trail.size()) + "\n";
+    char line[96];
+    for (const TrailPoint& point : trail) {
+        snprintf(line, sizeof(line), "%lld %.7f %.7f %.1f\n", static_cast<long long>(point.time_ms),
+                 point.position.latitude(), point.position.longitude(), point.position.height());
+        out += line;
+    }
+    out += "END\n";
+}
+
+void QueryServer::append_snapshot(Client& client, std::string& out) {
+    std::string events;
+    size_t count = 0;
+    for (const auto& track : store.tracks()) {
+        if (client.filter.matches(track.type.id, track.type.view(), track.team.id, track.team.view(), track.position)) {
+            append_event(events, track.xml);
+            count++;
+        }
+    }
+    counters.delivered += count;
+    out += "SNAPSHOT " + std::to_string(count) + "\n";
+    out += events;
+}
+
+void QueryServer::write_client(Client& client) {
+    while (!client.closing || !client.sending.empty()) {
+        if (client.sending.empty()) {
+            // The socket has taken everything so far: hand over the queue,
+            // or the fresh picture for a client that fell behind
+            if (!client.subscribed) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (client.resync) {
+                client.sending = "RESYNC " + std::to_string(client.dropped) + "\n";
+                append_snapshot(client, client.sending);
+                client.sending += "LIVE\n";
+                client.resync = false;
+                client.dropped = 0;
+            } else {
+                client.sending.swap(client.queued);
+                client.queued_events = 0;
+            }
+            if (client.sending.empty()) return;
+        }
+
+        ssize_t sent = ::send(client.fd, client.sending.data(), client.sending.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent > 0) {
+            client.sending.erase(0, sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+
+        client.sending.clear();
+        client.closing = true;
+        return;
+    }
+}
+
+QueryServer::Stats QueryServer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s = counters;
+    s.clients = clients.size();
+    s.subscribers = 0;
+    for (const auto& client : clients) {
+        if (client->subscribed) s.subscribers++;
+    }
+    s.tracks = store.size();
+    return s;
+}
+
+void QueryServer::publish_metrics() {
+    Stats s = stats();
+    published_metric.add(s.published - published_stats.published);
+    delivered_metric.add(s.delivered - published_stats.delivered);
+    resyncs_metric.add(s.resyncs - published_stats.resyncs);
+    dropped_metric.add(s.dropped - published_stats.dropped);
+    clients_metric.set(static_cast<int64_t>(s.clients));
+    subscribers_metric.set(static_cast<int64_t>(s.subscribers));
+    published_stats = s;
+}
+
+std::string QueryServer::stats_line() {
+    Stats s = stats();
+    return "STATS clients=" + std::to_string(s.clients) + " subscribers=" + std::to_string(s.subscribers) +
+           " tracks=" + std::to_string(s.tracks) + " published=" + std::to_string(s.published) +
+           " delivered=" + std::to_string(s.delivered) + " queries=" + std::to_string(s.queries) +
+           " resyncs=" + std::to_string(s.resyncs) + " dropped=" + std::to_string(s.dropped);
+}
+
+// QueryClient implementation
+bool QueryClient::connect(const std::string& endpoint) {
+    if (is_port(endpoint)) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(std::stoi(endpoint)));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0 && ::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            return true;
+        }
+    } else {
+        struct sockaddr_un addr;
+        if (!fill_unix_address(endpoint, addr)) {
+            return false;
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && ::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            return true;
+        }
+    }
+
+    std::cerr << "Error connecting to query endpoint " << endpoint << ": " << strerror(errno) << std::endl;
+    disconnect();
+    return false;
+}
+
+void QueryClient::disconnect() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool QueryClient::send_command(const std::string& command) {
+    std::string line = command + "\n";
+    return send_all(fd, line.data(), line.size());
+}
+
+bool QueryClient::read_message(std::string& line, std::string& xml) {
+    while (true) {
+        size_t newline = input.find('\n');
+        if (newline != std::string::npos) {
+            if (input.compare(0, 6, "EVENT ") != 0) {
+                line = input.substr(0, newline);
+                xml.clear();
+                input.erase(0, newline + 1);
+                return true;
+            }
+            size_t length = std::strtoull(input.c_str() + 6, nullptr, 10);
+            size_t need = newline + 1 + length + 1;
+            if (input.size() >= need) {
+                line = input.substr(0, newline);
+                xml.assign(input, newline + 1, length);
+                input.erase(0, need);
+                return true;
+            }
+        }
+
+        char buffer[65536];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        input.append(buffer, n);
+    }
+}
+
+} // namespace CoTCommon
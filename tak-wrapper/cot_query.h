@@ -0,0 +1,184 @@
+#ifndef COT_QUERY_H
+#define COT_QUERY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cot_common.h"
+#include "cot_history.h"
+#include "cot_merge.h"
+#include "cot_metrics.h"
+
+namespace CoTCommon {
+
+// Which tracks a query client wants: any of several type patterns, one team
+// and a bounding box. An empty filter matches everything.
+struct QueryFilter {
+    std::vector<std::string> types;          // match_cot_type() patterns
+    std::string team;
+    StringInterner::Id team_id = StringInterner::EMPTY;  // EMPTY if the team was unknown when parsed
+    bool has_team = false;
+    bool has_bbox = false;
+    int32_t south = 0, west = 0, north = 0, east = 0;  // CompactPosition units; west > east crosses 180
+
+    // Parse "type=a-f-*,a-h-* team=Cyan bbox=<south>,<west>,<north>,<east>"
+    static bool parse(std::string_view args, QueryFilter& filter, std::string& error);
+
+    // Type results are cached per interned type, so calls must be serialised.
+    // The strings are compared whenever either side has no interned ID.
+    bool matches(StringInterner::Id type, std::string_view type_str, StringInterner::Id event_team,
+                 std::string_view event_team_str, const CompactPosition& position) const;
+
+private:
+    mutable std::vector<uint8_t> type_cache;  // By type ID: 0 unknown, 1 match, 2 no match
+};
+
+// Local query and subscription API over the live track picture, served on a
+// Unix domain socket or a loopback TCP port. Requests are newline-terminated
+// commands:
+//
+//   QUERY [filter]\n       snapshot of the current tracks, then END
+//   SUBSCRIBE [filter]\n   snapshot, then LIVE and every newer version of a
+//                          matching track as it is published
+//   TRAIL <uid> [from=<time>] [to=<time>] [tolerance=<m>]\n
+//                          the track's recent path from a TrackHistory:
+//                          "TRAIL <n>", n lines "<time_ms> <lat> <lon> <hae>"
+//                          oldest first, then END. Times are epoch
+//                          milliseconds or CoT timestamps.
+//   STATS\n
+//   PING\n
+//
+// A snapshot is "SNAPSHOT <n>" followed by n events; every event is
+// "EVENT <length>\n<length bytes of CoT XML>\n". The snapshot and the attach
+// of a subscription happen under one lock with publish(), so the live stream
+// continues exactly where the snapshot ends.
+//
+// Each subscriber has its own bounded queue. A client that falls more than
+// max_queue_bytes behind loses its queued events and, once it has drained
+// what was already on its socket, gets "RESYNC <dropped>" and a fresh
+// snapshot, so it never sees a gap without knowing. Publishers never block
+// on a slow client.
+class QueryServer {
+public:
+    struct Options {
+        std::string socket_path;      // Unix socket, or
+        int port = 0;                 // loopback TCP port
+        size_t max_queue_bytes = 4 * 1024 * 1024;
+        bool expire = true;           // Drop tracks past their stale time
+        const TrackHistory* trails = nullptr;  // Answers TRAIL; fed by the caller
+    };
+
+    struct Stats {
+        uint64_t clients;        // Currently connected
+        uint64_t subscribers;    // Of those, streaming live events
+        uint64_t tracks;
+        uint64_t published;      // New track versions and untimed events
+        uint64_t delivered;      // Events queued to subscribers, snapshots included
+        uint64_t queries;        // QUERY and SUBSCRIBE requests
+        uint64_t resyncs;        // Subscribers that fell behind
+        uint64_t dropped;        // Events dropped from their queues
+    };
+
+    explicit QueryServer(const Options& options);
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // Bind the endpoint and serve clients on a background thread
+    bool start();
+    void stop();
+
+    // Thread-safe. Keeps msg if it is its track's newest version and passes
+    // it to every matching subscriber; untimed events are passed on without
+    // being kept.
+    void publish(const CoTParser::CoTMessageView& msg, std::string_view raw_xml);
+
+    Stats stats() const;
+    std::string endpoint() const;
+
+private:
+    struct Client {
+        int fd;
+        uint64_t id;
+        std::string input;
+        std::string sending;    // Owned by the server thread
+        bool subscribed;
+        bool closing;
+        QueryFilter filter;
+
+        // Guarded by mutex
+        std::string queued;
+        size_t queued_events;
+        uint64_t dropped;       // Since the last resync
+        bool resync;
+    };
+
+    Options options;
+    int listen_fd;
+    int wake_fds[2];
+    std::atomic<bool> stopping;
+    std::thread server_thread;
+
+    mutable std::mutex mutex;
+    TrackStore store;
+    std::vector<std::unique_ptr<Client>> clients;
+    std::atomic<bool> wake_pending;
+    uint64_t next_client_id;
+    Stats counters;
+
+    Stats published_stats;
+    MetricsRegistry::Counter published_metric;
+    MetricsRegistry::Counter delivered_metric;
+    MetricsRegistry::Counter resyncs_metric;
+    MetricsRegistry::Counter dropped_metric;
+    MetricsRegistry::Gauge clients_metric;
+    MetricsRegistry::Gauge subscribers_metric;
+
+    void serve();
+    void accept_clients();
+    void read_client(Client& client);
+    void handle_requests(Client& client);
+    void write_client(Client& client);
+    void wake();
+
+    // Append the filtered picture; called with mutex held
+    void append_snapshot(Client& client, std::string& out);
+    void append_trail(std::string_view args, std::string& out) const;
+    void publish_metrics();
+    std::string stats_line();
+};
+
+// Blocking client for a query endpoint: a Unix socket path, or a port
+// number for 127.0.0.1
+class QueryClient {
+private:
+    int fd;
+    std::string input;
+
+public:
+    QueryClient() : fd(-1) {}
+    ~QueryClient() { disconnect(); }
+
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    bool connect(const std::string& endpoint);
+    void disconnect();
+
+    bool send_command(const std::string& command);
+
+    // Read one message: a line (without the newline) and, for EVENT lines,
+    // the event's XML
+    bool read_message(std::string& line, std::string& xml);
+};
+
+} // namespace CoTCommon
+
+#endif // COT_QUERY_H
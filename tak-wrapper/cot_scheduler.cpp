@@ -0,0 +1,351 @@
+#include "cot_scheduler.h"
+#include "cot_common.h"
+
+#include <atomic>
+
+namespace CoTCommon {
+
+std::vector<SendScheduler::PriorityClass> SendScheduler::default_classes() {
+    std::vector<PriorityClass> classes(3);
+
+    classes[0].name = "urgent";
+    classes[0].type_patterns = {"b-a-*", "b-t-f*"};  // Emergencies/alerts, chat
+    classes[0].weight = 8;
+    classes[0].latency_budget_ms = 50.0;
+
+    classes[1].name = "routine";  // Catch-all
+    classes[1].weight = 4;
+    classes[1].latency_budget_ms = 1000.0;
+
+    classes[2].name = "bulk";
+    classes[2].type_patterns = {"a-*"};  // Position reports
+    classes[2].weight = 1;
+    classes[2].latency_budget_ms = 5000.0;
+    classes[2].coalesce = true;
+
+    return classes;
+}
+
+SendScheduler::SendScheduler(const Options& opts, Writer writer)
+    : options(opts), write(std::move(writer)), catch_all(0), running(false), stopping(false),
+      round_class(0), round_credit(0) {
+    if (options.classes.empty()) {
+        options.classes = default_classes();
+    }
+
+    // Unmatched types go to the first class without patterns, else the last
+    catch_all = options.classes.size() - 1;
+    for (size_t i = 0; i < options.classes.size(); i++) {
+        if (options.classes[i].type_patterns.empty()) {
+            catch_all = i;
+            break;
+        }
+    }
+
+    queues.resize(options.classes.size());
+    for (size_t i = 0; i < queues.size(); i++) {
+        queues[i].config = options.classes[i];
+        if (queues[i].config.weight == 0) queues[i].config.weight = 1;
+    }
+}
+
+SendScheduler::~SendScheduler() {
+    stop();
+}
+
+void SendScheduler::start() {
+    if (running) return;
+    stopping = false;
+    running = true;
+    writer_thread = std::thread(&SendScheduler::writer_loop, this);
+}
+
+void SendScheduler::stop() {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    writer_thread.join();
+    running = false;
+}
+
+size_t SendScheduler::classify(std::string_view type) const {
+    for (size_t i = 0; i < queues.size(); i++) {
+        for (const auto& pattern : queues[i].config.type_patterns) {
+            if (match_cot_type(pattern, type)) {
+                return i;
+            }
+        }
+    }
+    return catch_all;
+}
+
+bool SendScheduler::submit(std::string_view uid, std::string_view type, Payload payload, Completion done) {
+    size_t index = classify(type);
+    Completion superseded;
+    bool coalesced = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ClassQueue& queue = queues[index];
+        queue.submitted++;
+
+        // Replace the queued report for this UID in place; it keeps its
+        // position (and age) so a chatty track cannot starve itself
+        auto it = queue.config.coalesce && !uid.empty() ? queue.queued_uids.find(std::string(uid))
+                                                        : queue.queued_uids.end();
+        if (it != queue.queued_uids.end()) {
+            Entry& entry = queue.entries[it->second - queue.head_sequence];
+            queue.queued_bytes += payload->size() - entry.payload->size();
+            entry.payload = std::move(payload);
+            superseded = std::move(entry.done);
+            entry.done = std::move(done);
+            queue.coalesced++;
+            coalesced = true;
+        } else if (queue.entries.size() < queue.config.max_queued) {
+            queue.queued_bytes += payload->size();
+            queue.entries.push_back(Entry{std::string(uid), std::move(payload), Clock::now(), std::move(done)});
+            if (queue.config.coalesce && !uid.empty()) {
+                queue.queued_uids[std::string(uid)] = queue.head_sequence + queue.entries.size() - 1;
+            }
+            work_ready.notify_one();
+            return true;
+        } else {
+            queue.rejected++;
+        }
+    }
+
+    // Completions run outside the lock
+    if (superseded) {
+        superseded(Outcome::SUPERSEDED);
+    }
+    if (coalesced) {
+        return true;
+    }
+    if (done) {
+        done(Outcome::REJECTED);
+    }
+    return false;
+}
+
+bool SendScheduler::any_queued() const {
+    for (const auto& queue : queues) {
+        if (!queue.entries.empty()) return true;
+    }
+    return false;
+}
+
+size_t SendScheduler::pick_queue(Clock::time_point now) {
+    if (options.policy == Policy::WEIGHTED) {
+        // A class past its latency budget goes first, in priority order
+        for (size_t i = 0; i < queues.size(); i++) {
+            const ClassQueue& queue = queues[i];
+            if (queue.entries.empty() || queue.config.latency_budget_ms <= 0) continue;
+            std::chrono::duration<double, std::milli> age = now - queue.entries.front().enqueued;
+            if (age.count() >= queue.config.latency_budget_ms) return i;
+        }
+
+        // Otherwise each class gets `weight` events per round
+        for (size_t tries = 0; tries <= queues.size(); tries++) {
+            if (round_credit > 0 && !queues[round_class].entries.empty()) {
+                round_credit--;
+                return round_class;
+            }
+            round_class = (round_class + 1) % queues.size();
+            round_credit = queues[round_class].config.weight;
+        }
+    }
+
+    for (size_t i = 0; i < queues.size(); i++) {
+        if (!queues[i].entries.empty()) return i;
+    }
+    return 0;
+}
+
+void SendScheduler::pop_front(ClassQueue& queue, Pending& pending, size_t index) {
+    pending.queue = index;
+    pending.entry = std::move(queue.entries.front());
+    queue.entries.pop_front();
+    queue.queued_bytes -= pending.entry.payload->size();
+
+    if (queue.config.coalesce && !pending.entry.uid.empty()) {
+        auto it = queue.queued_uids.find(pending.entry.uid);
+        if (it != queue.queued_uids.end() && it->second == queue.head_sequence) {
+            queue.queued_uids.erase(it);
+        }
+    }
+    queue.head_sequence++;
+}
+
+void SendScheduler::writer_loop() {
+    std::vector<Pending> batch;
+    std::string buffer;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        work_ready.wait(lock, [this] { return stopping || any_queued(); });
+        if (!any_queued()) break;  // Stopping and drained
+
+        // Fill one write in scheduling order
+        Clock::time_point now = Clock::now();
+        size_t bytes = 0;
+        batch.clear();
+        while (bytes < options.max_write_bytes && any_queued()) {
+            size_t index = pick_queue(now);
+            Pending pending;
+            pop_front(queues[index], pending, index);
+            bytes += pending.entry.payload->size();
+            batch.push_back(std::move(pending));
+        }
+        lock.unlock();
+
+        bool ok;
+        if (batch.size() == 1) {
+            ok = write(*batch[0].entry.payload);
+        } else {
+            buffer.clear();
+            for (const auto& pending : batch) {
+                buffer += *pending.entry.payload;
+            }
+            ok = write(buffer);
+        }
+
+        Clock::time_point written = Clock::now();
+        for (auto& pending : batch) {
+            if (pending.entry.done) {
+                pending.entry.done(ok ? Outcome::SENT : Outcome::FAILED);
+            }
+        }
+
+        lock.lock();
+        for (const auto& pending : batch) {
+            ClassQueue& queue = queues[pending.queue];
+            if (!ok) {
+                queue.failed++;
+                continue;
+            }
+            std::chrono::duration<double, std::milli> latency = written - pending.entry.enqueued;
+            queue.sent++;
+            queue.total_latency_ms += latency.count();
+            if (latency.count() > queue.max_latency_ms) queue.max_latency_ms = latency.count();
+            if (queue.config.latency_budget_ms > 0 && latency.count() > queue.config.latency_budget_ms) {
+                queue.budget_misses++;
+            }
+        }
+    }
+}
+
+std::vector<SendScheduler::ClassStats> SendScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    std::vector<ClassStats> result;
+    for (const auto& queue : queues) {
+        ClassStats s;
+        s.name = queue.config.name;
+        s.depth = queue.entries.size();
+        s.submitted = queue.submitted;
+        s.sent = queue.sent;
+        s.coalesced = queue.coalesced;
+        s.rejected = queue.rejected;
+        s.failed = queue.failed;
+        s.budget_misses = queue.budget_misses;
+        s.max_latency_ms = queue.max_latency_ms;
+        s.mean_latency_ms = queue.sent ? queue.total_latency_ms / queue.sent : 0.0;
+        s.queued_bytes = queue.queued_bytes;
+        s.oldest_age_ms = queue.entries.empty()
+            ? 0.0 : std::chrono::duration<double, std::milli>(now - queue.entries.front().enqueued).count();
+        result.push_back(s);
+    }
+    return result;
+}
+
+// SendFanout implementation
+SendFanout::~SendFanout() {
+    stop();
+}
+
+void SendFanout::add_target(const std::string& name, const SendScheduler::Options& opts,
+                            SendScheduler::Writer writer) {
+    targets.push_back(Target{name, std::unique_ptr<SendScheduler>(new SendScheduler(opts, std::move(writer)))});
+}
+
+void SendFanout::start() {
+    for (auto& target : targets) {
+        target.scheduler->start();
+    }
+}
+
+void SendFanout::stop() {
+    for (auto& target : targets) {
+        target.scheduler->stop();
+    }
+}
+
+bool SendFanout::submit(std::string_view uid, std::string_view type, SendScheduler::Payload payload,
+                        SendScheduler::Completion done) {
+    if (targets.size() == 1 || !done) {
+        bool accepted = false;
+        for (auto& target : targets) {
+            accepted |= target.scheduler->submit(uid, type, payload, done);
+        }
+        return accepted;
+    }
+
+    // One outcome per event: the first target to take it, else the last failure
+    struct Ack {
+        std::atomic<size_t> remaining;
+        std::atomic<bool> reported;
+        std::atomic<int> failure;
+        SendScheduler::Completion done;
+    };
+    auto ack = std::make_shared<Ack>();
+    ack->remaining = targets.size();
+    ack->reported = false;
+    ack->failure = static_cast<int>(SendScheduler::Outcome::REJECTED);
+    ack->done = std::move(done);
+
+    SendScheduler::Completion each = [ack](SendScheduler::Outcome outcome) {
+        if (outcome == SendScheduler::Outcome::SENT || outcome == SendScheduler::Outcome::SUPERSEDED) {
+            if (!ack->reported.exchange(true)) ack->done(outcome);
+        } else if (outcome == SendScheduler::Outcome::FAILED) {
+            ack->failure = static_cast<int>(outcome);
+        }
+        if (ack->remaining.fetch_sub(1) == 1 && !ack->reported.exchange(true)) {
+            ack->done(static_cast<SendScheduler::Outcome>(ack->failure.load()));
+        }
+    };
+
+    bool accepted = false;
+    for (auto& target : targets) {
+        accepted |= target.scheduler->submit(uid, type, payload, each);
+    }
+    return accepted;
+}
+
+std::vector<SendFanout::TargetStats> SendFanout::stats() const {
+    std::vector<TargetStats> result;
+    for (const auto& target : targets) {
+        TargetStats t{};
+        t.name = target.name;
+        t.classes = target.scheduler->stats();
+
+        double total_latency_ms = 0.0;
+        for (const auto& c : t.classes) {
+            t.queued += c.depth;
+            t.queued_bytes += c.queued_bytes;
+            t.sent += c.sent;
+            t.dropped += c.rejected;
+            t.failed += c.failed;
+            total_latency_ms += c.mean_latency_ms * c.sent;
+            if (c.oldest_age_ms > t.lag_ms) t.lag_ms = c.oldest_age_ms;
+            if (c.max_latency_ms > t.max_latency_ms) t.max_latency_ms = c.max_latency_ms;
+        }
+        t.mean_latency_ms = t.sent ? total_latency_ms / t.sent : 0.0;
+        result.push_back(std::move(t));
+    }
+    return result;
+}
+
+} // namespace CoTCommon
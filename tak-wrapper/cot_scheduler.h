@@ -0,0 +1,210 @@
+#ifndef COT_SCHEDULER_H
+#define COT_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace CoTCommon {
+
+// Priority-aware outbound queue in front of a single server connection.
+//
+// Events are assigned to a class by CoT type pattern. Classes are listed in
+// priority order; an event goes to the first class with a matching pattern,
+// or to the first class without patterns (the catch-all). A writer thread
+// drains the classes by strict priority or by weighted round robin. Under
+// WEIGHTED a class whose oldest event has exceeded its latency budget is
+// served first, so every class is held to its budget; under STRICT budgets
+// are only accounted (see ClassStats::budget_misses).
+//
+// Classes with coalesce set keep only the latest event per UID: a newer
+// position report replaces the queued one in place, so a bulk backlog holds
+// at most one event per track.
+class SendScheduler {
+public:
+    // Payloads are immutable and shared so one render can feed several queues
+    using Payload = std::shared_ptr<const std::string>;
+    using Writer = std::function<bool(const std::string& data)>;
+
+    enum class Policy {
+        STRICT,
+        WEIGHTED
+    };
+
+    enum class Outcome {
+        SENT,
+        SUPERSEDED,   // Replaced by a newer event for the same UID
+        REJECTED,     // Class queue full
+        FAILED        // Write to the server failed
+    };
+
+    // Runs on the writer thread, or inside submit() for SUPERSEDED/REJECTED
+    using Completion = std::function<void(Outcome outcome)>;
+
+    struct PriorityClass {
+        std::string name;
+        std::vector<std::string> type_patterns;  // Glob, see match_cot_type()
+        unsigned weight = 1;                     // Events per round when WEIGHTED
+        double latency_budget_ms = 0.0;          // 0 = no budget
+        bool coalesce = false;                   // Latest event per UID only
+        size_t max_queued = 100000;
+    };
+
+    struct Options {
+        std::vector<PriorityClass> classes;  // Empty = default_classes()
+        Policy policy = Policy::STRICT;
+        size_t max_write_bytes = 16384;      // Coalesced into one write
+    };
+
+    struct ClassStats {
+        std::string name;
+        size_t depth;
+        uint64_t submitted;
+        uint64_t sent;
+        uint64_t coalesced;
+        uint64_t rejected;
+        uint64_t failed;
+        uint64_t budget_misses;   // Sent later than the class budget
+        double max_latency_ms;
+        double mean_latency_ms;
+        size_t queued_bytes;
+        double oldest_age_ms;     // Age of the oldest queued event (lag)
+    };
+
+    // Urgent (emergencies, alerts, chat), routine (catch-all) and bulk
+    // (coalesced position reports)
+    static std::vector<PriorityClass> default_classes();
+
+    SendScheduler(const Options& opts, Writer writer);
+    ~SendScheduler();
+
+    SendScheduler(const SendScheduler&) = delete;
+    SendScheduler& operator=(const SendScheduler&) = delete;
+
+    void start();
+
+    // Write everything still queued and join the writer thread
+    void stop();
+
+    // Index of the class an event type is assigned to
+    size_t classify(std::string_view type) const;
+
+    // Queue one event; returns false (after calling done with REJECTED) if
+    // its class is full
+    bool submit(std::string_view uid, std::string_view type, Payload payload, Completion done = nullptr);
+
+    std::vector<ClassStats> stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string uid;
+        Payload payload;
+        Clock::time_point enqueued;
+        Completion done;
+    };
+
+    struct ClassQueue {
+        PriorityClass config;
+        std::deque<Entry> entries;
+        uint64_t head_sequence = 0;                           // Sequence of entries.front()
+        std::unordered_map<std::string, uint64_t> queued_uids;  // Coalescing index
+        size_t queued_bytes = 0;
+
+        uint64_t submitted = 0;
+        uint64_t sent = 0;
+        uint64_t coalesced = 0;
+        uint64_t rejected = 0;
+        uint64_t failed = 0;
+        uint64_t budget_misses = 0;
+        double max_latency_ms = 0.0;
+        double total_latency_ms = 0.0;
+    };
+
+    struct Pending {
+        size_t queue;
+        Entry entry;
+    };
+
+    Options options;
+    Writer write;
+    std::vector<ClassQueue> queues;
+    size_t catch_all;
+
+    mutable std::mutex mutex;
+    std::condition_variable work_ready;
+    std::thread writer_thread;
+    bool running;
+    bool stopping;
+
+    // Weighted round robin position
+    size_t round_class;
+    unsigned round_credit;
+
+    bool any_queued() const;
+    size_t pick_queue(Clock::time_point now);
+    void pop_front(ClassQueue& queue, Pending& pending, size_t index);
+    void writer_loop();
+};
+
+// Feeds the same event stream to several servers. Each target has its own
+// SendScheduler (queues and writer thread), so a slow or unreachable server
+// only backs up its own queues. Payloads are shared by every target rather
+// than copied.
+class SendFanout {
+public:
+    struct TargetStats {
+        std::string name;
+        size_t queued;
+        size_t queued_bytes;
+        double lag_ms;            // Age of the oldest queued event
+        uint64_t sent;
+        uint64_t dropped;         // Rejected because the target's queue was full
+        uint64_t failed;
+        double mean_latency_ms;
+        double max_latency_ms;
+        std::vector<SendScheduler::ClassStats> classes;
+    };
+
+    SendFanout() = default;
+    ~SendFanout();
+
+    SendFanout(const SendFanout&) = delete;
+    SendFanout& operator=(const SendFanout&) = delete;
+
+    // Targets are added before start()
+    void add_target(const std::string& name, const SendScheduler::Options& opts, SendScheduler::Writer writer);
+    size_t target_count() const { return targets.size(); }
+
+    void start();
+    void stop();
+
+    // Queue one event on every target. done reports the first successful
+    // write, or a failure once no target has taken the event.
+    bool submit(std::string_view uid, std::string_view type, SendScheduler::Payload payload,
+                SendScheduler::Completion done = nullptr);
+
+    std::vector<TargetStats> stats() const;
+
+private:
+    struct Target {
+        std::string name;
+        std::unique_ptr<SendScheduler> scheduler;
+    };
+
+    std::vector<Target> targets;
+};
+
+} // namespace CoTCommon
+
+#endif // COT_SCHEDULER_H
@@ -0,0 +1,345 @@
+#include "cot_snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr char MAGIC[8] = {'C', 'O', 'T', 'S', 'N', 'A', 'P', '1'};
+constexpr uint32_t FORMAT_VERSION = 2;  // 2: CompactPosition instead of three doubles
+constexpr size_t HEADER_SIZE = 32;
+
+// size, time, stale, position, five string lengths, xml length
+constexpr size_t RECORD_FIXED = 4 + 8 * 2 + sizeof(CompactPosition) + 2 * 5 + 4;
+
+template <typename T>
+void put(char*& p, T value) {
+    memcpy(p, &value, sizeof(T));
+    p += sizeof(T);
+}
+
+template <typename T>
+T get(const char*& p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+}
+
+// Multiply-xor over 8-byte words; catches torn or corrupted files, fast
+// enough to check on every load
+uint64_t checksum(const char* data, size_t len) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, len - i);
+    h = (h ^ tail) * 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 29);
+}
+
+// Encode one track; false if a string is too long for the format
+bool encode_record(std::string& out, const TrackStore::Track& track) {
+    std::string_view strings[5] = {track.uid, track.type.view(), track.how.view(), track.callsign.view(),
+                                   track.team.view()};
+    size_t size = RECORD_FIXED + track.xml.size();
+    for (std::string_view s : strings) {
+        if (s.size() > UINT16_MAX) return false;
+        size += s.size();
+    }
+    if (size > UINT32_MAX) return false;
+
+    out.resize(size);
+    char* p = &out[0];
+    put<uint32_t>(p, static_cast<uint32_t>(size));
+    put<int64_t>(p, track.time_ms);
+    put<int64_t>(p, track.stale_ms);
+    put<CompactPosition>(p, track.position);
+    for (std::string_view s : strings) {
+        put<uint16_t>(p, static_cast<uint16_t>(s.size()));
+    }
+    put<uint32_t>(p, static_cast<uint32_t>(track.xml.size()));
+    for (std::string_view s : strings) {
+        memcpy(p, s.data(), s.size());
+        p += s.size();
+    }
+    memcpy(p, track.xml.data(), track.xml.size());
+    return true;
+}
+
+bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        len -= written;
+    }
+    return true;
+}
+
+// Make a rename in the file's directory durable
+void sync_directory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+int64_t now_epoch_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+bool load_track_snapshot(const std::string& path, int64_t now_ms,
+                         const std::function<void(const SnapshotTrack&)>& fn, SnapshotInfo& info) {
+    info = SnapshotInfo{0, 0, 0, 0};
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            std::cerr << "Cannot open snapshot " << path << ": " << strerror(errno) << std::endl;
+        }
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(HEADER_SIZE)) {
+        std::cerr << "Snapshot " << path << " is truncated" << std::endl;
+        close(fd);
+        return false;
+    }
+    size_t len = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Cannot map snapshot " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    info.bytes = len;
+
+    const char* data = static_cast<const char*>(map);
+    const char* p = data + sizeof(MAGIC);
+    uint32_t version = get<uint32_t>(p);
+    uint32_t count = get<uint32_t>(p);
+    info.written_ms = get<int64_t>(p);
+    uint64_t expected = get<uint64_t>(p);
+
+    bool valid = memcmp(data, MAGIC, sizeof(MAGIC)) == 0 && version == FORMAT_VERSION &&
+                 checksum(data + HEADER_SIZE, len - HEADER_SIZE) == expected;
+    const char* end = data + len;
+    uint32_t records = 0;
+    while (valid && p < end) {
+        if (static_cast<size_t>(end - p) < RECORD_FIXED) {
+            valid = false;
+            break;
+        }
+        const char* record = p;
+        uint32_t size = get<uint32_t>(p);
+        SnapshotTrack track;
+        track.time_ms = get<int64_t>(p);
+        track.stale_ms = get<int64_t>(p);
+        track.position = get<CompactPosition>(p);
+        uint16_t lengths[5];
+        size_t total = RECORD_FIXED;
+        for (uint16_t& length : lengths) {
+            length = get<uint16_t>(p);
+            total += length;
+        }
+        uint32_t xml_length = get<uint32_t>(p);
+        total += xml_length;
+        if (size != total || size > static_cast<size_t>(end - record)) {
+            valid = false;
+            break;
+        }
+
+        std::string_view* fields[5] = {&track.uid, &track.type, &track.how, &track.callsign, &track.team};
+        for (size_t i = 0; i < 5; i++) {
+            *fields[i] = std::string_view(p, lengths[i]);
+            p += lengths[i];
+        }
+        track.xml = std::string_view(p, xml_length);
+        p += xml_length;
+        records++;
+
+        if (track.stale_ms != 0 && track.stale_ms <= now_ms) {
+            info.dropped++;
+        } else {
+            fn(track);
+            info.loaded++;
+        }
+    }
+    valid = valid && records == count;
+    munmap(map, len);
+
+    if (!valid) {
+        std::cerr << "Snapshot " << path << " is corrupt; ignoring it" << std::endl;
+    }
+    return valid;
+}
+
+// TrackSnapshotter implementation
+TrackSnapshotter::TrackSnapshotter(const FeedMerger& source, const std::string& snapshot_path,
+                                   double interval_seconds, bool verb)
+    : merger(source), path(snapshot_path), interval_s(interval_seconds), verbose(verb),
+      captured_revision(0), running(false), stopping(false), counters{0, 0, 0, 0, 0, 0.0, 0.0} {
+}
+
+TrackSnapshotter::~TrackSnapshotter() {
+    stop();
+}
+
+void TrackSnapshotter::start() {
+    if (running) return;
+    stopping = false;
+    running = true;
+    writer_thread = std::thread(&TrackSnapshotter::writer_loop, this);
+}
+
+void TrackSnapshotter::stop() {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer_thread.join();
+    running = false;
+    write_now();
+}
+
+void TrackSnapshotter::writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wake.wait_for(lock, std::chrono::duration<double>(interval_s), [this] { return stopping; });
+        if (stopping) break;
+        lock.unlock();
+        write_now();
+        lock.lock();
+    }
+}
+
+void TrackSnapshotter::capture(int64_t now_ms) {
+    // Under the lock, only copy tracks changed since the last capture into
+    // reused slots (assignment keeps the strings' capacity)
+    auto start = std::chrono::steady_clock::now();
+    size_t changed = 0;
+    merger.with_tracks([this, &changed](const TrackStore& store) {
+        if (store.revision() == captured_revision) return;
+        for (const auto& track : store.tracks()) {
+            if (track.revision <= captured_revision) continue;
+            if (changed == changed_tracks.size()) {
+                changed_tracks.push_back(track);
+            } else {
+                changed_tracks[changed] = track;
+            }
+            changed++;
+        }
+        captured_revision = store.revision();
+    });
+    double lock_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for (size_t i = 0; i < changed; i++) {
+        const TrackStore::Track& track = changed_tracks[i];
+        Record& record = records[track.uid];
+        record.stale_ms = track.stale_ms;
+        if (!encode_record(record.bytes, track)) {
+            record.bytes.clear();
+        }
+    }
+
+    // The store expires the same tracks on its own schedule
+    for (auto it = records.begin(); it != records.end();) {
+        if (it->second.bytes.empty() || (it->second.stale_ms != 0 && it->second.stale_ms <= now_ms)) {
+            it = records.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.changed = changed;
+    counters.lock_ms = lock_ms;
+}
+
+bool TrackSnapshotter::write_file(int64_t now_ms) {
+    file_buffer.resize(HEADER_SIZE);
+    for (const auto& entry : records) {
+        file_buffer += entry.second.bytes;
+    }
+
+    char* p = &file_buffer[0];
+    memcpy(p, MAGIC, sizeof(MAGIC));
+    p += sizeof(MAGIC);
+    put<uint32_t>(p, FORMAT_VERSION);
+    put<uint32_t>(p, static_cast<uint32_t>(records.size()));
+    put<int64_t>(p, now_ms);
+    put<uint64_t>(p, checksum(file_buffer.data() + HEADER_SIZE, file_buffer.size() - HEADER_SIZE));
+
+    std::string temp = path + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Cannot write snapshot " << temp << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = write_all(fd, file_buffer.data(), file_buffer.size()) && fsync(fd) == 0;
+    int saved_errno = errno;
+    close(fd);
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot write snapshot " << path << ": " << strerror(ok ? errno : saved_errno) << std::endl;
+        unlink(temp.c_str());
+        return false;
+    }
+    sync_directory(path);
+    return true;
+}
+
+bool TrackSnapshotter::write_now() {
+    std::lock_guard<std::mutex> guard(write_mutex);
+    int64_t now_ms = now_epoch_ms();
+    capture(now_ms);
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = write_file(now_ms);
+    double write_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ok) {
+        counters.snapshots++;
+        counters.tracks = records.size();
+        counters.bytes = file_buffer.size();
+        counters.write_ms = write_ms;
+    } else {
+        counters.failures++;
+    }
+    if (verbose) {
+        std::cerr << "[snapshot] " << path << (ok ? " written" : " failed") << ": tracks=" << records.size()
+                  << " changed=" << counters.changed << " bytes=" << file_buffer.size() << std::endl;
+    }
+    return ok;
+}
+
+TrackSnapshotter::Stats TrackSnapshotter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+} // namespace CoTCommon
@@ -0,0 +1,129 @@
+#ifndef COT_SNAPSHOT_H
+#define COT_SNAPSHOT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cot_merge.h"
+
+namespace CoTCommon {
+
+// Warm-start snapshots of the track picture held by a FeedMerger.
+//
+// A snapshot file is a 32-byte header followed by one record per track:
+//
+//   header: "COTSNAP1", u32 version, u32 track count, i64 written (ms since
+//           the epoch), u64 checksum of everything after the header
+//   record: u32 record size, i64 time_ms, i64 stale_ms, CompactPosition
+//           (i32 lat, lon in 1e-7 degrees, i32 hae in decimeters, u16 ce,
+//           le in meters), u16 lengths of uid, type, how, callsign, team,
+//           u32 xml length, then the strings back to back
+//
+// There are no floating-point fields: every number is an integer in host
+// byte order. The loader rejects files whose magic, version, sizes or
+// checksum do not match.
+
+struct SnapshotTrack {
+    std::string_view uid;
+    std::string_view type;
+    std::string_view how;
+    std::string_view callsign;
+    std::string_view team;
+    std::string_view xml;       // Raw event of the stored version
+    CompactPosition position;
+    int64_t time_ms;
+    int64_t stale_ms;           // 0 if the event carried no stale time
+};
+
+struct SnapshotInfo {
+    size_t loaded;              // Tracks handed to the callback
+    size_t dropped;             // Tracks already past their stale time
+    int64_t written_ms;         // When the snapshot was written
+    size_t bytes;
+};
+
+// Map the snapshot at path and call fn for every track whose stale time is
+// after now_ms. Views point into the mapping and are only valid during the
+// call. False if the file is missing (info.bytes is 0) or invalid.
+bool load_track_snapshot(const std::string& path, int64_t now_ms,
+                         const std::function<void(const SnapshotTrack&)>& fn, SnapshotInfo& info);
+
+// Periodically writes the merger's tracks to a snapshot file from a
+// background thread.
+//
+// Ingest is only held up while changed tracks are copied: under the merger
+// lock, tracks whose revision is unchanged since the previous snapshot are
+// skipped with one comparison, and changed ones are copied out. Encoding
+// them into a private copy of the picture, writing and fsync happen outside
+// the lock. The file is replaced atomically (written to "<path>.tmp", then
+// renamed), so a reader or a crash mid-write always sees a whole snapshot.
+class TrackSnapshotter {
+public:
+    struct Stats {
+        uint64_t snapshots;
+        uint64_t failures;
+        size_t tracks;              // In the last snapshot
+        size_t bytes;
+        size_t changed;             // Tracks copied for the last snapshot
+        double lock_ms;             // Time the last capture held the merger lock
+        double write_ms;
+    };
+
+    TrackSnapshotter(const FeedMerger& source, const std::string& snapshot_path, double interval_seconds,
+                     bool verb = false);
+    ~TrackSnapshotter();
+
+    TrackSnapshotter(const TrackSnapshotter&) = delete;
+    TrackSnapshotter& operator=(const TrackSnapshotter&) = delete;
+
+    void start();
+
+    // Join the background thread after writing a final snapshot
+    void stop();
+
+    // Capture and write one snapshot on the calling thread
+    bool write_now();
+
+    Stats stats() const;
+
+private:
+    struct Record {
+        int64_t stale_ms;
+        std::string bytes;          // Encoded record, reused across versions
+    };
+
+    const FeedMerger& merger;
+    std::string path;
+    double interval_s;
+    bool verbose;
+
+    // Private copy of the picture, keyed by UID
+    std::unordered_map<std::string, Record> records;
+    std::vector<TrackStore::Track> changed_tracks;
+    uint64_t captured_revision;
+    std::string file_buffer;
+
+    mutable std::mutex mutex;       // Guards counters and the stop flag
+    std::condition_variable wake;
+    std::thread writer_thread;
+    bool running;
+    bool stopping;
+    Stats counters;
+
+    std::mutex write_mutex;         // One capture/write at a time
+
+    void capture(int64_t now_ms);
+    bool write_file(int64_t now_ms);
+    void writer_loop();
+};
+
+} // namespace CoTCommon
+
+#endif // COT_SNAPSHOT_H
@@ -0,0 +1,433 @@
+#include "cot_table.h"
+#include "cot_geo.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr int DEFAULT_HEIGHT = 24;
+constexpr int DEFAULT_WIDTH = 80;
+constexpr int HEADER_LINES = 2;
+
+// Terminal state restored at stop() or exit, whichever comes first
+struct termios saved_termios;
+bool termios_saved = false;
+std::atomic<int> cursor_row{0};
+
+void restore_terminal() {
+    if (termios_saved) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+        termios_saved = false;
+    }
+    int row = cursor_row.exchange(0);
+    if (row > 0) {
+        char buffer[32];
+        int len = snprintf(buffer, sizeof(buffer), "\x1b[%d;1H\x1b[?25h\n", row);
+        ssize_t written = write(STDOUT_FILENO, buffer, len);
+        (void)written;
+    }
+}
+
+void write_all(const std::string& out) {
+    const char* data = out.data();
+    size_t len = out.size();
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= n;
+    }
+}
+
+// Append text as a cell of width columns: cut at a character boundary,
+// control characters shown as '?' so a callsign cannot move the cursor
+void append_cell(std::string& out, std::string_view text, size_t width) {
+    size_t columns = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        bool continuation = (c & 0xC0) == 0x80;
+        if (!continuation && columns == width) break;
+        if (c < 0x20 || c == 0x7F) {
+            out += '?';
+        } else {
+            out += static_cast<char>(c);
+        }
+        if (!continuation) columns++;
+    }
+    out.append(width - columns, ' ');
+}
+
+// Cut a line to the terminal width
+void fit_line(std::string& line, int width) {
+    int columns = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+        if ((static_cast<unsigned char>(line[i]) & 0xC0) != 0x80 && ++columns > width) {
+            line.resize(i);
+            return;
+        }
+    }
+}
+
+bool contains_nocase(std::string_view text, std::string_view needle) {
+    auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+    return std::search(text.begin(), text.end(), needle.begin(), needle.end(),
+                       [&lower](char a, char b) { return lower(a) == lower(b); }) != text.end();
+}
+
+void append_age(std::string& out, int64_t seconds) {
+    char buffer[32];
+    if (seconds < 60) {
+        snprintf(buffer, sizeof(buffer), "%llds", static_cast<long long>(seconds));
+    } else if (seconds < 3600) {
+        snprintf(buffer, sizeof(buffer), "%lldm", static_cast<long long>(seconds / 60));
+    } else {
+        snprintf(buffer, sizeof(buffer), "%lldh", static_cast<long long>(seconds / 3600));
+    }
+    out.append(5 - std::min<size_t>(strlen(buffer), 5), ' ').append(buffer);
+}
+
+} // namespace
+
+TrackTable::TrackTable(const Options& table_options)
+    : options(table_options), stopping(false), running(false), keyboard(false), editing(false), events(0),
+      counters{}, width(0), height(0), rate_events(0), rate_start(Clock::now()), event_rate(0.0) {
+    if (options.frame_rate <= 0) {
+        options.frame_rate = 10.0;
+    }
+}
+
+TrackTable::~TrackTable() {
+    stop();
+}
+
+bool TrackTable::parse_sort_key(std::string_view name, SortKey& key) {
+    if (name == "age") {
+        key = SortKey::AGE;
+    } else if (name == "callsign") {
+        key = SortKey::CALLSIGN;
+    } else if (name == "type") {
+        key = SortKey::TYPE;
+    } else if (name == "team") {
+        key = SortKey::TEAM;
+    } else if (name == "updates") {
+        key = SortKey::UPDATES;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* TrackTable::sort_key_name(SortKey key) {
+    switch (key) {
+        case SortKey::AGE: return "age";
+        case SortKey::CALLSIGN: return "callsign";
+        case SortKey::TYPE: return "type";
+        case SortKey::TEAM: return "team";
+        case SortKey::UPDATES: return "updates";
+    }
+    return "";
+}
+
+void TrackTable::start() {
+    if (running) return;
+
+    // Keys arrive one at a time without echo; Ctrl+C still interrupts
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_termios) == 0) {
+        struct termios raw = saved_termios;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        termios_saved = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+        keyboard = termios_saved;
+    }
+    static bool registered = false;
+    if (!registered) {
+        std::atexit(restore_terminal);
+        registered = true;
+    }
+
+    write_all("\x1b[?25l\x1b[2J");
+    screen.clear();
+    stopping = false;
+    running = true;
+    render_thread = std::thread(&TrackTable::render_loop, this);
+}
+
+void TrackTable::stop() {
+    if (!running) return;
+    stopping = true;
+    render_thread.join();
+    running = false;
+    draw_frame();
+    restore_terminal();
+    keyboard = false;
+}
+
+void TrackTable::update(const CoTParser::CoTMessageView& msg) {
+    int64_t stale_ms = 0;
+    if (!parse_cot_time(msg.stale, stale_ms)) {
+        stale_ms = 0;
+    }
+    Clock::time_point now = Clock::now();
+
+    // Reused key buffer: looking up a known track does not allocate
+    thread_local std::string key;
+    key.assign(msg.uid.data(), msg.uid.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Row& row = rows[key];
+    row.callsign.assign(msg.callsign, msg.callsign_spill);
+    row.type.assign(msg.type, msg.type_spill);
+    row.team.assign(msg.team, msg.team_spill);
+    row.position = msg.position;
+    row.stale_ms = stale_ms;
+    row.updated = now;
+    row.updates++;
+    events++;
+}
+
+TrackTable::Stats TrackTable::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s = counters;
+    s.events = events;
+    s.tracks = rows.size();
+    return s;
+}
+
+void TrackTable::render_loop() {
+    auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.frame_rate));
+    Clock::time_point next_frame = Clock::now();
+
+    while (!stopping) {
+        Clock::time_point now = Clock::now();
+        if (now >= next_frame) {
+            draw_frame();
+            next_frame += interval;
+            if (next_frame < now) next_frame = now + interval;  // Never catch up on missed frames
+            continue;
+        }
+
+        // Wait for the next frame, or a key
+        int timeout_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(next_frame - now).count()) + 1;
+        struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&fd, keyboard ? 1 : 0, std::min(timeout_ms, 100)) > 0 && (fd.revents & POLLIN)) {
+            char keys[64];
+            ssize_t n = read(STDIN_FILENO, keys, sizeof(keys));
+            for (ssize_t i = 0; i < n; i++) {
+                handle_key(keys[i]);
+            }
+            if (n > 0) next_frame = now;  // Show the effect right away
+        }
+    }
+}
+
+void TrackTable::handle_key(char key) {
+    if (editing) {
+        if (key == '\n' || key == '\r') {
+            editing = false;
+        } else if (key == 27) {
+            options.filter.clear();
+            editing = false;
+        } else if (key == 127 || key == 8) {
+            if (!options.filter.empty()) options.filter.pop_back();
+        } else if (static_cast<unsigned char>(key) >= 0x20) {
+            options.filter += key;
+        }
+        return;
+    }
+
+    switch (key) {
+        case 'a': options.sort = SortKey::AGE; break;
+        case 'c': options.sort = SortKey::CALLSIGN; break;
+        case 't': options.sort = SortKey::TYPE; break;
+        case 'g': options.sort = SortKey::TEAM; break;
+        case 'u': options.sort = SortKey::UPDATES; break;
+        case 'r': options.reverse = !options.reverse; break;
+        case '/': editing = true; break;
+        case 'q':
+            // The same way out as Ctrl+C, with the terminal restored first
+            restore_terminal();
+            kill(getpid(), SIGINT);
+            break;
+        default: break;
+    }
+}
+
+void TrackTable::draw_frame() {
+    Clock::time_point start = Clock::now();
+    struct winsize size {};
+    int rows_available = DEFAULT_HEIGHT, columns = DEFAULT_WIDTH;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        rows_available = size.ws_row;
+        columns = size.ws_col;
+    }
+    size_t capacity = rows_available > HEADER_LINES ? rows_available - HEADER_LINES : 0;
+
+    // Pick and copy the visible rows under the lock; format outside it
+    struct Visible {
+        std::string uid;
+        Row row;
+    };
+    std::vector<Visible> visible;
+    size_t total, matched;
+    uint64_t event_count;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (options.expire) {
+            int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            for (auto it = rows.begin(); it != rows.end();) {
+                it = it->second.stale_ms != 0 && it->second.stale_ms < now_ms ? rows.erase(it) : std::next(it);
+            }
+        }
+
+        std::vector<std::pair<const std::string*, const Row*>> candidates;
+        candidates.reserve(rows.size());
+        for (const auto& entry : rows) {
+            const Row& row = entry.second;
+            if (!options.filter.empty() && !contains_nocase(entry.first, options.filter) &&
+                !contains_nocase(row.callsign.view(), options.filter) &&
+                !contains_nocase(row.type.view(), options.filter) &&
+                !contains_nocase(row.team.view(), options.filter)) {
+                continue;
+            }
+            candidates.emplace_back(&entry.first, &row);
+        }
+
+        SortKey sort = options.sort;
+        bool reverse = options.reverse;
+        auto before = [sort](const std::pair<const std::string*, const Row*>& a,
+                             const std::pair<const std::string*, const Row*>& b) {
+            int order = 0;
+            switch (sort) {
+                case SortKey::AGE:
+                    order = a.second->updated > b.second->updated ? -1 : a.second->updated < b.second->updated;
+                    break;
+                case SortKey::CALLSIGN:
+                    order = a.second->callsign.view().compare(b.second->callsign.view());
+                    break;
+                case SortKey::TYPE:
+                    order = a.second->type.view().compare(b.second->type.view());
+                    break;
+                case SortKey::TEAM:
+                    order = a.second->team.view().compare(b.second->team.view());
+                    break;
+                case SortKey::UPDATES:
+                    order = a.second->updates > b.second->updates ? -1 : a.second->updates < b.second->updates;
+                    break;
+            }
+            return order != 0 ? order < 0 : *a.first < *b.first;
+        };
+        size_t shown = std::min(capacity, candidates.size());
+        auto cmp = [&before, reverse](const std::pair<const std::string*, const Row*>& a,
+                                      const std::pair<const std::string*, const Row*>& b) {
+            return reverse ? before(b, a) : before(a, b);
+        };
+        std::partial_sort(candidates.begin(), candidates.begin() + shown, candidates.end(), cmp);
+
+        visible.reserve(shown);
+        for (size_t i = 0; i < shown; i++) {
+            visible.push_back(Visible{*candidates[i].first, *candidates[i].second});
+        }
+        total = rows.size();
+        matched = candidates.size();
+        event_count = events;
+    }
+
+    double elapsed = std::chrono::duration<double>(start - rate_start).count();
+    if (elapsed >= 1.0) {
+        event_rate = (event_count - rate_events) / elapsed;
+        rate_events = event_count;
+        rate_start = start;
+    }
+
+    // Lay out every line of the screen
+    std::vector<std::string> lines(rows_available);
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "Tracks %zu | shown %zu | %.0f events/s | sort %s%s | ", total, matched,
+             event_rate, sort_key_name(options.sort), options.reverse ? " (reversed)" : "");
+    std::string& status = lines[0];
+    status = buffer;
+    if (editing) {
+        status += "filter: " + options.filter + "_  (Enter keeps, Esc clears)";
+    } else {
+        if (!options.filter.empty()) status += "filter '" + options.filter + "' | ";
+        status += keyboard ? "keys: a c t g u sort, r reverse, / filter, q quit" : "";
+    }
+    if (rows_available > 1) {
+        std::string& header = lines[1];
+        append_cell(header, "CALLSIGN", 16);
+        header += ' ';
+        append_cell(header, "TYPE", 13);
+        header += ' ';
+        append_cell(header, "TEAM", 10);
+        snprintf(buffer, sizeof(buffer), " %9s %11s %-15s %5s %7s", "LATITUDE", "LONGITUDE", "MGRS", "AGE", "UPD");
+        header += buffer;
+    }
+
+    for (size_t i = 0; i < visible.size(); i++) {
+        const Row& row = visible[i].row;
+        std::string& line = lines[i + HEADER_LINES];
+        std::string_view callsign = row.callsign.view();
+        append_cell(line, callsign.empty() ? std::string_view(visible[i].uid) : callsign, 16);
+        line += ' ';
+        append_cell(line, row.type.view(), 13);
+        line += ' ';
+        append_cell(line, row.team.view(), 10);
+        snprintf(buffer, sizeof(buffer), " %9.5f %11.5f ", row.position.latitude(), row.position.longitude());
+        line += buffer;
+        size_t mgrs_start = line.size();
+        if (!append_mgrs(line, row.position.latitude(), row.position.longitude())) {
+            line += '-';
+        }
+        line.append(15 - std::min<size_t>(line.size() - mgrs_start, 15), ' ');
+        line += ' ';
+        append_age(line, std::chrono::duration_cast<std::chrono::seconds>(start - row.updated).count());
+        snprintf(buffer, sizeof(buffer), " %7llu", static_cast<unsigned long long>(row.updates));
+        line += buffer;
+    }
+
+    // Rewrite only the lines that changed since the last frame
+    std::string out;
+    if (rows_available != height || columns != width) {
+        out += "\x1b[2J";
+        screen.assign(rows_available, std::string(1, '\0'));
+        height = rows_available;
+        width = columns;
+    }
+    uint64_t drawn = 0;
+    for (int i = 0; i < rows_available; i++) {
+        fit_line(lines[i], columns);
+        if (lines[i] == screen[i]) continue;
+        snprintf(buffer, sizeof(buffer), "\x1b[%d;1H", i + 1);
+        out += buffer;
+        if (i == 1) out += "\x1b[1m";
+        out += lines[i];
+        if (i == 1) out += "\x1b[0m";
+        out += "\x1b[K";
+        screen[i] = std::move(lines[i]);
+        drawn++;
+    }
+    if (!out.empty()) {
+        write_all(out);
+    }
+    cursor_row = rows_available;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.frames++;
+    counters.rows_drawn += drawn;
+    counters.bytes += out.size();
+    counters.frame_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace CoTCommon
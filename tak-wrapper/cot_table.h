@@ -0,0 +1,107 @@
+#ifndef COT_TABLE_H
+#define COT_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cot_common.h"
+
+namespace CoTCommon {
+
+// Live table of the current tracks on a terminal. update() only records a
+// track's latest state; a render thread redraws the screen at a fixed frame
+// rate and rewrites just the rows whose text changed, using ANSI cursor
+// addressing. Terminal output therefore depends on the screen size and the
+// frame rate, not on the event rate.
+//
+// When stdin is a terminal, single keys change the view: a/c/t/g/u sort by
+// age, callsign, type, team (group) or updates, r reverses, / edits the
+// filter (Enter keeps it, Esc clears it) and q quits.
+class TrackTable {
+public:
+    enum class SortKey { AGE, CALLSIGN, TYPE, TEAM, UPDATES };
+
+    struct Options {
+        double frame_rate = 10.0;
+        SortKey sort = SortKey::AGE;
+        bool reverse = false;
+        std::string filter;       // Substring of uid, callsign, type or team (any case)
+        bool expire = true;       // Drop tracks past their stale time
+    };
+
+    struct Stats {
+        uint64_t events;
+        uint64_t frames;
+        uint64_t rows_drawn;      // Rows rewritten; unchanged rows cost nothing
+        uint64_t bytes;           // Written to the terminal
+        size_t tracks;
+        double frame_ms;          // Time to build the last frame
+    };
+
+    explicit TrackTable(const Options& options);
+    ~TrackTable();
+
+    TrackTable(const TrackTable&) = delete;
+    TrackTable& operator=(const TrackTable&) = delete;
+
+    // Take over the terminal and start the render thread
+    void start();
+
+    // Draw a final frame and leave the cursor below the table
+    void stop();
+
+    // Thread-safe; called for every displayed event
+    void update(const CoTParser::CoTMessageView& msg);
+
+    Stats stats() const;
+
+    static bool parse_sort_key(std::string_view name, SortKey& key);
+    static const char* sort_key_name(SortKey key);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Row {
+        InternedString callsign;
+        InternedString type;
+        InternedString team;
+        CompactPosition position;
+        int64_t stale_ms;         // 0 if the event carried no stale time
+        Clock::time_point updated;
+        uint64_t updates;
+    };
+
+    Options options;
+    std::atomic<bool> stopping;
+    std::thread render_thread;
+    bool running;
+    bool keyboard;               // stdin is a terminal in non-canonical mode
+    bool editing;                // Typing a filter after '/'
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Row> rows;
+    uint64_t events;
+    Stats counters;
+
+    // Render thread state
+    std::vector<std::string> screen;   // Text of each drawn line
+    int width;
+    int height;
+    uint64_t rate_events;
+    Clock::time_point rate_start;
+    double event_rate;
+
+    void render_loop();
+    void handle_key(char key);
+    void draw_frame();
+};
+
+} // namespace CoTCommon
+
+#endif // COT_TABLE_H
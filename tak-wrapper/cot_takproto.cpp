@@ -0,0 +1,844 @@
+#include "cot_takproto.h"
+#include "cot_text.h"
+
+#include <charconv>
+#include <poll.h>
+
+namespace CoTCommon {
+
+namespace {
+
+// TakMessage / CotEvent / Detail field numbers
+constexpr uint32_t TAK_MESSAGE_COT_EVENT = 2;
+
+constexpr uint32_t EVENT_TYPE = 1;
+constexpr uint32_t EVENT_ACCESS = 2;
+constexpr uint32_t EVENT_QOS = 3;
+constexpr uint32_t EVENT_OPEX = 4;
+constexpr uint32_t EVENT_UID = 5;
+constexpr uint32_t EVENT_SEND_TIME = 6;
+constexpr uint32_t EVENT_START_TIME = 7;
+constexpr uint32_t EVENT_STALE_TIME = 8;
+constexpr uint32_t EVENT_HOW = 9;
+constexpr uint32_t EVENT_LAT = 10;
+constexpr uint32_t EVENT_LON = 11;
+constexpr uint32_t EVENT_HAE = 12;
+constexpr uint32_t EVENT_CE = 13;
+constexpr uint32_t EVENT_LE = 14;
+constexpr uint32_t EVENT_DETAIL = 15;
+
+constexpr uint32_t DETAIL_XML = 1;
+
+enum class ValueKind { STRING, UINT, DOUBLE };
+
+// Detail elements with a structured field; attribute i is field i + 1.
+// Anything else (or one of these with other attributes or children) is
+// carried in xmlDetail.
+struct DetailSchema {
+    std::string_view element;
+    uint32_t field;
+    ValueKind kind;
+    std::string_view attributes[4];
+};
+
+constexpr DetailSchema DETAIL_SCHEMA[] = {
+    {"contact", 2, ValueKind::STRING, {"endpoint", "callsign"}},
+    {"__group", 3, ValueKind::STRING, {"name", "role"}},
+    {"precisionlocation", 4, ValueKind::STRING, {"geopointsrc", "altsrc"}},
+    {"status", 5, ValueKind::UINT, {"battery"}},
+    {"takv", 6, ValueKind::STRING, {"device", "platform", "os", "version"}},
+    {"track", 7, ValueKind::DOUBLE, {"speed", "course"}},
+};
+constexpr int DETAIL_SCHEMA_SIZE = sizeof(DETAIL_SCHEMA) / sizeof(DETAIL_SCHEMA[0]);
+
+int attribute_index(const DetailSchema& schema, std::string_view name) {
+    for (int i = 0; i < 4 && !schema.attributes[i].empty(); i++) {
+        if (schema.attributes[i] == name) return i;
+    }
+    return -1;
+}
+
+bool parse_double(std::string_view text, double& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool parse_uint(std::string_view text, uint64_t& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+void append_double(std::string& out, double value) {
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr - buf);
+}
+
+void append_attribute(std::string& out, std::string_view name, std::string_view value) {
+    out.append(" ").append(name).append("=\"");
+    append_xml_escaped(out, value);
+    out += '"';
+}
+
+// Days since 1970-01-01 to a proleptic Gregorian date
+void civil_from_days(int64_t days, int64_t& y, unsigned& m, unsigned& d) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = static_cast<unsigned>(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+constexpr size_t COT_TIME_LENGTH = 24;
+
+// Write "2024-05-01T12:00:00.123Z" (COT_TIME_LENGTH characters)
+void format_cot_time(int64_t epoch_ms, char* out) {
+    int64_t days = (epoch_ms >= 0 ? epoch_ms : epoch_ms - 86399999) / 86400000;
+    int64_t ms_of_day = epoch_ms - days * 86400000;
+    int64_t year;
+    unsigned month, day;
+    civil_from_days(days, year, month, day);
+
+    auto put = [&out](size_t pos, int64_t value, size_t digits) {
+        for (size_t i = digits; i-- > 0;) {
+            out[pos + i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    };
+    put(0, year, 4);
+    out[4] = '-';
+    put(5, month, 2);
+    out[7] = '-';
+    put(8, day, 2);
+    out[10] = 'T';
+    put(11, ms_of_day / 3600000, 2);
+    out[13] = ':';
+    put(14, ms_of_day / 60000 % 60, 2);
+    out[16] = ':';
+    put(17, ms_of_day / 1000 % 60, 2);
+    out[19] = '.';
+    put(20, ms_of_day % 1000, 3);
+    out[23] = 'Z';
+}
+
+// Absent times (0) stay empty, as they would from XML
+std::string_view arena_time(uint64_t epoch_ms, BatchArena& arena) {
+    if (epoch_ms == 0) return std::string_view();
+    char* text = static_cast<char*>(arena.allocate(COT_TIME_LENGTH, 1));
+    format_cot_time(static_cast<int64_t>(epoch_ms), text);
+    return std::string_view(text, COT_TIME_LENGTH);
+}
+
+void append_time(std::string& out, std::string_view name, uint64_t epoch_ms) {
+    if (epoch_ms == 0) return;
+    char text[COT_TIME_LENGTH];
+    format_cot_time(static_cast<int64_t>(epoch_ms), text);
+    out.append(" ").append(name).append("=\"").append(text, COT_TIME_LENGTH) += '"';
+}
+
+// Shared with CoTObject::to_xml(), labelled by format
+const MetricsRegistry::Histogram& encode_time() {
+    static const MetricsRegistry::Histogram histogram = MetricsRegistry::global().histogram(
+        "cot_serialize_seconds", "Time to render one CoT event", "format=\"takp\"", 1e-9, 8, 30);
+    return histogram;
+}
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Fields of one CotEvent, as views into the payload
+struct EventFields {
+    std::string_view type, access, qos, opex, uid, how;
+    uint64_t send_time = 0, start_time = 0, stale_time = 0;
+    double lat = 0.0, lon = 0.0, hae = 0.0, ce = 0.0, le = 0.0;
+    std::string_view detail;
+    bool present = false;
+};
+
+bool read_event(std::string_view payload, EventFields& event) {
+    ProtoReader message(payload);
+    while (message.next()) {
+        if (message.field() != TAK_MESSAGE_COT_EVENT) continue;  // TakControl
+        event.present = true;
+
+        ProtoReader fields(message.bytes());
+        while (fields.next()) {
+            switch (fields.field()) {
+                case EVENT_TYPE: event.type = fields.bytes(); break;
+                case EVENT_ACCESS: event.access = fields.bytes(); break;
+                case EVENT_QOS: event.qos = fields.bytes(); break;
+                case EVENT_OPEX: event.opex = fields.bytes(); break;
+                case EVENT_UID: event.uid = fields.bytes(); break;
+                case EVENT_SEND_TIME: event.send_time = fields.varint(); break;
+                case EVENT_START_TIME: event.start_time = fields.varint(); break;
+                case EVENT_STALE_TIME: event.stale_time = fields.varint(); break;
+                case EVENT_HOW: event.how = fields.bytes(); break;
+                case EVENT_LAT: event.lat = fields.fixed64(); break;
+                case EVENT_LON: event.lon = fields.fixed64(); break;
+                case EVENT_HAE: event.hae = fields.fixed64(); break;
+                case EVENT_CE: event.ce = fields.fixed64(); break;
+                case EVENT_LE: event.le = fields.fixed64(); break;
+                case EVENT_DETAIL: event.detail = fields.bytes(); break;
+                default: break;  // Unknown fields are skipped
+            }
+        }
+        if (!fields.ok()) return false;
+    }
+    return message.ok() && event.present;
+}
+
+// Structured value of a detail sub-message, or empty
+std::string_view sub_field(std::string_view message, uint32_t field) {
+    ProtoReader reader(message);
+    std::string_view value;
+    while (reader.next()) {
+        if (reader.field() == field) value = reader.bytes();
+    }
+    return value;
+}
+
+} // namespace
+
+// ProtoWriter implementation
+void ProtoWriter::append_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void ProtoWriter::varint(uint32_t field, uint64_t value) {
+    if (value == 0) return;
+    append_varint(out, static_cast<uint64_t>(field) << 3);
+    append_varint(out, value);
+}
+
+void ProtoWriter::fixed64(uint32_t field, double value) {
+    if (value == 0.0) return;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    append_varint(out, static_cast<uint64_t>(field) << 3 | 1);
+    for (int i = 0; i < 8; i++) {
+        out += static_cast<char>(bits >> (8 * i));  // Little-endian on the wire
+    }
+}
+
+void ProtoWriter::bytes(uint32_t field, std::string_view value) {
+    if (value.empty()) return;
+    append_varint(out, static_cast<uint64_t>(field) << 3 | 2);
+    append_varint(out, value.size());
+    out.append(value.data(), value.size());
+}
+
+size_t ProtoWriter::begin(uint32_t field) {
+    size_t mark = out.size();
+    append_varint(out, static_cast<uint64_t>(field) << 3 | 2);
+    out += '\0';  // One-byte length placeholder, widened by end() if needed
+    return mark;
+}
+
+void ProtoWriter::end(size_t mark, bool keep_empty) {
+    size_t placeholder = mark;
+    while (static_cast<unsigned char>(out[placeholder]) & 0x80) placeholder++;
+    placeholder++;
+
+    size_t length = out.size() - placeholder - 1;
+    if (length == 0 && !keep_empty) {
+        out.resize(mark);
+    } else if (length < 0x80) {
+        out[placeholder] = static_cast<char>(length);
+    } else {
+        char prefix[10];
+        size_t n = 0;
+        for (uint64_t v = length; ; v >>= 7) {
+            prefix[n++] = static_cast<char>(v >= 0x80 ? (v & 0x7f) | 0x80 : v);
+            if (v < 0x80) break;
+        }
+        out.replace(placeholder, 1, prefix, n);
+    }
+}
+
+// ProtoReader implementation
+bool ProtoReader::read_varint(std::string_view data, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool ProtoReader::next() {
+    if (!good || pos >= data.size()) return false;
+
+    uint64_t length;
+    bool valid = read_varint(data, pos, tag);
+    if (valid) {
+        switch (tag & 7) {
+            case 0:  // Varint
+                valid = read_varint(data, pos, value);
+                break;
+            case 1:  // 64-bit
+            case 5:  // 32-bit
+                length = (tag & 7) == 1 ? 8 : 4;
+                valid = data.size() - pos >= length;
+                if (valid) {
+                    value = 0;
+                    for (size_t i = 0; i < length; i++) {
+                        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+                    }
+                    pos += length;
+                }
+                break;
+            case 2:  // Length-delimited
+                valid = read_varint(data, pos, length) && length <= data.size() - pos;
+                if (valid) {
+                    payload = data.substr(pos, length);
+                    pos += length;
+                }
+                break;
+            default:  // Groups are not used by the TAK schema
+                valid = false;
+        }
+    }
+
+    good = valid;
+    return valid;
+}
+
+double ProtoReader::fixed64() const {
+    double result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// TakFramer implementation
+TakFramer::TakFramer(size_t max_message_bytes)
+    : consumed(0), max_message(max_message_bytes), skipped(0) {
+}
+
+void TakFramer::append(const char* data, size_t len) {
+    buffer.append(data, len);
+}
+
+bool TakFramer::next(std::string_view& payload) {
+    COT_TRACE_SCOPE("frame");
+    while (consumed < buffer.size()) {
+        if (static_cast<unsigned char>(buffer[consumed]) != TakEncoder::MAGIC) {
+            size_t magic = buffer.find(static_cast<char>(TakEncoder::MAGIC), consumed);
+            size_t resume = magic == std::string::npos ? buffer.size() : magic;
+            skipped += resume - consumed;
+            consumed = resume;
+            continue;
+        }
+
+        size_t pos = consumed + 1;
+        uint64_t length;
+        if (!ProtoReader::read_varint(buffer, pos, length)) {
+            if (buffer.size() - consumed <= 11) {
+                return false;  // Length still incomplete
+            }
+            length = max_message + 1;  // Not a varint: resynchronise
+        }
+        if (length > max_message) {
+            skipped++;
+            consumed++;
+            continue;
+        }
+        if (buffer.size() - pos < length) {
+            return false;
+        }
+
+        payload = std::string_view(buffer.data() + pos, length);
+        consumed = pos + length;
+        return true;
+    }
+    return false;
+}
+
+void TakFramer::compact() {
+    if (consumed > 0) {
+        buffer.erase(0, consumed);
+        consumed = 0;
+    }
+}
+
+// TakEncoder implementation
+void TakEncoder::frame(std::string& out) const {
+    out += static_cast<char>(MAGIC);
+    ProtoWriter::append_varint(out, message.size());
+    out.append(message);
+}
+
+void TakEncoder::encode(const CoTObject& obj, std::string& out) {
+    COT_TRACE_SCOPE("takp_encode");
+    uint64_t start = metrics_now_ns();
+    
+    // Same times as CoTObject::to_xml()
+    int64_t now = now_ms();
+    int64_t stale = now + (obj.is_persistent() ? 24 * 3600 * 1000 : 10 * 60 * 1000);
+    bool symbol = !obj.get_sidc().empty();
+
+    message.clear();
+    ProtoWriter writer(message);
+    size_t event = writer.begin(TAK_MESSAGE_COT_EVENT);
+    writer.bytes(EVENT_TYPE, obj.get_type());
+    writer.bytes(EVENT_UID, obj.get_uid());
+    writer.varint(EVENT_SEND_TIME, now);
+    writer.varint(EVENT_START_TIME, now);
+    writer.varint(EVENT_STALE_TIME, stale);
+    writer.bytes(EVENT_HOW, obj.get_how());
+    writer.fixed64(EVENT_LAT, obj.get_latitude());
+    writer.fixed64(EVENT_LON, obj.get_longitude());
+    writer.fixed64(EVENT_HAE, obj.get_hae());
+    writer.fixed64(EVENT_CE, 9999999.0);
+    writer.fixed64(EVENT_LE, 9999999.0);
+
+    size_t detail = writer.begin(EVENT_DETAIL);
+
+    // Elements without a structured field travel as XML
+    size_t xml = writer.begin(DETAIL_XML);
+    write_detail(message, UidDetail{"tactical-wrapper"});
+    if (symbol) {
+        write_detail(message, StatusDetail{true});
+        scratch = "34ae1613-9645-4222-a9d2-e5f243dea2865/Military/2525C-mil-std-2525c/";
+        scratch += obj.get_type();
+        write_detail(message, UserIconDetail{scratch});
+        write_detail(message, FlowTagsDetail{"2525c-mil-std-2525c"});
+    }
+    if (obj.is_persistent()) {
+        write_detail(message, RemarksDetail{"Persistent tactical object"});
+        write_detail(message, ArchiveDetail{});
+        write_detail(message, LinkDetail{"p-p", "a-f-G-U-C", "ANDROID-"});
+    }
+    writer.end(xml);
+
+    size_t contact = writer.begin(2);
+    writer.bytes(1, "*:-1:stcp");
+    writer.bytes(2, obj.get_callsign());
+    writer.end(contact);
+
+    size_t group = writer.begin(3);
+    writer.bytes(1, obj.get_team());
+    writer.bytes(2, "Team Member");
+    writer.end(group);
+
+    if (obj.is_persistent()) {
+        size_t precision = writer.begin(4);
+        writer.bytes(1, "USER");
+        writer.bytes(2, "DTED0");
+        writer.end(precision);
+    }
+    if (symbol) {
+        size_t takv = writer.begin(6);
+        writer.bytes(1, "tactical-wrapper");
+        writer.bytes(2, "Linux");
+        writer.bytes(3, "Linux");
+        writer.bytes(4, "1.0");
+        writer.end(takv);
+        writer.end(writer.begin(7));  // Stationary track: speed and course 0
+    }
+
+    writer.end(detail);
+    writer.end(event);
+    frame(out);
+    encode_time().observe_since(start);
+}
+
+void TakEncoder::attribute(ProtoWriter& writer, uint32_t field, std::string_view raw) {
+    if (raw.find('&') == std::string_view::npos) {
+        writer.bytes(field, raw);
+        return;
+    }
+    scratch.clear();
+    append_xml_unescaped(scratch, raw);
+    writer.bytes(field, scratch);
+}
+
+int TakEncoder::schema_index(uint32_t element, unsigned& seen) const {
+    std::string_view name = tape.name(element);
+    for (int i = 0; i < DETAIL_SCHEMA_SIZE; i++) {
+        const DetailSchema& schema = DETAIL_SCHEMA[i];
+        if (schema.element != name) continue;
+
+        // Only one of each, and only if nothing would be lost
+        if ((seen & (1u << i)) || tape.first_child(element) != CoTTape::NONE) return -1;
+        for (char c : tape.text(element)) {
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return -1;
+        }
+
+        const CoTTape::Attribute* attrs = tape.attributes_of(element);
+        for (uint32_t a = 0; a < tape.element(element).attribute_count; a++) {
+            std::string_view value = tape.attribute_value(attrs[a]);
+            double number;
+            uint64_t count;
+            if (attribute_index(schema, tape.attribute_name(attrs[a])) < 0 ||
+                (schema.kind == ValueKind::DOUBLE && !parse_double(value, number)) ||
+                (schema.kind == ValueKind::UINT && (!parse_uint(value, count) || count > UINT32_MAX))) {
+                return -1;
+            }
+        }
+        seen |= 1u << i;
+        return i;
+    }
+    return -1;
+}
+
+void TakEncoder::write_structured(ProtoWriter& writer, uint32_t element, int index) {
+    const DetailSchema& schema = DETAIL_SCHEMA[index];
+    size_t mark = writer.begin(schema.field);
+
+    const CoTTape::Attribute* attrs = tape.attributes_of(element);
+    for (uint32_t a = 0; a < tape.element(element).attribute_count; a++) {
+        uint32_t field = static_cast<uint32_t>(attribute_index(schema, tape.attribute_name(attrs[a])) + 1);
+        std::string_view value = tape.attribute_value(attrs[a]);
+        double number = 0.0;
+        uint64_t count = 0;
+        switch (schema.kind) {
+            case ValueKind::STRING: attribute(writer, field, value); break;
+            case ValueKind::UINT: parse_uint(value, count); writer.varint(field, count); break;
+            case ValueKind::DOUBLE: parse_double(value, number); writer.fixed64(field, number); break;
+        }
+    }
+    writer.end(mark);
+}
+
+bool TakEncoder::encode_xml(std::string_view xml, std::string& out) {
+    COT_TRACE_SCOPE("takp_encode");
+    uint64_t start = metrics_now_ns();
+    if (!tape.build(xml) || tape.name(0) != "event") {
+        return false;
+    }
+
+    message.clear();
+    ProtoWriter writer(message);
+    size_t event = writer.begin(TAK_MESSAGE_COT_EVENT);
+    attribute(writer, EVENT_TYPE, tape.attribute(0, "type"));
+    attribute(writer, EVENT_ACCESS, tape.attribute(0, "access"));
+    attribute(writer, EVENT_QOS, tape.attribute(0, "qos"));
+    attribute(writer, EVENT_OPEX, tape.attribute(0, "opex"));
+    attribute(writer, EVENT_UID, tape.attribute(0, "uid"));
+
+    int64_t time_ms;
+    if (parse_cot_time(tape.attribute(0, "time"), time_ms)) writer.varint(EVENT_SEND_TIME, time_ms);
+    if (parse_cot_time(tape.attribute(0, "start"), time_ms)) writer.varint(EVENT_START_TIME, time_ms);
+    if (parse_cot_time(tape.attribute(0, "stale"), time_ms)) writer.varint(EVENT_STALE_TIME, time_ms);
+    attribute(writer, EVENT_HOW, tape.attribute(0, "how"));
+
+    uint32_t point = tape.child(0, "point");
+    if (point != CoTTape::NONE) {
+        static constexpr std::pair<const char*, uint32_t> point_fields[] = {
+            {"lat", EVENT_LAT}, {"lon", EVENT_LON}, {"hae", EVENT_HAE}, {"ce", EVENT_CE}, {"le", EVENT_LE}};
+        for (const auto& f : point_fields) {
+            double value;
+            if (parse_double(tape.attribute(point, f.first), value)) writer.fixed64(f.second, value);
+        }
+    }
+
+    uint32_t detail = tape.child(0, "detail");
+    if (detail != CoTTape::NONE) {
+        size_t mark = writer.begin(EVENT_DETAIL);
+        std::string_view source = tape.source();
+
+        // Everything the schema cannot hold is passed through verbatim
+        unsigned seen = 0;
+        size_t xml_mark = writer.begin(DETAIL_XML);
+        for (uint32_t child = tape.first_child(detail); child != CoTTape::NONE; child = tape.next_sibling(child)) {
+            if (schema_index(child, seen) >= 0) continue;
+
+            const CoTTape::Element& e = tape.element(child);
+            size_t start = e.name_offset - 1;
+            size_t end = e.content_offset;
+            if (source[e.content_offset - 2] != '/') {
+                end = source.find('>', e.content_offset + e.content_length);
+                end = end == std::string_view::npos ? source.size() : end + 1;
+            }
+            message.append(source.data() + start, end - start);
+        }
+        writer.end(xml_mark, false);
+
+        seen = 0;
+        for (uint32_t child = tape.first_child(detail); child != CoTTape::NONE; child = tape.next_sibling(child)) {
+            int index = schema_index(child, seen);
+            if (index >= 0) write_structured(writer, child, index);
+        }
+        writer.end(mark);
+    }
+
+    writer.end(event);
+    frame(out);
+    encode_time().observe_since(start);
+    return true;
+}
+
+size_t TakEncoder::encode_stream(std::string_view xml, std::string& out, size_t* failed) {
+    size_t encoded = 0;
+    size_t rejected = 0;
+    size_t pos = 0;
+    while (true) {
+        size_t start = std::min(xml.find("<?xml", pos), xml.find("<event", pos));
+        if (start == std::string_view::npos) break;
+        size_t end = xml.find("</event>", start);
+        if (end == std::string_view::npos) {
+            rejected++;  // Truncated last event
+            break;
+        }
+        end += 8;
+        if (encode_xml(xml.substr(start, end - start), out)) {
+            encoded++;
+        } else {
+            rejected++;
+        }
+        pos = end;
+    }
+    if (failed) *failed = rejected;
+    return encoded;
+}
+
+// Decoding
+bool decode_tak_message(std::string_view payload, CoTParser::CoTMessageView& msg, BatchArena& arena) {
+    COT_TRACE_SCOPE("takp_decode");
+    StringInterner& strings = StringInterner::global();
+    msg = CoTParser::CoTMessageView();
+
+    EventFields event;
+    if (!read_event(payload, event)) {
+        return false;
+    }
+
+    // The XML path validates the whole document; here only the strings the
+    // view exposes are checked
+    if (!is_valid_utf8(event.uid) || !is_valid_utf8(event.type) || !is_valid_utf8(event.how)) {
+        return false;
+    }
+    msg.uid = arena.copy(event.uid);
+    msg.type = strings.intern_or_copy(event.type, msg.type_spill, arena);
+    msg.how = strings.intern_or_copy(event.how, msg.how_spill, arena);
+    msg.time = arena_time(event.send_time, arena);
+    msg.start = arena_time(event.start_time, arena);
+    msg.stale = arena_time(event.stale_time, arena);
+    msg.latitude = event.lat;
+    msg.longitude = event.lon;
+    msg.hae = event.hae;
+    if (!CompactPosition::from_degrees(event.lat, event.lon, event.hae, msg.position)) {
+        return false;
+    }
+    msg.position.ce = CompactPosition::error_from_meters(event.ce);
+    msg.position.le = CompactPosition::error_from_meters(event.le);
+
+    std::string_view callsign, team, xml_detail;
+    ProtoReader detail(event.detail);
+    while (detail.next()) {
+        switch (detail.field()) {
+            case DETAIL_XML: xml_detail = detail.bytes(); break;
+            case 2: callsign = sub_field(detail.bytes(), 2); break;
+            case 3: team = sub_field(detail.bytes(), 1); break;
+            default: break;
+        }
+    }
+
+    // A contact or group with extra attributes stayed in the XML, where its
+    // values are still escaped
+    if (callsign.empty() && !xml_detail.empty()) {
+        parse_detail_string(CoTParser::peek_attribute(xml_detail, "contact", "callsign"), callsign, arena);
+    }
+    if (team.empty() && !xml_detail.empty()) {
+        parse_detail_string(CoTParser::peek_attribute(xml_detail, "__group", "name"), team, arena);
+    }
+    if (!is_valid_utf8(callsign) || !is_valid_utf8(team)) {
+        return false;
+    }
+    msg.callsign = strings.intern_or_copy(callsign, msg.callsign_spill, arena);
+    msg.team = strings.intern_or_copy(team, msg.team_spill, arena);
+    return detail.ok();
+}
+
+bool tak_to_xml(std::string_view payload, std::string& out) {
+    COT_TRACE_SCOPE("takp_to_xml");
+    EventFields event;
+    if (!read_event(payload, event)) {
+        return false;
+    }
+
+    out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<event version=\"2.0\"";
+    append_attribute(out, "uid", event.uid);
+    append_attribute(out, "type", event.type);
+    append_attribute(out, "how", event.how);
+    append_time(out, "time", event.send_time);
+    append_time(out, "start", event.start_time);
+    append_time(out, "stale", event.stale_time);
+    if (!event.access.empty()) append_attribute(out, "access", event.access);
+    if (!event.qos.empty()) append_attribute(out, "qos", event.qos);
+    if (!event.opex.empty()) append_attribute(out, "opex", event.opex);
+
+    out += "><point lat=\"";
+    append_double(out, event.lat);
+    out += "\" lon=\"";
+    append_double(out, event.lon);
+    out += "\" hae=\"";
+    append_double(out, event.hae);
+    out += "\" ce=\"";
+    append_double(out, event.ce);
+    out += "\" le=\"";
+    append_double(out, event.le);
+    out += "\"/><detail>";
+
+    std::string_view xml_detail;
+    ProtoReader detail(event.detail);
+    while (detail.next()) {
+        if (detail.field() == DETAIL_XML) {
+            xml_detail = detail.bytes();
+            continue;
+        }
+        const DetailSchema* schema = nullptr;
+        for (const auto& s : DETAIL_SCHEMA) {
+            if (s.field == detail.field()) schema = &s;
+        }
+        if (!schema) continue;
+
+        out.append("<").append(schema->element);
+        unsigned present = 0;
+        ProtoReader fields(detail.bytes());
+        while (fields.next()) {
+            if (fields.field() < 1 || fields.field() > 4 || schema->attributes[fields.field() - 1].empty()) continue;
+            std::string_view name = schema->attributes[fields.field() - 1];
+            present |= 1u << (fields.field() - 1);
+            switch (schema->kind) {
+                case ValueKind::STRING:
+                    append_attribute(out, name, fields.bytes());
+                    break;
+                case ValueKind::UINT:
+                    out.append(" ").append(name).append("=\"").append(std::to_string(fields.varint())) += '"';
+                    break;
+                case ValueKind::DOUBLE:
+                    out.append(" ").append(name).append("=\"");
+                    append_double(out, fields.fixed64());
+                    out += '"';
+                    break;
+            }
+        }
+        // Zero values are not on the wire, but a track always has both
+        for (int i = 0; schema->kind == ValueKind::DOUBLE && i < 2; i++) {
+            if (!(present & (1u << i))) out.append(" ").append(schema->attributes[i]).append("=\"0\"");
+        }
+        out += "/>";
+    }
+    out.append(xml_detail).append("</detail></event>");
+    return detail.ok();
+}
+
+// Negotiation
+namespace {
+
+bool offers_version(std::string_view event, std::string_view version) {
+    size_t pos = 0;
+    while ((pos = event.find("<TakProtocolSupport", pos)) != std::string_view::npos) {
+        if (CoTParser::peek_attribute(event.substr(pos), "TakProtocolSupport", "version") == version) {
+            return true;
+        }
+        pos++;
+    }
+    return false;
+}
+
+std::string control_request() {
+    int64_t ms = now_ms();
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<event version=\"2.0\" uid=\"tactical-wrapper-";
+    xml += std::to_string(getpid());
+    xml += "\" type=\"t-x-takp-q\" how=\"m-g\"";
+    append_time(xml, "time", ms);
+    append_time(xml, "start", ms);
+    append_time(xml, "stale", ms + 60000);
+    xml += "><point lat=\"0.0\" lon=\"0.0\" hae=\"0.0\" ce=\"999999\" le=\"999999\"/>"
+           "<detail><TakControl><TakRequest version=\"1\"/></TakControl></detail></event>";
+    return xml;
+}
+
+} // namespace
+
+bool negotiate_tak_protocol(CoTTransport& connection, int timeout_ms, std::string& leftover, bool verbose) {
+    leftover.clear();
+    if (!connection.set_nonblocking(true)) {
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::string buffer;
+    std::string xml_events;  // Ordinary events that arrived while negotiating
+    bool requested = false;
+    bool switched = false;
+    bool done = false;
+    char chunk[16384];
+
+    while (!done) {
+        size_t pos = 0;
+        while (!done) {
+            size_t start = std::min(buffer.find("<?xml", pos), buffer.find("<event", pos));
+            size_t end = start == std::string::npos ? start : buffer.find("</event>", start);
+            if (end == std::string::npos) break;
+            end += 8;
+            std::string_view event(buffer.data() + start, end - start);
+            std::string_view type = CoTParser::peek_attribute(event, "event", "type");
+            pos = end;
+
+            if (type == "t-x-takp-v" && !requested) {
+                if (!offers_version(event, "1")) {
+                    if (verbose) std::cerr << "Server does not offer TAK Protocol version 1\n";
+                    done = true;
+                } else if (!connection.send_data(control_request())) {
+                    done = true;
+                } else {
+                    requested = true;
+                }
+            } else if (type == "t-x-takp-r") {
+                switched = CoTParser::peek_attribute(event, "TakResponse", "status") == "true";
+                if (!switched && verbose) std::cerr << "Server refused TAK Protocol version 1\n";
+                done = true;
+            } else if (type.compare(0, 8, "t-x-takp") != 0) {
+                xml_events.append(event.data(), event.size());
+            }
+        }
+        buffer.erase(0, pos);
+        if (done) break;
+
+        int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+        if (remaining <= 0) {
+            if (verbose) std::cerr << "No TAK Protocol negotiation from server, staying with XML\n";
+            break;
+        }
+
+        int received = connection.receive_data(chunk, sizeof(chunk));
+        if (received > 0) {
+            buffer.append(chunk, received);
+            continue;
+        }
+        if (!connection.would_block(received)) {
+            break;
+        }
+        struct pollfd pfd = {connection.get_socket_fd(), POLLIN, 0};
+        poll(&pfd, 1, remaining);
+    }
+
+    connection.set_nonblocking(false);
+
+    // Hand over everything in the encoding the stream continues in
+    if (switched) {
+        TakEncoder encoder;
+        encoder.encode_stream(xml_events, leftover);
+    } else {
+        leftover = xml_events;
+    }
+    leftover += buffer;
+    return switched;
+}
+
+} // namespace CoTCommon
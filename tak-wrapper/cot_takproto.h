@@ -0,0 +1,151 @@
+#ifndef COT_TAKPROTO_H
+#define COT_TAKPROTO_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "cot_common.h"
+
+namespace CoTCommon {
+
+// TAK Protocol version 1: the binary encoding TAK servers and clients switch
+// to on streaming connections once both sides agree. Every message is
+//
+//   0xbf <varint payload length> <TakMessage protobuf>
+//
+// where TakMessage carries a CotEvent whose Detail has structured fields for
+// the common elements (contact, __group, precisionlocation, status, takv,
+// track) and keeps everything else as an XML string (xmlDetail). Only the
+// handful of messages in that schema are needed, so the wire format is
+// written and read by hand rather than through generated code.
+
+// Appends protobuf fields to a caller-owned buffer. Zero and empty values
+// are skipped, as proto3 does.
+class ProtoWriter {
+public:
+    explicit ProtoWriter(std::string& buffer) : out(buffer) {}
+
+    void varint(uint32_t field, uint64_t value);
+    void fixed64(uint32_t field, double value);
+    void bytes(uint32_t field, std::string_view value);
+
+    // Length-delimited field written in place: begin() returns a mark to
+    // hand to end() once the contents have been appended. With keep_empty
+    // false a field that stayed empty is removed again.
+    size_t begin(uint32_t field);
+    void end(size_t mark, bool keep_empty = true);
+
+    std::string& buffer() { return out; }
+
+    static void append_varint(std::string& out, uint64_t value);
+
+private:
+    std::string& out;
+};
+
+// Cursor over one protobuf message. Views returned by bytes() point into
+// the input.
+class ProtoReader {
+public:
+    explicit ProtoReader(std::string_view message) : data(message), pos(0), good(true) {}
+
+    // Advance to the next field; false at the end or on malformed input
+    bool next();
+
+    uint32_t field() const { return tag >> 3; }
+    uint64_t varint() const { return value; }
+    double fixed64() const;
+    std::string_view bytes() const { return payload; }
+
+    // False if next() stopped on malformed input rather than the end
+    bool ok() const { return good; }
+
+    static bool read_varint(std::string_view data, size_t& pos, uint64_t& value);
+
+private:
+    std::string_view data;
+    size_t pos;
+    bool good;
+    uint64_t tag = 0;
+    uint64_t value = 0;
+    std::string_view payload;
+};
+
+// Splits a TAK Protocol stream into TakMessage payloads. Bytes that do not
+// start with the magic byte are skipped up to the next one.
+class TakFramer {
+private:
+    std::string buffer;
+    size_t consumed;
+    size_t max_message;
+    uint64_t skipped;
+
+public:
+    explicit TakFramer(size_t max_message_bytes = 1024 * 1024);
+
+    void append(const char* data, size_t len);
+
+    // Return the next complete payload (without magic byte and length)
+    bool next(std::string_view& payload);
+
+    // Drop consumed bytes
+    void compact();
+
+    // Preallocate, so steady-state appends do not allocate
+    void reserve(size_t bytes) { buffer.reserve(bytes); }
+
+    size_t pending() const { return buffer.size() - consumed; }
+    uint64_t skipped_bytes() const { return skipped; }
+};
+
+// Builds framed TakMessages. The encoder keeps its parse tape and scratch
+// space, so steady-state encoding only grows the output buffer.
+class TakEncoder {
+public:
+    static constexpr unsigned char MAGIC = 0xbf;
+
+    // Append obj as one framed message
+    void encode(const CoTObject& obj, std::string& out);
+
+    // Append one rendered XML event as a framed message; false if it is not
+    // a CoT event
+    bool encode_xml(std::string_view xml, std::string& out);
+
+    // Encode every event in a run of rendered XML (e.g. a daemon batch);
+    // returns how many were encoded and, in failed, how many were not
+    size_t encode_stream(std::string_view xml, std::string& out, size_t* failed = nullptr);
+
+private:
+    CoTTape tape;
+    std::string message;   // Payload under construction
+    std::string scratch;   // Entity-decoded attribute values, icon paths
+
+    void frame(std::string& out) const;
+    void attribute(ProtoWriter& writer, uint32_t field, std::string_view raw);
+    int schema_index(uint32_t element, unsigned& seen) const;
+    void write_structured(ProtoWriter& writer, uint32_t element, int index);
+};
+
+// Fill msg from a TakMessage payload; per-event strings are copied into the
+// arena. False if the payload is malformed, carries no CotEvent or has a
+// uid, type, how, callsign or team that is not valid UTF-8. The view
+// has no tape: detail fields beyond callsign and team need tak_to_xml().
+bool decode_tak_message(std::string_view payload, CoTParser::CoTMessageView& msg, BatchArena& arena);
+
+// Append a TakMessage payload as an XML event (structured detail first,
+// then xmlDetail verbatim); false if it carries no CotEvent
+bool tak_to_xml(std::string_view payload, std::string& out);
+
+// Run the client side of the protocol negotiation on a freshly connected
+// stream: wait up to timeout_ms for the server to announce version 1
+// (t-x-takp-v), request it (t-x-takp-q) and wait for the response
+// (t-x-takp-r). Returns true once both sides have switched to TAK Protocol;
+// on false the connection stays XML. Whatever else arrived meanwhile is left
+// in leftover for the caller's framer, already in the negotiated encoding.
+bool negotiate_tak_protocol(CoTTransport& connection, int timeout_ms, std::string& leftover,
+                            bool verbose = false);
+
+} // namespace CoTCommon
+
+#endif // COT_TAKPROTO_H
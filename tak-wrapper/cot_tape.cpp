@@ -0,0 +1,231 @@
+#include "cot_tape.h"
+
+#include <cstring>
+
+namespace CoTCommon {
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool starts_with(std::string_view str, size_t pos, std::string_view prefix) {
+    return str.compare(pos, prefix.size(), prefix) == 0;
+}
+
+} // namespace
+
+void CoTTape::close_element(uint32_t index, size_t end_offset) {
+    Element& e = elements[index];
+    e.content_length = static_cast<uint32_t>(end_offset - e.content_offset);
+    e.subtree_end = static_cast<uint32_t>(elements.size());
+}
+
+bool CoTTape::build(std::string_view xml) {
+    xml_source = xml;
+    elements.clear();
+    attributes.clear();
+    open_stack.clear();
+
+    const size_t n = xml.size();
+    size_t pos = 0;
+
+    while (pos < n) {
+        const char* lt = static_cast<const char*>(memchr(xml.data() + pos, '<', n - pos));
+        if (!lt) break;
+        size_t tag = lt - xml.data();
+        if (tag + 1 >= n) return false;
+
+        char kind = xml[tag + 1];
+
+        // Declarations, comments and CDATA carry no structure we index
+        if (kind == '?' || kind == '!') {
+            std::string_view terminator = ">";
+            if (kind == '?') terminator = "?>";
+            else if (starts_with(xml, tag, "<!--")) terminator = "-->";
+            else if (starts_with(xml, tag, "<![CDATA[")) terminator = "]]>";
+
+            size_t end = xml.find(terminator, tag + 2);
+            if (end == std::string_view::npos) return false;
+            pos = end + terminator.size();
+            continue;
+        }
+
+        // Close tag: pop up to and including the matching element
+        if (kind == '/') {
+            size_t gt = xml.find('>', tag + 2);
+            if (gt == std::string_view::npos) return false;
+
+            size_t name_end = tag + 2;
+            while (name_end < gt && !is_space(xml[name_end])) name_end++;
+            std::string_view close_name = xml.substr(tag + 2, name_end - tag - 2);
+
+            while (!open_stack.empty()) {
+                uint32_t index = open_stack.back();
+                open_stack.pop_back();
+                close_element(index, tag);
+                if (name(index) == close_name) break;
+            }
+
+            pos = gt + 1;
+            continue;
+        }
+
+        // Open tag
+        size_t p = tag + 1;
+        while (p < n && !is_space(xml[p]) && xml[p] != '/' && xml[p] != '>') p++;
+
+        Element e;
+        e.name_offset = static_cast<uint32_t>(tag + 1);
+        e.name_length = static_cast<uint32_t>(p - tag - 1);
+        e.parent = open_stack.empty() ? NONE : open_stack.back();
+        e.depth = static_cast<uint32_t>(open_stack.size());
+        e.first_attribute = static_cast<uint32_t>(attributes.size());
+        e.attribute_count = 0;
+        e.content_offset = 0;
+        e.content_length = 0;
+        e.subtree_end = NONE;
+
+        // Walk the attributes up to the end of the tag
+        bool self_closing = false;
+        while (p < n && xml[p] != '>') {
+            if (xml[p] == '/') {
+                self_closing = true;
+                p++;
+                continue;
+            }
+            if (is_space(xml[p])) {
+                p++;
+                continue;
+            }
+            self_closing = false;
+
+            size_t attr_start = p;
+            while (p < n && xml[p] != '=' && xml[p] != '>' && xml[p] != '/' && !is_space(xml[p])) p++;
+            size_t attr_end = p;
+
+            while (p < n && is_space(xml[p])) p++;
+            if (p >= n || xml[p] != '=') continue;  // Attribute without a value
+            p++;
+            while (p < n && is_space(xml[p])) p++;
+            if (p >= n || (xml[p] != '"' && xml[p] != '\'')) continue;
+
+            char quote = xml[p++];
+            const char* value_end = static_cast<const char*>(memchr(xml.data() + p, quote, n - p));
+            if (!value_end) return false;
+            size_t value_end_pos = value_end - xml.data();
+
+            attributes.push_back(Attribute{
+                static_cast<uint32_t>(attr_start), static_cast<uint32_t>(attr_end - attr_start),
+                static_cast<uint32_t>(p), static_cast<uint32_t>(value_end_pos - p)});
+            e.attribute_count++;
+            p = value_end_pos + 1;
+        }
+        if (p >= n) return false;  // Unterminated tag
+
+        e.content_offset = static_cast<uint32_t>(p + 1);
+        uint32_t index = static_cast<uint32_t>(elements.size());
+        elements.push_back(e);
+
+        if (self_closing) {
+            close_element(index, p + 1);
+        } else {
+            open_stack.push_back(index);
+        }
+        pos = p + 1;
+    }
+
+    // Tolerate truncated documents by closing whatever is still open
+    while (!open_stack.empty()) {
+        close_element(open_stack.back(), n);
+        open_stack.pop_back();
+    }
+
+    return !elements.empty();
+}
+
+std::string_view CoTTape::name(uint32_t index) const {
+    return slice(elements[index].name_offset, elements[index].name_length);
+}
+
+std::string_view CoTTape::text(uint32_t index) const {
+    return slice(elements[index].content_offset, elements[index].content_length);
+}
+
+const CoTTape::Attribute* CoTTape::attributes_of(uint32_t index) const {
+    return attributes.data() + elements[index].first_attribute;
+}
+
+std::string_view CoTTape::attribute_name(const Attribute& attr) const {
+    return slice(attr.name_offset, attr.name_length);
+}
+
+std::string_view CoTTape::attribute_value(const Attribute& attr) const {
+    return slice(attr.value_offset, attr.value_length);
+}
+
+std::string_view CoTTape::attribute(uint32_t index, std::string_view attr_name) const {
+    const Attribute* attrs = attributes_of(index);
+    for (uint32_t i = 0; i < elements[index].attribute_count; i++) {
+        if (attribute_name(attrs[i]) == attr_name) {
+            return attribute_value(attrs[i]);
+        }
+    }
+    return std::string_view();
+}
+
+uint32_t CoTTape::first_child(uint32_t index) const {
+    return index + 1 < elements[index].subtree_end ? index + 1 : NONE;
+}
+
+uint32_t CoTTape::next_sibling(uint32_t index) const {
+    uint32_t parent = elements[index].parent;
+    uint32_t next = elements[index].subtree_end;
+    if (parent == NONE || next >= elements[parent].subtree_end) return NONE;
+    return next;
+}
+
+uint32_t CoTTape::child(uint32_t parent, std::string_view child_name) const {
+    for (uint32_t i = first_child(parent); i != NONE; i = next_sibling(i)) {
+        if (name(i) == child_name) return i;
+    }
+    return NONE;
+}
+
+uint32_t CoTTape::find_element(std::string_view path) const {
+    if (elements.empty()) return NONE;
+
+    uint32_t current = 0;
+    bool first = true;
+    while (!path.empty()) {
+        size_t slash = path.find('/');
+        std::string_view segment = path.substr(0, slash);
+        path = slash == std::string_view::npos ? std::string_view() : path.substr(slash + 1);
+        if (segment.empty()) continue;
+
+        // Allow paths to spell out the root element
+        if (first && segment == name(0)) {
+            first = false;
+            continue;
+        }
+        first = false;
+
+        current = child(current, segment);
+        if (current == NONE) return NONE;
+    }
+    return current;
+}
+
+std::string_view CoTTape::find(std::string_view path) const {
+    size_t at = path.find('@');
+    uint32_t index = find_element(path.substr(0, at));
+    if (index == NONE) return std::string_view();
+
+    if (at == std::string_view::npos) {
+        return text(index);
+    }
+    return attribute(index, path.substr(at + 1));
+}
+
+} // namespace CoTCommon
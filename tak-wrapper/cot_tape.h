@@ -0,0 +1,90 @@
+#ifndef COT_TAPE_H
+#define COT_TAPE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace CoTCommon {
+
+// One-pass structural index over a CoT document. build() records every
+// element and attribute as offsets into the source text on a flat tape, so
+// any field can be resolved later without a DOM or regex pass:
+//
+//   tape.find("@uid")                 -> event attribute
+//   tape.find("point@lat")            -> attribute of a child element
+//   tape.find("detail/track@speed")   -> nested detail attribute
+//   tape.find("detail/remarks")       -> element text
+//
+// Paths are relative to the root element (a leading "event" is accepted).
+// Values are returned as raw views into the source, without entity decoding,
+// and are only valid while the source buffer is alive and until the next
+// build(). The tape keeps its capacity, so steady-state builds do not
+// allocate.
+class CoTTape {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Element {
+        uint32_t name_offset;
+        uint32_t name_length;
+        uint32_t parent;           // NONE for the root
+        uint32_t depth;
+        uint32_t first_attribute;  // Index into the attribute tape
+        uint32_t attribute_count;
+        uint32_t content_offset;   // Everything between the open and close tag
+        uint32_t content_length;
+        uint32_t subtree_end;      // Index one past the last descendant
+    };
+
+    struct Attribute {
+        uint32_t name_offset;
+        uint32_t name_length;
+        uint32_t value_offset;
+        uint32_t value_length;
+    };
+
+    // Index a document. Returns false if no element was found or a tag is
+    // unterminated; unclosed elements are closed at the end of the input.
+    bool build(std::string_view xml);
+
+    // Resolve a path to an attribute value or element text (empty if absent)
+    std::string_view find(std::string_view path) const;
+
+    // Resolve an element path to its index, or NONE
+    uint32_t find_element(std::string_view path) const;
+
+    // Direct child of parent with the given name, or NONE
+    uint32_t child(uint32_t parent, std::string_view name) const;
+
+    // Iterate direct children: first_child(i), then next_sibling(child)
+    uint32_t first_child(uint32_t index) const;
+    uint32_t next_sibling(uint32_t index) const;
+
+    std::string_view name(uint32_t index) const;
+    std::string_view text(uint32_t index) const;
+    std::string_view attribute(uint32_t index, std::string_view attr_name) const;
+    std::string_view attribute_name(const Attribute& attr) const;
+    std::string_view attribute_value(const Attribute& attr) const;
+
+    size_t element_count() const { return elements.size(); }
+    const Element& element(uint32_t index) const { return elements[index]; }
+    const Attribute* attributes_of(uint32_t index) const;
+
+    std::string_view source() const { return xml_source; }
+
+private:
+    std::string_view xml_source;
+    std::vector<Element> elements;
+    std::vector<Attribute> attributes;
+    std::vector<uint32_t> open_stack;
+
+    void close_element(uint32_t index, size_t end_offset);
+    std::string_view slice(uint32_t offset, uint32_t length) const {
+        return xml_source.substr(offset, length);
+    }
+};
+
+} // namespace CoTCommon
+
+#endif // COT_TAPE_H
@@ -0,0 +1,217 @@
+#include "cot_text.h"
+
+#include <charconv>
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace CoTCommon {
+
+namespace {
+
+const char* xml_entity(char c) {
+    switch (c) {
+        case '&': return "&amp;";
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        case '"': return "&quot;";
+        default: return "&apos;";
+    }
+}
+
+bool is_xml_special(char c) {
+    return c == '&' || c == '<' || c == '>' || c == '"' || c == '\'';
+}
+
+char* write_utf8(char* out, uint32_t code) {
+    if (code < 0x80) {
+        *out++ = static_cast<char>(code);
+    } else if (code < 0x800) {
+        *out++ = static_cast<char>(0xc0 | (code >> 6));
+        *out++ = static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        *out++ = static_cast<char>(0xe0 | (code >> 12));
+        *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        *out++ = static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        *out++ = static_cast<char>(0xf0 | (code >> 18));
+        *out++ = static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        *out++ = static_cast<char>(0x80 | (code & 0x3f));
+    }
+    return out;
+}
+
+// The character a predefined or numeric entity (without & and ;) stands for.
+// NUL and surrogates are not characters and stay undecoded.
+bool decode_entity(std::string_view entity, uint32_t& code) {
+    if (entity == "amp") code = '&';
+    else if (entity == "lt") code = '<';
+    else if (entity == "gt") code = '>';
+    else if (entity == "quot") code = '"';
+    else if (entity == "apos") code = '\'';
+    else {
+        if (entity.size() < 2 || entity[0] != '#') return false;
+        bool hex = entity[1] == 'x';
+        const char* end = entity.data() + entity.size();
+        auto result = std::from_chars(entity.data() + (hex ? 2 : 1), end, code, hex ? 16 : 10);
+        return result.ec == std::errc() && result.ptr == end && code != 0 && code <= 0x10ffff &&
+               (code < 0xd800 || code > 0xdfff);
+    }
+    return true;
+}
+
+} // namespace
+
+size_t find_xml_special(std::string_view text) {
+    const char* p = text.data();
+    size_t n = text.size();
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quot = _mm_set1_epi8('"');
+    const __m128i apos = _mm_set1_epi8('\'');
+    for (; i + 16 <= n; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, amp), _mm_cmpeq_epi8(chunk, lt)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(chunk, gt), _mm_cmpeq_epi8(chunk, quot)));
+        int mask = _mm_movemask_epi8(_mm_or_si128(hits, _mm_cmpeq_epi8(chunk, apos)));
+        if (mask) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (is_xml_special(p[i])) return i;
+    }
+    return n;
+}
+
+void append_xml_escaped(std::string& out, std::string_view text) {
+    size_t pos = 0;
+    while (true) {
+        size_t hit = pos + find_xml_special(text.substr(pos));
+        out.append(text.data() + pos, hit - pos);
+        if (hit == text.size()) return;
+        out += xml_entity(text[hit]);
+        pos = hit + 1;
+    }
+}
+
+size_t escape_xml(std::string_view text, char* out) {
+    char* start = out;
+    size_t pos = 0;
+    while (true) {
+        size_t hit = pos + find_xml_special(text.substr(pos));
+        out += text.copy(out, hit - pos, pos);
+        if (hit == text.size()) return out - start;
+        std::string_view entity = xml_entity(text[hit]);
+        out += entity.copy(out, entity.size());
+        pos = hit + 1;
+    }
+}
+
+void write_xml_escaped(std::ostream& out, std::string_view text) {
+    size_t pos = 0;
+    while (true) {
+        size_t hit = pos + find_xml_special(text.substr(pos));
+        out.write(text.data() + pos, static_cast<std::streamsize>(hit - pos));
+        if (hit == text.size()) return;
+        out << xml_entity(text[hit]);
+        pos = hit + 1;
+    }
+}
+
+size_t unescape_xml(std::string_view raw, char* out) {
+    char* start = out;
+    size_t pos = 0;
+    while (pos < raw.size()) {
+        size_t amp = raw.find('&', pos);
+        size_t semi = amp == std::string_view::npos ? amp : raw.find(';', amp);
+        if (semi == std::string_view::npos) {
+            raw.copy(out, raw.size() - pos, pos);
+            return out + (raw.size() - pos) - start;
+        }
+        out += raw.copy(out, amp - pos, pos);
+
+        uint32_t code;
+        if (decode_entity(raw.substr(amp + 1, semi - amp - 1), code)) {
+            out = write_utf8(out, code);
+        } else {
+            out += raw.copy(out, semi - amp + 1, amp);  // Unknown entity, keep as is
+        }
+        pos = semi + 1;
+    }
+    return out - start;
+}
+
+void append_xml_unescaped(std::string& out, std::string_view raw) {
+    size_t size = out.size();
+    out.resize(size + raw.size());
+    out.resize(size + unescape_xml(raw, &out[size]));
+}
+
+bool is_valid_utf8(std::string_view text) {
+    const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+    size_t n = text.size();
+    size_t i = 0;
+    while (i < n) {
+#ifdef __SSE2__
+        // Skip ASCII a block at a time, stopping at the first lead byte
+        bool tail = true;
+        while (i + 64 <= n) {
+            const auto* block = reinterpret_cast<const __m128i*>(p + i);
+            __m128i any = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(block), _mm_loadu_si128(block + 1)),
+                                       _mm_or_si128(_mm_loadu_si128(block + 2), _mm_loadu_si128(block + 3)));
+            if (_mm_movemask_epi8(any)) break;
+            i += 64;
+        }
+        while (i + 16 <= n) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            int high = _mm_movemask_epi8(chunk);
+            if (high) {
+                i += static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(high)));
+                tail = false;
+                break;
+            }
+            i += 16;
+        }
+        if (tail && i == n) break;
+#endif
+        unsigned char c = p[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+
+        // Second byte range per lead byte (Unicode Table 3-7)
+        size_t length;
+        unsigned char low = 0x80, high = 0xbf;
+        if (c >= 0xc2 && c <= 0xdf) {
+            length = 2;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            length = 3;
+            if (c == 0xe0) low = 0xa0;       // Overlong
+            else if (c == 0xed) high = 0x9f;  // Surrogates
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            length = 4;
+            if (c == 0xf0) low = 0x90;       // Overlong
+            else if (c == 0xf4) high = 0x8f;  // Above U+10FFFF
+        } else {
+            return false;
+        }
+
+        if (n - i < length || p[i + 1] < low || p[i + 1] > high) return false;
+        for (size_t k = 2; k < length; k++) {
+            if ((p[i + k] & 0xc0) != 0x80) return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+} // namespace CoTCommon
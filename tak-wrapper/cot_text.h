@@ -0,0 +1,56 @@
+#ifndef COT_TEXT_H
+#define COT_TEXT_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace CoTCommon {
+
+// Text kernels for the XML paths: escaping of values written into CoT, and
+// unescaping and UTF-8 validation of what is read. Escaping and validation
+// scan 16 bytes per step with SSE2 where available (every x86-64 CPU) and
+// fall back to a byte loop elsewhere. Strings that need no work, which is
+// nearly all of them, are handled in that single scan.
+
+// Offset of the first & < > " or ' in text, or text.size() if there is none
+size_t find_xml_special(std::string_view text);
+
+// Append text as XML character data or attribute value. Runs without a
+// special character are copied through unchanged.
+void append_xml_escaped(std::string& out, std::string_view text);
+void write_xml_escaped(std::ostream& out, std::string_view text);
+
+// Escape into a buffer of at least 6 * text.size() bytes; returns the length
+size_t escape_xml(std::string_view text, char* out);
+
+// Decode the predefined and numeric entities of raw attribute or text
+// content; unknown entities, and numeric ones for NUL, surrogates or past
+// U+10FFFF, are kept as they are, so the result stays valid UTF-8 when raw
+// is. The result is never longer than raw, so out needs raw.size() bytes.
+// Returns the length.
+size_t unescape_xml(std::string_view raw, char* out);
+void append_xml_unescaped(std::string& out, std::string_view raw);
+
+// Stream form: xml << "uid=\"" << xml_escaped(uid) << '"'
+struct XmlEscaped {
+    std::string_view text;
+};
+
+inline XmlEscaped xml_escaped(std::string_view text) {
+    return XmlEscaped{text};
+}
+
+inline std::ostream& operator<<(std::ostream& out, XmlEscaped value) {
+    write_xml_escaped(out, value.text);
+    return out;
+}
+
+// Well-formed UTF-8 (RFC 3629): no overlong forms, surrogates, code points
+// above U+10FFFF or truncated sequences
+bool is_valid_utf8(std::string_view text);
+
+} // namespace CoTCommon
+
+#endif // COT_TEXT_H
@@ -0,0 +1,241 @@
+#include "cot_trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace CoTCommon {
+
+#ifdef COT_ENABLE_TRACING
+
+namespace {
+
+uint64_t steady_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Rings outlive their threads so an export still shows threads that have
+// exited. Never destroyed: threads may still trace during exit.
+struct TraceState {
+    std::mutex mutex;
+    std::vector<detail::TraceRing*> rings;
+    size_t ring_records = 65536;
+    uint64_t base_ticks = 0;  // trace_clock() and steady clock at enable()
+    uint64_t base_ns = 0;
+    std::string export_path;
+};
+
+TraceState& state() {
+    static TraceState* s = new TraceState();
+    return *s;
+}
+
+int export_pipe_write = -1;
+
+void export_signal_handler(int) {
+    int saved_errno = errno;
+    if (export_pipe_write >= 0) {
+        char c = 'e';
+        ssize_t written = write(export_pipe_write, &c, 1);
+        (void)written;
+    }
+    errno = saved_errno;
+}
+
+void export_at_exit() {
+    Tracer::export_chrome(state().export_path);
+}
+
+struct Snapshot {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+};
+
+// Copy the records the thread cannot have overwritten while we read
+void copy_ring(const detail::TraceRing& ring, std::vector<Snapshot>& out) {
+    uint64_t capacity = ring.mask + 1;
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+    uint64_t first = head > capacity ? head - capacity : 0;
+    size_t base = out.size();
+    for (uint64_t i = first; i < head; i++) {
+        const detail::TraceRecord& r = ring.records[i & ring.mask];
+        out.push_back({r.name.load(std::memory_order_relaxed), r.start.load(std::memory_order_relaxed),
+                       r.duration.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t now = ring.head.load(std::memory_order_relaxed);
+    uint64_t valid_from = now + 1 > capacity ? now + 1 - capacity : 0;
+    if (valid_from > first) {
+        size_t stale = static_cast<size_t>(std::min(valid_from - first, head - first));
+        out.erase(out.begin() + base, out.begin() + base + stale);
+    }
+}
+
+} // namespace
+
+namespace detail {
+
+TraceRing* attach_trace_ring() {
+    TraceState& s = state();
+    size_t capacity = 1;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        while (capacity < s.ring_records) capacity <<= 1;
+    }
+    auto* ring = new TraceRing();
+    ring->records = new TraceRecord[capacity]();
+    ring->mask = capacity - 1;
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tid = syscall(SYS_gettid);
+    char name[16] = {};
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0) {
+        ring->thread_name = name;
+    }
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.rings.push_back(ring);
+    }
+    trace_thread.ring = ring;
+    return ring;
+}
+
+} // namespace detail
+
+bool Tracer::enable(size_t records, uint32_t sample_every) {
+    TraceState& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.ring_records = records ? records : 1;
+        s.base_ticks = detail::trace_clock();
+        s.base_ns = steady_ns();
+    }
+    detail::trace_sample_every.store(sample_every ? sample_every : 1, std::memory_order_relaxed);
+    detail::trace_enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+void Tracer::disable() {
+    detail::trace_enabled.store(false, std::memory_order_release);
+}
+
+bool Tracer::export_chrome(const std::string& path) {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        std::cerr << "Failed to write trace " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Ticks to nanoseconds over the whole time since enable()
+    uint64_t now_ticks = detail::trace_clock();
+    uint64_t now_ns = steady_ns();
+    double ns_per_tick = 1.0;
+    if (now_ticks > s.base_ticks && now_ns > s.base_ns) {
+        ns_per_tick = static_cast<double>(now_ns - s.base_ns) / static_cast<double>(now_ticks - s.base_ticks);
+    }
+
+    int pid = static_cast<int>(getpid());
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    size_t events = 0;
+    std::vector<Snapshot> records;
+    for (const detail::TraceRing* ring : s.rings) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", pid, ring->tid, ring->thread_name.c_str());
+        first = false;
+
+        records.clear();
+        copy_ring(*ring, records);
+        for (const Snapshot& r : records) {
+            double start_us = (static_cast<double>(s.base_ns) +
+                               (static_cast<double>(r.start) - static_cast<double>(s.base_ticks)) * ns_per_tick) /
+                              1000.0;
+            double duration_us = static_cast<double>(r.duration) * ns_per_tick / 1000.0;
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"cot\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%ld}",
+                    r.name, start_us, duration_us, pid, ring->tid);
+        }
+        events += records.size();
+    }
+    fprintf(file, "\n]}\n");
+    bool ok = fclose(file) == 0;
+    std::cerr << "Trace written to " << path << " (" << events << " events)" << std::endl;
+    return ok;
+}
+
+bool Tracer::export_on_signal(const std::string& path) {
+    TraceState& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (!s.export_path.empty()) {
+            s.export_path = path;
+            return true;
+        }
+        s.export_path = path;
+    }
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        std::cerr << "Failed to create trace signal pipe: " << strerror(errno) << std::endl;
+        return false;
+    }
+    export_pipe_write = fds[1];
+
+    struct sigaction action {};
+    action.sa_handler = export_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &action, nullptr);
+
+    // Blocked in read() for the life of the process
+    std::thread([read_fd = fds[0]] {
+        char c;
+        while (read(read_fd, &c, 1) > 0) {
+            std::string target;
+            {
+                std::lock_guard<std::mutex> lock(state().mutex);
+                target = state().export_path;
+            }
+            Tracer::export_chrome(target);
+        }
+    }).detach();
+
+    std::atexit(export_at_exit);
+    return true;
+}
+
+#else
+
+bool Tracer::enable(size_t, uint32_t) {
+    std::cerr << "Tracing is not compiled in (configure with -DCOT_TRACING=ON)" << std::endl;
+    return false;
+}
+
+void Tracer::disable() {
+}
+
+bool Tracer::export_chrome(const std::string&) {
+    return false;
+}
+
+bool Tracer::export_on_signal(const std::string&) {
+    return false;
+}
+
+#endif // COT_ENABLE_TRACING
+
+} // namespace CoTCommon
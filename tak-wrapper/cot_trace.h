@@ -0,0 +1,142 @@
+#ifndef COT_TRACE_H
+#define COT_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace CoTCommon {
+
+// Scoped trace points for the hot paths, exported as Chrome trace JSON
+// (chrome://tracing or ui.perfetto.dev).
+//
+//     COT_TRACE_SCOPE("parse");
+//
+// records the start and duration of the enclosing scope while tracing is
+// on. Each thread writes fixed-size records into its own ring, overwriting
+// the oldest when full, so an export shows the most recent activity of
+// every thread. While tracing is off a trace point is one relaxed load and
+// a branch. With sampling, one in N outermost scopes is recorded together
+// with everything nested inside it.
+//
+// Built without COT_ENABLE_TRACING (cmake -DCOT_TRACING=OFF) the macro
+// expands to nothing and Tracer::enable() fails.
+class Tracer {
+public:
+    // records is the ring size per thread, rounded up to a power of two
+    static bool enable(size_t records = 65536, uint32_t sample_every = 1);
+    static void disable();
+
+    // Write every thread's ring; tracing keeps running
+    static bool export_chrome(const std::string& path);
+
+    // Export to path on SIGUSR2 and when the process exits
+    static bool export_on_signal(const std::string& path);
+};
+
+#ifdef COT_ENABLE_TRACING
+
+namespace detail {
+
+struct TraceRecord {
+    // Relaxed atomics compile to plain stores and let the exporter read a
+    // ring its thread is still writing
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> start;
+    std::atomic<uint64_t> duration;
+};
+
+struct TraceRing {
+    TraceRecord* records;
+    uint64_t mask;
+    std::atomic<uint64_t> head;
+    long tid;
+    std::string thread_name;
+};
+
+struct TraceThread {
+    TraceRing* ring;
+    uint32_t depth;      // Open trace scopes on this thread
+    uint32_t countdown;  // Outermost scopes until the next sampled one
+    bool sampled;
+};
+
+inline std::atomic<bool> trace_enabled{false};
+inline std::atomic<uint32_t> trace_sample_every{1};
+inline thread_local TraceThread trace_thread{nullptr, 0, 1, false};
+
+TraceRing* attach_trace_ring();
+
+// Timestamp counter where available, converted at export time
+inline uint64_t trace_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+} // namespace detail
+
+// name must outlive the export (use a string literal)
+class TraceScope {
+public:
+    explicit TraceScope(const char* scope_name) : name(nullptr) {
+        if (!detail::trace_enabled.load(std::memory_order_relaxed)) return;
+        detail::TraceThread& t = detail::trace_thread;
+        if (t.depth++ == 0 && --t.countdown == 0) {
+            t.countdown = detail::trace_sample_every.load(std::memory_order_relaxed);
+            t.sampled = true;
+        } else if (t.depth == 1) {
+            t.sampled = false;
+        }
+        entered = true;
+        if (!t.sampled) return;
+        name = scope_name;
+        start = detail::trace_clock();
+    }
+
+    ~TraceScope() {
+        if (!entered) return;
+        detail::TraceThread& t = detail::trace_thread;
+        t.depth--;
+        if (!name) return;
+        uint64_t end = detail::trace_clock();
+        detail::TraceRing* ring = t.ring ? t.ring : detail::attach_trace_ring();
+        if (!ring) return;
+        uint64_t h = ring->head.load(std::memory_order_relaxed);
+        detail::TraceRecord& r = ring->records[h & ring->mask];
+        r.name.store(name, std::memory_order_relaxed);
+        r.start.store(start, std::memory_order_relaxed);
+        r.duration.store(end - start, std::memory_order_relaxed);
+        ring->head.store(h + 1, std::memory_order_release);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t start = 0;
+    bool entered = false;
+};
+
+#define COT_TRACE_CONCAT_(a, b) a##b
+#define COT_TRACE_CONCAT(a, b) COT_TRACE_CONCAT_(a, b)
+#define COT_TRACE_SCOPE(name) CoTCommon::TraceScope COT_TRACE_CONCAT(cot_trace_scope_, __LINE__)(name)
+
+#else
+
+#define COT_TRACE_SCOPE(name) ((void)0)
+
+#endif // COT_ENABLE_TRACING
+
+} // namespace CoTCommon
+
+#endif // COT_TRACE_H
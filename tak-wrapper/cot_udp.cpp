@@ -0,0 +1,378 @@
+#include "cot_udp.h"
+
+#include <cerrno>
+#include <charconv>
+#include <fcntl.h>
+
+namespace CoTCommon {
+
+namespace {
+
+constexpr size_t MAX_DATAGRAM = 65507;   // Largest UDP payload over IPv4
+constexpr size_t SLOT_BYTES = 65536;
+constexpr size_t STAMP_BYTES = 64;
+constexpr std::string_view STAMP_MARK = "<!--cot-seq ";
+
+int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// UdpTransport implementation
+UdpTransport::UdpTransport(const std::string& hostname, int udp_port, Mode transport_mode,
+                           const Options& opts, bool verb)
+    : host(hostname), port(udp_port), mode(transport_mode), options(opts), verbose(verb), socket_fd(-1),
+      last_errno(0), multicast(false), source_id(std::random_device()()), next_sequence(1), received(0),
+      next_slot(0), counters{}, total_latency_ms(0.0) {
+    if (options.batch == 0) options.batch = 1;
+
+    messages.resize(options.batch);
+    iovecs.resize(2 * options.batch);
+    if (mode == Mode::SEND) {
+        stamp_buffer.resize(options.batch * STAMP_BYTES);
+    } else {
+        slots.resize(options.batch * SLOT_BYTES);
+        for (size_t i = 0; i < options.batch; i++) {
+            iovecs[i].iov_base = &slots[i * SLOT_BYTES];
+            iovecs[i].iov_len = SLOT_BYTES;
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+}
+
+UdpTransport::~UdpTransport() {
+    disconnect();
+}
+
+bool UdpTransport::connect() {
+    if (socket_fd >= 0) return true;
+
+    struct hostent* server = gethostbyname(host.c_str());
+    if (!server) {
+        std::cerr << "Error resolving hostname: " << host << std::endl;
+        return false;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    memcpy(&addr.sin_addr.s_addr, server->h_addr, server->h_length);
+    multicast = IN_MULTICAST(ntohl(addr.sin_addr.s_addr));
+
+    socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (socket_fd < 0) {
+        std::cerr << "Error creating socket\n";
+        return false;
+    }
+
+    bool ok = mode == Mode::SEND ? open_sender(addr) : open_receiver(addr);
+    if (!ok) {
+        close(socket_fd);
+        socket_fd = -1;
+        return false;
+    }
+
+    if (verbose) {
+        std::cout << (mode == Mode::SEND ? "Sending" : "Listening") << " on udp://" << host << ":" << port
+                  << (multicast ? " (multicast)" : "") << std::endl;
+    }
+    return true;
+}
+
+bool UdpTransport::open_sender(const struct sockaddr_in& addr) {
+    if (multicast) {
+        if (options.ttl > 0) {
+            setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, &options.ttl, sizeof(options.ttl));
+        }
+        int loop = options.loopback ? 1 : 0;
+        setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        if (!options.interface_address.empty()) {
+            struct in_addr local;
+            if (inet_pton(AF_INET, options.interface_address.c_str(), &local) != 1 ||
+                setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) < 0) {
+                std::cerr << "Invalid multicast interface: " << options.interface_address << std::endl;
+                return false;
+            }
+        }
+    } else if (options.ttl > 0) {
+        setsockopt(socket_fd, IPPROTO_IP, IP_TTL, &options.ttl, sizeof(options.ttl));
+    }
+
+    // A connected socket needs no address per datagram
+    if (::connect(socket_fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "Error connecting to udp://" << host << ":" << port << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool UdpTransport::open_receiver(const struct sockaddr_in& addr) {
+    int on = 1;
+    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    // Bursts are absorbed here; SO_RCVBUFFORCE lifts rmem_max when permitted
+    int requested = options.receive_buffer;
+    if (requested > 0) {
+        if (setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUFFORCE, &requested, sizeof(requested)) < 0) {
+            setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &requested, sizeof(requested));
+        }
+    }
+    socklen_t len = sizeof(counters.receive_buffer);
+    getsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &counters.receive_buffer, &len);
+    counters.receive_buffer /= 2;  // The kernel reports twice the usable size
+    if (requested > 0 && counters.receive_buffer < requested) {
+        std::cerr << "Warning: receive buffer limited to " << counters.receive_buffer
+                  << " bytes (raise net.core.rmem_max)\n";
+    }
+
+    // Binding the group address keeps other groups on the same port out
+    if (bind(socket_fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "Error binding udp://" << host << ":" << port << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (multicast) {
+        struct ip_mreq membership;
+        membership.imr_multiaddr = addr.sin_addr;
+        membership.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (!options.interface_address.empty() &&
+            inet_pton(AF_INET, options.interface_address.c_str(), &membership.imr_interface) != 1) {
+            std::cerr << "Invalid multicast interface: " << options.interface_address << std::endl;
+            return false;
+        }
+        if (setsockopt(socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+            std::cerr << "Error joining multicast group " << host << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void UdpTransport::disconnect() {
+    if (socket_fd >= 0) {
+        close(socket_fd);
+        socket_fd = -1;
+    }
+    received = 0;
+    next_slot = 0;
+}
+
+bool UdpTransport::set_nonblocking(bool enabled) {
+    if (socket_fd < 0) return false;
+    int flags = fcntl(socket_fd, F_GETFL, 0);
+    if (flags < 0) return false;
+    flags = enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(socket_fd, F_SETFL, flags) == 0;
+}
+
+bool UdpTransport::send_data(const std::string& data) {
+    // Rendered CoT may hold several events (daemon batches); one per datagram
+    split_events.clear();
+    size_t pos = 0;
+    while ((pos = data.find('<', pos)) != std::string::npos) {
+        if (data.compare(pos, 5, "<?xml") != 0 && data.compare(pos, 6, "<event") != 0) {
+            pos++;
+            continue;
+        }
+        size_t end = data.find("</event>", pos);
+        if (end == std::string::npos) break;
+        end += 8;
+        split_events.emplace_back(data.data() + pos, end - pos);
+        pos = end;
+    }
+
+    if (split_events.empty()) {
+        std::cerr << "No complete CoT event to send\n";
+        return false;
+    }
+    return send_events(split_events);
+}
+
+bool UdpTransport::send_events(const std::vector<std::string_view>& events) {
+    if (socket_fd < 0) {
+        std::cerr << "Not connected to udp://" << host << ":" << port << std::endl;
+        return false;
+    }
+
+    size_t index = 0;
+    while (index < events.size()) {
+        // Fill one sendmmsg() call
+        int64_t stamp_time = options.stamp ? now_us() : 0;
+        size_t count = 0;
+        for (; index < events.size() && count < options.batch; index++) {
+            std::string_view event = events[index];
+            if (event.size() + (options.stamp ? STAMP_BYTES : 0) > MAX_DATAGRAM) {
+                counters.oversized++;
+                continue;
+            }
+
+            struct iovec* iov = &iovecs[2 * count];
+            iov[0].iov_base = const_cast<char*>(event.data());
+            iov[0].iov_len = event.size();
+            size_t parts = 1;
+            if (options.stamp) {
+                char* stamp = &stamp_buffer[count * STAMP_BYTES];
+                int len = snprintf(stamp, STAMP_BYTES, "<!--cot-seq %08x %llu %lld-->", source_id,
+                                   static_cast<unsigned long long>(next_sequence++),
+                                   static_cast<long long>(stamp_time));
+                iov[1].iov_base = stamp;
+                iov[1].iov_len = len;
+                parts = 2;
+            }
+
+            memset(&messages[count], 0, sizeof(messages[count]));
+            messages[count].msg_hdr.msg_iov = iov;
+            messages[count].msg_hdr.msg_iovlen = parts;
+            counters.bytes += event.size();
+            count++;
+        }
+
+        size_t sent = 0;
+        while (sent < count) {
+            int n = sendmmsg(socket_fd, &messages[sent], count - sent, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == ECONNREFUSED) {
+                    // ICMP from an earlier unicast datagram; the peer is not up yet
+                    sent++;
+                    continue;
+                }
+                last_errno = errno;
+                std::cerr << "Error sending to udp://" << host << ":" << port << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+            counters.syscalls++;
+            counters.datagrams += n;
+            sent += n;
+        }
+    }
+    return true;
+}
+
+int UdpTransport::receive_data(char* buffer, size_t buffer_size) {
+    if (socket_fd < 0) {
+        last_errno = ENOTCONN;
+        return -1;
+    }
+
+    if (next_slot >= received) {
+        // Blocks (unless non-blocking) for the first datagram only
+        int n = recvmmsg(socket_fd, messages.data(), messages.size(), MSG_WAITFORONE, nullptr);
+        if (n <= 0) {
+            last_errno = n < 0 ? errno : EAGAIN;
+            return -1;
+        }
+        counters.syscalls++;
+        received = n;
+        next_slot = 0;
+    }
+
+    // Copy whole datagrams; the rest stay for the next call
+    size_t capacity = buffer_size - 1;
+    size_t used = 0;
+    while (next_slot < received) {
+        const struct mmsghdr& message = messages[next_slot];
+        const char* data = &slots[next_slot * SLOT_BYTES];
+        size_t len = message.msg_len;
+
+        if ((message.msg_hdr.msg_flags & MSG_TRUNC) || len > capacity) {
+            counters.truncated++;
+            next_slot++;
+            continue;
+        }
+        if (used + len > capacity) break;
+
+        counters.datagrams++;
+        counters.bytes += len;
+        len = strip_stamp(data, len);
+        memcpy(buffer + used, data, len);
+        used += len;
+        next_slot++;
+    }
+
+    if (used == 0) {
+        last_errno = EAGAIN;
+        return -1;
+    }
+    return static_cast<int>(used);
+}
+
+bool UdpTransport::would_block(int result) {
+    (void)result;
+    return last_errno == EAGAIN || last_errno == EWOULDBLOCK || last_errno == EINTR;
+}
+
+size_t UdpTransport::strip_stamp(const char* data, size_t len) {
+    std::string_view text(data, len);
+    size_t at = text.rfind(STAMP_MARK);
+    if (at == std::string_view::npos) return len;
+
+    const char* p = data + at + STAMP_MARK.size();
+    const char* end = data + len;
+    uint32_t source;
+    uint64_t sequence;
+    int64_t sent_us;
+    auto r = std::from_chars(p, end, source, 16);
+    if (r.ec != std::errc() || r.ptr == end || *r.ptr != ' ') return len;
+    r = std::from_chars(r.ptr + 1, end, sequence);
+    if (r.ec != std::errc() || r.ptr == end || *r.ptr != ' ') return len;
+    r = std::from_chars(r.ptr + 1, end, sent_us);
+    if (r.ec != std::errc() || std::string_view(r.ptr, end - r.ptr).compare(0, 3, "-->") != 0) return len;
+
+    // The stamp ends the datagram; the same text inside the event is content
+    for (p = r.ptr + 3; p < end; p++) {
+        if (*p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') return len;
+    }
+
+    counters.stamped++;
+    track_sequence(source, sequence);
+
+    int64_t latency_us = now_us() - sent_us;
+    if (latency_us >= 0) {
+        double latency_ms = latency_us / 1000.0;
+        total_latency_ms += latency_ms;
+        if (latency_ms > counters.max_latency_ms) counters.max_latency_ms = latency_ms;
+    }
+    return at;
+}
+
+void UdpTransport::track_sequence(uint32_t source, uint64_t sequence) {
+    auto it = sources.find(source);
+    if (it == sources.end()) {
+        sources[source] = SourceState{sequence, 1};
+        return;
+    }
+
+    SourceState& state = it->second;
+    if (sequence > state.highest) {
+        uint64_t gap = sequence - state.highest;
+        counters.lost += gap - 1;
+        state.window = gap >= 64 ? 1 : (state.window << gap) | 1;
+        state.highest = sequence;
+        return;
+    }
+
+    // At or behind the highest sequence seen: a duplicate or a late arrival
+    // that was counted lost when the gap opened
+    uint64_t behind = state.highest - sequence;
+    if (behind < 64 && (state.window & (1ULL << behind))) {
+        counters.duplicates++;
+        return;
+    }
+    counters.reordered++;
+    if (counters.lost > 0) counters.lost--;
+    if (behind < 64) state.window |= 1ULL << behind;
+}
+
+UdpTransport::Stats UdpTransport::stats() const {
+    Stats s = counters;
+    s.sources = sources.size();
+    s.mean_latency_ms = counters.stamped ? total_latency_ms / counters.stamped : 0.0;
+    return s;
+}
+
+} // namespace CoTCommon
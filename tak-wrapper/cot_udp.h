@@ -0,0 +1,131 @@
+#ifndef COT_UDP_H
+#define COT_UDP_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include "cot_common.h"
+
+namespace CoTCommon {
+
+// Plain CoT over UDP, unicast or multicast (e.g. the SA mesh on
+// 239.2.3.1:6969), behind the same interface as the TLS connection.
+//
+// Every event travels in its own datagram. send_data() splits rendered CoT
+// into events and hands up to `batch` datagrams to the kernel per sendmmsg()
+// call; receive_data() pulls up to `batch` datagrams per recvmmsg() call and
+// returns them back to back, ready for a CoTFramer.
+//
+// With stamping enabled each datagram carries a trailing comment after the
+// event, "<!--cot-seq <source> <sequence> <send time us>-->". Receivers use it
+// to count lost, reordered and duplicated datagrams per sender and to measure
+// latency (meaningful when sender and receiver clocks agree), and strip it
+// before the event is framed. Only a stamp that ends the datagram, trailing
+// whitespace aside, counts; the same text inside an event is left alone.
+//
+// Not thread-safe; use one transport per thread.
+class UdpTransport : public CoTTransport {
+public:
+    enum class Mode {
+        SEND,
+        RECEIVE     // Bind the port (and join the group if it is multicast)
+    };
+
+    struct Options {
+        std::string interface_address;        // Multicast interface (IPv4); empty = routing default
+        int ttl = 0;                          // IP TTL; 0 = kernel default (1 for multicast)
+        bool loopback = true;                 // Deliver multicast to receivers on this host
+        int receive_buffer = 8 * 1024 * 1024; // SO_RCVBUF
+        size_t batch = 64;                    // Datagrams per sendmmsg()/recvmmsg()
+        bool stamp = false;                   // Append sequence/time stamps when sending
+    };
+
+    struct Stats {
+        uint64_t datagrams;
+        uint64_t bytes;
+        uint64_t syscalls;          // sendmmsg()/recvmmsg() calls
+        uint64_t truncated;         // Received datagrams larger than the buffer, dropped
+        uint64_t oversized;         // Events too large for one datagram, not sent
+        uint64_t stamped;           // Received datagrams with a sequence stamp
+        uint64_t lost;              // Sequence gaps, net of late arrivals
+        uint64_t reordered;         // Arrived after a later sequence number
+        uint64_t duplicates;
+        size_t sources;             // Distinct stamping senders seen
+        double mean_latency_ms;
+        double max_latency_ms;
+        int receive_buffer;         // SO_RCVBUF granted by the kernel
+    };
+
+    UdpTransport(const std::string& hostname, int udp_port, Mode transport_mode,
+                 const Options& opts, bool verb = false);
+    ~UdpTransport() override;
+
+    UdpTransport(const UdpTransport&) = delete;
+    UdpTransport& operator=(const UdpTransport&) = delete;
+
+    bool connect() override;
+    void disconnect() override;
+    bool is_connected() const override { return socket_fd >= 0; }
+    const std::string& get_host() const override { return host; }
+    int get_port() const override { return port; }
+    int get_socket_fd() const override { return socket_fd; }
+    bool set_nonblocking(bool enabled) override;
+
+    // Send each event in data as its own datagram
+    bool send_data(const std::string& data) override;
+
+    // Send a list of complete events, batched
+    bool send_events(const std::vector<std::string_view>& events);
+
+    // Whole datagrams, back to back; -1 with would_block() when none is ready
+    int receive_data(char* buffer, size_t buffer_size) override;
+    bool would_block(int result) override;
+
+    Stats stats() const;
+
+private:
+    struct SourceState {
+        uint64_t highest;
+        uint64_t window;    // Bit i: highest - i has arrived
+    };
+
+    std::string host;
+    int port;
+    Mode mode;
+    Options options;
+    bool verbose;
+    int socket_fd;
+    int last_errno;
+    bool multicast;
+
+    // Stamping
+    uint32_t source_id;
+    uint64_t next_sequence;
+    std::vector<char> stamp_buffer;
+
+    // recvmmsg() slots, handed out across receive_data() calls
+    std::vector<char> slots;
+    std::vector<struct mmsghdr> messages;
+    std::vector<struct iovec> iovecs;
+    size_t received;
+    size_t next_slot;
+
+    std::vector<std::string_view> split_events;
+    std::unordered_map<uint32_t, SourceState> sources;
+    Stats counters;
+    double total_latency_ms;
+
+    bool open_sender(const struct sockaddr_in& addr);
+    bool open_receiver(const struct sockaddr_in& addr);
+    size_t strip_stamp(const char* data, size_t len);
+    void track_sequence(uint32_t source, uint64_t sequence);
+};
+
+} // namespace CoTCommon
+
+#endif // COT_UDP_H
@@ -26,20 +26,21 @@ if [[ ! -f "$CA_CERT" ]]; then
 fi
 
 # Default parameters
-HOST="localhost"
-PORT="8089"
+HOSTS=()
+PORTS=()
 COUNT="1"
 INTERVAL="1.0"
+EXTRA_ARGS=()
 
 # Parse command line arguments
 while [[ $# -gt 0 ]]; do
     case $1 in
         --host)
-            HOST="$2"
+            HOSTS+=("$2")
             shift 2
             ;;
         --port)
-            PORT="$2"
+            PORTS+=("$2")
             shift 2
             ;;
         --count)
@@ -50,13 +51,28 @@ while [[ $# -gt 0 ]]; do
             INTERVAL="$2"
             shift 2
             ;;
+        --daemon)
+            EXTRA_ARGS+=("--daemon")
+            shift
+            ;;
+        --socket|--via|--schedule|--urgent|--bulk|--budget)
+            EXTRA_ARGS+=("$1" "$2")
+            shift 2
+            ;;
         --help|-h)
             echo "Usage: $0 [options]"
             echo "Options:"
-            echo "  --host <hostname>     TAK server hostname (default: localhost)"
-            echo "  --port <port>         TAK server TCP port (default: 8089)"
+            echo "  --host <hostname>     TAK server hostname (default: localhost, repeatable)"
+            echo "  --port <port>         TAK server TCP port (default: 8089; one, or one per --host)"
             echo "  --count <number>      Number of iterations (default: 1)"
             echo "  --interval <seconds>  Interval between sends (default: 1.0)"
+            echo "  --daemon              Keep the connection open and serve the ingest socket"
+            echo "  --socket <path>       Ingest socket path (default: /tmp/cot_injector.sock)"
+            echo "  --via <path>          Send through a running injector daemon"
+            echo "  --schedule <policy>   Daemon send order: strict, weighted or fifo"
+            echo "  --urgent <type>       Also send this type pattern as urgent"
+            echo "  --bulk <type>         Also coalesce this type pattern as bulk"
+            echo "  --budget <class>=<ms> Latency budget for urgent, routine or bulk"
             echo "  --help, -h           Show this help message"
             echo ""
             echo "This script automatically uses the admin certificate with passphrase."
@@ -71,7 +87,14 @@ while [[ $# -gt 0 ]]; do
 done
 
 echo "Running CoT Injector with admin certificates..."
-echo "Target: $HOST:$PORT"
+# Default target; repeated --host/--port fan out to several servers
+[[ ${#HOSTS[@]} -eq 0 ]] && HOSTS=("localhost")
+[[ ${#PORTS[@]} -eq 0 ]] && PORTS=("8089")
+TARGET_ARGS=()
+for h in "${HOSTS[@]}"; do TARGET_ARGS+=(--host "$h"); done
+for p in "${PORTS[@]}"; do TARGET_ARGS+=(--port "$p"); done
+
+echo "Target: ${HOSTS[*]} (port ${PORTS[*]})"
 echo "Count: $COUNT, Interval: $INTERVAL"
 echo ""
 
@@ -91,11 +114,11 @@ fi
 
 # Run the CoT injector
 build/cot_injector \
-    --host "$HOST" \
-    --port "$PORT" \
+    "${TARGET_ARGS[@]}" \
     --cert "$ADMIN_CERT" \
     --key "$ADMIN_KEY" \
     --ca "$CA_CERT" \
     --passphrase "$PASSPHRASE" \
     --count "$COUNT" \
-    --interval "$INTERVAL"
\ No newline at end of file
+    --interval "$INTERVAL" \
+    "${EXTRA_ARGS[@]}"
\ No newline at end of file
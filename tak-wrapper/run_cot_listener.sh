@@ -26,8 +26,8 @@ if [[ ! -f "$CA_CERT" ]]; then
 fi
 
 # Default parameters
-HOST="localhost"
-PORT="8089"
+HOSTS=()
+PORTS=()
 COMPACT=""
 VERBOSE=""
 FILTER=""
@@ -36,11 +36,11 @@ FILTER=""
 while [[ $# -gt 0 ]]; do
     case $1 in
         --host)
-            HOST="$2"
+            HOSTS+=("$2")
             shift 2
             ;;
         --port)
-            PORT="$2"
+            PORTS+=("$2")
             shift 2
             ;;
         --compact)
@@ -58,8 +58,8 @@ while [[ $# -gt 0 ]]; do
         --help|-h)
             echo "Usage: $0 [options]"
             echo "Options:"
-            echo "  --host <hostname>     TAK server hostname (default: localhost)"
-            echo "  --port <port>         TAK server TCP port (default: 8089)"
+            echo "  --host <hostname>     TAK server hostname (default: localhost); repeat to merge servers"
+            echo "  --port <port>         TAK server TCP port (default: 8089; one, or one per --host)"
             echo "  --compact             Use compact display format"
             echo "  --verbose             Show detailed information and raw XML"
             echo "  --filter <type>       Filter messages by type (e.g., 'a-f' for friendly)"
@@ -84,7 +84,14 @@ while [[ $# -gt 0 ]]; do
 done
 
 echo "Starting CoT Listener with admin certificates..."
-echo "Target: $HOST:$PORT"
+# Default target; repeated --host/--port merge several servers
+[[ ${#HOSTS[@]} -eq 0 ]] && HOSTS=("localhost")
+[[ ${#PORTS[@]} -eq 0 ]] && PORTS=("8089")
+TARGET_ARGS=()
+for h in "${HOSTS[@]}"; do TARGET_ARGS+=(--host "$h"); done
+for p in "${PORTS[@]}"; do TARGET_ARGS+=(--port "$p"); done
+
+echo "Target: ${HOSTS[*]} (port ${PORTS[*]})"
 if [[ -n "$FILTER" ]]; then
     echo "Filter: $FILTER"
 fi
@@ -107,8 +114,7 @@ fi
 
 # Run the CoT listener
 build/cot_listener \
-    --host "$HOST" \
-    --port "$PORT" \
+    "${TARGET_ARGS[@]}" \
     --cert "$ADMIN_CERT" \
     --key "$ADMIN_KEY" \
     --ca "$CA_CERT" \